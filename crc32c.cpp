@@ -0,0 +1,143 @@
+#include "crc32c.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#  define CRC32C_HAVE_X86 1
+#  include <nmmintrin.h>
+#  if defined(_MSC_VER) && !defined(__clang__)
+#    include <intrin.h>
+#  endif
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#  define CRC32C_HAVE_ARM 1
+#  include <arm_acle.h>
+#endif
+
+namespace {
+
+/// 反射形式的 Castagnoli 多项式
+constexpr quint32 kPolynomial = 0x82F63B78u;
+
+struct Crc32cTable {
+    quint32 entries[256];
+    constexpr Crc32cTable() : entries()
+    {
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1u) ? (crc >> 1) ^ kPolynomial : (crc >> 1);
+            }
+            entries[i] = crc;
+        }
+    }
+};
+
+constexpr Crc32cTable kTable;
+
+// 以下实现都只处理"内部状态"，首尾取反由 Crc32c::extend 统一完成。
+quint32 extendSoftware(quint32 crc, const uchar* p, qint64 len)
+{
+    while (len-- > 0) {
+        crc = kTable.entries[(crc ^ *p++) & 0xFFu] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef CRC32C_HAVE_X86
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((target("sse4.2")))
+#endif
+quint32 extendSse42(quint32 crc, const uchar* p, qint64 len)
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    quint64 crc64 = crc;
+    while (len >= 8) {
+        quint64 word;
+        std::memcpy(&word, p, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+        p += 8;
+        len -= 8;
+    }
+    crc = static_cast<quint32>(crc64);
+#endif
+    while (len >= 4) {
+        quint32 word;
+        std::memcpy(&word, p, sizeof(word));
+        crc = _mm_crc32_u32(crc, word);
+        p += 4;
+        len -= 4;
+    }
+    while (len-- > 0) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+
+bool cpuHasSse42()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4] = {0, 0, 0, 0};
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+#endif
+}
+#endif // CRC32C_HAVE_X86
+
+#ifdef CRC32C_HAVE_ARM
+quint32 extendArmv8(quint32 crc, const uchar* p, qint64 len)
+{
+    while (len >= 8) {
+        quint64 word;
+        std::memcpy(&word, p, sizeof(word));
+        crc = __crc32cd(crc, word);
+        p += 8;
+        len -= 8;
+    }
+    while (len-- > 0) {
+        crc = __crc32cb(crc, *p++);
+    }
+    return crc;
+}
+#endif // CRC32C_HAVE_ARM
+
+using ExtendFn = quint32 (*)(quint32, const uchar*, qint64);
+
+ExtendFn selectImplementation()
+{
+#ifdef CRC32C_HAVE_X86
+    if (cpuHasSse42()) {
+        return &extendSse42;
+    }
+#endif
+#ifdef CRC32C_HAVE_ARM
+    return &extendArmv8;
+#endif
+    return &extendSoftware;
+}
+
+ExtendFn implementation()
+{
+    // 首次调用时探测一次 CPU 特性，之后直接走函数指针
+    static const ExtendFn fn = selectImplementation();
+    return fn;
+}
+
+} // namespace
+
+quint32 Crc32c::extend(quint32 crc, const char* data, qint64 len)
+{
+    if (!data || len <= 0) {
+        return crc;
+    }
+    return ~implementation()(~crc, reinterpret_cast<const uchar*>(data), len);
+}
+
+bool Crc32c::hardwareAccelerated()
+{
+    return implementation() != &extendSoftware;
+}
@@ -0,0 +1,40 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <QtGlobal>
+#include <QByteArray>
+
+/**
+ * @brief CRC32C（Castagnoli 多项式 0x1EDC6F41）校验。
+ *
+ * 用于分片文件的分块完整性检查点（见 HttpWorker 的 .crc 旁路文件）。
+ * 运行时选择实现：
+ *   - x86/x64：CPU 支持 SSE4.2 时使用 crc32 指令（_mm_crc32_u64/u8）；
+ *   - ARMv8：编译器开启 CRC 扩展（__ARM_FEATURE_CRC32）时使用 __crc32cd/__crc32cb；
+ *   - 其它情况回退到查表实现。
+ * 各实现结果一致，可以混用（例如旧机器写、新机器读）。
+ */
+class Crc32c
+{
+public:
+    /**
+     * @brief 在已有 CRC 上继续累加一段数据。
+     * @param crc 之前的结果（首次传 0）。
+     * @param data 数据指针。
+     * @param len 数据长度。
+     * @return 累加后的 CRC32C；extend(extend(0, a), b) == compute(a + b)。
+     */
+    static quint32 extend(quint32 crc, const char* data, qint64 len);
+
+    /**
+     * @brief 计算整段数据的 CRC32C。
+     */
+    static quint32 compute(const QByteArray& data) { return extend(0, data.constData(), data.size()); }
+
+    /**
+     * @brief 当前进程是否走硬件加速路径（日志/诊断用）。
+     */
+    static bool hardwareAccelerated();
+};
+
+#endif // CRC32C_H
@@ -0,0 +1,171 @@
+#include "downloadercore.h"
+#include "downloadmanager.h"
+#include "settingsmanager.h"
+#include "logger.h"
+
+DownloaderCore& DownloaderCore::instance()
+{
+    static DownloaderCore instance;
+    return instance;
+}
+
+DownloaderCore::DownloaderCore(QObject* parent)
+    : QObject(parent)
+    , m_manager(DownloadManager::instance())
+{
+    connect(&m_manager, &DownloadManager::telemetryUpdated, this, &DownloaderCore::onTelemetryUpdated);
+    connect(&m_manager, &DownloadManager::taskFinished, this, &DownloaderCore::onTaskFinished);
+    connect(&m_manager, &DownloadManager::taskError, this, &DownloaderCore::onTaskError);
+}
+
+DownloaderCore::TaskId DownloaderCore::createTask(const QUrl& url, const QString& savePath,
+                                                  int threadCount, bool autoStart)
+{
+    const QString scheme = url.scheme().toLower();
+    if (!url.isValid() || (scheme != "http" && scheme != "https")) {
+        LOGD(QString("DownloaderCore: 拒绝无效 URL %1").arg(url.toString()));
+        return 0;
+    }
+
+    SettingsManager& settings = SettingsManager::instance();
+    const QString finalSavePath = DownloadManager::resolveSavePath(url, savePath,
+                                                                   settings.loadDefaultDownloadPath());
+    const int threads = threadCount > 0 ? threadCount : settings.loadDefaultThreads();
+
+    DownloadTask* task = m_manager.createTask(url, finalSavePath, threads);
+    if (!task) {
+        return 0;
+    }
+
+    const TaskId id = task->id();
+    m_tasks.insert(id, task);
+    LOGD(QString("DownloaderCore: 任务 %1 -> %2").arg(id).arg(finalSavePath));
+
+    if (autoStart) {
+        m_manager.startTask(task);
+    }
+    return id;
+}
+
+bool DownloaderCore::start(TaskId id)
+{
+    DownloadTask* task = taskFor(id);
+    if (!task) return false;
+    m_manager.startTask(task);
+    return true;
+}
+
+bool DownloaderCore::pause(TaskId id)
+{
+    DownloadTask* task = taskFor(id);
+    if (!task) return false;
+    m_manager.pauseTask(task);
+    return true;
+}
+
+bool DownloaderCore::resume(TaskId id)
+{
+    DownloadTask* task = taskFor(id);
+    if (!task) return false;
+    m_manager.resumeTask(task);
+    return true;
+}
+
+bool DownloaderCore::cancel(TaskId id, bool deleteTempFiles)
+{
+    DownloadTask* task = taskFor(id);
+    if (!task) return false;
+    m_manager.cancelTask(task, deleteTempFiles);
+    return true;
+}
+
+bool DownloaderCore::setPriority(TaskId id, int priority)
+{
+    DownloadTask* task = taskFor(id);
+    if (!task) return false;
+    m_manager.setTaskPriority(task, priority);
+    return true;
+}
+
+bool DownloaderCore::progress(TaskId id, Progress* out) const
+{
+    const DownloadTask* task = taskFor(id);
+    if (!task || !out) return false;
+
+    // 原子读，和遥测周期里的数值一致（下载量/速度由遥测采样写入）
+    Progress p;
+    p.id = id;
+    p.status = task->status();
+    p.finalizing = task->finalizePhase() != FinalizePhase::None;
+    p.downloadedBytes = task->downloadedSize();
+    p.totalBytes = task->totalSize();
+    p.speed = task->downloadSpeed();
+    p.etaSeconds = task->etaSeconds();
+    p.percent = p.finalizing ? task->finalizePercentage() : task->progressPercentage();
+    p.filePath = task->filePath();
+    *out = p;
+    return true;
+}
+
+QList<DownloaderCore::TaskId> DownloaderCore::tasks() const
+{
+    QList<TaskId> ids;
+    ids.reserve(m_tasks.size());
+    for (auto it = m_tasks.cbegin(); it != m_tasks.cend(); ++it) {
+        if (it.value()) ids.append(it.key());
+    }
+    return ids;
+}
+
+void DownloaderCore::onTelemetryUpdated(const QList<TaskTelemetry>& snapshot)
+{
+    if (m_tasks.isEmpty()) return;
+
+    QList<Progress> batch;
+    for (const TaskTelemetry& sample : snapshot) {
+        if (!sample.task || !m_tasks.contains(sample.task->id())) {
+            continue; // GUI 等其它入口建的任务不在本接口范围内
+        }
+
+        Progress p;
+        p.id = sample.task->id();
+        p.status = sample.status;
+        p.finalizing = sample.phase != FinalizePhase::None;
+        p.downloadedBytes = sample.downloadedBytes;
+        p.totalBytes = sample.totalBytes;
+        p.speed = sample.speed;
+        p.etaSeconds = sample.etaSeconds;
+        p.percent = sample.percent;
+        p.filePath = sample.task->filePath();
+        batch.append(p);
+    }
+    if (!batch.isEmpty()) {
+        emit progressUpdated(batch);
+    }
+}
+
+void DownloaderCore::onTaskFinished(DownloadTask* task)
+{
+    // DownloadTask::finished 只在完成与取消时发出
+    retire(task, task->status(), QString());
+}
+
+void DownloaderCore::onTaskError(DownloadTask* task, const QString& errorString)
+{
+    retire(task, DownloadTaskStatus::Failed, errorString);
+}
+
+DownloadTask* DownloaderCore::taskFor(TaskId id) const
+{
+    const auto it = m_tasks.constFind(id);
+    return it == m_tasks.cend() ? nullptr : it.value().data();
+}
+
+void DownloaderCore::retire(DownloadTask* task, DownloadTaskStatus status, const QString& errorString)
+{
+    // DownloadManager 在发出信号后才 deleteLater，这里的 task 在本次派发内有效
+    const TaskId id = task->id();
+    if (!m_tasks.remove(id)) return;
+
+    emit taskFinished(id, status, errorString);
+}
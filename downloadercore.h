@@ -0,0 +1,159 @@
+#ifndef DOWNLOADERCORE_H
+#define DOWNLOADERCORE_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QString>
+#include <QUrl>
+#include "downloadtask.h"
+
+class DownloadManager;
+
+/**
+ * @brief downloader_core 库对外的精简接口：建任务、看进度、暂停、继续、取消。
+ *
+ * 供嵌入方（自建的制品拉取工具、基准、无界面进程）使用，不需要了解 DownloadTask /
+ * HttpWorker 的生命周期：任务用稳定的 TaskId 引用，任务结束后 DownloadManager 释放
+ * DownloadTask 对象，TaskId 只是不再有效，不会留下悬空指针。
+ *
+ * 前提：进程里已有 QCoreApplication（或其子类）且运行事件循环；所有调用都在主线程。
+ * 进度沿用 DownloadManager 的遥测节拍（每个周期一批 progressUpdated），
+ * 也可以随时用 progress() 主动读取一次。
+ */
+class DownloaderCore : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// 任务标识，即 DownloadTask::id()（单调递增，从 1 开始）；0 表示无效。
+    using TaskId = quint64;
+
+    /**
+     * @brief 任务进度快照（值类型，可以随意拷贝、跨线程传递）。
+     */
+    struct Progress {
+        TaskId id = 0;                                       ///< 任务标识。
+        DownloadTaskStatus status = DownloadTaskStatus::Pending; ///< 任务状态。
+        bool finalizing = false;                             ///< 是否处于合并/移动/清理阶段。
+        qint64 downloadedBytes = 0;                          ///< 已下载（收尾期间为已合并）字节数。
+        qint64 totalBytes = 0;                               ///< 总字节数（未知时为 0）。
+        qint64 speed = 0;                                    ///< 平滑后的速度（字节/秒）。
+        qint64 etaSeconds = -1;                              ///< 预计剩余秒数，未知时为 -1。
+        int percent = 0;                                     ///< 进度百分比（收尾期间为收尾进度）。
+        QString filePath;                                    ///< 最终保存路径。
+    };
+
+    /**
+     * @brief 获取单例（首次调用时一并创建 DownloadManager）。
+     */
+    static DownloaderCore& instance();
+
+    DownloaderCore(const DownloaderCore&) = delete;
+    DownloaderCore& operator=(const DownloaderCore&) = delete;
+
+    /**
+     * @brief 创建下载任务。
+     * @param url 下载地址（仅 http/https）。
+     * @param savePath 保存路径；可以是完整文件路径、目录或空（按 DownloadManager::resolveSavePath 归一化，
+     *                 默认目录取 SettingsManager 的下载目录）。
+     * @param threadCount 分片线程数；<= 0 时使用设置中的默认线程数。
+     * @param autoStart 是否立即开始。
+     * @return 任务标识；URL 无效或创建失败返回 0。
+     */
+    TaskId createTask(const QUrl& url, const QString& savePath = QString(),
+                      int threadCount = 0, bool autoStart = true);
+
+    /**
+     * @brief 开始一个以 autoStart = false 创建的任务。
+     * @return 任务仍存在时返回 true。
+     */
+    bool start(TaskId id);
+
+    /**
+     * @brief 暂停（不阻塞，worker 确认停止后状态变为 Paused）。
+     * @return 任务仍存在时返回 true。
+     */
+    bool pause(TaskId id);
+
+    /**
+     * @brief 继续已暂停或失败的任务。
+     * @return 任务仍存在时返回 true。
+     */
+    bool resume(TaskId id);
+
+    /**
+     * @brief 取消任务。
+     * @param deleteTempFiles 是否删除已下载的临时分片。
+     * @return 任务仍存在时返回 true。
+     */
+    bool cancel(TaskId id, bool deleteTempFiles = true);
+
+    /**
+     * @brief 调整调度优先级（越大越优先，默认 0）。
+     * @return 任务仍存在时返回 true。
+     */
+    bool setPriority(TaskId id, int priority);
+
+    /**
+     * @brief 立即读取一次任务进度。
+     * @param id 任务标识。
+     * @param out 输出快照。
+     * @return 任务仍存在时返回 true；已结束或不存在时返回 false，out 不变。
+     */
+    bool progress(TaskId id, Progress* out) const;
+
+    /**
+     * @brief 当前仍存在（未结束）的任务标识。
+     */
+    QList<TaskId> tasks() const;
+
+signals:
+    /**
+     * @brief 每个遥测周期发一次，包含本周期所有由本接口创建且仍在运行的任务。
+     */
+    void progressUpdated(const QList<DownloaderCore::Progress>& snapshot);
+
+    /**
+     * @brief 任务结束（完成、取消或失败），之后 id 不再有效。
+     * @param id 任务标识。
+     * @param status 最终状态（Completed / Cancelled / Failed）。
+     * @param errorString 失败原因，非失败时为空。
+     */
+    void taskFinished(DownloaderCore::TaskId id, DownloadTaskStatus status, const QString& errorString);
+
+private slots:
+    /**
+     * @brief 把 DownloadManager 的遥测批次转换为本接口任务的进度快照。
+     */
+    void onTelemetryUpdated(const QList<TaskTelemetry>& snapshot);
+
+    /**
+     * @brief DownloadManager::taskFinished（完成或取消）。
+     */
+    void onTaskFinished(DownloadTask* task);
+
+    /**
+     * @brief DownloadManager::taskError（失败）。
+     */
+    void onTaskError(DownloadTask* task, const QString& errorString);
+
+private:
+    explicit DownloaderCore(QObject* parent = nullptr);
+
+    /**
+     * @brief 按 id 取任务；已释放或不存在时返回 nullptr。
+     */
+    DownloadTask* taskFor(TaskId id) const;
+
+    /**
+     * @brief 任务结束：从表里移除并发射 taskFinished。
+     */
+    void retire(DownloadTask* task, DownloadTaskStatus status, const QString& errorString);
+
+    DownloadManager& m_manager;                         ///< 下层调度器。
+    QHash<TaskId, QPointer<DownloadTask>> m_tasks;      ///< 经本接口创建的任务（QPointer 防任务被释放后悬空）。
+};
+
+#endif // DOWNLOADERCORE_H
@@ -0,0 +1,139 @@
+#include "settingsmanager.h"
+#include "historymanager.h"
+#include "schedulemanager.h"
+#include "downloadmanager.h"
+#include "downloadtask.h"
+#include "httpserver.h"
+#include "terminationsignal.h"
+#include "logger.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QDebug>
+#include <QDir>
+#include <QUrl>
+
+/**
+ * @brief downloaderd：无界面守护进程入口。
+ *
+ * 与 GUI 共用 DownloadManager / ScheduleManager / HistoryManager / HttpServer，
+ * 只依赖 Qt Core/Network，适合作为 systemd 服务或在无桌面的 NAS、服务器上运行。
+ * 配置沿用 GUI 写入的 QSettings（同一组织名/应用名），命令行参数只做本次运行的覆盖；
+ * SIGTERM/SIGINT 走与 GUI 退出相同的检查点流程，重启后由 restoreQueue() 接续。
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    // 与 GUI 保持一致，共享同一份 QSettings 和 AppData 目录
+    QCoreApplication::setOrganizationName("Programming666");
+    QCoreApplication::setApplicationName("Downloader");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Programming666 multi-thread downloader (headless daemon)");
+    parser.addHelpOption();
+    QCommandLineOption optPort(QStringLiteral("port"),
+                               QStringLiteral("Control port for the HTTP server (overrides settings)."),
+                               QStringLiteral("port"));
+    QCommandLineOption optDir(QStringLiteral("download-dir"),
+                              QStringLiteral("Default download directory (overrides settings, not persisted)."),
+                              QStringLiteral("dir"));
+    QCommandLineOption optThreads(QStringLiteral("threads"),
+                                  QStringLiteral("Threads per task (overrides settings, not persisted)."),
+                                  QStringLiteral("n"));
+    parser.addOption(optPort);
+    parser.addOption(optDir);
+    parser.addOption(optThreads);
+    parser.process(a);
+
+    // 预热单例（顺序与 GUI 入口一致）
+    SettingsManager& settings = SettingsManager::instance();
+    HistoryManager::instance();
+    ScheduleManager::instance();
+    DownloadManager& manager = DownloadManager::instance();
+
+    quint16 listenPort = settings.loadLocalListenPort();
+    if (parser.isSet(optPort)) {
+        bool ok = false;
+        const uint port = parser.value(optPort).toUInt(&ok);
+        if (!ok || port == 0 || port > 65535) {
+            qCritical() << "Invalid --port value:" << parser.value(optPort);
+            return 1;
+        }
+        listenPort = static_cast<quint16>(port);
+    }
+
+    const QString downloadDir = parser.isSet(optDir)
+        ? QDir(parser.value(optDir)).absolutePath()
+        : settings.loadDefaultDownloadPath();
+    if (!QDir().mkpath(downloadDir)) {
+        qCritical() << "Cannot create download directory:" << downloadDir;
+        return 1;
+    }
+
+    int threads = settings.loadDefaultThreads();
+    if (parser.isSet(optThreads)) {
+        bool ok = false;
+        const int n = parser.value(optThreads).toInt(&ok);
+        if (!ok || n <= 0) {
+            qCritical() << "Invalid --threads value:" << parser.value(optThreads);
+            return 1;
+        }
+        threads = n;
+    }
+
+    LOGD(QString("downloaderd: 下载目录 %1，每任务 %2 线程").arg(downloadDir).arg(threads));
+
+    // 任务结果只写日志；历史记录由 DownloadTask 自己落盘
+    QObject::connect(&manager, &DownloadManager::taskFinished, &a, [](DownloadTask* task) {
+        qInfo() << "Download finished:" << task->filePath();
+    });
+    QObject::connect(&manager, &DownloadManager::taskError, &a,
+                     [](DownloadTask* task, const QString& errorString) {
+        qWarning() << "Download failed:" << task->url() << errorString;
+    });
+
+    // SIGTERM（systemctl stop）等终止请求走 DownloadManager::shutdown 的快速检查点
+    TerminationSignal::install();
+
+    // 恢复上次退出时未完成的任务
+    manager.restoreQueue();
+
+    // 控制面：浏览器插件 / 脚本通过 HttpServer 投递下载请求
+    HttpServer httpServer;
+    // 批量投递由 HttpServer 直接入队，沿用本次运行的目录/线程数覆盖
+    httpServer.setDownloadDefaults(downloadDir, threads);
+    if (!httpServer.startServer(listenPort)) {
+        qCritical() << "Failed to start HTTP server on port" << listenPort;
+        return 1;
+    }
+    LOGD(QString("downloaderd: HTTP server listening on port %1").arg(listenPort));
+
+    QObject::connect(&httpServer, &HttpServer::newDownloadRequest, &a,
+                     [&manager, downloadDir, threads](const QString& url, const QString& savePath,
+                                                      const QList<QHostAddress>& addresses) {
+        // 与 GUI 相同：只接受 http/https
+        if (!(url.startsWith("http://") || url.startsWith("https://"))) {
+            qWarning() << "Rejected download request with invalid URL:" << url;
+            return;
+        }
+        const QUrl urlObj(url);
+        const QString finalSavePath = DownloadManager::resolveSavePath(urlObj, savePath, downloadDir);
+        LOGD(QString("downloaderd: 解析 savePath:%1 -> finalSavePath:%2").arg(savePath, finalSavePath));
+        // 无界面进程可能被脚本灌进大量请求：先排队，按活动任务上限逐个建任务
+        manager.enqueue(urlObj, finalSavePath, threads, addresses);
+    });
+
+    // 定时任务
+    QObject::connect(ScheduleManager::instance(), &ScheduleManager::scheduledTaskTriggered, &a,
+                     [&manager, downloadDir, threads](const ScheduledTask& scheduled) {
+        const ScheduledTask taskCopy = scheduled;
+        LOGD(QString("downloaderd: 定时任务触发 - 文件:%1 URL:%2").arg(taskCopy.fileName, taskCopy.url));
+        const QUrl urlObj(taskCopy.url);
+        const QString finalSavePath = DownloadManager::resolveSavePath(urlObj, taskCopy.savePath, downloadDir);
+        manager.enqueue(urlObj, finalSavePath, threads);
+    });
+
+    return a.exec();
+}
@@ -1,15 +1,101 @@
 #include "downloadmanager.h"
 #include "logger.h"
 #include "settingsmanager.h"
+#include "urlmetadatacache.h"
+#include "hostprofilestore.h"
+#include "smallfilefetcher.h"
 #include <QDebug>
 #include <QPointer>
 #include <QMutex>
 #include <QMutexLocker>
 #include <QMetaObject>
+#include <QStorageInfo>
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QSet>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <algorithm>
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <unistd.h>
+#endif
 
 namespace {
     // 保护 m_tasks 的并发访问（task 创建/移除可能跨线程触发）
     QMutex g_tasksMutex;
+
+    /// 准入时额外保留的余量，留给文件系统元数据、检查点等小文件
+    constexpr qint64 kDiskSpaceSafetyMargin = 64LL * 1024 * 1024;
+
+    /// 等待磁盘空间的任务的重试间隔
+    constexpr int kDiskSpaceRetryIntervalMs = 30 * 1000;
+
+    /// 遥测采样间隔：进度/速度/ETA 的刷新频率，与任务数量无关
+    constexpr int kTelemetryIntervalMs = 500;
+
+    // 在 target 处放一份 source：同一文件系统上建硬链接（不占额外空间），否则复制。
+    // 已存在的 target 与 DownloadTask 移动最终文件时一样先删除。
+    bool linkOrCopy(const QString& source, const QString& target)
+    {
+        const QFileInfo targetInfo(target);
+        if (!targetInfo.dir().exists() && !targetInfo.dir().mkpath(".")) {
+            return false;
+        }
+        if (!QFile::remove(target) && QFileInfo::exists(target)) {
+            return false;
+        }
+#ifdef _WIN32
+        if (CreateHardLinkW(reinterpret_cast<LPCWSTR>(QDir::toNativeSeparators(target).utf16()),
+                            reinterpret_cast<LPCWSTR>(QDir::toNativeSeparators(source).utf16()), nullptr)) {
+            return true;
+        }
+#else
+        if (::link(QFile::encodeName(source).constData(), QFile::encodeName(target).constData()) == 0) {
+            return true;
+        }
+#endif
+        return QFile::copy(source, target);
+    }
+
+    QByteArray journalLineOf(const QJsonObject& obj)
+    {
+        return QJsonDocument(obj).toJson(QJsonDocument::Compact) + '\n';
+    }
+
+    // 钉住的地址写成字符串数组；没有钉住时不写这个字段
+    void writeAddresses(QJsonObject& entry, const QList<QHostAddress>& addresses)
+    {
+        if (addresses.isEmpty()) {
+            return;
+        }
+        QJsonArray array;
+        for (const QHostAddress& address : addresses) {
+            array.append(address.toString());
+        }
+        entry["addresses"] = array;
+    }
+
+    QList<QHostAddress> readAddresses(const QJsonObject& entry)
+    {
+        QList<QHostAddress> addresses;
+        for (const QJsonValue& value : entry.value("addresses").toArray()) {
+            const QHostAddress address(value.toString());
+            if (!address.isNull()) {
+                addresses.append(address);
+            }
+        }
+        return addresses;
+    }
 }
 
 /**
@@ -35,12 +121,33 @@ DownloadManager::DownloadManager(QObject *parent)
     m_threadPool->setMaxThreadCount(maxThreads);
     LOGD(QString("线程池最大线程数设置完成:%1").arg(m_threadPool->maxThreadCount()));
 
+    // 收尾线程池：合并是顺序磁盘 IO，线程数不必多，但至少 2 个，保证一个大文件
+    // 合并时其它任务的收尾不会排队等它。
+    m_finalizePool = new QThreadPool(this);
+    m_finalizePool->setMaxThreadCount(qMax(2, QThread::idealThreadCount() / 2));
+    LOGD(QString("收尾线程池最大线程数:%1").arg(m_finalizePool->maxThreadCount()));
+
     // 监听设置变更广播：当代理/线程数/默认路径等被 SettingsDialog 写入时，
     // 自动把新代理推送给所有活动 DownloadTask。线程数变更只对后续新建任务
     // 生效——in-flight 任务的 worker 数量不能中途改变。
     connect(&SettingsManager::instance(), &SettingsManager::settingsChanged,
             this, &DownloadManager::onSettingsChanged);
 
+    m_diskSpaceRetryTimer.setInterval(kDiskSpaceRetryIntervalMs);
+    connect(&m_diskSpaceRetryTimer, &QTimer::timeout, this, &DownloadManager::processDiskSpaceQueue);
+
+    m_telemetryTimer.setInterval(kTelemetryIntervalMs);
+    connect(&m_telemetryTimer, &QTimer::timeout, this, &DownloadManager::onTelemetryTick);
+
+    m_journalTimer.setSingleShot(true);
+    m_journalTimer.setInterval(kQueueJournalDelayMs);
+    connect(&m_journalTimer, &QTimer::timeout, this, &DownloadManager::flushQueueJournal);
+
+    // 退出时（托盘退出、File->Exit、SIGTERM 触发的 quit）统一走快速检查点
+    if (QCoreApplication::instance()) {
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, [this]() { shutdown(); });
+    }
+
     LOGD("DownloadManager初始化完成");
 }
 
@@ -48,14 +155,6 @@ DownloadManager::~DownloadManager()
 {
     LOGD(QString("开始销毁DownloadManager，当前任务数:%1").arg(m_tasks.size()));
 
-    // 等待所有任务完成（带超时，避免永久阻塞）
-    LOGD("等待线程池中的任务完成（超时5秒）...");
-    if (!m_threadPool->waitForDone(5000)) {
-        LOGD("线程池等待超时，强制继续清理");
-    } else {
-        LOGD("线程池中的任务已全部完成");
-    }
-
     // 用 QPointer 复制当前任务列表并加锁访问，避免其他线程并发修改 m_tasks 时 UAF；
     // 删除前显式 disconnect + blockSignals 防止回调触发到正在销毁的对象上。
     QList<QPointer<DownloadTask>> snapshot;
@@ -77,6 +176,10 @@ DownloadManager::~DownloadManager()
     LOGD("开始删除所有任务对象...");
     qDeleteAll(m_tasks);
     m_tasks.clear();
+
+    // 不再先 waitForDone 等 worker 跑完：任务析构时已把排队中的 worker 从线程池撤回，
+    // 运行中的 worker 收到 abort 后很快退出 run()。QThreadPool 作为子对象析构时
+    // 只需等这些正在退出的 run()。
     LOGD("DownloadManager销毁完成");
 }
 
@@ -101,20 +204,81 @@ DownloadManager& DownloadManager::instance()
 DownloadTask* DownloadManager::createTask(const QUrl& url, const QString& savePath, int threadCount)
 {
     LOGD(QString("开始创建任务 - URL:%1 保存路径:%2 线程数:%3").arg(url.toString()).arg(savePath).arg(threadCount));
-    
+
+    // 同一资源已有活动任务：合并到它，而不是再开一份传输
+    // （已取消/失败、只是还没从列表移除的任务不算）
+    const QString key = taskKey(url);
+    DownloadTask* existing = m_taskIndex.value(key);
+    if (existing && existing->status() != DownloadTaskStatus::Cancelled
+        && existing->status() != DownloadTaskStatus::Failed) {
+        const QString target = QDir::cleanPath(savePath);
+        if (target != QDir::cleanPath(existing->filePath())) {
+            QStringList& mirrors = m_mirrors[existing];
+            if (!mirrors.contains(target)) {
+                mirrors.append(target);
+            }
+        }
+        LOGD(QString("重复请求合并到任务 %1：%2 -> %3").arg(existing->id()).arg(url.toString(), savePath));
+        return existing;
+    }
+
+    // 同一资源还在排队：提前出队，用条目的编号建任务，外部已经拿到的编号继续有效
+    const auto queued = m_queueIndex.constFind(key);
+    if (queued != m_queueIndex.cend()) {
+        QueuedTask entry = takeQueued(queued.value());
+        LOGD(QString("排队条目 %1 被直接请求，提前建任务").arg(entry.id));
+        DownloadTask* task = addTask(entry.url, entry.filePath, entry.threadCount, entry.id);
+        task->setPinnedAddresses(entry.addresses);
+        task->setPriority(entry.priority);
+        const QString target = QDir::cleanPath(savePath);
+        if (target != QDir::cleanPath(entry.filePath) && !entry.mirrors.contains(target)) {
+            entry.mirrors.append(target);
+        }
+        if (!entry.mirrors.isEmpty()) {
+            m_mirrors.insert(task, entry.mirrors);
+        }
+        journalQueueEntry(task->id());
+        emit queueChanged(int(m_queue.size()));
+        return task;
+    }
+
+    DownloadTask* task = addTask(url, savePath, threadCount, 0);
+    journalQueueEntry(task->id());
+    return task;
+}
+
+DownloadTask* DownloadManager::addTask(const QUrl& url, const QString& savePath, int threadCount, quint64 id)
+{
     LOGD("开始创建DownloadTask对象...");
-    DownloadTask* task = new DownloadTask(url, savePath, threadCount);
+    DownloadTask* task = new DownloadTask(url, savePath, threadCount, id);
     LOGD(QString("DownloadTask对象创建完成，任务指针:%1").arg(task ? "有效" : "空"));
     
-    m_tasks.append(task);
+    {
+        QMutexLocker locker(&g_tasksMutex);
+        m_tasks.insert(task->id(), task);
+    }
+    m_taskIndex.insert(taskKey(url), task);
     LOGD(QString("任务已添加到任务列表，总任务数:%1").arg(m_tasks.size()));
 
+    if (!m_telemetryTimer.isActive()) {
+        m_telemetryClock.start();
+        m_telemetryTimer.start();
+    }
+
     LOGD("开始连接任务信号...");
     // 使用 QueuedConnection 强制跨线程安全派发；
     // DownloadTask 的 finished/error 可能在子线程触发，但 DownloadManager 可能在主线程
     // （取决于线程亲和性），用 QueuedConnection 可以避免跨线程直接派发到正在析构的对象。
     connect(task, &DownloadTask::finished, this, &DownloadManager::onTaskFinished, Qt::QueuedConnection);
     connect(task, &DownloadTask::error, this, &DownloadManager::onTaskError, Qt::QueuedConnection);
+    // 暂停让出一个活动名额，由队列补位；暂停/恢复也要记进队列日志
+    const quint64 taskId = task->id();
+    connect(task, &DownloadTask::statusChanged, this, [this, taskId](DownloadTaskStatus status) {
+        if (status == DownloadTaskStatus::Paused && !m_queue.isEmpty()) {
+            pumpQueue();
+        }
+        journalQueueEntry(taskId);
+    }, Qt::QueuedConnection);
     LOGD("任务信号连接完成");
     
     LOGD("准备发射taskAdded信号...");
@@ -173,12 +337,337 @@ void DownloadManager::cancelTask(DownloadTask* task, bool deleteFile)
     }
 }
 
+void DownloadManager::setTaskPriority(DownloadTask* task, int priority)
+{
+    if (task) {
+        task->setPriority(priority);
+        journalQueueEntry(task->id());
+    }
+}
+
+QList<DownloadTask*> DownloadManager::tasks() const
+{
+    QList<DownloadTask*> tasks;
+    {
+        QMutexLocker locker(&g_tasksMutex);
+        tasks = m_tasks.values();
+    }
+    std::sort(tasks.begin(), tasks.end(), [](const DownloadTask* a, const DownloadTask* b) {
+        return a->id() < b->id();
+    });
+    return tasks;
+}
+
+DownloadTask* DownloadManager::findTask(quint64 id) const
+{
+    QMutexLocker locker(&g_tasksMutex);
+    return m_tasks.value(id, nullptr);
+}
+
+quint64 DownloadManager::enqueue(const QUrl& url, const QString& savePath, int threadCount,
+                                 const QList<QHostAddress>& addresses, int priority)
+{
+    const QString key = taskKey(url);
+    const QString target = QDir::cleanPath(savePath);
+
+    // 与活动任务重复：交给 createTask 的合并逻辑
+    DownloadTask* existing = m_taskIndex.value(key);
+    if (existing && existing->status() != DownloadTaskStatus::Cancelled
+        && existing->status() != DownloadTaskStatus::Failed) {
+        return createTask(url, savePath, threadCount)->id();
+    }
+
+    // 与排队条目重复：登记附加目标
+    const auto queued = m_queueIndex.constFind(key);
+    if (queued != m_queueIndex.cend()) {
+        QueuedTask& entry = m_queue[queued.value()];
+        if (target != QDir::cleanPath(entry.filePath) && !entry.mirrors.contains(target)) {
+            entry.mirrors.append(target);
+        }
+        LOGD(QString("重复请求合并到排队条目 %1：%2 -> %3").arg(entry.id).arg(url.toString(), savePath));
+        return entry.id;
+    }
+
+    QueuedTask entry;
+    entry.id = DownloadTask::allocateId();
+    entry.url = url;
+    entry.filePath = savePath;
+    entry.threadCount = qMax(1, threadCount);
+    entry.priority = priority;
+    entry.addresses = addresses;
+    const quint64 id = entry.id;
+    m_queueOrder.emplace(-priority, id);
+    m_queueIndex.insert(key, id);
+    m_queue.insert(id, std::move(entry));
+
+    journalQueueEntry(id);
+    emit taskQueued(m_queue.value(id));
+    pumpQueue();
+    emit queueChanged(int(m_queue.size()));
+    return id;
+}
+
+QList<QueuedTask> DownloadManager::queuedTasks() const
+{
+    QList<QueuedTask> entries;
+    entries.reserve(qsizetype(m_queueOrder.size()));
+    for (const auto& slot : m_queueOrder) {
+        entries.append(m_queue.value(slot.second));
+    }
+    return entries;
+}
+
+bool DownloadManager::findQueued(quint64 id, QueuedTask* out) const
+{
+    const auto it = m_queue.constFind(id);
+    if (it == m_queue.cend()) {
+        return false;
+    }
+    if (out) {
+        *out = it.value();
+    }
+    return true;
+}
+
+bool DownloadManager::isSavePathTaken(const QUrl& url, const QString& savePath) const
+{
+    const QString key = taskKey(url);
+    const QString target = QDir::cleanPath(savePath);
+
+    // 已取消/失败、只是还没从列表移除的任务不再写目标文件；命中合并键的任务会合并，不算占用
+    const DownloadTask* merged = m_taskIndex.value(key);
+    const QList<DownloadTask*> active = tasks();
+    for (DownloadTask* task : active) {
+        if (task == merged || task->status() == DownloadTaskStatus::Cancelled
+            || task->status() == DownloadTaskStatus::Failed) {
+            continue;
+        }
+        if (target == QDir::cleanPath(task->filePath()) || m_mirrors.value(task).contains(target)) {
+            return true;
+        }
+    }
+    for (const QueuedTask& entry : m_queue) {
+        if (taskKey(entry.url) != key
+            && (target == QDir::cleanPath(entry.filePath) || entry.mirrors.contains(target))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DownloadManager::cancelQueued(quint64 id)
+{
+    if (!m_queue.contains(id)) {
+        return false;
+    }
+    takeQueued(id);
+    LOGD(QString("排队条目 %1 已取消").arg(id));
+    emit queuedTaskCancelled(id);
+    emit queueChanged(int(m_queue.size()));
+    journalQueueEntry(id);
+    return true;
+}
+
+bool DownloadManager::setQueuedPriority(quint64 id, int priority)
+{
+    const auto it = m_queue.find(id);
+    if (it == m_queue.end()) {
+        return false;
+    }
+    m_queueOrder.erase({-it->priority, id});
+    it->priority = priority;
+    m_queueOrder.emplace(-priority, id);
+    journalQueueEntry(id);
+    return true;
+}
+
+QueuedTask DownloadManager::takeQueued(quint64 id)
+{
+    QueuedTask entry = m_queue.take(id);
+    m_queueOrder.erase({-entry.priority, id});
+    m_queueIndex.remove(taskKey(entry.url));
+    return entry;
+}
+
+int DownloadManager::activeTaskCount() const
+{
+    int active = 0;
+    for (const DownloadTask* task : m_tasks) {
+        const DownloadTaskStatus status = task->status();
+        if (status == DownloadTaskStatus::Downloading || status == DownloadTaskStatus::Pending) {
+            ++active;
+        }
+    }
+    return active;
+}
+
+void DownloadManager::pumpQueue()
+{
+    // 退出时不再建任务：排队条目原样写进队列日志
+    if (m_shuttingDown || m_queueOrder.empty()) {
+        return;
+    }
+
+    int active = activeTaskCount();
+    bool started = false;
+    while (active < kMaxActiveTasks && !m_queueOrder.empty()) {
+        QueuedTask entry = takeQueued(m_queueOrder.begin()->second);
+        DownloadTask* task = addTask(entry.url, entry.filePath, entry.threadCount, entry.id);
+        task->setPinnedAddresses(entry.addresses);
+        task->setPriority(entry.priority);
+        if (!entry.mirrors.isEmpty()) {
+            m_mirrors.insert(task, entry.mirrors);
+        }
+        journalQueueEntry(task->id());
+        startTask(task);
+        ++active;
+        started = true;
+    }
+    if (started) {
+        LOGD(QString("队列补位完成，活动任务:%1 排队:%2").arg(active).arg(m_queue.size()));
+        emit queueChanged(int(m_queue.size()));
+    }
+}
+
 QThreadPool* DownloadManager::threadPool() const
 {
     LOGD("返回线程池指针");
     return m_threadPool;
 }
 
+QThreadPool* DownloadManager::finalizePool() const
+{
+    return m_finalizePool;
+}
+
+bool DownloadManager::admitTask(DownloadTask* task)
+{
+    if (!task) {
+        return false;
+    }
+
+    // 探测刚完成：重定向终点也登记为合并键，之后直接投递终点 URL 的请求同样合并到本任务
+    if (task->effectiveUrl().isValid()) {
+        const QString effectiveKey = taskKey(task->effectiveUrl());
+        if (!m_taskIndex.contains(effectiveKey)) {
+            m_taskIndex.insert(effectiveKey, task);
+        }
+    }
+
+    // 大小未知（无 Content-Length）时无法预估，直接放行
+    if (task->totalSize() <= 0) {
+        LOGD(QString("任务大小未知，跳过磁盘空间检查：%1").arg(task->fileName()));
+        return true;
+    }
+
+    QStorageInfo storage(task->stagingDirectory());
+    storage.refresh();
+    if (!storage.isValid() || !storage.isReady()) {
+        LOGD(QString("无法获取暂存目录所在文件系统信息，跳过磁盘空间检查：%1").arg(task->stagingDirectory()));
+        return true;
+    }
+
+    const qint64 downloadBytes = task->pendingDownloadBytes();
+    const qint64 required = downloadBytes + task->mergeReserveBytes() + kDiskSpaceSafetyMargin;
+    const qint64 available = storage.bytesAvailable() - outstandingReservedBytes(storage.device(), task);
+    LOGD(QString("磁盘空间准入 - 文件:%1 需要:%2 可用:%3").arg(task->fileName()).arg(required).arg(available));
+
+    if (available < required) {
+        bool queued = false;
+        for (const QPointer<DownloadTask>& p : std::as_const(m_diskSpaceQueue)) {
+            if (p == task) {
+                queued = true;
+                break;
+            }
+        }
+        if (!queued) {
+            m_diskSpaceQueue.append(QPointer<DownloadTask>(task));
+        }
+        if (!m_diskSpaceRetryTimer.isActive()) {
+            m_diskSpaceRetryTimer.start();
+        }
+        return false;
+    }
+
+    DiskReservation reservation;
+    reservation.device = storage.device();
+    reservation.downloadBytes = downloadBytes;
+    // downloadedSize 由 worker 计数汇总而来，包含续传前已落盘的分片字节
+    reservation.baseline = task->totalSize() - downloadBytes;
+    m_reservations.insert(task, reservation);
+    return true;
+}
+
+qint64 DownloadManager::outstandingReservedBytes(const QByteArray& device, const DownloadTask* exclude) const
+{
+    // 合并空间已由 .merge 预分配体现在 bytesAvailable 里，这里只统计下载部分还没落盘的字节
+    qint64 outstanding = 0;
+    for (auto it = m_reservations.cbegin(); it != m_reservations.cend(); ++it) {
+        const DownloadTask* task = it.key();
+        if (task == exclude || it.value().device != device) {
+            continue;
+        }
+        // 首次遥测采样前 downloadedSize 可能还没同步到磁盘上的分片字节，按 0 计
+        const qint64 consumed = qMax<qint64>(0, task->downloadedSize() - it.value().baseline);
+        outstanding += qMax<qint64>(0, it.value().downloadBytes - consumed);
+    }
+    return outstanding;
+}
+
+void DownloadManager::releaseDiskReservation(DownloadTask* task)
+{
+    m_reservations.remove(task);
+    m_diskSpaceQueue.removeAll(QPointer<DownloadTask>(task));
+}
+
+void DownloadManager::processDiskSpaceQueue()
+{
+    // 逐个按 FIFO 顺序尝试；admitTask 失败会把任务留在队列里（已在队列中不会重复入队）
+    const QList<QPointer<DownloadTask>> queue = m_diskSpaceQueue;
+    for (const QPointer<DownloadTask>& p : queue) {
+        DownloadTask* task = p.data();
+        if (!task || !task->isWaitingForDiskSpace()) {
+            m_diskSpaceQueue.removeAll(p);
+            continue;
+        }
+        if (!admitTask(task)) {
+            // 队首都放不下就不再尝试后面的任务，避免小任务一直插队把大任务饿死
+            break;
+        }
+        m_diskSpaceQueue.removeAll(p);
+        task->onDiskSpaceAdmitted();
+    }
+
+    if (m_diskSpaceQueue.isEmpty()) {
+        m_diskSpaceRetryTimer.stop();
+    }
+}
+
+void DownloadManager::onTelemetryTick()
+{
+    const qint64 elapsedMs = m_telemetryClock.restart();
+
+    QList<DownloadTask*> tasks;
+    {
+        QMutexLocker locker(&g_tasksMutex);
+        tasks = m_tasks.values();
+    }
+    if (tasks.isEmpty()) {
+        // 最后一个任务结束：发一次空快照让托盘等消费者复位，然后停表
+        m_telemetryTimer.stop();
+        emit telemetryUpdated({});
+        return;
+    }
+
+    // 任务结束时先移出 m_tasks 再 deleteLater，这里拿到的指针在本次派发内都有效
+    QList<TaskTelemetry> snapshot;
+    snapshot.reserve(tasks.size());
+    for (DownloadTask* task : std::as_const(tasks)) {
+        snapshot.append(task->sampleTelemetry(elapsedMs));
+    }
+    emit telemetryUpdated(snapshot);
+}
+
 void DownloadManager::onTaskFinished()
 {
     LOGD("接收到任务完成信号");
@@ -190,6 +679,13 @@ void DownloadManager::onTaskFinished()
         DownloadTask* task = safeTask.data();
         LOGD(QString("任务有效，文件名:%1 状态:%2").arg(task->fileName()).arg(static_cast<int>(task->status())));
 
+        unindexTask(task);
+        if (task->status() == DownloadTaskStatus::Completed) {
+            materializeMirrors(task);
+        } else {
+            m_mirrors.remove(task);
+        }
+
         LOGD("发射taskFinished信号...");
         emit taskFinished(task);
         LOGD("taskFinished信号已发射");
@@ -197,10 +693,16 @@ void DownloadManager::onTaskFinished()
         LOGD("从任务列表中移除任务...");
         {
             QMutexLocker locker(&g_tasksMutex);
-            m_tasks.removeOne(task);
+            m_tasks.remove(task->id());
         }
         LOGD(QString("任务已从列表中移除，剩余任务数:%1").arg(m_tasks.size()));
 
+        // 释放预留后重新检查排队任务
+        releaseDiskReservation(task);
+        QTimer::singleShot(0, this, &DownloadManager::processDiskSpaceQueue);
+        pumpQueue();
+        journalQueueEntry(task->id());
+
         LOGD("标记任务为延迟删除...");
         task->deleteLater(); // 任务完成后安全删除
         LOGD("任务已标记为延迟删除");
@@ -222,6 +724,11 @@ void DownloadManager::onTaskError(const QString& errorString)
         DownloadTask* task = safeTask.data();
         LOGD(QString("任务有效，文件名:%1").arg(task->fileName()));
 
+        unindexTask(task);
+        m_mirrors.remove(task);
+        // 缓存的重定向终点可能已经失效（签名过期、文件被替换），下次重新探测
+        UrlMetadataCache::instance().invalidate(QUrl(task->url()));
+
         LOGD("发射taskError信号...");
         emit taskError(task, errorString);
         LOGD("taskError信号已发射");
@@ -230,10 +737,15 @@ void DownloadManager::onTaskError(const QString& errorString)
         LOGD("从任务列表中移除错误任务...");
         {
             QMutexLocker locker(&g_tasksMutex);
-            m_tasks.removeOne(task);
+            m_tasks.remove(task->id());
         }
         LOGD(QString("错误任务已从列表中移除，剩余任务数:%1").arg(m_tasks.size()));
 
+        releaseDiskReservation(task);
+        QTimer::singleShot(0, this, &DownloadManager::processDiskSpaceQueue);
+        pumpQueue();
+        journalQueueEntry(task->id());
+
         LOGD("标记错误任务为延迟删除...");
         task->deleteLater();
         LOGD("错误任务已标记为延迟删除");
@@ -244,6 +756,47 @@ void DownloadManager::onTaskError(const QString& errorString)
     LOGD("onTaskError处理完成");
 }
 
+QString DownloadManager::taskKey(const QUrl& url)
+{
+    QUrl normalized = url.adjusted(QUrl::RemoveFragment | QUrl::NormalizePathSegments);
+    normalized.setScheme(normalized.scheme().toLower());
+    normalized.setHost(normalized.host().toLower());
+    const int defaultPort = normalized.scheme() == QLatin1String("https") ? 443
+                          : normalized.scheme() == QLatin1String("http") ? 80 : -1;
+    if (normalized.port() == defaultPort) {
+        normalized.setPort(-1);
+    }
+    if (normalized.path().isEmpty()) {
+        normalized.setPath(QStringLiteral("/"));
+    }
+    return normalized.toString(QUrl::FullyEncoded);
+}
+
+void DownloadManager::unindexTask(DownloadTask* task)
+{
+    m_taskIndex.removeIf([task](const QHash<QString, DownloadTask*>::iterator it) {
+        return it.value() == task;
+    });
+}
+
+void DownloadManager::materializeMirrors(DownloadTask* task)
+{
+    const QStringList mirrors = m_mirrors.take(task);
+    if (mirrors.isEmpty()) {
+        return;
+    }
+    const QString source = task->filePath();
+    m_finalizePool->start([source, mirrors]() {
+        for (const QString& target : mirrors) {
+            if (linkOrCopy(source, target)) {
+                LOGD(QString("重复请求的目标已落地：%1 -> %2").arg(source, target));
+            } else {
+                LOGD(QString("重复请求的目标落地失败：%1 -> %2").arg(source, target));
+            }
+        }
+    });
+}
+
 void DownloadManager::onSettingsChanged()
 {
     // 拉取最新代理。其它设置（线程数/默认路径等）不影响 in-flight 任务，
@@ -270,4 +823,315 @@ void DownloadManager::onSettingsChanged()
         ++applied;
     }
     LOGD(QString("DownloadManager::onSettingsChanged: 代理已推送给 %1 个活动任务").arg(applied));
-}
\ No newline at end of file
+}
+
+void DownloadManager::shutdown(int deadlineMs)
+{
+    if (m_shuttingDown) {
+        return;
+    }
+    m_shuttingDown = true;
+
+    QElapsedTimer clock;
+    clock.start();
+    LOGD(QString("DownloadManager::shutdown: 开始退出检查点，任务数:%1 排队:%2 截止:%3ms")
+         .arg(m_tasks.size()).arg(m_queue.size()).arg(deadlineMs));
+
+    m_telemetryTimer.stop();
+    m_diskSpaceRetryTimer.stop();
+    m_journalTimer.stop();
+
+    // 快速通道里还没写完的小文件转成排队条目，随队列日志保存、下次启动恢复
+    SmallFileFetcher::instance().handOffAll();
+
+    // 所有任务同时发起检查点：各 worker 在自己的线程里并行落盘/关闭分片，
+    // 主线程只等确认，等待总时长取决于最慢的那个 worker 而不是 worker 数之和。
+    QList<QPointer<DownloadTask>> snapshot;
+    for (DownloadTask* task : std::as_const(m_tasks)) {
+        snapshot.append(QPointer<DownloadTask>(task));
+    }
+
+    QEventLoop loop;
+    QSet<DownloadTask*> ready;
+    for (const QPointer<DownloadTask>& p : std::as_const(snapshot)) {
+        DownloadTask* task = p.data();
+        if (!task) continue;
+        connect(task, &DownloadTask::checkpointReady, &loop, [task, &ready, &loop, &snapshot]() {
+            ready.insert(task);
+            if (ready.size() >= snapshot.size()) {
+                loop.quit();
+            }
+        });
+    }
+    for (const QPointer<DownloadTask>& p : std::as_const(snapshot)) {
+        if (p) {
+            p->checkpointForShutdown();
+        }
+    }
+
+    if (ready.size() < snapshot.size()) {
+        QTimer::singleShot(deadlineMs, &loop, &QEventLoop::quit);
+        loop.exec(QEventLoop::ExcludeUserInputEvents);
+    }
+
+    // 截止时间到仍未确认的任务：按磁盘现状记录分片布局。worker 可能还在写最后一块，
+    // 续传时 verifyResumeTail 会按 CRC 截掉没写完的尾部。
+    for (const QPointer<DownloadTask>& p : std::as_const(snapshot)) {
+        DownloadTask* task = p.data();
+        if (task && !ready.contains(task)) {
+            LOGD(QString("退出检查点超时，按磁盘现状记录 - %1").arg(task->fileName()));
+            task->writeResumeManifest();
+        }
+    }
+
+    // 检查点期间任务状态可能还有没派发的变化，按当前状态补齐后写出
+    for (DownloadTask* task : tasks()) {
+        journalQueueEntry(task->id());
+    }
+    flushQueueJournal();
+    HostProfileStore::instance().save();
+    LOGD(QString("DownloadManager::shutdown: 完成，已确认%1/%2 耗时%3ms")
+         .arg(ready.size()).arg(snapshot.size()).arg(clock.elapsed()));
+}
+
+QString DownloadManager::queueJournalPath()
+{
+    QString appDataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    if (appDataPath.isEmpty()) {
+        appDataPath = QDir::currentPath();
+    }
+    return QDir(appDataPath).filePath("queue.log");
+}
+
+QJsonObject DownloadManager::queueJournalEntryOf(quint64 id) const
+{
+    QJsonObject entry;
+    const auto queued = m_queue.constFind(id);
+    if (queued != m_queue.cend()) {
+        entry["id"] = qint64(id);
+        entry["url"] = queued->url.toString();
+        entry["filePath"] = queued->filePath;
+        entry["threadCount"] = queued->threadCount;
+        entry["paused"] = false;
+        if (queued->priority != 0) entry["priority"] = queued->priority;
+        writeAddresses(entry, queued->addresses);
+        return entry;
+    }
+
+    const DownloadTask* task = findTask(id);
+    if (!task) {
+        return entry;
+    }
+    const DownloadTaskStatus status = task->status();
+    if (status != DownloadTaskStatus::Downloading &&
+        status != DownloadTaskStatus::Paused &&
+        status != DownloadTaskStatus::Pending) {
+        return entry;
+    }
+    entry["id"] = qint64(id);
+    entry["url"] = task->url();
+    entry["filePath"] = task->filePath();
+    entry["threadCount"] = task->threadCount();
+    entry["paused"] = (status == DownloadTaskStatus::Paused);
+    if (task->priority() != 0) entry["priority"] = task->priority();
+    writeAddresses(entry, task->pinnedAddresses());
+    return entry;
+}
+
+void DownloadManager::journalQueueEntry(quint64 id)
+{
+    const QJsonObject entry = queueJournalEntryOf(id);
+    QJsonObject line;
+    if (entry.isEmpty()) {
+        if (m_journalEntries.remove(id) == 0) {
+            return;
+        }
+        line["del"] = qint64(id);
+    } else {
+        auto it = m_journalEntries.find(id);
+        if (it != m_journalEntries.end() && it.value() == entry) {
+            return;
+        }
+        m_journalEntries.insert(id, entry);
+        line["set"] = entry;
+    }
+
+    // restoreQueue 之前不攒行：恢复时按全部条目整体重写
+    if (!m_journalArmed) {
+        return;
+    }
+    m_pendingLines += journalLineOf(line);
+    ++m_journalLines;
+    if (!m_shuttingDown && !m_journalTimer.isActive()) {
+        m_journalTimer.start();
+    }
+}
+
+void DownloadManager::flushQueueJournal()
+{
+    m_journalTimer.stop();
+    if (!m_journalArmed) {
+        return;
+    }
+    if (m_journalLines >= kQueueJournalCompactMinLines
+        && m_journalLines > 2 * qint64(m_journalEntries.size())) {
+        compactQueueJournal();
+        return;
+    }
+    if (m_pendingLines.isEmpty()) {
+        return;
+    }
+
+    const QString path = queueJournalPath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        LOGD(QString("无法写入队列日志:%1").arg(file.errorString()));
+        return;
+    }
+    if (file.write(m_pendingLines) != m_pendingLines.size()) {
+        // 可能留下半行：加载时跳过半行并压缩
+        LOGD(QString("写入队列日志失败:%1").arg(file.errorString()));
+    }
+    file.close();
+    m_pendingLines.clear();
+}
+
+bool DownloadManager::compactQueueJournal()
+{
+    const QString path = queueJournalPath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        LOGD(QString("无法重写队列日志:%1").arg(file.errorString()));
+        return false;
+    }
+    // 按编号（即创建顺序）写出，恢复时同优先级的条目保持原来的先后
+    QList<quint64> ids = m_journalEntries.keys();
+    std::sort(ids.begin(), ids.end());
+    for (quint64 id : std::as_const(ids)) {
+        QJsonObject line;
+        line["set"] = m_journalEntries.value(id);
+        file.write(journalLineOf(line));
+    }
+    if (!file.commit()) {
+        LOGD(QString("提交队列日志失败:%1").arg(file.errorString()));
+        return false;
+    }
+    // 快照已经包含攒着的修改
+    m_pendingLines.clear();
+    m_journalLines = m_journalEntries.size();
+    LOGD(QString("队列日志已压缩，条目数:%1").arg(m_journalEntries.size()));
+    return true;
+}
+
+int DownloadManager::restoreQueue()
+{
+    if (m_journalArmed) {
+        return 0;
+    }
+
+    // 逐行回放：后出现的 set 覆盖前面的，del 删除；编号升序即创建顺序
+    QMap<quint64, QJsonObject> entries;
+    const QString path = queueJournalPath();
+    const QString legacyPath = QDir(QFileInfo(path).absolutePath()).filePath("queue.json");
+    bool migrated = false;
+    QFile file(path);
+    if (!file.exists()) {
+        // 旧版整份快照：条目没有编号，按文件中的顺序编号
+        QFile legacy(legacyPath);
+        if (legacy.open(QIODevice::ReadOnly)) {
+            const QJsonArray tasks = QJsonDocument::fromJson(legacy.readAll()).object().value("tasks").toArray();
+            legacy.close();
+            quint64 order = 0;
+            for (const QJsonValue& value : tasks) {
+                entries.insert(++order, value.toObject());
+            }
+            migrated = true;
+        }
+    } else if (file.open(QIODevice::ReadOnly)) {
+        while (!file.atEnd()) {
+            const QByteArray line = file.readLine();
+            if (!line.endsWith('\n')) {
+                // 上次写到一半：丢掉半行，下面的整体重写会把它去掉
+                break;
+            }
+            const QJsonObject obj = QJsonDocument::fromJson(line).object();
+            if (obj.contains("set")) {
+                const QJsonObject entry = obj.value("set").toObject();
+                entries.insert(quint64(entry.value("id").toInteger()), entry);
+            } else if (obj.contains("del")) {
+                entries.remove(quint64(obj.value("del").toInteger()));
+            }
+        }
+        file.close();
+    } else {
+        LOGD(QString("无法读取队列日志:%1").arg(file.errorString()));
+    }
+
+    // 恢复出的任务换了新编号：先把它们登记进 m_journalEntries，再按新编号原子重写日志。
+    // 旧日志在重写提交之前保持原样，中途崩溃下次仍能完整恢复。
+    int restored = 0;
+    for (const QJsonObject& entry : std::as_const(entries)) {
+        const QUrl url(entry.value("url").toString());
+        const QString filePath = entry.value("filePath").toString();
+        if (!url.isValid() || filePath.isEmpty()) {
+            continue;
+        }
+        const int threadCount = qMax(1, entry.value("threadCount").toInt(1));
+        const int priority = entry.value("priority").toInt(0);
+        // 入队时 SSRF 校验过的地址：恢复后仍钉在这些地址上，不给 DNS rebinding 留窗口
+        const QList<QHostAddress> addresses = readAddresses(entry);
+        if (entry.value("paused").toBool()) {
+            DownloadTask* task = createTask(url, filePath, threadCount);
+            task->setPinnedAddresses(addresses);
+            task->setPriority(priority);
+            task->restoreAsPaused();
+            journalQueueEntry(task->id());
+        } else {
+            // 下载中与排队的条目一起重新排队，按 kMaxActiveTasks 逐批启动
+            enqueue(url, filePath, threadCount, addresses, priority);
+        }
+        ++restored;
+    }
+
+    m_journalArmed = true;
+    if (compactQueueJournal() && migrated) {
+        QFile::remove(legacyPath + ".bak");
+        QFile::rename(legacyPath, legacyPath + ".bak");
+        LOGD(QString("已迁移旧版队列日志:%1 个条目").arg(entries.size()));
+    }
+    LOGD(QString("从队列日志恢复%1个任务").arg(restored));
+    return restored;
+}
+
+QString DownloadManager::resolveSavePath(const QUrl& url, const QString& savePath, const QString& defaultDir)
+{
+    QString fileName = url.fileName();
+    if (fileName.isEmpty()) {
+        // URL 里没有文件名：用探测缓存里 Content-Disposition 给出的名字
+        UrlMetadata metadata;
+        if (UrlMetadataCache::instance().lookup(url, &metadata)) {
+            fileName = metadata.fileName;
+        }
+    }
+    if (fileName.isEmpty()) {
+        // 没有文件名时回退到默认名，避免生成空文件名导致任务无法落地
+        fileName = "download";
+    }
+
+    if (savePath.isEmpty()) {
+        return QDir(defaultDir).absoluteFilePath(fileName);
+    }
+    const QFileInfo info(savePath);
+    const bool endsWithSep = savePath.endsWith('/') || savePath.endsWith('\\');
+    if (info.isDir() || endsWithSep) {
+        return QDir(savePath).absoluteFilePath(fileName);
+    }
+    if (info.fileName() == savePath) {
+        // 关键：QFileInfo::fileName() 等于整段输入，说明完全没有目录分量。
+        // HttpServer 在 savePath 为空时把 filename 兜底发过来，落入此分支。
+        return QDir(defaultDir).absoluteFilePath(savePath);
+    }
+    return QDir::cleanPath(savePath);
+}
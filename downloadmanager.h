@@ -4,8 +4,35 @@
 #include <QObject>
 #include <QThreadPool>
 #include <QList>
+#include <QHash>
+#include <QPointer>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QStringList>
+#include <QUrl>
+#include <QByteArray>
+#include <QJsonObject>
+#include <set>
+#include <utility>
 #include "downloadtask.h"
 
+/**
+ * @brief 排队中的下载：只有建任务所需的几个字段。
+ *
+ * 不持有 QObject、网络管理器、worker 与暂存目录，十万条排队也只占几十 MB；
+ * 轮到它时 DownloadManager 才用同一编号建 DownloadTask。
+ */
+struct QueuedTask {
+    quint64 id = 0;                 ///< 任务编号（与建出的 DownloadTask::id() 相同）。
+    QUrl url;                       ///< 下载地址。
+    QString filePath;               ///< 保存路径。
+    int threadCount = 1;            ///< 线程数。
+    int priority = 0;               ///< 调度优先级，越大越先启动。
+    QList<QHostAddress> addresses;  ///< SSRF 校验过的地址（为空时不钉）。
+    QStringList mirrors;            ///< 合并进来的重复请求的保存路径。
+};
+
 /**
  * @brief DownloadManager类是下载任务的核心调度中心。
  * 这是一个单例类，负责创建、管理和调度所有的DownloadTask。
@@ -28,13 +55,83 @@ public:
 
     /**
      * @brief 创建一个新的下载任务。
+     *
+     * 重复请求合并：浏览器插件、downloader:// 协议、单实例转发与定时任务可能几乎同时投递同一个 URL。
+     * 活动任务按 taskKey() 建索引（探测后再加上重定向终点），命中时不再新建任务，直接返回已有任务，
+     * 不会有两份带宽和写进同一暂存目录的两组 .partN。保存路径不同时登记为附加目标，
+     * 已有任务完成后在附加目标处建硬链接（不同文件系统时复制）。附加目标不写入队列日志，
+     * 已有任务取消或失败时一并放弃。同一资源还在队列里时，条目提前出队，用它的编号建任务。
+     *
      * @param url 文件的URL。
      * @param savePath 文件的保存路径。
      * @param threadCount 使用的线程数。
-     * @return 返回创建的DownloadTask指针。任务创建后需要手动调用startTask来启动。
+     * @return 返回创建（或合并到）的DownloadTask指针。任务创建后需要手动调用startTask来启动；
+     *         对已在下载的任务调用 startTask 不会有任何动作。
      */
     DownloadTask* createTask(const QUrl& url, const QString& savePath, int threadCount);
 
+    /**
+     * @brief 重复请求合并的键：scheme/主机小写、去掉默认端口与片段、规范化路径段后的 URL。
+     * 查询串原样保留（不同参数可能是不同资源）。
+     */
+    static QString taskKey(const QUrl& url);
+
+    /**
+     * @brief 把下载放进队列：只记一个 QueuedTask 描述符，活动任务少于 kMaxActiveTasks 时才建 DownloadTask 并启动。
+     *
+     * 批量投递、快速通道转交与队列日志恢复走这里，排队的条目不占 worker、QNAM 与界面行。
+     * 按优先级（相同时按入队顺序）启动；活动任务完成、失败或暂停时补位。
+     * 与活动任务或已排队条目重复时同 createTask 一样合并。
+     *
+     * @param url 文件的URL。
+     * @param savePath 文件的保存路径。
+     * @param threadCount 使用的线程数。
+     * @param addresses SSRF 校验过的地址（为空时不钉）。
+     * @param priority 调度优先级。
+     * @return 任务编号（排队期间与建出的任务相同）；合并时返回已有任务或条目的编号。
+     */
+    quint64 enqueue(const QUrl& url, const QString& savePath, int threadCount,
+                    const QList<QHostAddress>& addresses = {}, int priority = 0);
+
+    /**
+     * @brief 排队中的条目，按启动顺序。
+     */
+    QList<QueuedTask> queuedTasks() const;
+
+    /**
+     * @brief 排队中的条目数。
+     */
+    int queuedCount() const { return int(m_queue.size()); }
+
+    /**
+     * @brief 按编号查找排队中的条目。
+     * @return 找到时写入 out 并返回 true。
+     */
+    bool findQueued(quint64 id, QueuedTask* out) const;
+
+    /**
+     * @brief 保存路径是否已被另一个资源（合并键不同）的活动任务或排队条目占用。
+     * 同一资源的重复请求会被合并，不算占用。
+     * @param url 新请求的下载地址。
+     * @param savePath 新请求解析后的保存路径。
+     */
+    bool isSavePathTaken(const QUrl& url, const QString& savePath) const;
+
+    /**
+     * @brief 从队列中移除条目（还没有任何文件落盘，不需要清理）。
+     * @return 条目存在时返回 true。
+     */
+    bool cancelQueued(quint64 id);
+
+    /**
+     * @brief 调整排队条目的优先级，决定它在队列中的位置。
+     * @return 条目存在时返回 true。
+     */
+    bool setQueuedPriority(quint64 id, int priority);
+
+    /// 由队列启动的活动任务上限；createTask 直接建的任务不受限，但计入活动数。
+    static constexpr int kMaxActiveTasks = 4;
+
     /**
      * @brief 启动一个下载任务。
      * @param task 要启动的DownloadTask指针。
@@ -60,12 +157,97 @@ public:
      */
     void cancelTask(DownloadTask* task, bool deleteFile = true);
 
+    /**
+     * @brief 调整任务的调度优先级（见 DownloadTask::setPriority）。
+     * @param task 目标任务。
+     * @param priority 新优先级，越大越优先。
+     */
+    void setTaskPriority(DownloadTask* task, int priority);
+
+    /**
+     * @brief 当前活动任务的快照，按编号排序（主线程使用；指针在本次事件派发内有效）。不含排队条目。
+     */
+    QList<DownloadTask*> tasks() const;
+
+    /**
+     * @brief 按任务编号查找活动任务。
+     * @param id DownloadTask::id()。
+     * @return 找不到（已结束、仍在排队或编号无效）时返回 nullptr。
+     */
+    DownloadTask* findTask(quint64 id) const;
+
     /**
      * @brief 获取全局的线程池实例。
      * @return QThreadPool的指针。
      */
     QThreadPool* threadPool() const;
 
+    /**
+     * @brief 获取收尾（合并/校验/移动/清理）专用线程池。
+     * 与下载线程池分开：worker 的 run() 会长时间占住线程，收尾作业不应排在它们后面；
+     * 多个任务的收尾也可以并行，互不串行。
+     * @return QThreadPool的指针。
+     */
+    QThreadPool* finalizePool() const;
+
+    /**
+     * @brief 磁盘空间准入（DownloadTask 探测到文件大小后调用，主线程）。
+     *
+     * 可用空间 = 暂存目录所在文件系统的 bytesAvailable − 同一设备上其它活动任务
+     * 尚未落盘的预留字节。所需空间 = 剩余下载字节 + 合并所需字节 + 安全余量。
+     * 满足时登记预留并返回 true；否则把任务放入等待队列并返回 false，
+     * 之后在有任务结束或定时重试时通过 DownloadTask::onDiskSpaceAdmitted 唤醒。
+     *
+     * @param task 申请准入的任务。
+     * @return 是否可以立即开始传输。
+     */
+    bool admitTask(DownloadTask* task);
+
+    /// 退出检查点的硬截止时间（毫秒）：到点后不再等待 worker，按磁盘现状记录。
+    static constexpr int kShutdownDeadlineMs = 800;
+
+    /**
+     * @brief 快速优雅退出（主线程）。QCoreApplication::aboutToQuit 时自动调用，
+     * 无界面进程收到 SIGTERM 时经同一路径退出。可重复调用，只执行一次。
+     *
+     * 1. 停止遥测与磁盘空间重试，不再准入新的传输；
+     * 2. 所有任务并行做退出检查点：worker 各自在自己的线程里把缓冲数据落盘、关闭分片；
+     * 3. 等待全部确认，最多 deadlineMs；超时的任务按磁盘现状写续传清单
+     *    （续传时尾部 CRC 校验会截掉没写完的块）；
+     * 4. 写出攒着的队列日志行，下次启动由 restoreQueue() 恢复未完成的任务。
+     *
+     * @param deadlineMs 等待 worker 确认的最长时间。
+     */
+    void shutdown(int deadlineMs = kShutdownDeadlineMs);
+
+    /**
+     * @brief 从队列日志恢复上次退出时未完成的任务（启动时在主窗口就绪后调用一次）。
+     * 上次在下载或排队的条目重新入队（轮到时按续传清单续传），暂停的任务恢复为暂停状态。
+     *
+     * 队列日志是追加式的 queue.log（位于 AppDataLocation）：每行一个 {"set": 条目} 或 {"del": 编号}，
+     * 条目入队、出队、暂停/恢复、调整优先级各追加一行，攒批 kQueueJournalDelayMs 后写出，
+     * 崩溃、kill -9 或断电最多丢失这段时间内的变化；行数多于条目数两倍时用 QSaveFile 整体重写。
+     * 读完不删除：恢复出的任务换了编号，随即按新编号原子重写整个日志。
+     * 旧版的 queue.json（整份快照）在首次启动时迁移，原文件改名为 .bak。
+     * @return 恢复的任务数。
+     */
+    int restoreQueue();
+
+    /**
+     * @brief 把外部请求（浏览器插件、HTTP 接口、定时任务）给出的保存路径归一化为最终文件路径。
+     *
+     *  (a) 空                               -> 默认下载目录 + 文件名
+     *  (b) 已存在的目录 / 以分隔符结尾     -> 该目录下拼文件名
+     *  (c) 裸文件名（无目录分量）           -> 默认下载目录 + 该文件名
+     *  (d) 完整路径（绝对或带目录的相对路径）-> 标准化分隔符后原样使用
+     *
+     * @param url 下载地址，文件名取自 URL 路径（取不到时为 "download"）。
+     * @param savePath 请求给出的保存路径，可为空。
+     * @param defaultDir 默认下载目录。
+     * @return 最终保存路径。
+     */
+    static QString resolveSavePath(const QUrl& url, const QString& savePath, const QString& defaultDir);
+
 signals:
     /**
      * @brief 当一个任务被添加到管理器时发射此信号。
@@ -86,6 +268,31 @@ signals:
      */
     void taskError(DownloadTask* task, const QString& errorString);
 
+    /**
+     * @brief 遥测快照：每个采样周期对所有活动任务采样一次，打包成一批发出。
+     * 主窗口、托盘等消费者都订阅这一个信号，不再各自挂定时器或逐任务收进度信号。
+     * @param snapshot 本周期所有活动任务的采样结果。
+     */
+    void telemetryUpdated(const QList<TaskTelemetry>& snapshot);
+
+    /**
+     * @brief 排队条目数变化（入队、启动、取消）。
+     * @param queued 当前排队条数。
+     */
+    void queueChanged(int queued);
+
+    /**
+     * @brief 新的排队条目（合并进已有条目的重复请求不发）。轮到它时以同一编号发出 taskAdded。
+     * @param entry 条目描述符。
+     */
+    void taskQueued(const QueuedTask& entry);
+
+    /**
+     * @brief 排队条目经 cancelQueued 取消，没有建过任务。
+     * @param id 条目编号。
+     */
+    void queuedTaskCancelled(quint64 id);
+
 private slots:
     /**
      * @brief 处理任务完成的槽函数。
@@ -105,7 +312,96 @@ private slots:
      */
     void onSettingsChanged();
 
+    /**
+     * @brief 重新检查等待磁盘空间的任务，按入队顺序逐个准入。
+     */
+    void processDiskSpaceQueue();
+
+    /**
+     * @brief 遥测定时器槽：读取各任务 worker 的原子计数，计算速度/ETA 并发出 telemetryUpdated。
+     * 没有活动任务时发出一次空快照后停表，createTask 时重新启动。
+     */
+    void onTelemetryTick();
+
+    /**
+     * @brief 活动任务少于 kMaxActiveTasks 时从队首建任务并启动。
+     */
+    void pumpQueue();
+
+    /**
+     * @brief 把攒着的队列日志行追加到文件；行数过多时改为压缩（攒批定时器与 shutdown 调用）。
+     */
+    void flushQueueJournal();
+
 private:
+    /**
+     * @brief 单个任务的磁盘空间预留。
+     */
+    struct DiskReservation {
+        QByteArray device;          ///< 所在文件系统的设备标识（QStorageInfo::device）。
+        qint64 downloadBytes = 0;   ///< 准入时登记的剩余下载字节数。
+        qint64 baseline = 0;        ///< 准入时任务的 downloadedSize，用于计算已消耗的预留。
+    };
+
+    /**
+     * @brief 统计同一设备上其它任务尚未落盘的预留字节。
+     * @param device 设备标识。
+     * @param exclude 不计入的任务（正在申请准入的任务本身）。
+     */
+    qint64 outstandingReservedBytes(const QByteArray& device, const DownloadTask* exclude) const;
+
+    /**
+     * @brief 释放任务的预留并移出等待队列；任务结束/出错时调用。
+     */
+    void releaseDiskReservation(DownloadTask* task);
+
+    /**
+     * @brief 把任务从合并索引中移除（任务结束时调用）。
+     */
+    void unindexTask(DownloadTask* task);
+
+    /**
+     * @brief 建 DownloadTask、登记并发出 taskAdded（createTask 与 pumpQueue 共用，调用方已做合并检查）。
+     * @param id 任务编号；0 表示新分配。
+     */
+    DownloadTask* addTask(const QUrl& url, const QString& savePath, int threadCount, quint64 id);
+
+    /**
+     * @brief 从队列中取出条目（同时移出顺序集合与合并索引）。
+     */
+    QueuedTask takeQueued(quint64 id);
+
+    /**
+     * @brief 正在下载或等待开始的任务数（不含暂停）。
+     */
+    int activeTaskCount() const;
+
+    /**
+     * @brief 任务完成后在附加目标处建硬链接或复制（收尾线程池执行）。
+     */
+    void materializeMirrors(DownloadTask* task);
+
+    /**
+     * @brief 队列日志路径（AppDataLocation/queue.log）。
+     */
+    static QString queueJournalPath();
+
+    /**
+     * @brief 某个编号当前应写进日志的条目：排队条目或下载中/暂停/等待的任务；已结束或不存在时返回空对象。
+     */
+    QJsonObject queueJournalEntryOf(quint64 id) const;
+
+    /**
+     * @brief 编号对应的条目有变化时调用：与日志里最后写出的内容不同才攒一行 set 或 del。
+     */
+    void journalQueueEntry(quint64 id);
+
+    /**
+     * @brief 按当前条目重写整个队列日志（QSaveFile，写临时文件后改名）。
+     * @return 提交成功返回true。
+     */
+    bool compactQueueJournal();
+
     /**
      * @brief 私有构造函数，确保单例模式。
      * @param parent 父QObject。
@@ -114,7 +410,27 @@ private:
     ~DownloadManager();
 
     QThreadPool* m_threadPool;          ///< 全局线程池。
-    QList<DownloadTask*> m_tasks;       ///< 当前活动的下载任务列表。
+    QThreadPool* m_finalizePool;        ///< 收尾作业线程池（磁盘 IO 为主）。
+    QHash<DownloadTask*, DiskReservation> m_reservations; ///< 已准入任务的磁盘预留（仅主线程访问）。
+    QList<QPointer<DownloadTask>> m_diskSpaceQueue;       ///< 等待磁盘空间的任务（FIFO）。
+    QTimer m_diskSpaceRetryTimer;       ///< 队列非空时定期重试（外部释放空间不会通知我们）。
+    QTimer m_telemetryTimer;            ///< 全局遥测采样定时器（所有任务共用一个）。
+    QElapsedTimer m_telemetryClock;     ///< 两次采样之间的实际间隔，用于折算速度。
+    QHash<quint64, DownloadTask*> m_tasks; ///< 当前活动的下载任务（编号 -> 任务，移除与查找都是 O(1)）。
+    QHash<quint64, QueuedTask> m_queue;    ///< 排队中的条目（编号 -> 描述符，仅主线程）。
+    std::set<std::pair<int, quint64>> m_queueOrder; ///< (−优先级, 编号)：begin() 是下一个要启动的条目。
+    QHash<QString, quint64> m_queueIndex;  ///< 合并键 -> 排队条目编号（仅主线程）。
+    QHash<QString, DownloadTask*> m_taskIndex;  ///< 合并键（请求 URL 与探测后的重定向终点）-> 活动任务（仅主线程）。
+    QHash<DownloadTask*, QStringList> m_mirrors; ///< 合并进来的重复请求的保存路径，任务完成后落地（仅主线程）。
+    bool m_shuttingDown = false;        ///< shutdown() 已执行。
+    QTimer m_journalTimer;              ///< 队列日志攒批定时器（单次）。
+    bool m_journalArmed = false;        ///< restoreQueue() 已执行：之前写日志会覆盖还没恢复的条目。
+    QHash<quint64, QJsonObject> m_journalEntries; ///< 日志里各未完成条目最后写出的内容（编号 -> 条目，仅主线程）。
+    QByteArray m_pendingLines;          ///< 攒着还没写出的日志行。
+    qint64 m_journalLines = 0;          ///< 日志中的行数（含还没写出的），用于判断何时压缩。
+
+    static constexpr int kQueueJournalDelayMs = 1000;        ///< 日志行最长攒批时间（毫秒）
+    static constexpr int kQueueJournalCompactMinLines = 256; ///< 日志行数不到这个数不压缩
 };
 
 #endif // DOWNLOADMANAGER_H
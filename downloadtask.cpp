@@ -9,9 +9,44 @@
 #include <QThreadPool>
 #include <QMetaObject>
 #include <QPointer>
+#include <QThread>
 #include <QStandardPaths>
 #include <QNetworkProxy>
+#include <QSaveFile>
+#include <QStorageInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QCryptographicHash>
+#include <QtConcurrent/QtConcurrent>
+#include <cmath>
 #include "historymanager.h"
+#include "hostguard.h"
+#include "urlmetadatacache.h"
+
+#ifdef _WIN32
+#  include <windows.h>
+#endif
+#ifdef __linux__
+#  include <fcntl.h>
+#endif
+
+namespace {
+    /// 合并时每追加这么多字节就 flush + 写一次检查点；崩溃后最多重做这一段。
+    constexpr qint64 kMergeCheckpointInterval = 64LL * 1024 * 1024;
+
+    /// 单任务分片数上限。INT_MAX 会让 chunkSize 计算溢出或创建数千个 worker 把磁盘/线程池打爆。
+    constexpr int kMaxThreadCount = 16;
+
+    /// 钉住地址的 HEAD 手动跟随的重定向次数上限（与 QNetworkAccessManager 默认的上限一致）
+    constexpr int kMaxHeadRedirects = 50;
+
+    /// EWMA 测速的时间常数（毫秒）：越大速度显示越平稳，对突变的响应越慢
+    constexpr double kSpeedSmoothingMs = 3000.0;
+
+    /// 下一个分配的任务编号
+    std::atomic<quint64> g_nextTaskId{1};
+}
 
 /**
  * @brief 下载任务构造函数
@@ -22,20 +57,22 @@
  * - 线程数：下载线程数量
  * - 状态：初始为Pending
  * 
- * 提取文件名，初始化速度计算定时器（每秒计算一次下载速度）
+ * 提取文件名并选择分片暂存目录；进度与速度由 DownloadManager 的遥测定时器统一采样
  * 
  * @param url 下载文件的URL
  * @param savePath 文件保存的完整路径
  * @param threadCount 下载线程数量
+ * @param id 任务编号（0 时新分配）
  * @param parent 父对象指针
  */
-DownloadTask::DownloadTask(const QUrl& url, const QString& savePath, int threadCount, QObject *parent)
+DownloadTask::DownloadTask(const QUrl& url, const QString& savePath, int threadCount, quint64 id, QObject *parent)
     : QObject(parent),
+      m_id(id != 0 ? id : allocateId()),
       m_url(url),
       m_filePath(savePath),
       m_threadCount(threadCount),
       m_threadPool(DownloadManager::instance().threadPool()),
-      m_status(DownloadTaskStatus::Pending),
+      m_status(static_cast<int>(DownloadTaskStatus::Pending)),
       m_totalSize(0),
       m_downloadedSize(0),
       m_lastDownloadedSize(0),
@@ -68,16 +105,16 @@ DownloadTask::DownloadTask(const QUrl& url, const QString& savePath, int threadC
     m_fileName = fileInfo.fileName();
     LOGD(QString("提取文件名:%1").arg(m_fileName));
     
-    // 获取系统临时目录
+    // 选择分片暂存目录（优先目标文件旁的隐藏目录）
     m_tempDirectory = getTempDirectory();
     LOGD(QString("临时目录:%1").arg(m_tempDirectory));
     
     LOGD("DownloadTask构造完成");
+}
 
-    // 初始化速度计算定时器
-    m_speedCalculationTimer.setInterval(1000); // 每秒计算一次速度
-    connect(&m_speedCalculationTimer, &QTimer::timeout, this, &DownloadTask::onSpeedCalculationTimerTimeout);
-    LOGD("速度计算定时器初始化完成");
+quint64 DownloadTask::allocateId()
+{
+    return g_nextTaskId.fetch_add(1, std::memory_order_relaxed);
 }
 
 DownloadTask::~DownloadTask()
@@ -85,22 +122,33 @@ DownloadTask::~DownloadTask()
     LOGD(QString("开始析构DownloadTask - 文件名:%1").arg(m_fileName));
 
     // 先断开所有信号连接，避免在清理过程中再有信号发出触发外部槽函数
-    // 注意：不能用 blockSignals(true)，因为 setStatus 内部的 emit 是通过
-    // QTimer::singleShot(0, ...) 异步排队，blockSignals 会把已排队的 emit 也屏蔽掉
+    // 注意：不能用 blockSignals(true)，非主线程触发的状态转换会把 statusChanged
+    // 排队到主线程发射，blockSignals 会把已排队的 emit 也屏蔽掉
     this->disconnect();
 
-    // 停止所有worker
-    LOGD(QString("停止所有worker，当前worker数量:%1").arg(m_workers.size()));
-    for (HttpWorker* worker : m_workers) {
+    // 放手所有worker：断开与本任务的信号连接（避免晚到的信号进入正在析构的
+    // DownloadTask 导致 UAF），停止后由 worker 在 run() 真正退出时自行 deleteLater。
+    // 不等待线程池：仍在运行的 worker 只访问自身成员。
+    LOGD(QString("停止并释放所有worker，当前worker数量:%1").arg(m_workers.size()));
+    for (HttpWorker* worker : std::as_const(m_workers)) {
         if (worker) {
-            worker->stop();
+            worker->disconnect(this);
+            worker->stopAndDeleteLater();
         }
     }
+    m_workers.clear();
 
-    // 等待线程池中的worker全部结束，避免析构时还有线程在跑
-    LOGD("等待线程池中任务结束...");
-    if (m_threadPool) {
-        m_threadPool->waitForDone(3000);
+    // 收尾作业还在 finalize 线程池里跑时（退出/取消后被 deleteLater），作业会访问
+    // this 的成员，必须等它退出。置位 m_finalizeAbort 后合并循环最多再处理一个块；
+    // 检查点保留在磁盘上，下次同一任务可从断点续合并。
+    if (m_finalizeWatcher) {
+        LOGD("等待收尾作业退出...");
+        m_finalizeAbort.store(true, std::memory_order_release);
+        m_finalizeWatcher->disconnect(this);
+        m_finalizeWatcher->waitForFinished();
+        if (m_deleteTempsAfterFinalize) {
+            deleteTempFiles();
+        }
     }
 
     // 清理网络资源
@@ -114,17 +162,8 @@ DownloadTask::~DownloadTask()
         m_headManager->deleteLater();
     }
 
-    // 使用deleteLater异步删除worker，避免阻塞
-    LOGD("标记所有worker为延迟删除");
-    for (HttpWorker* worker : m_workers) {
-        if (worker) {
-            // 先断开与本任务的全部信号连接，避免在 deleteLater 排队期间
-            // 晚到的信号进入正在析构的 DownloadTask，导致 UAF。
-            worker->disconnect(this);
-            worker->deleteLater();
-        }
-    }
-    m_workers.clear();
+    // 失败或取消后没有写出任何分片时，构造时建的暂存目录还是空的
+    removeEmptyStagingDirectory();
 
     LOGD("DownloadTask析构完成");
 }
@@ -141,48 +180,50 @@ DownloadTask::~DownloadTask()
  */
 void DownloadTask::start()
 {
-    LOGD(QString("开始启动任务 - 当前状态:%1 URL:%2").arg(static_cast<int>(m_status)).arg(m_url.toString()));
+    const DownloadTaskStatus current = status();
+    LOGD(QString("开始启动任务 - 当前状态:%1 URL:%2").arg(static_cast<int>(current)).arg(m_url.toString()));
 
     bool needInit = false;
     bool needResume = false;
 
-    {
-        QMutexLocker locker(&m_statusMutex); // 统一使用m_statusMutex保护m_status
-        if (m_status == DownloadTaskStatus::Pending || m_status == DownloadTaskStatus::Failed) {
-            LOGD("任务状态为Pending/Failed，清理旧worker并重新初始化下载");
-            needInit = true;
-        } else if (m_status == DownloadTaskStatus::Paused) {
-            LOGD("任务状态为Paused，调用resume()");
-            needResume = true;
-        } else {
-            LOGD(QString("任务状态不是Pending/Failed/Paused，不执行任何操作，状态:%1").arg(static_cast<int>(m_status)));
-        }
+    // 排队等待磁盘空间的任务由 DownloadManager 在空间足够时唤醒，不重新探测
+    if (m_waitingForDiskSpace) {
+        LOGD("任务正在等待磁盘空间，忽略启动请求");
+        return;
+    }
+
+    if (current == DownloadTaskStatus::Pending || current == DownloadTaskStatus::Failed) {
+        LOGD("任务状态为Pending/Failed，清理旧worker并重新初始化下载");
+        needInit = true;
+    } else if (current == DownloadTaskStatus::Paused) {
+        LOGD("任务状态为Paused，调用resume()");
+        needResume = true;
+    } else {
+        LOGD(QString("任务状态不是Pending/Failed/Paused，不执行任何操作，状态:%1").arg(static_cast<int>(current)));
     }
 
     if (needInit) {
-        QList<HttpWorker*> oldWorkers;
-        {
-            QMutexLocker workerLocker(&m_mutex); // 保护m_workers
-            LOGD(QString("当前workers数量: %1").arg(m_workers.size()));
-
-            // 清理之前的worker
-            for (HttpWorker* worker : m_workers) {
-                if (worker) {
-                    LOGD("停止并删除worker");
-                    worker->stop();
-                    // 在 deleteLater 之前断开与本任务的全部信号连接，
-                    // 避免在 deleteLater 排队期间晚到的信号进入新的 DownloadTask。
-                    worker->disconnect(this);
-                    worker->deleteLater();
-                } else {
-                    LOGD("发现空worker指针");
-                }
+        // m_workers 只在主线程读写，无需加锁
+        LOGD(QString("当前workers数量: %1").arg(m_workers.size()));
+
+        // 清理之前的worker（出错路径停止的 worker 可能还没退出 run()，交给它们自行删除）
+        for (HttpWorker* worker : std::as_const(m_workers)) {
+            if (worker) {
+                LOGD("停止并删除worker");
+                // 先断开与本任务的全部信号连接，
+                // 避免在删除排队期间晚到的信号进入新一轮下载。
+                worker->disconnect(this);
+                worker->stopAndDeleteLater();
+            } else {
+                LOGD("发现空worker指针");
             }
-            m_workers.clear();
-            m_finishedWorkers = 0;
-            m_createdWorkerCount = 0;
-            LOGD("worker清理完成");
         }
+        m_workers.clear();
+        m_finishedWorkers = 0;
+        m_createdWorkerCount = 0;
+        m_pendingStopAcks = 0;
+        m_stopIntent = StopIntent::None;
+        LOGD("worker清理完成");
 
         m_startTime = QDateTime::currentDateTime();
         LOGD(QString("任务开始时间:%1").arg(m_startTime.toString()));
@@ -192,8 +233,8 @@ void DownloadTask::start()
         // 避免出现"显示 Downloading 但 HEAD 还没发"的窗口
         QPointer<DownloadTask> safeThis(this);
         QTimer::singleShot(0, this, [safeThis]() {
-            if (safeThis) {
-                safeThis->setStatus(DownloadTaskStatus::Downloading); // 走setStatus，自动用m_statusMutex
+            // 排队期间可能已被取消：转换失败就不再发起 HEAD
+            if (safeThis && safeThis->transitionTo(DownloadTaskStatus::Downloading)) {
                 LOGD("异步执行initializeDownload()");
                 safeThis->initializeDownload();
             }
@@ -209,98 +250,85 @@ void DownloadTask::start()
  * @brief 暂停下载任务
  * 
  * 当任务处于Downloading状态时执行暂停操作：
- * 1. 将状态设置为Paused
- * 2. 停止速度计算定时器
- * 3. 停止所有worker线程
+ * 1. 通知所有worker停止（不阻塞，不等待线程池）
+ * 2. 所有worker的stopped()确认到齐后，CAS 把状态从 Downloading 切到 Paused
+ *    （确认期间任务出错/被取消时转换失败，以那一方为准）
  * 
- * 使用互斥锁保护状态和资源访问，确保线程安全
+ * 收尾阶段 worker 已全部结束，不允许暂停。
  */
 void DownloadTask::pause()
 {
     LOGD("开始暂停任务");
-    QList<HttpWorker*> workersToStop;
-    bool shouldStop = false;
 
-    // 先获取worker锁
-    {
-        QMutexLocker workerLocker(&m_mutex);
-        QMutexLocker statusLocker(&m_statusMutex);
-        if (m_status == DownloadTaskStatus::Downloading) {
-            LOGD("任务正在下载中，准备暂停");
-            workersToStop = m_workers;
-            shouldStop = true;
-            m_speedCalculationTimer.stop();
-            LOGD("已复制worker列表并停止定时器");
-        }
+    if (finalizePhase() != FinalizePhase::None) {
+        LOGD("任务正在收尾，忽略暂停请求");
+        return;
     }
-
-    // 在worker锁外处理状态变更和停止操作
-    if (shouldStop) {
-        setStatus(DownloadTaskStatus::Paused); // 内部使用statusMutex
-        LOGD("任务状态设置为Paused");
-
-        // 异步停止workers（在事件循环回到主线程时真正执行stop）
-        for (HttpWorker* worker : workersToStop) {
-            if (worker) {
-                LOGD("异步停止worker");
-                worker->stopAsync();
-            }
-        }
-        LOGD(QString("任务暂停完成 - URL:%1").arg(url()));
-    } else {
+    if (status() != DownloadTaskStatus::Downloading) {
         LOGD(QString("任务不在下载状态，无法暂停"));
+        return;
     }
+    requestStop(StopIntent::Pause);
 }
 
 /**
  * @brief 恢复下载任务
  * 
  * 当任务处于Paused状态时执行恢复操作：
- * 1. 将状态设置为Downloading
- * 2. 启动速度计算定时器
- * 3. 重新提交所有worker到线程池
+ * 1. CAS 把状态从 Paused 切回 Downloading
+ * 2. 按原分片范围重新提交所有worker到线程池（不重新探测）
  * 
- * 使用互斥锁保护状态和资源访问，确保线程安全
+ * 暂停确认还没到齐（状态仍是 Downloading）时，把挂起动作改为 Resume，
+ * 确认到齐后直接重新提交。
+ * HEAD 探测期间被暂停的任务还没有 worker：探测结果已回来时重新走一遍初始化，
+ * 仍在飞的探测会在回调里看到 Downloading 状态继续往下走。
  */
 void DownloadTask::resume()
 {
     LOGD("开始恢复任务");
-    QList<HttpWorker*> workersToResume;
-    bool shouldResume = false;
 
-    // 1. 获取worker列表
-    {
-        QMutexLocker workerLocker(&m_mutex);
-        QMutexLocker statusLocker(&m_statusMutex);
-        if (m_status == DownloadTaskStatus::Paused) {
-            LOGD("任务已暂停，准备恢复");
-            workersToResume = m_workers;
-            shouldResume = true;
-        }
+    if (m_stopIntent == StopIntent::Pause) {
+        LOGD("暂停确认尚未到齐，确认后直接重新提交worker");
+        m_stopIntent = StopIntent::Resume;
+        return;
     }
 
-    // 2. 在锁外处理状态和worker提交
-    if (shouldResume) {
-        // 重置每个worker的运行状态。pause时worker.m_isStopped被置true，若不重置
-        // worker.run()会直接return，导致断点续传失效
-        LOGD(QString("重置%1个worker状态").arg(workersToResume.size()));
-        for (HttpWorker* worker : workersToResume) {
-            if (worker) {
-                worker->reset();
-            }
+    if (!transition(DownloadTaskStatus::Paused, DownloadTaskStatus::Downloading)) {
+        LOGD(QString("任务不在暂停状态，无法恢复"));
+        return;
+    }
+
+    if (m_workers.isEmpty()) {
+        if (!m_headReply) {
+            LOGD("暂停时尚未创建worker，重新初始化下载");
+            initializeDownload();
         }
+        return;
+    }
 
-        setStatus(DownloadTaskStatus::Downloading); // 使用statusMutex
-        m_speedCalculationTimer.start();
+    resubmitWorkers();
+    LOGD(QString("任务恢复完成 - URL:%1").arg(m_url.toString()));
+}
 
-        LOGD(QString("重新提交%1个worker到线程池").arg(workersToResume.size()));
-        for (HttpWorker* worker : workersToResume) {
-            m_threadPool->start(worker);
+void DownloadTask::resubmitWorkers()
+{
+    // 重置每个worker的运行状态。pause时worker.m_isStopped被置true，若不重置
+    // worker.run()会直接return，导致断点续传失效。分片范围沿用创建时的值，
+    // worker 从磁盘上已有的分片长度续传，不需要重新 HEAD。
+    LOGD(QString("重置%1个worker状态").arg(m_workers.size()));
+    for (HttpWorker* worker : std::as_const(m_workers)) {
+        if (worker) {
+            worker->reset();
         }
+    }
+    // 已下完的分片续传时会立即再发一次 finished()，完成计数从零重新累计
+    m_finishedWorkers = 0;
 
-        LOGD(QString("任务恢复完成 - URL:%1").arg(m_url.toString()));
-    } else {
-        LOGD(QString("任务不在暂停状态，无法恢复"));
+    LOGD(QString("重新提交%1个worker到线程池").arg(m_workers.size()));
+    for (HttpWorker* worker : std::as_const(m_workers)) {
+        if (worker) {
+            worker->submit(m_threadPool, m_priority);
+        }
     }
 }
 
@@ -308,69 +336,270 @@ void DownloadTask::resume()
  * @brief 取消下载任务
  * 
  * 取消当前下载任务，支持删除临时文件：
- * 1. 检查任务状态，已完成/已取消/失败的任务不能再次取消
- * 2. 设置状态为Cancelled，停止速度计算定时器
- * 3. 停止所有worker线程
- * 4. 根据参数决定是否删除临时文件
- * 5. 保存取消记录到历史
- * 6. 发射finished信号通知任务完成
+ * 1. CAS 切到 Cancelled；已完成/已取消/失败的任务转换不合法，直接返回
+ * 2. 记录结束时间，通知所有worker停止（不阻塞）
+ * 3. 所有worker确认停止后（completeCancel）：
+ *    根据参数删除临时文件、保存取消记录到历史、发射finished信号
+ * 
+ * 删除临时文件必须等 worker 确认：否则仍在写分片的 worker 会与删除争用文件句柄。
  * 
  * @param deleteTempFiles 是否删除临时文件，true表示删除，false表示保留
  */
 void DownloadTask::cancel(bool deleteTempFiles)
 {
     LOGD(QString("开始取消任务，删除临时文件:%1").arg(deleteTempFiles));
-    QList<HttpWorker*> workersToStop;
-    bool shouldCancel = false;
 
-    // 1. 检查状态并获取worker列表
-    {
-        QMutexLocker statusLocker(&m_statusMutex);
-        QMutexLocker workerLocker(&m_mutex);
-        if (m_status != DownloadTaskStatus::Completed &&
-            m_status != DownloadTaskStatus::Cancelled &&
-            m_status != DownloadTaskStatus::Failed) {
-            workersToStop = m_workers;
-            shouldCancel = true;
-            m_speedCalculationTimer.stop();
-            m_finishTime = QDateTime::currentDateTime();
-        }
+    // 状态转换即是"谁来收尾"的仲裁：与出错/完成并发时只有一方转换成功
+    if (!transitionTo(DownloadTaskStatus::Cancelled)) {
+        LOGD("任务已完成或已取消，无需操作");
+        return;
     }
 
-    // 2. 在锁外执行取消操作
-    if (shouldCancel) {
-        // 停止所有worker
-        LOGD(QString("停止%1个worker").arg(workersToStop.size()));
-        for (HttpWorker* worker : workersToStop) {
-            worker->stop();
+    m_finishTime = QDateTime::currentDateTime();
+    m_waitingForDiskSpace = false;
+    m_cancelDeletesTemps = deleteTempFiles;
+    LOGD(QString("任务状态设置为Cancelled，结束时间:%1").arg(m_finishTime.toString()));
+
+    requestStop(StopIntent::Cancel);
+}
+
+void DownloadTask::requestStop(StopIntent intent)
+{
+    if (m_pendingStopAcks > 0) {
+        // 上一轮停止还在等确认（例如暂停中又取消）：worker 已在停止，只改挂起动作
+        LOGD(QString("停止确认进行中（剩余%1），更新挂起动作").arg(m_pendingStopAcks));
+        m_stopIntent = intent;
+        return;
+    }
+
+    m_stopIntent = intent;
+    int pending = 0;
+    for (HttpWorker* worker : std::as_const(m_workers)) {
+        if (worker && worker->stop()) {
+            ++pending;
         }
+    }
+    m_pendingStopAcks = pending;
+    LOGD(QString("已通知%1个worker停止，等待%2个确认").arg(m_workers.size()).arg(pending));
+
+    if (pending == 0) {
+        completeStop();
+    }
+}
 
-        // 状态变更
-        setStatus(DownloadTaskStatus::Cancelled);
-        LOGD(QString("任务状态设置为Cancelled，结束时间:%1").arg(m_finishTime.toString()));
+void DownloadTask::onWorkerStopped()
+{
+    if (m_pendingStopAcks <= 0) {
+        // 出错/完成路径上的 stop 不等待确认
+        return;
+    }
+    if (--m_pendingStopAcks > 0) {
+        return;
+    }
+    completeStop();
+}
 
-        // 等待线程池中正在跑 run() 的 worker 真正退出，避免后续 deleteTempFiles 时
-        // 仍有 worker 在写临时分片文件导致文件锁/句柄竞态
-        LOGD("cancel: 等待线程池worker退出（超时3秒）");
-        if (m_threadPool) {
-            m_threadPool->waitForDone(3000);
+void DownloadTask::completeStop()
+{
+    const StopIntent intent = m_stopIntent;
+    m_stopIntent = StopIntent::None;
+
+    switch (intent) {
+    case StopIntent::Pause:
+        if (transition(DownloadTaskStatus::Downloading, DownloadTaskStatus::Paused)) {
+            LOGD(QString("任务暂停完成 - URL:%1").arg(url()));
+        } else {
+            LOGD(QString("暂停确认到齐但状态已变更，当前状态:%1").arg(static_cast<int>(status())));
+        }
+        break;
+    case StopIntent::Resume:
+        if (status() == DownloadTaskStatus::Downloading) {
+            resubmitWorkers();
+            LOGD(QString("任务恢复完成 - URL:%1").arg(m_url.toString()));
         }
+        break;
+    case StopIntent::Cancel:
+        completeCancel();
+        break;
+    case StopIntent::Shutdown:
+        writeResumeManifest();
+        emit checkpointReady();
+        break;
+    case StopIntent::None:
+        break;
+    }
+}
 
+void DownloadTask::completeCancel()
+{
+    // 收尾作业还在跑：通知它中止，临时文件删除推迟到作业退出后
+    // （onFinalizeFinished 或析构），避免与合并线程争用同一批分片文件。
+    if (m_finalizeWatcher) {
+        LOGD("cancel: 收尾作业运行中，通知中止并推迟临时文件删除");
+        m_finalizeAbort.store(true, std::memory_order_release);
+        m_deleteTempsAfterFinalize = m_cancelDeletesTemps;
+    } else if (m_cancelDeletesTemps) {
         // 耗时操作放在最后
-        if (deleteTempFiles) {
-            LOGD("删除临时文件");
-            this->deleteTempFiles();
+        LOGD("删除临时文件");
+        deleteTempFiles();
+    } else {
+        // 保留临时文件；还没写出分片（例如 HEAD 阶段取消）时不留空目录
+        removeEmptyStagingDirectory();
+    }
+
+    // 记录历史
+    saveToHistory("Cancelled");
+    if (!m_alreadyFinished) {
+        m_alreadyFinished = true;
+        emit finished();
+    }
+    LOGD(QString("任务取消完成 - URL:%1").arg(m_url.toString()));
+}
+
+void DownloadTask::checkpointForShutdown()
+{
+    m_checkpointing = true;
+
+    // 收尾中：合并循环按块检查中止标志并保存合并检查点，作业退出后在 onFinalizeFinished 发射就绪
+    if (m_finalizeWatcher) {
+        LOGD(QString("退出检查点：通知收尾作业中止 - %1").arg(m_fileName));
+        m_finalizeAbort.store(true, std::memory_order_release);
+        return;
+    }
+
+    const DownloadTaskStatus current = status();
+    if (current == DownloadTaskStatus::Downloading && !m_workers.isEmpty()) {
+        LOGD(QString("退出检查点：停止%1个worker - %2").arg(m_workers.size()).arg(m_fileName));
+        requestStop(StopIntent::Shutdown);
+        return;
+    }
+
+    // 暂停/排队/探测中：worker 没有在写，直接记录当前分片布局；已结束的任务没有可续传的东西
+    if (current == DownloadTaskStatus::Downloading ||
+        current == DownloadTaskStatus::Paused ||
+        current == DownloadTaskStatus::Pending) {
+        writeResumeManifest();
+    }
+    emit checkpointReady();
+}
+
+QString DownloadTask::resumeManifestPath() const
+{
+    return QDir(m_tempDirectory).filePath(QFileInfo(m_filePath).fileName() + ".resume.json");
+}
+
+bool DownloadTask::writeResumeManifest() const
+{
+    if (m_workers.isEmpty()) {
+        return false;
+    }
+
+    QJsonArray parts;
+    for (const HttpWorker* worker : m_workers) {
+        QJsonObject part;
+        part["start"] = worker->startPoint();
+        part["end"] = worker->endPoint();
+        part["bytes"] = QFileInfo(worker->filePath()).size();
+        parts.append(part);
+    }
+
+    QJsonObject obj;
+    obj["url"] = m_url.toString();
+    obj["totalSize"] = totalSize();
+    obj["parts"] = parts;
+    obj["savedAt"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+
+    QSaveFile file(resumeManifestPath());
+    if (!file.open(QIODevice::WriteOnly)) {
+        LOGD(QString("无法写入续传清单:%1").arg(file.errorString()));
+        return false;
+    }
+    file.write(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+    if (!file.commit()) {
+        LOGD(QString("提交续传清单失败:%1").arg(file.errorString()));
+        return false;
+    }
+    LOGD(QString("续传清单已写入:%1 分片数:%2").arg(resumeManifestPath()).arg(parts.size()));
+    return true;
+}
+
+QList<DownloadTask::ResumePart> DownloadTask::loadResumeManifest(qint64 totalSize) const
+{
+    QFile file(resumeManifestPath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    const QJsonObject obj = QJsonDocument::fromJson(file.readAll()).object();
+    file.close();
+
+    // 清单必须属于同一个文件：服务器上的文件变了，已有分片就不可信
+    if (obj.value("url").toString() != m_url.toString() ||
+        obj.value("totalSize").toInteger() != totalSize) {
+        LOGD("续传清单与本次探测结果不匹配，忽略");
+        return {};
+    }
+
+    // 范围必须从 0 开始首尾相接覆盖整个文件
+    QList<ResumePart> parts;
+    qint64 expectedStart = 0;
+    const QJsonArray array = obj.value("parts").toArray();
+    for (const QJsonValue& value : array) {
+        const QJsonObject part = value.toObject();
+        ResumePart range;
+        range.start = part.value("start").toInteger(-1);
+        range.end = part.value("end").toInteger(-1);
+        if (range.start != expectedStart || range.end < range.start || range.end >= totalSize) {
+            LOGD("续传清单分片范围无效，忽略");
+            return {};
         }
+        expectedStart = range.end + 1;
+        parts.append(range);
+    }
+    if (parts.isEmpty() || parts.size() > kMaxThreadCount || expectedStart != totalSize) {
+        LOGD("续传清单分片未覆盖整个文件，忽略");
+        return {};
+    }
+    return parts;
+}
 
-        // 记录历史
-        saveToHistory("Cancelled");
-        if (!m_alreadyFinished) {
-            m_alreadyFinished = true;
-            emit finished();
+void DownloadTask::restoreAsPaused()
+{
+    if (transition(DownloadTaskStatus::Pending, DownloadTaskStatus::Paused)) {
+        m_startTime = QDateTime::currentDateTime();
+        LOGD(QString("从退出队列恢复为暂停状态 - %1").arg(m_fileName));
+    }
+}
+
+/**
+ * @brief 钉住 SSRF 校验过的地址
+ *
+ * 只接受第一次设置：合并进来的重复请求不能替换或解除已有的钉住。
+ */
+void DownloadTask::setPinnedAddresses(const QList<QHostAddress>& addresses)
+{
+    if (!m_pinnedAddresses.isEmpty()) {
+        return;
+    }
+    m_pinnedAddresses = addresses;
+}
+
+/**
+ * @brief 调整调度优先级
+ *
+ * 线程池满时排队的 worker 按优先级出队。这里只重排还在队列里的 worker；
+ * 正在传输的分片不打断，暂停/恢复后重新提交时自然使用新优先级。
+ */
+void DownloadTask::setPriority(int priority)
+{
+    if (priority == m_priority) {
+        return;
+    }
+    LOGD(QString("任务优先级调整 %1: %2 -> %3").arg(m_fileName).arg(m_priority).arg(priority));
+    m_priority = priority;
+    for (HttpWorker* worker : std::as_const(m_workers)) {
+        if (worker) {
+            worker->reprioritize(priority);
         }
-        LOGD(QString("任务取消完成 - URL:%1").arg(m_url.toString()));
-    } else {
-        LOGD("任务已完成或已取消，无需操作");
     }
 }
 
@@ -402,13 +631,8 @@ void DownloadTask::applyProxy(const QNetworkProxy& proxy)
         m_headManager->setProxy(proxy);
     }
 
-    // 已存在的 worker：拷贝到本地列表再操作，避免持锁调外部接口
-    QList<HttpWorker*> workerSnapshot;
-    {
-        QMutexLocker locker(&m_mutex);
-        workerSnapshot = m_workers;
-    }
-    for (HttpWorker* worker : workerSnapshot) {
+    // 已存在的 worker（m_workers 只在主线程读写）
+    for (HttpWorker* worker : std::as_const(m_workers)) {
         if (worker) {
             worker->setProxy(proxy);
         }
@@ -417,16 +641,10 @@ void DownloadTask::applyProxy(const QNetworkProxy& proxy)
 
 int DownloadTask::progressPercentage() const
 {
-    qint64 totalSize;
-    qint64 downloadedSize;
-    qint64 workerBytes;
-
-    {
-        QMutexLocker locker(&m_mutex); // 保护m_totalSize和m_downloadedSize
-        totalSize = m_totalSize;
-        downloadedSize = m_downloadedSize;
-        workerBytes = m_bytesReceivedByWorkers;
-    }
+    // 全部原子读：UI/HttpServer 读进度不会与 worker 回调或收尾线程互相阻塞
+    const qint64 totalSize = m_totalSize.load(std::memory_order_acquire);
+    const qint64 downloadedSize = m_downloadedSize.load(std::memory_order_acquire);
+    const qint64 workerBytes = m_bytesReceivedByWorkers.load(std::memory_order_acquire);
 
     if (totalSize > 0) {
         // 正常路径：有 Content-Length，按已下载字节 / 总大小算。
@@ -443,41 +661,86 @@ int DownloadTask::progressPercentage() const
     return percent > 99 ? 99 : static_cast<int>(percent);
 }
 
-void DownloadTask::setStatus(DownloadTaskStatus newStatus)
+bool DownloadTask::isLegalTransition(DownloadTaskStatus from, DownloadTaskStatus to)
 {
-    bool shouldEmitSignal = false;
-    DownloadTaskStatus statusToEmit;
-    
-    {
-        QMutexLocker locker(&m_statusMutex); // 使用专门的状态锁
-        if (m_status != newStatus) {
-            LOGD(QString("任务状态变更：%1 -> %2").arg(static_cast<int>(m_status)).arg(static_cast<int>(newStatus)));
-            m_status = newStatus;
-            statusToEmit = newStatus;
-            shouldEmitSignal = true;
-        }
+    switch (from) {
+    case DownloadTaskStatus::Pending:
+        // -> Paused：从退出队列恢复上次暂停的任务
+        return to == DownloadTaskStatus::Downloading ||
+               to == DownloadTaskStatus::Paused ||
+               to == DownloadTaskStatus::Cancelled ||
+               to == DownloadTaskStatus::Failed;
+    case DownloadTaskStatus::Downloading:
+        // -> Pending：探测后磁盘空间不足，回到队列等待
+        return to == DownloadTaskStatus::Pending ||
+               to == DownloadTaskStatus::Paused ||
+               to == DownloadTaskStatus::Cancelled ||
+               to == DownloadTaskStatus::Completed ||
+               to == DownloadTaskStatus::Failed;
+    case DownloadTaskStatus::Paused:
+        return to == DownloadTaskStatus::Downloading ||
+               to == DownloadTaskStatus::Cancelled ||
+               to == DownloadTaskStatus::Failed;
+    case DownloadTaskStatus::Failed:
+        // 失败的任务可以重新开始
+        return to == DownloadTaskStatus::Downloading;
+    case DownloadTaskStatus::Cancelled:
+    case DownloadTaskStatus::Completed:
+        return false;
     }
-    
-    // 在互斥锁外异步发射信号，避免潜在的死锁
-    if (shouldEmitSignal) {
-        LOGD("准备异步发射statusChanged信号");
-        QPointer<DownloadTask> safeThis(this);
-        QTimer::singleShot(0, this, [safeThis, statusToEmit]() {
-            if (safeThis) {
-                LOGD("异步发射statusChanged信号");
-                emit safeThis->statusChanged(statusToEmit);
-            }
-        });
-        LOGD("statusChanged信号已排队发射");
+    return false;
+}
+
+bool DownloadTask::transition(DownloadTaskStatus from, DownloadTaskStatus to)
+{
+    if (!isLegalTransition(from, to)) {
+        return false;
+    }
+    int expected = static_cast<int>(from);
+    if (!m_status.compare_exchange_strong(expected, static_cast<int>(to),
+                                          std::memory_order_acq_rel, std::memory_order_acquire)) {
+        return false;
+    }
+    LOGD(QString("任务状态变更：%1 -> %2").arg(static_cast<int>(from)).arg(static_cast<int>(to)));
+    notifyStatusChanged(to);
+    return true;
+}
+
+bool DownloadTask::transitionTo(DownloadTaskStatus to)
+{
+    int current = m_status.load(std::memory_order_acquire);
+    do {
+        const DownloadTaskStatus from = static_cast<DownloadTaskStatus>(current);
+        if (from == to || !isLegalTransition(from, to)) {
+            return false;
+        }
+    } while (!m_status.compare_exchange_weak(current, static_cast<int>(to),
+                                             std::memory_order_acq_rel, std::memory_order_acquire));
+    // CAS 成功时 current 仍是转换前的状态
+    LOGD(QString("任务状态变更：%1 -> %2").arg(current).arg(static_cast<int>(to)));
+    notifyStatusChanged(to);
+    return true;
+}
+
+void DownloadTask::notifyStatusChanged(DownloadTaskStatus status)
+{
+    // 主线程上直接发射，订阅者看到的就是这次转换的目标状态，不会再收到排队后过期的中间状态；
+    // 其它线程上的转换排队到本对象所在线程发射
+    if (QThread::currentThread() == thread()) {
+        emit statusChanged(status);
+        return;
     }
+    QMetaObject::invokeMethod(this, [this, status]() {
+        emit statusChanged(status);
+    }, Qt::QueuedConnection);
 }
 
 void DownloadTask::initializeDownload()
 {
     LOGD("开始初始化下载...");
 
-    if (m_status != DownloadTaskStatus::Downloading) {
-        LOGD(QString("任务状态已变更，取消HEAD请求，当前状态:%1").arg(static_cast<int>(m_status)));
+    if (status() != DownloadTaskStatus::Downloading) {
+        LOGD(QString("任务状态已变更，取消HEAD请求，当前状态:%1").arg(static_cast<int>(status())));
         return;
     }
 
@@ -499,7 +762,9 @@ void DownloadTask::initializeDownload()
                 m_headManager = nullptr;
             }
             
-            setStatus(DownloadTaskStatus::Failed);
+            if (!transitionTo(DownloadTaskStatus::Failed)) {
+                return;
+            }
             m_finishTime = QDateTime::currentDateTime();
             emit error(tr("无法创建下载目录: %1").arg(dir.path()));
             saveToHistory("Failed");
@@ -514,17 +779,34 @@ void DownloadTask::initializeDownload()
         LOGD("目录已存在");
     }
 
+    // 元数据缓存命中：不再发 HEAD，直接按缓存的大小、Range 支持与重定向终点分片
+    UrlMetadata cached;
+    if (UrlMetadataCache::instance().lookup(m_url, &cached)) {
+        LOGD(QString("URL 元数据缓存命中，跳过 HEAD 探测:%1").arg(m_url.toString()));
+        applyMetadata(cached);
+        QPointer<DownloadTask> safeThis(this);
+        QTimer::singleShot(0, this, [safeThis]() {
+            if (safeThis) {
+                safeThis->requestAdmission();
+            }
+        });
+        return;
+    }
+
     // 文件系统操作不需要锁保护
     LOGD("创建HEAD请求的网络管理器");
-    {
-        QMutexLocker locker(&m_mutex); // 仅在创建网络管理器时加锁
-        // 不要用 this 作为父对象，HEAD 请求通常早于 DownloadTask 析构；
-        // 如果父对象先析构，QNetworkAccessManager 会跟着销毁，可能正在飞的 reply
-        // 就会 UAF。改成无父对象，由 DownloadTask 显式管理 deleteLater 生命周期。
-        m_headManager = new QNetworkAccessManager();
-    }
+    // 不要用 this 作为父对象，HEAD 请求通常早于 DownloadTask 析构；
+    // 如果父对象先析构，QNetworkAccessManager 会跟着销毁，可能正在飞的 reply
+    // 就会 UAF。改成无父对象，由 DownloadTask 显式管理 deleteLater 生命周期。
+    m_headManager = new QNetworkAccessManager();
 
-    QNetworkRequest request(m_url);
+    m_headRedirects = 0;
+    sendHeadRequest(m_url);
+}
+
+void DownloadTask::sendHeadRequest(const QUrl& url)
+{
+    QNetworkRequest request(url);
     request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::SameOriginRedirectPolicy);
     request.setTransferTimeout(15000); // 15秒超时
     
@@ -536,7 +818,14 @@ void DownloadTask::initializeDownload()
     request.setRawHeader("Accept-Language", "en-US,en;q=0.9,zh-CN;q=0.8,zh;q=0.7");
     request.setRawHeader("Connection", "keep-alive");
 
-    LOGD(QString("发送HEAD请求到:%1").arg(m_url.toString()));
+    if (!m_pinnedAddresses.isEmpty()) {
+        HostGuard::pinRequest(request, m_url.host(), m_pinnedAddresses.first());
+        // 钉住后 URL 主机是 IP：QNAM 自己跟随重定向时，Location 写原主机名的下一跳会绕过钉住按 DNS 连接。
+        // 改为手动跟随，由 followPinnedRedirect 核对同源后把下一跳重新钉住
+        request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::ManualRedirectPolicy);
+    }
+
+    LOGD(QString("发送HEAD请求到:%1").arg(request.url().toString()));
     m_headReply = m_headManager->head(request);
 
     connect(m_headReply, &QNetworkReply::finished, this, &DownloadTask::onHeadRequestFinished);
@@ -557,10 +846,10 @@ void DownloadTask::initializeDownload()
             // 注意要排除 Cancelled / Completed 状态，避免覆盖 cancel() 后的状态
             QTimer::singleShot(100, safeThis, [safeThis]() {
                 if (safeThis) {
-                    QMutexLocker statusLocker(&safeThis->m_statusMutex);
-                    if (safeThis->m_status == DownloadTaskStatus::Failed ||
-                        safeThis->m_status == DownloadTaskStatus::Cancelled ||
-                        safeThis->m_status == DownloadTaskStatus::Completed) {
+                    const DownloadTaskStatus st = safeThis->status();
+                    if (st == DownloadTaskStatus::Failed ||
+                        st == DownloadTaskStatus::Cancelled ||
+                        st == DownloadTaskStatus::Completed) {
                         return;
                     }
                 }
@@ -580,7 +869,7 @@ void DownloadTask::handleHeadRequestError(const QString& errorString)
     LOGD(QString("处理HEAD请求错误:%1").arg(errorString));
     
     // 检查是否已经处理过错误（避免重复处理）
-    if (m_status == DownloadTaskStatus::Failed) {
+    if (status() == DownloadTaskStatus::Failed) {
         LOGD("HEAD请求错误已处理，忽略重复处理");
         return;
     }
@@ -595,8 +884,13 @@ void DownloadTask::handleHeadRequestError(const QString& errorString)
         m_headManager = nullptr;
     }
     
+    // 已被取消/暂停后转为其它终态时，转换失败即不再报错
+    if (!transitionTo(DownloadTaskStatus::Failed)) {
+        return;
+    }
+    // HEAD 之前还没有分片：构造时建的暂存目录是空的
+    removeEmptyStagingDirectory();
     emit error(tr("HEAD请求失败: %1").arg(errorString));
-    setStatus(DownloadTaskStatus::Failed);
     m_finishTime = QDateTime::currentDateTime();
     saveToHistory("Failed");
     if (!m_alreadyFinished) {
@@ -608,16 +902,34 @@ void DownloadTask::handleHeadRequestError(const QString& errorString)
 void DownloadTask::processHeadResponse()
 {
     // processHeadResponse 仅在主线程 onHeadRequestFinished 内被调用，
-    // 与 m_totalSize / m_threadCount 的其他写入路径不并发，不需要 m_mutex。
-    m_totalSize = m_headReply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
-    LOGD(QString("文件大小:%1 字节").arg(m_totalSize));
+    // m_threadCount 只有主线程写；m_totalSize 为原子量，供其它线程无锁读取。
+    UrlMetadata metadata = UrlMetadataCache::metadataFromReply(m_headReply);
+    // 钉住的请求 URL 主机是 IP，换回原主机名，DownloadManager 据此合并指向同一资源的重复请求
+    if (!m_pinnedAddresses.isEmpty()) {
+        metadata.finalUrl.setHost(m_url.host());
+    }
+    UrlMetadataCache::instance().store(m_url, metadata);
 
-    if (m_totalSize <= 0) {
+    applyMetadata(metadata);
+}
+
+void DownloadTask::applyMetadata(const UrlMetadata& metadata)
+{
+    m_effectiveUrl = metadata.finalUrl;
+    if (m_effectiveUrl != m_url) {
+        LOGD(QString("重定向终点:%1").arg(m_effectiveUrl.toString()));
+    }
+
+    const qint64 contentLength = metadata.totalSize;
+    m_totalSize.store(contentLength, std::memory_order_release);
+    LOGD(QString("文件大小:%1 字节").arg(contentLength));
+
+    if (contentLength <= 0) {
         LOGD("无法获取内容长度，强制使用单线程下载");
         m_threadCount = 1;
     }
 
-    bool acceptRanges = m_headReply->rawHeader("Accept-Ranges") == "bytes";
+    const bool acceptRanges = metadata.acceptRanges;
     LOGD(QString("服务器支持Range请求:%1").arg(acceptRanges ? "是" : "否"));
 
     if (!acceptRanges && m_threadCount > 1) {
@@ -625,6 +937,16 @@ void DownloadTask::processHeadResponse()
         m_threadCount = 1;
     }
 
+    // 主机画像：已知无视 Range 的主机不再尝试分片；吞吐早已到平台的主机少开连接
+    const QUrl source = m_effectiveUrl.isValid() ? m_effectiveUrl : m_url;
+    m_hostHints = HostProfileStore::instance().hints(source.host(), m_threadCount);
+    if (m_hostHints.ignoresRange && m_threadCount > 1) {
+        LOGD("主机画像：服务器近期无视 Range，使用单线程下载");
+    } else if (m_hostHints.segments != m_threadCount) {
+        LOGD(QString("主机画像：分片数 %1 -> %2").arg(m_threadCount).arg(m_hostHints.segments));
+    }
+    m_threadCount = m_hostHints.segments;
+
     LOGD(QString("最终线程数:%1").arg(m_threadCount));
 }
 
@@ -644,7 +966,7 @@ void DownloadTask::onHeadRequestFinished()
     }
 
     // 检查是否已经处理过错误（避免重复处理）
-    if (m_status == DownloadTaskStatus::Failed) {
+    if (status() == DownloadTaskStatus::Failed) {
         LOGD("HEAD请求错误已处理，忽略此回调");
         return;
     }
@@ -654,6 +976,10 @@ void DownloadTask::onHeadRequestFinished()
         return;
     }
 
+    if (!m_pinnedAddresses.isEmpty() && followPinnedRedirect()) {
+        return;
+    }
+
     LOGD("HEAD请求成功，开始解析响应头...");
     processHeadResponse();
 
@@ -667,15 +993,53 @@ void DownloadTask::onHeadRequestFinished()
     QTimer::singleShot(0, safeThis, [safeThis]() {
         if (safeThis) {
             LOGD("异步创建HttpWorkers...");
-            safeThis->createHttpWorkers();
-            safeThis->m_speedCalculationTimer.start();
-            LOGD("HttpWorkers创建完成，速度计算定时器已启动");
+            safeThis->requestAdmission();
         }
     });
 
     LOGD("HEAD请求处理完成");
 }
 
+bool DownloadTask::followPinnedRedirect()
+{
+    const int statusCode = m_headReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (statusCode != 301 && statusCode != 302 && statusCode != 303 && statusCode != 307 && statusCode != 308) {
+        return false;
+    }
+    const QUrl location = m_headReply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl();
+    if (!location.isValid()) {
+        return false;
+    }
+
+    // 相对的 Location 按请求 URL（主机是钉住的 IP）解析；主机换回原主机名后统一核对、重新钉住
+    const QString pinnedHost = m_headReply->url().host();
+    QUrl target = m_headReply->url().resolved(location);
+    if (target.host() == pinnedHost) {
+        target.setHost(m_url.host());
+    }
+
+    // 规则与 SameOriginRedirectPolicy 相同：协议、端口一致，主机为原主机
+    const int defaultPort = m_url.scheme().compare("https", Qt::CaseInsensitive) == 0 ? 443 : 80;
+    const bool sameOrigin = target.scheme().compare(m_url.scheme(), Qt::CaseInsensitive) == 0
+        && target.port(defaultPort) == m_url.port(defaultPort)
+        && target.host().compare(m_url.host(), Qt::CaseInsensitive) == 0;
+    if (!sameOrigin) {
+        LOGD(QString("HEAD 跨源重定向被拒绝:%1").arg(target.toString()));
+        handleHeadRequestError(tr("跨源重定向被拒绝: %1").arg(target.toString()));
+        return true;
+    }
+    if (++m_headRedirects > kMaxHeadRedirects) {
+        handleHeadRequestError(tr("重定向次数过多"));
+        return true;
+    }
+
+    LOGD(QString("HEAD 同源重定向（重新钉住）:%1").arg(target.toString()));
+    m_headReply->deleteLater();
+    m_headReply = nullptr;
+    sendHeadRequest(target);
+    return true;
+}
+
 void DownloadTask::onHeadRequestError(QNetworkReply::NetworkError code)
 {
     Q_UNUSED(code);
@@ -693,21 +1057,12 @@ void DownloadTask::onHeadRequestError(QNetworkReply::NetworkError code)
     }
     
     // 检查是否已经处理过错误（避免重复处理）
-    if (m_status == DownloadTaskStatus::Failed) {
+    if (status() == DownloadTaskStatus::Failed) {
         LOGD("HEAD请求错误已处理，忽略此回调");
         return;
     }
     
-    QString errorString;
-    
-    {
-        QMutexLocker locker(&m_mutex); // 保护m_headReply
-        if (m_headReply) {
-            errorString = m_headReply->errorString();
-        } else {
-            errorString = tr("未知网络错误");
-        }
-    }
+    const QString errorString = m_headReply ? m_headReply->errorString() : tr("未知网络错误");
     
     LOGD(QString("HEAD请求错误，错误码:%1 错误信息:%2").arg(code).arg(errorString));
     
@@ -721,8 +1076,11 @@ void DownloadTask::onHeadRequestError(QNetworkReply::NetworkError code)
         m_headManager = nullptr;
     }
     
+    if (!transitionTo(DownloadTaskStatus::Failed)) {
+        return;
+    }
+    removeEmptyStagingDirectory();
     emit error(tr("HEAD请求错误: %1").arg(errorString));
-    setStatus(DownloadTaskStatus::Failed);
     m_finishTime = QDateTime::currentDateTime();
     saveToHistory("Failed");
     if (!m_alreadyFinished) {
@@ -731,11 +1089,127 @@ void DownloadTask::onHeadRequestError(QNetworkReply::NetworkError code)
     }
 }
 
+void DownloadTask::requestAdmission()
+{
+    if (status() != DownloadTaskStatus::Downloading) {
+        LOGD(QString("任务状态已变更，跳过磁盘空间准入，当前状态:%1").arg(static_cast<int>(status())));
+        return;
+    }
+
+    if (DownloadManager::instance().admitTask(this)) {
+        beginTransfer();
+        return;
+    }
+
+    // 空间不足：回到 Pending 排队，而不是跑一小时后在合并阶段失败
+    LOGD(QString("磁盘空间不足，任务进入等待队列：%1").arg(m_fileName));
+    m_waitingForDiskSpace = true;
+    transition(DownloadTaskStatus::Downloading, DownloadTaskStatus::Pending);
+}
+
+void DownloadTask::onDiskSpaceAdmitted()
+{
+    if (!m_waitingForDiskSpace || !transition(DownloadTaskStatus::Pending, DownloadTaskStatus::Downloading)) {
+        return;
+    }
+    LOGD(QString("磁盘空间已满足，继续任务：%1").arg(m_fileName));
+    m_waitingForDiskSpace = false;
+    beginTransfer();
+}
+
+void DownloadTask::beginTransfer()
+{
+    // 上次已合并完成、只差移动：分片可能已被 rename 掉，不再建 worker
+    const int mergedParts = completedMergePartCount();
+    if (mergedParts > 0) {
+        LOGD(QString("合并检查点显示%1个分片已合并完成，直接收尾").arg(mergedParts));
+        m_threadCount = mergedParts;
+        m_createdWorkerCount = mergedParts;
+        startFinalize();
+        return;
+    }
+
+    preallocateMergeFile();
+    LOGD("异步创建HttpWorkers...");
+    createHttpWorkers();
+    LOGD("HttpWorkers创建完成");
+}
+
+QString DownloadTask::partFilePath(int index) const
+{
+    return QDir(m_tempDirectory).filePath(QFileInfo(m_filePath).fileName() + QString(".part%1").arg(index));
+}
+
+QString DownloadTask::mergeFilePath() const
+{
+    return QDir(m_tempDirectory).filePath(QFileInfo(m_filePath).fileName() + ".merge");
+}
+
+bool DownloadTask::needsMergeCopy() const
+{
+    // 单分片收尾走 rename，不需要额外的合并空间
+    return totalSize() > 0 && m_threadCount > 1;
+}
+
+qint64 DownloadTask::pendingDownloadBytes() const
+{
+    if (totalSize() <= 0 || completedMergePartCount() > 0) {
+        return 0;
+    }
+    // 断点续传时已落盘的分片不需要再占空间；分片数上限与 createHttpWorkers 的 clamp 一致
+    qint64 onDisk = 0;
+    for (int i = 0; i < kMaxThreadCount; ++i) {
+        const QFileInfo part(partFilePath(i));
+        if (!part.exists()) {
+            break;
+        }
+        onDisk += part.size();
+    }
+    return qMax<qint64>(0, totalSize() - onDisk);
+}
+
+qint64 DownloadTask::mergeReserveBytes() const
+{
+    if (!needsMergeCopy()) {
+        return 0;
+    }
+    // 已预分配（或续合并中）的 .merge 已经计入文件系统的已用空间
+    return qMax<qint64>(0, totalSize() - QFileInfo(mergeFilePath()).size());
+}
+
+void DownloadTask::preallocateMergeFile()
+{
+    if (!needsMergeCopy()) {
+        return;
+    }
+    const QString path = mergeFilePath();
+    if (QFileInfo(path).size() >= totalSize()) {
+        return;
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadWrite)) {
+        LOGD(QString("无法打开合并文件进行预分配:%1 错误:%2").arg(path).arg(file.errorString()));
+        return;
+    }
+
+    bool allocated = false;
+#ifdef __linux__
+    // fallocate 真正占住块；不支持的文件系统返回 EOPNOTSUPP，再退回 resize
+    allocated = ::fallocate(file.handle(), 0, 0, static_cast<off_t>(totalSize())) == 0;
+#endif
+    if (!allocated) {
+        // Windows/NTFS 上 SetEndOfFile 会分配簇；其它平台尽力而为（可能是稀疏文件）
+        allocated = file.resize(totalSize());
+    }
+    file.close();
+    LOGD(QString("预分配合并文件:%1 大小:%2 结果:%3").arg(path).arg(totalSize()).arg(allocated ? "成功" : "失败"));
+}
+
 void DownloadTask::createHttpWorkers()
 {
     LOGD(QString("开始创建%1个HttpWorkers...").arg(m_threadCount));
-
-    QMutexLocker locker(&m_mutex); // 保护m_workers
+    const qint64 totalSize = m_totalSize.load(std::memory_order_acquire);
 
     // 防御性检查：m_threadCount 不能为 0，避免除零
     if (m_threadCount <= 0) {
@@ -743,37 +1217,42 @@ void DownloadTask::createHttpWorkers()
         m_threadCount = 1;
     }
 
-    // m_totalSize <= 0 时走单线程分支（不使用 Range）
-    if (m_totalSize <= 0 || m_threadCount == 1) {
+    // 上次退出时留下的续传清单：按清单里的分片范围建 worker，与磁盘上已有分片对齐。
+    // 必须在单线程分支之前判断——线程数设置变了也不能让新范围错位地追加到旧分片上。
+    if (totalSize > 0) {
+        const QList<ResumePart> saved = loadResumeManifest(totalSize);
+        if (!saved.isEmpty()) {
+            LOGD(QString("按续传清单恢复%1个分片（设置线程数:%2）").arg(saved.size()).arg(m_threadCount));
+            m_threadCount = saved.size();
+            const bool singlePart = (saved.size() == 1);
+            for (int i = 0; i < saved.size(); ++i) {
+                addWorker(partFilePath(i), saved[i].start, saved[i].end, singlePart ? -1 : i);
+            }
+            m_createdWorkerCount = m_threadCount;
+            return;
+        }
+    }
+
+    // totalSize <= 0 时走单线程分支（不使用 Range）
+    if (totalSize <= 0 || m_threadCount == 1) {
         // 单线程下载
         LOGD("使用单线程下载模式");
         QString tempFileName = QFileInfo(m_filePath).fileName() + ".part0";
         QString tempFilePath = QDir(m_tempDirectory).filePath(tempFileName);
-        // 当 m_totalSize 未知时，endPoint 设为 -1 作为哨兵值，HttpWorker 检测到后
+        // 当 totalSize 未知时，endPoint 设为 -1 作为哨兵值，HttpWorker 检测到后
         // 不发送 Range 头，直接读完整文件直到服务器结束
-        qint64 endPoint = (m_totalSize > 0) ? (m_totalSize - 1) : -1;
+        qint64 endPoint = (totalSize > 0) ? (totalSize - 1) : -1;
         LOGD(QString("创建单线程worker，临时文件:%1 范围:0-%2 (endPoint=-1表示整文件下载)")
              .arg(tempFilePath).arg(endPoint));
-        HttpWorker* worker = new HttpWorker(m_url, tempFilePath, 0, endPoint);
-        m_workers.append(worker);
-        // worker 跑在自己的线程上（HttpWorker::run() 入口 moveToThread），
-        // 强制 QueuedConnection 让 progress/finished/error 信号投回主线程的 DownloadTask 槽，
-        // 避免 auto-detect 把信号在 worker 线程同步派发到主线程对象导致跨线程访问。
-        connect(worker, &HttpWorker::progress, this, &DownloadTask::onWorkerProgress, Qt::QueuedConnection);
-        connect(worker, &HttpWorker::finished, this, &DownloadTask::onWorkerFinished, Qt::QueuedConnection);
-        connect(worker, &HttpWorker::error, this, &DownloadTask::onWorkerError, Qt::QueuedConnection);
-        LOGD("单线程worker创建完成，提交到线程池...");
-        m_threadPool->start(worker);
+        addWorker(tempFilePath, 0, endPoint, -1);
         m_createdWorkerCount = 1;
         LOGD("单线程worker已提交到线程池");
         return;
     }
 
-    LOGD(QString("使用多线程下载模式，文件大小:%1").arg(m_totalSize));
+    LOGD(QString("使用多线程下载模式，文件大小:%1").arg(totalSize));
 
-    // 把线程数限制在合理区间 [1, 16]。INT_MAX 会让 chunkSize 计算溢出
-    // 或创建数千个 worker 把磁盘/线程池打爆。
-    constexpr int kMaxThreadCount = 16;
+    // 把线程数限制在合理区间 [1, kMaxThreadCount]。
     if (m_threadCount > kMaxThreadCount) {
         LOGD(QString("线程数(%1)超过上限%2，截断").arg(m_threadCount).arg(kMaxThreadCount));
         m_threadCount = kMaxThreadCount;
@@ -783,43 +1262,33 @@ void DownloadTask::createHttpWorkers()
         m_threadCount = 1;
     }
 
-    // 防止 m_totalSize < m_threadCount 导致 chunkSize=0：
+    // 防止 totalSize < m_threadCount 导致 chunkSize=0：
     // 实际并发数不超过文件总字节数（至少 1 字节/线程），多余的 worker 就不再创建
-    const int effectiveThreadCount = qMin(m_threadCount, static_cast<int>(qMax<qint64>(1, m_totalSize)));
+    const int effectiveThreadCount = qMin(m_threadCount, static_cast<int>(qMax<qint64>(1, totalSize)));
     if (effectiveThreadCount != m_threadCount) {
         LOGD(QString("线程数(%1)超过文件大小(%2)，调整为%3")
-             .arg(m_threadCount).arg(m_totalSize).arg(effectiveThreadCount));
+             .arg(m_threadCount).arg(totalSize).arg(effectiveThreadCount));
         m_threadCount = effectiveThreadCount;
     }
 
-    const qint64 chunkSize = m_totalSize / m_threadCount;
-    const qint64 leftover = m_totalSize % m_threadCount; // 余数字节，分散到前 leftover 个 worker
+    const qint64 chunkSize = totalSize / m_threadCount;
+    const qint64 leftover = totalSize % m_threadCount; // 余数字节，分散到前 leftover 个 worker
     QString baseFileName = QFileInfo(m_filePath).fileName();
 
     for (int i = 0; i < m_threadCount; ++i) {
         // 把余数字节按 1 byte/worker 均匀分散给前 leftover 个 worker
         const qint64 extra = (i < leftover) ? 1 : 0;
         const qint64 startPoint = i * chunkSize + extra;
-        qint64 endPoint = (i == m_threadCount - 1) ? (m_totalSize - 1) : (startPoint + chunkSize - 1);
-        if (endPoint >= m_totalSize) {
-            endPoint = m_totalSize - 1;
+        qint64 endPoint = (i == m_threadCount - 1) ? (totalSize - 1) : (startPoint + chunkSize - 1);
+        if (endPoint >= totalSize) {
+            endPoint = totalSize - 1;
         }
         QString tempFileName = baseFileName + QString(".part%1").arg(i);
         QString tempFilePath = QDir(m_tempDirectory).filePath(tempFileName);
 
         LOGD(QString("创建worker%1 范围:%2-%3 临时文件:%4").arg(i).arg(startPoint).arg(endPoint).arg(tempFilePath));
 
-        HttpWorker* worker = new HttpWorker(m_url, tempFilePath, startPoint, endPoint, i);
-        m_workers.append(worker);
-
-        // worker 跑在自己的线程上（HttpWorker::run() 入口 moveToThread），
-        // 强制 QueuedConnection 让 progress/finished/error 信号投回主线程的 DownloadTask 槽。
-        connect(worker, &HttpWorker::progress, this, &DownloadTask::onWorkerProgress, Qt::QueuedConnection);
-        connect(worker, &HttpWorker::finished, this, &DownloadTask::onWorkerFinished, Qt::QueuedConnection);
-        connect(worker, &HttpWorker::error, this, &DownloadTask::onWorkerError, Qt::QueuedConnection);
-
-        LOGD(QString("worker%1创建完成，提交到线程池...").arg(i));
-        m_threadPool->start(worker);
+        addWorker(tempFilePath, startPoint, endPoint, i);
         LOGD(QString("worker%1已提交到线程池").arg(i));
     }
 
@@ -830,126 +1299,187 @@ void DownloadTask::createHttpWorkers()
     LOGD("所有workers创建完成");
 }
 
-void DownloadTask::onWorkerProgress(qint64 bytes)
+void DownloadTask::addWorker(const QString& tempFilePath, qint64 startPoint, qint64 endPoint, int partIndex)
 {
-    // 防止合并/取消/失败之后还有迟到 onWorkerProgress 信号
-    // 把 m_downloadedSize 推回小于 totalSize 的值，进而误导 UI 显示未完成
-    {
-        QMutexLocker statusLocker(&m_statusMutex);
-        if (m_status == DownloadTaskStatus::Completed ||
-            m_status == DownloadTaskStatus::Failed ||
-            m_status == DownloadTaskStatus::Cancelled) {
-            return;
-        }
-    }
-
-    qint64 downloadedSize;
-    qint64 totalSize;
-    qint64 downloadSpeed;
-
-    {
-        QMutexLocker locker(&m_mutex); // 保护m_downloadedSize和m_lastDownloadedSize
-        m_downloadedSize += bytes;
-
-        // Copy values to local variables before releasing the mutex
-        downloadedSize = m_downloadedSize;
-        totalSize = m_totalSize;
-        downloadSpeed = m_downloadSpeed;
-    }
-
-    // Emit signal outside of mutex lock to avoid potential deadlocks
-    emit progressUpdated(downloadedSize, totalSize, downloadSpeed);
+    // 直接请求探测得到的重定向终点，每个分片与重试不再各自走一遍重定向链
+    const QUrl source = m_effectiveUrl.isValid() ? m_effectiveUrl : m_url;
+    HttpWorker* worker = new HttpWorker(source, tempFilePath, startPoint, endPoint, partIndex);
+    worker->setPinnedAddresses(m_url.host(), m_pinnedAddresses);
+    worker->setTransferHints(m_hostHints.transferTimeoutMs, m_hostHints.readBufferBytes);
+    m_workers.append(worker);
+    // worker 跑在自己的线程上（HttpWorker::run() 入口 moveToThread），
+    // 强制 QueuedConnection 让 finished/error 信号投回主线程的 DownloadTask 槽，
+    // 避免 auto-detect 把信号在 worker 线程同步派发到主线程对象导致跨线程访问。
+    connect(worker, &HttpWorker::finished, this, &DownloadTask::onWorkerFinished, Qt::QueuedConnection);
+    connect(worker, &HttpWorker::error, this, &DownloadTask::onWorkerError, Qt::QueuedConnection);
+    connect(worker, &HttpWorker::stopped, this, &DownloadTask::onWorkerStopped, Qt::QueuedConnection);
+    worker->submit(m_threadPool, m_priority);
 }
 
 void DownloadTask::onWorkerFinished()
 {
-    bool shouldMergeFiles = false;
-    int finishedCount = 0;
+    // 取消/出错后排队到达的完成信号不再计数，避免对已结束的任务启动收尾
+    if (status() != DownloadTaskStatus::Downloading) {
+        LOGD(QString("任务已不在下载状态，忽略worker完成信号，状态:%1").arg(static_cast<int>(status())));
+        return;
+    }
 
-    {
-        QMutexLocker locker(&m_mutex); // 保护m_finishedWorkers和m_workers
-        m_finishedWorkers++;
-        finishedCount = m_finishedWorkers;
+    // worker 信号都以 QueuedConnection 投递到主线程，m_finishedWorkers 无需加锁
+    m_finishedWorkers++;
+    const int finishedCount = m_finishedWorkers;
 
-        // 直接比较，不调用allWorkersFinished()方法
-        // 用 m_createdWorkerCount（创建时的实际 part 数快照）而不是 m_threadCount，
-        // 防止未来有路径在 createHttpWorkers 返回后再改写 m_threadCount 导致永远不触发。
-        shouldMergeFiles = (m_finishedWorkers == m_createdWorkerCount);
-    }
+    // 用 m_createdWorkerCount（创建时的实际 part 数快照）而不是 m_threadCount，
+    // 防止未来有路径在 createHttpWorkers 返回后再改写 m_threadCount 导致永远不触发。
+    const bool shouldMergeFiles = (m_finishedWorkers == m_createdWorkerCount);
 
     LOGD(QString("worker完成，已完成worker数:%1/%2").arg(finishedCount).arg(m_threadCount));
 
     if (shouldMergeFiles) {
+        // 暂停请求与最后一个分片完成擦肩而过：分片已齐，收尾优先，放弃挂起的暂停
+        if (m_stopIntent != StopIntent::None) {
+            LOGD("停止确认到齐前所有分片已完成，放弃挂起的暂停/恢复");
+            m_stopIntent = StopIntent::None;
+            m_pendingStopAcks = 0;
+        }
+
         LOGD("所有worker完成，先停止所有worker确保它们不再写文件");
         // 在合并/删除临时文件前，先确保所有worker都已停止（stopAsync内部已经
         // 在onFinished中调用过cleanup，但保险起见再发一次）
-        {
-            QList<HttpWorker*> workers;
-            {
-                QMutexLocker locker(&m_mutex);
-                workers = m_workers;
-            }
-            for (HttpWorker* worker : workers) {
-                if (worker) {
-                    worker->stopAsync();
-                }
+        for (HttpWorker* worker : std::as_const(m_workers)) {
+            if (worker) {
+                worker->stopAsync();
             }
         }
 
-        LOGD("开始合并文件");
-        m_speedCalculationTimer.stop();
-        if (mergeFiles()) {
-            LOGD("文件合并成功");
-            setStatus(DownloadTaskStatus::Completed);
-            m_finishTime = QDateTime::currentDateTime();
-            saveToHistory("Completed");
-            if (!m_alreadyFinished) {
-                m_alreadyFinished = true;
-                emit finished();
-            }
-            LOGD(QString("任务完成 - URL:%1").arg(m_url.toString()));
-        } else {
-            LOGD("文件合并失败");
-            setStatus(DownloadTaskStatus::Failed);
-            m_finishTime = QDateTime::currentDateTime();
-            saveToHistory("Failed");
-            emit error(tr("文件合并失败！"));
-            if (!m_alreadyFinished) {
-                m_alreadyFinished = true;
-                emit finished();
-            }
-            LOGD(QString("任务失败 - URL:%1").arg(m_url.toString()));
-        }
-        // 临时文件删除由mergeFiles()内部完成，避免worker还在写时被unlink
+        // 合并/校验/移动/清理交给 finalize 线程池，主线程（UI、托盘、HttpServer）不被阻塞
+        startFinalize();
     }
 }
 
-void DownloadTask::onWorkerError(const QString& errorString)
+void DownloadTask::startFinalize()
 {
-    bool shouldStopWorkers = false;
+    if (m_finalizeWatcher) {
+        LOGD("收尾作业已在运行，忽略重复启动");
+        return;
+    }
 
-    {
-        QMutexLocker statusLocker(&m_statusMutex); // 统一用m_statusMutex保护m_status
-        if (m_status != DownloadTaskStatus::Failed && m_status != DownloadTaskStatus::Cancelled) {
-            LOGD(QString("worker出错，错误信息:%1").arg(errorString));
-            // 走 setStatus() 以确保 statusChanged 信号被发射
-            setStatus(DownloadTaskStatus::Failed);
-            m_speedCalculationTimer.stop();
-            m_finishTime = QDateTime::currentDateTime();
-            saveToHistory("Failed");
-            shouldStopWorkers = true;
+    LOGD("提交收尾作业到finalize线程池");
+    m_finalizeAbort.store(false, std::memory_order_release);
+    m_deleteTempsAfterFinalize = false;
+    m_finalizeProcessed.store(0, std::memory_order_release);
+    m_finalizeTotal.store(0, std::memory_order_release);
+    // 收尾期间遥测采样看到 phase != None，改为报告合并进度
+    m_finalizePhase.store(static_cast<int>(FinalizePhase::Merging), std::memory_order_release);
+
+    m_finalizeWatcher = new QFutureWatcher<bool>(this);
+    connect(m_finalizeWatcher, &QFutureWatcher<bool>::finished, this, &DownloadTask::onFinalizeFinished);
+    m_finalizeWatcher->setFuture(QtConcurrent::run(DownloadManager::instance().finalizePool(),
+                                                   [this]() { return mergeFiles(); }));
+}
+
+void DownloadTask::onFinalizeFinished()
+{
+    if (!m_finalizeWatcher) {
+        return;
+    }
+    const bool merged = m_finalizeWatcher->result();
+    m_finalizeWatcher->deleteLater();
+    m_finalizeWatcher = nullptr;
+    m_finalizePhase.store(static_cast<int>(FinalizePhase::None), std::memory_order_release);
+
+    // 退出检查点中止的收尾：不是失败，合并检查点已保留，下次启动续合并。
+    // 中止前已经合并完成的照常走完成路径。
+    if (m_checkpointing) {
+        LOGD(QString("退出检查点：收尾作业已退出，合并结果:%1").arg(merged));
+        emit checkpointReady();
+        if (!merged) {
+            return;
         }
     }
 
-    if (shouldStopWorkers) {
-        QList<HttpWorker*> workers;
-        {
-            QMutexLocker locker(&m_mutex);
-            workers = m_workers;
+    // 收尾期间任务已被取消：不再切换 Completed/Failed，只补做被推迟的临时文件删除
+    if (status() == DownloadTaskStatus::Cancelled) {
+        LOGD(QString("收尾作业在取消后退出，合并结果:%1").arg(merged));
+        if (m_deleteTempsAfterFinalize) {
+            deleteTempFiles();
+            m_deleteTempsAfterFinalize = false;
+        }
+        return;
+    }
+
+    // 转换失败说明任务已进入其它终态（例如收尾结束前被取消），不再覆盖
+    if (!transitionTo(merged ? DownloadTaskStatus::Completed : DownloadTaskStatus::Failed)) {
+        LOGD(QString("收尾作业结束但状态已变更，当前状态:%1").arg(static_cast<int>(status())));
+        return;
+    }
+
+    if (merged) {
+        LOGD("文件合并成功");
+        recordHostProfile();
+        m_finishTime = QDateTime::currentDateTime();
+        saveToHistory("Completed");
+        if (!m_alreadyFinished) {
+            m_alreadyFinished = true;
+            emit finished();
+        }
+        LOGD(QString("任务完成 - URL:%1").arg(m_url.toString()));
+    } else {
+        LOGD("文件合并失败");
+        m_finishTime = QDateTime::currentDateTime();
+        saveToHistory("Failed");
+        emit error(tr("文件合并失败！"));
+        if (!m_alreadyFinished) {
+            m_alreadyFinished = true;
+            emit finished();
+        }
+        LOGD(QString("任务失败 - URL:%1").arg(m_url.toString()));
+    }
+}
+
+void DownloadTask::recordHostProfile()
+{
+    // 服务器无视 Range 时整文件落在 part0 上，实际只用了一个连接
+    bool rangeIgnored = false;
+    for (const HttpWorker* w : std::as_const(m_workers)) {
+        if (w && w->rangeIgnored()) {
+            rangeIgnored = true;
+            break;
         }
-        LOGD(QString("停止所有其他worker，总数:%1").arg(workers.size()));
+    }
+    const int segments = rangeIgnored ? 1 : qMax(1, m_createdWorkerCount);
+    const QUrl source = m_effectiveUrl.isValid() ? m_effectiveUrl : m_url;
+    HostProfileStore& store = HostProfileStore::instance();
+    store.recordTransfer(source.host(), segments, m_activeNetworkBytes, m_activeMs);
+    store.save();
+}
+
+int DownloadTask::finalizePercentage() const
+{
+    const qint64 total = m_finalizeTotal.load(std::memory_order_acquire);
+    if (total <= 0) {
+        return 0;
+    }
+    const qint64 processed = m_finalizeProcessed.load(std::memory_order_acquire);
+    if (processed >= total) {
+        return 100;
+    }
+    return static_cast<int>((processed * 100) / total);
+}
+
+void DownloadTask::onWorkerError(const QString& errorString)
+{
+    // 多个 worker 同时出错时只有第一个转换成功，其余直接忽略
+    const bool shouldStopWorkers = transitionTo(DownloadTaskStatus::Failed);
+    if (shouldStopWorkers) {
+        LOGD(QString("worker出错，错误信息:%1").arg(errorString));
+        m_finishTime = QDateTime::currentDateTime();
+        saveToHistory("Failed");
+    }
+
+    if (shouldStopWorkers) {
+        LOGD(QString("停止所有其他worker，总数:%1").arg(m_workers.size()));
         // 停止所有其他worker
-        for (HttpWorker* worker : workers) {
+        for (HttpWorker* worker : std::as_const(m_workers)) {
             if (worker) {
                 worker->stop();
             }
@@ -965,53 +1495,67 @@ void DownloadTask::onWorkerError(const QString& errorString)
     }
 }
 
-void DownloadTask::onSpeedCalculationTimerTimeout()
+TaskTelemetry DownloadTask::sampleTelemetry(qint64 elapsedMs)
 {
-    qint64 downloadedSize;
-    qint64 downloadSpeed;
-    qint64 totalSize;
-
-    {
-        QMutexLocker locker(&m_mutex); // 保护m_downloadedSize和m_lastDownloadedSize
-        // 合并完成后 m_downloadedSize 可能被回写为 totalSize，
-        // 再减去旧值会得到负数；clamp 到 0 避免 UI 显示负速度。
-        const qint64 delta = m_downloadedSize - m_lastDownloadedSize;
-        m_downloadSpeed = delta > 0 ? delta : 0;
-        m_lastDownloadedSize = m_downloadedSize;
-
-        // 累计 worker 实际写入字节，给 HEAD 没拿到 Content-Length 的场景
-        // 提供"已下载多少"的量化（不依赖 m_downloadedSize 增量，避免被
-        // merge 阶段的 updateDownloadedSize 干扰）。
-        qint64 workerSum = 0;
-        for (const HttpWorker* w : std::as_const(m_workers)) {
-            if (w) workerSum += w->bytesReceivedAtomic();
+    TaskTelemetry sample;
+    sample.task = this;
+    sample.status = status();
+    sample.phase = finalizePhase();
+
+    // 主线程调用；m_workers 只在主线程读写，worker 计数本身是原子量
+    qint64 workerSum = 0;
+    qint64 networkSum = 0;
+    for (const HttpWorker* w : std::as_const(m_workers)) {
+        if (w) {
+            workerSum += w->bytesReceivedAtomic();
+            networkSum += w->networkBytesAtomic();
         }
-        m_bytesReceivedByWorkers = workerSum;
-
-        // Copy values to local variables before releasing the mutex
-        downloadedSize = m_downloadedSize;
-        downloadSpeed = m_downloadSpeed;
-        totalSize = m_totalSize;
     }
-
-    // Emit signal outside of mutex lock to avoid potential deadlocks
-    // HEAD 没给 Content-Length 时 m_totalSize==0，progressPercentage() 仍返 0，
-    // 但 MainWindow 大小列现在可以基于 m_bytesReceivedByWorkers 显示已下载字节数。
-    emit progressUpdated(downloadedSize, totalSize, downloadSpeed);
+    m_bytesReceivedByWorkers.store(workerSum, std::memory_order_release);
+
+    if (sample.phase == FinalizePhase::None && sample.status == DownloadTaskStatus::Downloading) {
+        // 网络字节单调递增，增量不会为负；按实际采样间隔折算成瞬时速度后做 EWMA，
+        // 平滑系数随间隔变化，定时器抖动时时间常数保持不变
+        const qint64 delta = qMax<qint64>(0, networkSum - m_lastDownloadedSize);
+        const double instant = elapsedMs > 0 ? double(delta) * 1000.0 / double(elapsedMs) : m_smoothedSpeed;
+        const double alpha = 1.0 - std::exp(-double(qMax<qint64>(elapsedMs, 1)) / kSpeedSmoothingMs);
+        m_smoothedSpeed += alpha * (instant - m_smoothedSpeed);
+        m_activeNetworkBytes += delta;
+        m_activeMs += elapsedMs;
+    } else {
+        // 暂停/排队/收尾期间没有网络流量
+        m_smoothedSpeed = 0.0;
+    }
+    m_lastDownloadedSize = networkSum;
+    const qint64 speed = qRound64(m_smoothedSpeed);
+
+    // worker 计数包含续传前已在磁盘上的字节；合并完成后由 updateDownloadedSize 写入最终大小，不再覆盖
+    if (!m_workers.isEmpty() && sample.phase == FinalizePhase::None &&
+        (sample.status == DownloadTaskStatus::Downloading || sample.status == DownloadTaskStatus::Paused)) {
+        m_downloadedSize.store(workerSum, std::memory_order_release);
+    }
+
+    const qint64 total = m_totalSize.load(std::memory_order_acquire);
+    const qint64 downloaded = m_downloadedSize.load(std::memory_order_acquire);
+    const qint64 eta = (total > 0 && speed > 0 && downloaded < total)
+        ? (total - downloaded + speed - 1) / speed
+        : -1;
+    m_downloadSpeed.store(speed, std::memory_order_release);
+    m_etaSeconds.store(eta, std::memory_order_release);
+
+    sample.downloadedBytes = downloaded;
+    sample.totalBytes = total;
+    sample.speed = speed;
+    sample.etaSeconds = eta;
+    // 收尾期间进度条显示合并进度
+    sample.percent = sample.phase == FinalizePhase::None ? progressPercentage() : finalizePercentage();
+    return sample;
 }
 
 bool DownloadTask::allWorkersFinished() const
 {
-    int finishedWorkers;
-    int threadCount;
-    
-    {
-        QMutexLocker locker(&m_mutex); // 保护m_finishedWorkers和m_threadCount
-        finishedWorkers = m_finishedWorkers;
-        threadCount = m_threadCount;
-    }
-    
-    return finishedWorkers == threadCount;
+    // 两者都只在主线程读写
+    return m_finishedWorkers == m_threadCount;
 }
 
 bool DownloadTask::prepareFinalFile(QFile& finalFile)
@@ -1033,7 +1577,7 @@ bool DownloadTask::prepareFinalFile(QFile& finalFile)
     return true;
 }
 
-bool DownloadTask::mergeTempFile(const QString& tempFilePath, QFile& finalFile, qint64& totalBytesWritten)
+bool DownloadTask::mergeTempFile(const QString& tempFilePath, QFile& finalFile, int partIndex, qint64 partOffset, qint64& totalBytesWritten)
 {
     QFile tempFile(tempFilePath);
     if (!tempFile.exists()) {
@@ -1059,9 +1603,23 @@ bool DownloadTask::mergeTempFile(const QString& tempFilePath, QFile& finalFile,
         return false;
     }
 
+    // 续合并：跳过检查点之前已经追加到 .merge 的部分
+    if (partOffset > 0 && !tempFile.seek(partOffset)) {
+        LOGD(QString("无法定位到续合并偏移:%1 文件:%2").arg(partOffset).arg(tempFilePath));
+        tempFile.close();
+        return false;
+    }
+
     QByteArray buffer;
     qint64 partBytesWritten = 0;
+    qint64 sinceCheckpoint = 0;
     while (!tempFile.atEnd()) {
+        if (m_finalizeAbort.load(std::memory_order_acquire)) {
+            LOGD(QString("合并被中止，分片%1停在偏移:%2").arg(partIndex).arg(partOffset + partBytesWritten));
+            tempFile.close();
+            return false;
+        }
+
         buffer = tempFile.read(1024 * 1024); // 1MB buffer
         qint64 bytesRead = buffer.size();
         if (bytesRead == 0) break;
@@ -1074,6 +1632,15 @@ bool DownloadTask::mergeTempFile(const QString& tempFilePath, QFile& finalFile,
         }
         totalBytesWritten += bytesWritten;
         partBytesWritten += bytesWritten;
+        sinceCheckpoint += bytesWritten;
+        m_finalizeProcessed.fetch_add(bytesWritten, std::memory_order_acq_rel);
+
+        if (sinceCheckpoint >= kMergeCheckpointInterval) {
+            // 检查点只能指向已经落到 .merge 的字节：先 flush 再写
+            finalFile.flush();
+            saveMergeCheckpoint(partIndex, partOffset + partBytesWritten, totalBytesWritten);
+            sinceCheckpoint = 0;
+        }
     }
     tempFile.close();
     LOGD(QString("临时文件%1合并完成，写入字节数:%2").arg(QFileInfo(tempFilePath).fileName()).arg(partBytesWritten));
@@ -1099,40 +1666,185 @@ bool DownloadTask::validateFinalFile(qint64 totalBytesWritten, qint64 expectedSi
     return true;
 }
 
+QString DownloadTask::mergeCheckpointPath() const
+{
+    return QDir(m_tempDirectory).filePath(QFileInfo(m_filePath).fileName() + ".merge.ckpt");
+}
+
+bool DownloadTask::loadMergeCheckpoint(int& nextPart, qint64& partOffset, qint64& mergedBytes) const
+{
+    QFile file(mergeCheckpointPath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const QJsonObject obj = QJsonDocument::fromJson(file.readAll()).object();
+    file.close();
+
+    // 检查点必须属于同一次下载（同 URL、同总大小、同分片数），否则 .merge 内容不可信
+    if (obj.value("url").toString() != m_url.toString() ||
+        obj.value("totalSize").toInteger() != getTotalSize() ||
+        obj.value("partCount").toInt() != m_createdWorkerCount) {
+        LOGD("合并检查点与当前任务不匹配，忽略");
+        return false;
+    }
+
+    nextPart = obj.value("nextPart").toInt(-1);
+    partOffset = obj.value("partOffset").toInteger(-1);
+    mergedBytes = obj.value("mergedBytes").toInteger(-1);
+    if (nextPart < 0 || nextPart > m_createdWorkerCount || partOffset < 0 || mergedBytes < 0) {
+        LOGD("合并检查点字段无效，忽略");
+        return false;
+    }
+    return true;
+}
+
+void DownloadTask::saveMergeCheckpoint(int nextPart, qint64 partOffset, qint64 mergedBytes) const
+{
+    QJsonObject obj;
+    obj["url"] = m_url.toString();
+    obj["totalSize"] = getTotalSize();
+    obj["partCount"] = m_createdWorkerCount;
+    obj["nextPart"] = nextPart;
+    obj["partOffset"] = partOffset;
+    obj["mergedBytes"] = mergedBytes;
+
+    QSaveFile file(mergeCheckpointPath());
+    if (!file.open(QIODevice::WriteOnly)) {
+        LOGD(QString("无法写入合并检查点:%1").arg(file.errorString()));
+        return;
+    }
+    file.write(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+    if (!file.commit()) {
+        LOGD(QString("提交合并检查点失败:%1").arg(file.errorString()));
+    }
+}
+
+int DownloadTask::completedMergePartCount() const
+{
+    QFile file(mergeCheckpointPath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    const QJsonObject obj = QJsonDocument::fromJson(file.readAll()).object();
+    file.close();
+
+    const int partCount = obj.value("partCount").toInt();
+    const qint64 mergedBytes = obj.value("mergedBytes").toInteger(-1);
+    if (obj.value("url").toString() != m_url.toString() ||
+        obj.value("totalSize").toInteger() != getTotalSize() ||
+        partCount <= 0 || obj.value("nextPart").toInt(-1) != partCount || mergedBytes < 0) {
+        return 0;
+    }
+    return QFileInfo(mergeFilePath()).size() >= mergedBytes ? partCount : 0;
+}
+
 bool DownloadTask::mergeFiles()
 {
     LOGD("开始合并文件");
+    m_finalizePhase.store(static_cast<int>(FinalizePhase::Merging), std::memory_order_release);
 
     // 在临时目录中创建临时合并文件
     QString tempMergeFileName = QFileInfo(m_filePath).fileName() + ".merge";
     QString tempMergeFilePath = QDir(m_tempDirectory).filePath(tempMergeFileName);
 
-    QFile tempMergeFile(tempMergeFilePath);
-    if (!tempMergeFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-        LOGD(QString("无法创建临时合并文件:%1 错误:%2").arg(tempMergeFilePath).arg(tempMergeFile.errorString()));
-        return false;
-    }
-
-    qint64 totalBytesWritten = 0;
-    qint64 totalTempFileSize = 0;
     // 用创建时的实际 part 数快照（m_createdWorkerCount），而不是可能被未来路径
     // 改写的 m_threadCount。mergeTempFile 对不存在的 part 文件会直接 return false。
     int threadCount = m_createdWorkerCount;
-
-    LOGD(QString("开始合并%1个临时文件到临时合并文件:%2").arg(threadCount).arg(tempMergeFilePath));
-
+    QStringList partPaths;
+    qint64 totalTempFileSize = 0;
     for (int i = 0; i < threadCount; ++i) {
         QString tempFileName = QFileInfo(m_filePath).fileName() + QString(".part%1").arg(i);
-        QString tempFilePath = QDir(m_tempDirectory).filePath(tempFileName);
-        if (!mergeTempFile(tempFilePath, tempMergeFile, totalBytesWritten)) {
-            tempMergeFile.close();
-            QFile::remove(tempMergeFilePath); // 清理临时合并文件
-            return false;
+        partPaths.append(QDir(m_tempDirectory).filePath(tempFileName));
+        totalTempFileSize += QFileInfo(partPaths.last()).size();
+    }
+    m_finalizeTotal.store(totalTempFileSize, std::memory_order_release);
+
+    int startPart = 0;
+    qint64 startOffset = 0;
+    qint64 totalBytesWritten = 0;
+    const bool hasCheckpoint = loadMergeCheckpoint(startPart, startOffset, totalBytesWritten);
+
+    // 单分片且没有合并进度：part0 就是完整文件，同目录 rename 成 .merge 即可，
+    // 省掉整文件读写（暂存目录与目标同文件系统时整个收尾都是 O(1) 的 rename）。
+    bool mergeDone = false;
+    if (threadCount == 1 && !hasCheckpoint && QFileInfo::exists(partPaths.at(0))) {
+        QFile::remove(tempMergeFilePath);
+        if (QFile::rename(partPaths.at(0), tempMergeFilePath)) {
+            totalBytesWritten = totalTempFileSize;
+            m_finalizeProcessed.store(totalBytesWritten, std::memory_order_release);
+            mergeDone = true;
+            // part0 已不存在：记下合并完成，移动前被中止时下次直接从 .merge 收尾
+            saveMergeCheckpoint(1, 0, totalBytesWritten);
+            LOGD(QString("单分片直接重命名为合并文件:%1").arg(tempMergeFilePath));
         }
-        totalTempFileSize += QFileInfo(tempFilePath).size();
     }
 
-    tempMergeFile.close();
+    // 上次已合并完所有分片（包括单分片 rename）但没来得及移动：跳过合并，直接移动
+    if (!mergeDone && hasCheckpoint && startPart >= threadCount &&
+        QFileInfo(tempMergeFilePath).size() >= totalBytesWritten) {
+        QFile tempMergeFile(tempMergeFilePath);
+        // 多分片的 .merge 可能还带着预分配的尾部
+        if (!tempMergeFile.resize(totalBytesWritten)) {
+            LOGD(QString("无法截断合并文件到%1字节:%2").arg(totalBytesWritten).arg(tempMergeFile.errorString()));
+        }
+        m_finalizeTotal.store(totalBytesWritten, std::memory_order_release);
+        m_finalizeProcessed.store(totalBytesWritten, std::memory_order_release);
+        mergeDone = true;
+        LOGD(QString("合并检查点显示已合并完成，直接移动:%1字节").arg(totalBytesWritten));
+    }
+
+    if (!mergeDone) {
+        // 上次合并中途退出（崩溃/退出/取消但保留临时文件）时，从检查点续合并：
+        // 把 .merge 截断到检查点确认过的长度，再从记录的分片/偏移继续追加。
+        QFile tempMergeFile(tempMergeFilePath);
+        bool resumed = false;
+        // .merge 可能已被 preallocateMergeFile 预分配到总大小：只 seek 不截断，
+        // 合并结束后再 resize 到实际写入长度。
+        if (hasCheckpoint && QFileInfo(tempMergeFilePath).size() >= totalBytesWritten) {
+            if (tempMergeFile.open(QIODevice::ReadWrite) &&
+                tempMergeFile.seek(totalBytesWritten)) {
+                resumed = true;
+                LOGD(QString("从检查点续合并：分片%1 偏移%2 已合并%3字节").arg(startPart).arg(startOffset).arg(totalBytesWritten));
+            } else {
+                tempMergeFile.close();
+            }
+        }
+        if (!resumed) {
+            startPart = 0;
+            startOffset = 0;
+            totalBytesWritten = 0;
+            if (!tempMergeFile.open(QIODevice::ReadWrite) || !tempMergeFile.seek(0)) {
+                LOGD(QString("无法创建临时合并文件:%1 错误:%2").arg(tempMergeFilePath).arg(tempMergeFile.errorString()));
+                return false;
+            }
+        }
+        m_finalizeProcessed.store(totalBytesWritten, std::memory_order_release);
+
+        LOGD(QString("开始合并%1个临时文件到临时合并文件:%2").arg(threadCount).arg(tempMergeFilePath));
+
+        for (int i = startPart; i < threadCount; ++i) {
+            const qint64 partOffset = (i == startPart) ? startOffset : 0;
+            if (!mergeTempFile(partPaths.at(i), tempMergeFile, i, partOffset, totalBytesWritten)) {
+                tempMergeFile.close();
+                if (m_finalizeAbort.load(std::memory_order_acquire)) {
+                    // 主动中止：保留 .merge 与检查点，下次可续合并（cancel(true) 会在作业退出后统一删除）
+                    LOGD("合并被中止，保留检查点");
+                    return false;
+                }
+                QFile::remove(tempMergeFilePath); // 清理临时合并文件
+                QFile::remove(mergeCheckpointPath());
+                return false;
+            }
+            tempMergeFile.flush();
+            saveMergeCheckpoint(i + 1, 0, totalBytesWritten);
+        }
+
+        // 去掉预分配留下的尾部
+        if (!tempMergeFile.resize(totalBytesWritten)) {
+            LOGD(QString("无法截断合并文件到%1字节:%2").arg(totalBytesWritten).arg(tempMergeFile.errorString()));
+        }
+        tempMergeFile.close();
+    }
 
     qint64 totalSize = getTotalSize();
     LOGD(QString("文件合并完成，总写入字节数:%1 临时文件总大小:%2 期望总大小:%3").arg(totalBytesWritten).arg(totalTempFileSize).arg(totalSize));
@@ -1144,19 +1856,29 @@ bool DownloadTask::mergeFiles()
     if (totalSize > 0 && totalBytesWritten != totalSize) {
         LOGD(QString("临时合并文件大小与期望不符，实际:%1 期望:%2").arg(totalBytesWritten).arg(totalSize));
         QFile::remove(tempMergeFilePath);
+        QFile::remove(mergeCheckpointPath());
+        return false;
+    }
+
+    // 移动之前最后一次响应中止；移动开始后不可再中断
+    if (m_finalizeAbort.load(std::memory_order_acquire)) {
+        LOGD("合并完成但任务已中止，保留合并结果与检查点");
         return false;
     }
 
     // 将临时合并文件移动到最终位置
+    m_finalizePhase.store(static_cast<int>(FinalizePhase::Moving), std::memory_order_release);
     if (!moveFileToFinalLocation(tempMergeFilePath, m_filePath)) {
         LOGD(QString("无法将临时合并文件移动到最终位置:%1 -> %2").arg(tempMergeFilePath).arg(m_filePath));
         QFile::remove(tempMergeFilePath);
+        QFile::remove(mergeCheckpointPath());
         return false;
     }
 
     // 验证最终文件。totalSize==0 的情况下用总写入字节数作为期望值
     const qint64 expectedFinalSize = (totalSize > 0) ? totalSize : totalBytesWritten;
     if (!validateFinalFile(totalBytesWritten, expectedFinalSize)) {
+        QFile::remove(mergeCheckpointPath());
         return false;
     }
 
@@ -1165,6 +1887,7 @@ bool DownloadTask::mergeFiles()
 
     // 合并完成且最终文件已落盘后再删除临时分片文件，确保worker不再写时再unlink
     LOGD("合并完成，开始删除临时分片文件");
+    m_finalizePhase.store(static_cast<int>(FinalizePhase::Cleaning), std::memory_order_release);
     deleteTempFiles();
     return true;
 }
@@ -1183,6 +1906,8 @@ void DownloadTask::deleteTempFiles()
         QString tempFilePath = QDir(m_tempDirectory).filePath(tempFileName);
         bool removed = QFile::remove(tempFilePath);
         LOGD(QString("删除临时文件%1:%2 结果:%3").arg(i).arg(tempFilePath).arg(removed ? "成功" : "失败"));
+        // 分片的 CRC32C 旁路文件
+        QFile::remove(tempFilePath + ".crc");
     }
     
     // 也尝试删除临时合并文件（如果存在）
@@ -1192,49 +1917,57 @@ void DownloadTask::deleteTempFiles()
         bool removed = QFile::remove(tempMergeFilePath);
         LOGD(QString("删除临时合并文件:%1 结果:%2").arg(tempMergeFilePath).arg(removed ? "成功" : "失败"));
     }
+
+    // 合并检查点与 .merge 同生命周期；续传清单与分片同生命周期
+    QFile::remove(mergeCheckpointPath());
+    QFile::remove(resumeManifestPath());
+
+    // 分任务暂存目录此时应已清空；目录里残留其它文件时保持不动
+    removeEmptyStagingDirectory();
     
     LOGD("临时文件删除完成");
 }
 
+void DownloadTask::removeEmptyStagingDirectory()
+{
+    if (!m_perTaskStaging) {
+        return;
+    }
+    const bool removed = QDir().rmdir(m_tempDirectory);
+    LOGD(QString("删除暂存目录:%1 结果:%2").arg(m_tempDirectory).arg(removed ? "成功" : "未删除（不存在或非空）"));
+}
+
 int DownloadTask::getThreadCount() const
 {
-    QMutexLocker locker(&m_mutex);
+    // 收尾线程读取时 worker 早已创建完毕，m_threadCount 不会再被主线程改写
     return m_threadCount;
 }
 
 qint64 DownloadTask::getTotalSize() const
 {
-    QMutexLocker locker(&m_mutex);
-    return m_totalSize;
+    return m_totalSize.load(std::memory_order_acquire);
 }
 
 void DownloadTask::updateDownloadedSize(qint64 size)
 {
-    QMutexLocker locker(&m_mutex);
-    m_downloadedSize = size;
+    m_downloadedSize.store(size, std::memory_order_release);
 }
 
 void DownloadTask::saveToHistory(const QString& status)
 {
     LOGD(QString("开始保存任务历史记录，状态:%1").arg(status));
     
-    // 准备记录数据（不需要锁）
+    // 只在主线程的终态转换之后调用，字段不会并发改写，直接拷贝
     DownloadRecord record;
-    
-    // 使用专用锁快速拷贝数据
-    {
-        QMutexLocker locker(&m_historyMutex);
-        record.url = m_url.toString();
-        record.filePath = m_filePath;
-        record.fileSize = m_totalSize;
-        record.startTime = m_startTime;
-        record.finishTime = m_finishTime;
-        record.fileName = m_fileName;
-    }
-    
+    record.url = m_url.toString();
+    record.filePath = m_filePath;
+    record.fileSize = m_totalSize.load(std::memory_order_acquire);
+    record.startTime = m_startTime;
+    record.finishTime = m_finishTime;
+    record.fileName = m_fileName;
     record.status = status;
     
-    // 在锁外执行数据库操作
+    // 异步执行数据库操作
     QTimer::singleShot(0, this, [record]() {
         HistoryManager::instance().addRecord(record);
     });
@@ -1242,9 +1975,34 @@ void DownloadTask::saveToHistory(const QString& status)
     LOGD("历史记录保存请求已提交");
 }
 
-QString DownloadTask::getTempDirectory() const
+QString DownloadTask::getTempDirectory()
 {
-    // 优先使用环境变量中的临时目录
+    // 首选：目标文件旁边的隐藏分任务目录（.<fileName>.<urlHash>.downloading）。
+    // 与最终文件同一文件系统，收尾时 .merge -> 最终路径只是一次原子 rename，
+    // 不会退化成整文件 copy；也避免把分片放到 tmpfs 上占用内存。
+    // 目录名带上合并键的哈希：不同 URL 存到同一路径时不会共用 .partN 与合并检查点，
+    // 同一 URL 重启后仍能找回自己的分片续传。
+    const QFileInfo targetInfo(m_filePath);
+    const QString targetDirPath = targetInfo.absolutePath();
+    const QString urlHash = QString::fromLatin1(
+        QCryptographicHash::hash(DownloadManager::taskKey(m_url).toUtf8(), QCryptographicHash::Sha1)
+            .toHex().left(8));
+    const QString stagingName = QStringLiteral("%1.%2.downloading").arg(targetInfo.fileName(), urlHash);
+    const QString stagingPath = QDir(targetDirPath).filePath(QLatin1Char('.') + stagingName);
+    QDir stagingDir(stagingPath);
+    if (stagingDir.exists() || stagingDir.mkpath(".")) {
+#ifdef _WIN32
+        // Windows 下点前缀不代表隐藏，显式加上隐藏属性
+        SetFileAttributesW(reinterpret_cast<LPCWSTR>(QDir::toNativeSeparators(stagingPath).utf16()),
+                           FILE_ATTRIBUTE_HIDDEN);
+#endif
+        m_perTaskStaging = true;
+        LOGD(QString("使用同文件系统暂存目录:%1").arg(stagingPath));
+        return stagingPath;
+    }
+    LOGD(QString("无法创建暂存目录:%1，回退到系统临时目录").arg(stagingPath));
+
+    // 回退：环境变量中的临时目录
     QString tempPath = QString::fromLocal8Bit(qgetenv("TEMP"));
     if (tempPath.isEmpty()) {
         tempPath = QString::fromLocal8Bit(qgetenv("TMP"));
@@ -1260,7 +2018,23 @@ QString DownloadTask::getTempDirectory() const
     if (!tempDir.exists()) {
         tempDir.mkpath(".");
     }
+
+    // 设备 ID 比对：不同设备意味着收尾时 rename 会失败、退回 copy + delete
+    const QStorageInfo tempStorage(tempPath);
+    const QStorageInfo targetStorage(targetDirPath);
+    if (tempStorage.isValid() && targetStorage.isValid() &&
+        tempStorage.device() != targetStorage.device()) {
+        LOGD(QString("临时目录与目标目录不在同一设备（%1 vs %2），收尾将退化为复制")
+             .arg(QString::fromLocal8Bit(tempStorage.device()))
+             .arg(QString::fromLocal8Bit(targetStorage.device())));
+    }
     
+    // 系统临时目录是共享的：同样放进本任务专属的子目录，避免同名文件的分片互相覆盖
+    const QString fallbackStaging = QDir(tempPath).filePath(stagingName);
+    m_perTaskStaging = QDir(fallbackStaging).exists() || QDir().mkpath(fallbackStaging);
+    if (m_perTaskStaging) {
+        tempPath = fallbackStaging;
+    }
     LOGD(QString("获取临时目录:%1").arg(tempPath));
     return tempPath;
 }
@@ -3,6 +3,7 @@
 
 #include <QObject>
 #include <QUrl>
+#include <QHostAddress>
 #include <QList>
 #include <QFile>
 #include <QNetworkAccessManager>
@@ -10,12 +11,15 @@
 #include <QFileInfo>
 #include <QDateTime>
 #include <QTimer>
-#include <QMutex>
 #include <QEventLoop>
 #include <QThreadPool>
 #include <QAtomicInt>
 #include <QNetworkProxy>
+#include <QFutureWatcher>
+#include <atomic>
 #include "httpworker.h"
+#include "urlmetadatacache.h"
+#include "hostprofilestore.h"
 //#include "historymanager.h" // 包含历史管理器头文件
 
 /**
@@ -30,9 +34,43 @@ enum class DownloadTaskStatus {
     Failed      ///< 失败
 };
 
+/**
+ * @brief 收尾阶段（所有 worker 完成后在 finalize 线程池里执行）。
+ * 收尾期间任务状态仍为 Downloading，UI 通过 finalizePhase() 区分"下载中"与"合并中"。
+ */
+enum class FinalizePhase {
+    None,       ///< 未进入收尾
+    Merging,    ///< 正在合并分片到 .merge
+    Moving,     ///< 正在移动到最终位置并校验大小
+    Cleaning    ///< 正在删除临时分片
+};
+
+class DownloadTask;
+
+/**
+ * @brief 单个任务的一次遥测采样结果。
+ * 由 DownloadManager 的遥测定时器在主线程统一采样，打包成一批发给所有消费者
+ * （主窗口、托盘等）。task 指针只在信号派发期间有效，消费者不应保存它。
+ */
+struct TaskTelemetry {
+    DownloadTask* task = nullptr;                       ///< 被采样的任务。
+    DownloadTaskStatus status = DownloadTaskStatus::Pending; ///< 采样时的任务状态。
+    FinalizePhase phase = FinalizePhase::None;          ///< 采样时的收尾阶段。
+    qint64 downloadedBytes = 0;                         ///< 已下载（收尾期间为已合并）字节数。
+    qint64 totalBytes = 0;                              ///< 总字节数（未知时为 0）。
+    qint64 speed = 0;                                   ///< EWMA 平滑后的速度（字节/秒）。
+    qint64 etaSeconds = -1;                             ///< 预计剩余秒数，未知时为 -1。
+    int percent = 0;                                    ///< 进度百分比（收尾期间为收尾进度）。
+};
+
 /**
  * @brief DownloadTask类代表一个独立的下载任务。
  * 它负责获取文件信息、分块、调度HttpWorker、合并文件以及管理任务状态。
+ *
+ * 线程模型：任务对象、worker 列表与 HEAD 请求只在主线程访问；状态、大小与进度是原子量，
+ * 任意线程（UI、HttpServer、ScheduleManager、收尾线程）读取都不会被 worker 回调阻塞。
+ * 状态只能经 isLegalTransition() 允许的边用 CAS 转换，并发的 pause/cancel/出错
+ * 只有一方转换成功，由成功方负责后续动作。
  */
 class DownloadTask : public QObject
 {
@@ -44,9 +82,12 @@ public:
      * @param url 文件的URL。
      * @param savePath 文件保存的本地路径。
      * @param threadCount 下载使用的线程数。
+     * @param id 任务编号；0 表示新分配。DownloadManager 从排队描述符建任务时传入描述符的编号，
+     *           外部拿到的编号在任务排队与下载期间保持不变。
      * @param parent 父QObject。
      */
-    explicit DownloadTask(const QUrl& url, const QString& savePath, int threadCount, QObject *parent = nullptr);
+    explicit DownloadTask(const QUrl& url, const QString& savePath, int threadCount, quint64 id = 0,
+                          QObject *parent = nullptr);
     ~DownloadTask();
 
     /**
@@ -55,17 +96,20 @@ public:
     void start();
 
     /**
-     * @brief 暂停下载任务。
+     * @brief 暂停下载任务（不阻塞）。
+     * 通知所有 worker 停止，全部 stopped() 确认到达后才切换为 Paused。
      */
     void pause();
 
     /**
      * @brief 恢复下载任务。
+     * 沿用已有 worker 的分片范围直接续传，不重新发 HEAD 探测。
      */
     void resume();
 
     /**
-     * @brief 取消下载任务。
+     * @brief 取消下载任务（不阻塞）。
+     * 状态立即切为 Cancelled；临时文件删除、写历史与 finished() 推迟到所有 worker 确认停止后。
      * @param deleteTempFiles 是否删除所有临时文件。
      */
     void cancel(bool deleteTempFiles = true);
@@ -90,7 +134,60 @@ public:
      * @brief 获取当前任务的状态。
      * @return DownloadTaskStatus枚举值。
      */
-    DownloadTaskStatus status() const { return m_status; }
+    DownloadTaskStatus status() const { return static_cast<DownloadTaskStatus>(m_status.load(std::memory_order_acquire)); }
+
+    /**
+     * @brief 状态转换表。
+     *
+     * Pending → Downloading / Paused（从退出队列恢复暂停的任务）/ Cancelled / Failed；
+     * Downloading → Pending（等待磁盘空间）/ Paused / Cancelled / Completed / Failed；
+     * Paused → Downloading / Cancelled / Failed；
+     * Failed → Downloading（重新开始）；Cancelled、Completed 为终态。
+     *
+     * @return from → to 是否合法（相同状态视为不合法）。
+     */
+    static bool isLegalTransition(DownloadTaskStatus from, DownloadTaskStatus to);
+
+    /**
+     * @brief 进程内唯一的任务编号（从 1 递增，不复用）。
+     * HTTP 控制接口与 DownloaderCore 用它引用任务，任务释放后编号随之失效。
+     */
+    quint64 id() const { return m_id; }
+
+    /**
+     * @brief 分配一个新的任务编号（线程安全）。排队描述符与任务共用同一编号序列。
+     */
+    static quint64 allocateId();
+
+    /**
+     * @brief 调度优先级：worker 以此优先级提交到下载线程池，线程池满时高优先级任务的分片先开始。
+     * @return 优先级，默认 0，越大越优先。
+     */
+    int priority() const { return m_priority; }
+
+    /**
+     * @brief 调整调度优先级（主线程）。之后提交的 worker 使用新优先级，
+     * 仍在线程池队列里排队的 worker 按新优先级重新排队；已在运行的不受影响。
+     * @param priority 新优先级。
+     */
+    void setPriority(int priority);
+
+    /**
+     * @brief 把本任务的连接钉到 SSRF 校验过的地址（主线程，start 之前调用）。
+     *
+     * HttpServer 校验主机时拿到的地址就是实际连接的地址，校验之后 DNS 再变（rebinding）也不会
+     * 把下载导向内网。只作用于 URL 原主机；地址随队列日志落盘，恢复的任务仍连这些地址。
+     * 已经钉住的任务不会被再次设置替换或解除（DownloadManager 合并重复请求时，
+     * 后来的投递方拿到的是同一个任务）。
+     * @param addresses 校验过的地址，为空时不钉。
+     */
+    void setPinnedAddresses(const QList<QHostAddress>& addresses);
+
+    /**
+     * @brief 钉住的地址（主线程）。
+     * @return 没有钉住时为空。
+     */
+    QList<QHostAddress> pinnedAddresses() const { return m_pinnedAddresses; }
 
     /**
      * @brief 获取任务的URL。
@@ -98,6 +195,13 @@ public:
      */
     QString url() const { return m_url.toString(); }
 
+    /**
+     * @brief HEAD 探测（或元数据缓存）给出的实际资源地址（跟随同源重定向之后，主机仍写原主机名）。
+     * worker 直接请求这个地址。
+     * @return 探测完成前为空。
+     */
+    QUrl effectiveUrl() const { return m_effectiveUrl; }
+
     /**
      * @brief 获取文件保存路径。
      * @return 文件路径字符串。
@@ -114,13 +218,13 @@ public:
      * @brief 获取文件总大小。
      * @return 文件总大小（字节）。
      */
-    qint64 totalSize() const { return m_totalSize; }
+    qint64 totalSize() const { return m_totalSize.load(std::memory_order_acquire); }
 
     /**
      * @brief 获取已下载大小。
      * @return 已下载大小（字节）。
      */
-    qint64 downloadedSize() const { return m_downloadedSize; }
+    qint64 downloadedSize() const { return m_downloadedSize.load(std::memory_order_acquire); }
 
     /**
      * @brief 获取下载进度百分比。
@@ -130,9 +234,90 @@ public:
 
     /**
      * @brief 获取当前下载速度。
-     * @return 下载速度（字节/秒）。
+     * @return 下载速度（字节/秒，EWMA 平滑值，由遥测采样更新）。
+     */
+    qint64 downloadSpeed() const { return m_downloadSpeed.load(std::memory_order_acquire); }
+
+    /**
+     * @brief 按最近一次遥测采样估算的剩余秒数。
+     * @return 剩余秒数；总大小未知或速度为 0 时返回 -1。
      */
-    qint64 downloadSpeed() const { return m_downloadSpeed; }
+    qint64 etaSeconds() const { return m_etaSeconds.load(std::memory_order_acquire); }
+
+    /**
+     * @brief 遥测采样（主线程，由 DownloadManager 的遥测定时器统一调用）。
+     *
+     * 汇总所有 worker 的原子字节计数得到已下载大小，用距上次采样的字节增量
+     * 更新 EWMA 平滑速度与 ETA；收尾期间改为报告合并进度。
+     *
+     * @param elapsedMs 距上次采样的毫秒数。
+     * @return 本次采样结果。
+     */
+    TaskTelemetry sampleTelemetry(qint64 elapsedMs);
+
+    /**
+     * @brief 当前收尾阶段（原子读，跨线程安全）。
+     * @return FinalizePhase::None 表示尚未进入收尾或收尾已结束。
+     */
+    FinalizePhase finalizePhase() const { return static_cast<FinalizePhase>(m_finalizePhase.load(std::memory_order_acquire)); }
+
+    /**
+     * @brief 收尾进度百分比（0-100），仅在 finalizePhase() != None 时有意义。
+     */
+    int finalizePercentage() const;
+
+    /**
+     * @brief 是否因磁盘空间不足在 DownloadManager 队列中等待（此时状态为 Pending）。
+     */
+    bool isWaitingForDiskSpace() const { return m_waitingForDiskSpace; }
+
+    /**
+     * @brief 分片暂存目录（DownloadManager 据此定位所在文件系统做空间准入）。
+     */
+    QString stagingDirectory() const { return m_tempDirectory; }
+
+    /**
+     * @brief 还需下载落盘的字节数（总大小减去已存在的分片字节；大小未知时为 0）。
+     */
+    qint64 pendingDownloadBytes() const;
+
+    /**
+     * @brief 合并阶段还需额外占用的字节数（多分片时为总大小减去已预分配的 .merge 大小）。
+     */
+    qint64 mergeReserveBytes() const;
+
+    /**
+     * @brief DownloadManager 在磁盘空间足够时调用：把排队中的任务切回 Downloading 并开始传输。
+     */
+    void onDiskSpaceAdmitted();
+
+    /**
+     * @brief 实际使用的分片数（worker 创建前为请求的线程数）。
+     */
+    int threadCount() const { return m_threadCount; }
+
+    /**
+     * @brief 退出检查点（主线程，不阻塞）。
+     *
+     * 停止所有 worker 但不改变任务状态：worker 把已收到的数据落盘、关闭分片后确认，
+     * 全部确认后写续传清单并发射 checkpointReady()。收尾中的任务通知合并尽快中止
+     * （合并检查点保留），作业退出后发射 checkpointReady()。没有需要等待的工作时立即发射。
+     */
+    void checkpointForShutdown();
+
+    /**
+     * @brief 把当前分片布局写入续传清单（暂存目录下的 <文件名>.resume.json）。
+     * 下次启动恢复任务时，createHttpWorkers 按清单里的分片范围建 worker，
+     * 与磁盘上已有的分片对齐，不受线程数设置变化影响。
+     * @return 是否写入成功；还没有 worker（探测未完成）时返回 false。
+     */
+    bool writeResumeManifest() const;
+
+    /**
+     * @brief 从退出队列恢复一个上次处于暂停状态的任务：Pending 直接进入 Paused，
+     * resume() 时重新探测并按续传清单续传。
+     */
+    void restoreAsPaused();
 
 signals:
     /**
@@ -141,14 +326,6 @@ signals:
      */
     void statusChanged(DownloadTaskStatus status);
 
-    /**
-     * @brief 当下载进度更新时发射此信号。
-     * @param bytesReceived 已下载的字节数。
-     * @param totalBytes 文件总字节数。
-     * @param speed 当前下载速度。
-     */
-    void progressUpdated(qint64 bytesReceived, qint64 totalBytes, qint64 speed);
-
     /**
      * @brief 当任务完成时发射此信号。
      */
@@ -160,6 +337,11 @@ signals:
      */
     void error(const QString& errorString);
 
+    /**
+     * @brief checkpointForShutdown() 完成：worker 已全部停止、续传清单已写入。
+     */
+    void checkpointReady();
+
 private slots:
     /**
      * @brief 处理HEAD请求完成的槽函数，用于获取文件信息。
@@ -172,12 +354,6 @@ private slots:
      */
     void onHeadRequestError(QNetworkReply::NetworkError code);
 
-    /**
-     * @brief 处理HttpWorker的进度更新信号。
-     * @param bytes 本次HttpWorker下载的字节数。
-     */
-    void onWorkerProgress(qint64 bytes);
-
     /**
      * @brief 处理HttpWorker完成的信号。
      */
@@ -190,32 +366,136 @@ private slots:
     void onWorkerError(const QString& errorString);
 
     /**
-     * @brief 定时器槽函数，用于计算下载速度和更新UI。
+     * @brief 处理HttpWorker的停止确认；最后一个确认到达时执行挂起的暂停/恢复/取消。
+     */
+    void onWorkerStopped();
+
+    /**
+     * @brief 收尾作业结束（主线程）：按结果切换 Completed/Failed 并写历史。
      */
-    void onSpeedCalculationTimerTimeout();
+    void onFinalizeFinished();
 
 private:
     /**
-     * @brief 设置任务状态并发射statusChanged信号。
-     * @param newStatus 新的任务状态。
+     * @brief 仅当当前状态为 from 时 CAS 转换到 to（转换须合法），成功后发射 statusChanged。
+     * @return 转换是否成功。
+     */
+    bool transition(DownloadTaskStatus from, DownloadTaskStatus to);
+
+    /**
+     * @brief 从当前任意状态 CAS 转换到 to（转换须合法），成功后发射 statusChanged。
+     * @return 转换是否成功；当前已是 to 或转换不合法时返回 false。
+     */
+    bool transitionTo(DownloadTaskStatus to);
+
+    /**
+     * @brief 发射 statusChanged：主线程上同步发射，其它线程上排队到主线程。
+     */
+    void notifyStatusChanged(DownloadTaskStatus status);
+
+    /// 等待 worker 停止确认期间挂起的动作。
+    enum class StopIntent {
+        None,   ///< 没有挂起的动作（出错/完成路径的 stop 不等待确认）
+        Pause,  ///< 确认齐后切换为 Paused
+        Resume, ///< 暂停确认到齐前又被恢复：确认齐后直接重新提交 worker
+        Cancel, ///< 确认齐后删除临时文件、写历史并发射 finished()
+        Shutdown ///< 确认齐后写续传清单并发射 checkpointReady()，状态不变
+    };
+
+    /// 续传清单中的一个分片范围。
+    struct ResumePart {
+        qint64 start = 0;   ///< 起始字节。
+        qint64 end = 0;     ///< 结束字节（含）。
+    };
+
+    /**
+     * @brief 续传清单路径（<fileName>.resume.json，与分片同目录）。
+     */
+    QString resumeManifestPath() const;
+
+    /**
+     * @brief 读取续传清单；URL 或总大小与本次探测结果不一致、或范围不连续时返回空。
+     * @param totalSize 本次探测到的文件总大小。
+     */
+    QList<ResumePart> loadResumeManifest(qint64 totalSize) const;
+
+    /**
+     * @brief 创建一个 worker、连接信号并提交到线程池。
+     */
+    void addWorker(const QString& tempFilePath, qint64 startPoint, qint64 endPoint, int partIndex);
+
+    /**
+     * @brief 停止所有 worker 并登记挂起动作；没有需要等待的 worker 时立即执行。
+     * 已有停止在进行中时只更新挂起动作，不重复计数。
      */
-    void setStatus(DownloadTaskStatus newStatus);
+    void requestStop(StopIntent intent);
+
+    /**
+     * @brief 执行挂起动作（所有停止确认已到达）。
+     */
+    void completeStop();
+
+    /**
+     * @brief 复位并把所有 worker 按原分片范围重新提交到线程池。
+     */
+    void resubmitWorkers();
+
+    /**
+     * @brief 取消的收尾部分：处理收尾作业、删除临时文件、写历史并发射 finished()。
+     */
+    void completeCancel();
 
     /**
      * @brief 初始化下载任务，包括获取文件信息和创建HttpWorker。
      */
     void initializeDownload();
 
+    /**
+     * @brief HEAD 探测完成后向 DownloadManager 申请磁盘空间准入；
+     * 不满足时进入 Pending 排队，满足时调用 beginTransfer。
+     */
+    void requestAdmission();
+
+    /**
+     * @brief 准入通过后开始传输：预分配 .merge、创建 worker。
+     */
+    void beginTransfer();
+
+    /**
+     * @brief 多分片任务用 fallocate（Linux）/resize 把 .merge 预分配到总大小，
+     * 让并发任务无法超额占用同一块磁盘空间。
+     */
+    void preallocateMergeFile();
+
+    /**
+     * @brief 是否需要把分片复制合并到 .merge（单分片走 rename，不需要）。
+     */
+    bool needsMergeCopy() const;
+
+    /**
+     * @brief 第 index 个分片文件的完整路径。
+     */
+    QString partFilePath(int index) const;
+
+    /**
+     * @brief 合并文件（.merge）的完整路径。
+     */
+    QString mergeFilePath() const;
+
     /**
      * @brief 分割文件并创建HttpWorker。
      */
     void createHttpWorkers();
 
     /**
-     * @brief 获取系统临时目录路径。
-     * @return 临时目录路径。
+     * @brief 选择分片暂存目录。
+     * 优先使用目标文件旁的隐藏目录 .<fileName>.<urlHash>.downloading（与最终文件同一文件系统，
+     * 收尾只需 rename；urlHash 取合并键 SHA-1 的前 8 位，同名不同 URL 的任务互不干扰）；
+     * 创建失败时回退到 TEMP/TMP/系统临时目录下的同名子目录，并比对设备 ID 记录
+     * 是否会退化为跨设备复制。会设置 m_perTaskStaging。
+     * @return 暂存目录路径。
      */
-    QString getTempDirectory() const;
+    QString getTempDirectory();
 
     /**
      * @brief 将文件从临时目录移动到最终目标位置。
@@ -232,16 +512,54 @@ private:
     bool allWorkersFinished() const;
 
     /**
-     * @brief 合并所有临时文件到最终文件。
+     * @brief 所有 worker 完成后，把合并/校验/移动/清理提交到 DownloadManager::finalizePool()。
+     * 不阻塞主线程；结果经 m_finalizeWatcher 回到 onFinalizeFinished。
+     */
+    void startFinalize();
+
+    /**
+     * @brief 合并所有临时文件到最终文件（在 finalize 线程池中执行）。
+     * 支持从 .merge.ckpt 检查点续合并；m_finalizeAbort 置位时尽快返回 false 并保留检查点。
      * @return 如果合并成功则返回true，否则返回false。
      */
     bool mergeFiles();
 
+    /**
+     * @brief 合并检查点文件路径（<fileName>.merge.ckpt，与分片同目录）。
+     */
+    QString mergeCheckpointPath() const;
+
+    /**
+     * @brief 读取合并检查点；URL/总大小/分片数与当前任务不一致时视为无效。
+     * @param nextPart 下一个要合并的分片下标。
+     * @param partOffset 该分片内已合并的字节偏移。
+     * @param mergedBytes .merge 文件中已确认写入的字节数。
+     * @return 检查点有效返回true。
+     */
+    bool loadMergeCheckpoint(int& nextPart, qint64& partOffset, qint64& mergedBytes) const;
+
+    /**
+     * @brief 原子写入合并检查点（QSaveFile）。调用前必须已 flush .merge 文件。
+     */
+    void saveMergeCheckpoint(int nextPart, qint64 partOffset, qint64 mergedBytes) const;
+
+    /**
+     * @brief 检查点记录所有分片都已合并且 .merge 完整时返回分片数，否则返回0。
+     * 单分片 rename 之后 part0 已不存在，续传时据此直接收尾而不是重新下载。
+     */
+    int completedMergePartCount() const;
+
     /**
      * @brief 删除所有临时文件。
      */
     void deleteTempFiles();
 
+    /**
+     * @brief 本任务专属的暂存目录为空时删除它（HEAD 失败、没写出分片就失败或取消时不留空目录）。
+     * rmdir 只删空目录，有分片或续传清单时保持不动。
+     */
+    void removeEmptyStagingDirectory();
+
     /**
      * @brief 处理HEAD请求错误。
      * @param errorString 错误信息。
@@ -249,10 +567,27 @@ private:
     void handleHeadRequestError(const QString& errorString);
 
     /**
-     * @brief 处理HEAD响应。
+     * @brief 处理HEAD响应：提取元数据写入 UrlMetadataCache，再 applyMetadata。
      */
     void processHeadResponse();
 
+    /**
+     * @brief 用 m_headManager 发出 HEAD 请求（钉住地址时改写到钉住的 IP）并接好完成、出错与超时处理。
+     * @param url 请求地址（主机为原主机名）。
+     */
+    void sendHeadRequest(const QUrl& url);
+
+    /**
+     * @brief 钉住地址的 HEAD 收到重定向：同源时把下一跳重新钉住再发，跨源或次数过多时按 HEAD 失败处理。
+     * @return 已处理（发出下一跳或报错）返回true；不是重定向时返回false。
+     */
+    bool followPinnedRedirect();
+
+    /**
+     * @brief 应用探测结果（HEAD 响应或缓存）：重定向终点、总大小，并按大小与 Range 支持确定分片数。
+     */
+    void applyMetadata(const UrlMetadata& metadata);
+
     /**
      * @brief 准备最终文件。
      * @param finalFile 最终文件对象。
@@ -264,10 +599,12 @@ private:
      * @brief 合并单个临时文件。
      * @param tempFilePath 临时文件路径。
      * @param finalFile 最终文件对象。
+     * @param partIndex 分片下标（写检查点用）。
+     * @param partOffset 从分片内该偏移开始追加（续合并时非 0）。
      * @param totalBytesWritten 累计写入字节数。
      * @return 合并成功返回true，否则返回false。
      */
-    bool mergeTempFile(const QString& tempFilePath, QFile& finalFile, qint64& totalBytesWritten);
+    bool mergeTempFile(const QString& tempFilePath, QFile& finalFile, int partIndex, qint64 partOffset, qint64& totalBytesWritten);
 
     /**
      * @brief 验证最终文件。
@@ -301,35 +638,59 @@ private:
      */
     void saveToHistory(const QString& status);
 
+    /**
+     * @brief 下载成功后把本次的连接数与平均吞吐记入主机画像并写回磁盘。
+     */
+    void recordHostProfile();
+
+    const quint64 m_id;                 ///< 进程内唯一的任务编号。
+    int m_priority = 0;                 ///< 调度优先级（worker 提交到线程池时使用，仅主线程）。
     QUrl m_url;                         ///< 下载文件的URL。
+    QList<QHostAddress> m_pinnedAddresses; ///< SSRF 校验过的地址（仅主线程；空表示按 DNS 正常连接）。
+    QUrl m_effectiveUrl;                ///< 探测得到的重定向终点（仅主线程；worker 请求此地址）。
+    HostHints m_hostHints;              ///< 主机画像给出的传输参数（applyMetadata 时取，仅主线程）。
     QString m_filePath;                 ///< 文件保存的本地路径。
     QString m_fileName;                 ///< 文件名。
     QString m_tempDirectory;            ///< 临时文件存储目录。
+    bool m_perTaskStaging = false;      ///< m_tempDirectory 是否为本任务专属的暂存目录（清理时一并删除）。
     int m_threadCount;                  ///< 下载线程数（用户请求，可能被 HEAD 阶段回退）。
     int m_createdWorkerCount = 0;       ///< 实际创建的 HttpWorker 数（被 merge/deleteTempFiles 当作 part 数快照，不会再变）。
     QThreadPool* m_threadPool;          ///< 线程池指针（来自DownloadManager，不使用globalInstance）。
-    DownloadTaskStatus m_status;        ///< 当前任务状态。
-
-    qint64 m_totalSize;                 ///< 文件总大小。
-    qint64 m_downloadedSize;            ///< 已下载大小。
-    qint64 m_bytesReceivedByWorkers = 0;///< worker 累计已写入磁盘字节（由 200ms 定时器刷新；HEAD 拿不到 Content-Length 时也能量化"已下载多少"）。
-    qint64 m_lastDownloadedSize;        ///< 上次计算速度时的已下载大小。
-    qint64 m_downloadSpeed;             ///< 当前下载速度。
+    std::atomic<int> m_status;          ///< 当前任务状态（DownloadTaskStatus，只经 transition/transitionTo 做 CAS 修改）。
+
+    std::atomic<qint64> m_totalSize;    ///< 文件总大小。
+    std::atomic<qint64> m_downloadedSize;            ///< 已下载大小。
+    std::atomic<qint64> m_bytesReceivedByWorkers{0}; ///< worker 累计已写入磁盘字节（遥测采样刷新；HEAD 拿不到 Content-Length 时也能量化"已下载多少"）。
+    qint64 m_lastDownloadedSize;        ///< 上次遥测采样时的 worker 网络累计字节（仅主线程）。
+    std::atomic<qint64> m_downloadSpeed;///< 当前下载速度（EWMA 平滑值取整）。
+    double m_smoothedSpeed = 0.0;       ///< EWMA 速度的浮点累加值（仅主线程）。
+    qint64 m_activeNetworkBytes = 0;    ///< 下载状态下累计的网络字节（主机画像的吞吐样本，仅主线程）。
+    qint64 m_activeMs = 0;              ///< 累计处于下载状态的时长（仅主线程）。
+    std::atomic<qint64> m_etaSeconds{-1};///< 最近一次采样估算的剩余秒数。
     QDateTime m_startTime;              ///< 任务开始时间。
     QDateTime m_finishTime;             ///< 任务完成时间。
 
     QNetworkAccessManager* m_headManager; ///< 用于发送HEAD请求获取文件信息的网络管理器。
     QNetworkReply* m_headReply;         ///< HEAD请求的应答。
 
-    QList<HttpWorker*> m_workers;       ///< HttpWorker列表。
-    int m_finishedWorkers;              ///< 已完成的HttpWorker数量。
-    QTimer m_speedCalculationTimer;     ///< 用于计算下载速度的定时器。
-    mutable QMutex m_mutex;                     ///< 用于保护worker列表等数据的互斥锁
-    mutable QMutex m_statusMutex;               ///< 专门保护状态变量的互斥锁
-    mutable QMutex m_historyMutex;              ///< 专门保护历史记录操作的互斥锁
+    QList<HttpWorker*> m_workers;       ///< HttpWorker列表（仅主线程读写）。
+    int m_finishedWorkers;              ///< 已完成的HttpWorker数量（仅主线程读写）。
     QAtomicInt m_headRequestTimedOut{0};  ///< 标记HEAD请求是否已超时（原子，多超时回调并发安全）。
+    int m_headRedirects = 0;            ///< 钉住地址的 HEAD 已手动跟随的重定向次数（仅主线程）。
     bool m_alreadyFinished{false};      ///< 标记finished信号是否已发射，避免重复发射。
     QNetworkProxy m_proxy;              ///< 当前代理设置；HEAD/Worker 的 QNAM 通过 applyProxy 同步此值。
+
+    QFutureWatcher<bool>* m_finalizeWatcher = nullptr; ///< 收尾作业 watcher；非空表示收尾作业在 finalize 线程池里运行。
+    std::atomic<int> m_finalizePhase{0};        ///< 当前 FinalizePhase（原子，作业线程写、主线程读）。
+    std::atomic<qint64> m_finalizeProcessed{0}; ///< 已合并字节数。
+    std::atomic<qint64> m_finalizeTotal{0};     ///< 需合并的分片总字节数。
+    std::atomic<bool> m_finalizeAbort{false};   ///< 取消/析构时置位，合并循环按块检查后尽快退出。
+    bool m_deleteTempsAfterFinalize = false;    ///< 收尾期间 cancel(true)：临时文件删除推迟到作业退出后。
+    bool m_waitingForDiskSpace = false;         ///< 探测后因磁盘空间不足在 DownloadManager 队列中等待。
+    StopIntent m_stopIntent = StopIntent::None; ///< 等待停止确认期间挂起的动作（仅主线程）。
+    int m_pendingStopAcks = 0;                  ///< 尚未到达的 worker 停止确认数（仅主线程）。
+    bool m_cancelDeletesTemps = false;          ///< 挂起的取消是否删除临时文件。
+    bool m_checkpointing = false;               ///< 正在做退出检查点：收尾作业中止不视为失败。
 };
 
 #endif // DOWNLOADTASK_H
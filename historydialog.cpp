@@ -5,6 +5,8 @@
 #include <QDebug>
 #include <QDate>
 #include <QEvent>
+#include <QHeaderView>
+#include "historytablemodel.h"
 #include "logger.h"
 
 HistoryDialog::HistoryDialog(QWidget *parent) :
@@ -14,15 +16,25 @@ HistoryDialog::HistoryDialog(QWidget *parent) :
 {
     ui->setupUi(this);
 
-    // 设置表格属性
-    ui->tableWidget->setColumnCount(6);
-    ui->tableWidget->setHorizontalHeaderLabels({
-        tr("文件名"), tr("URL"), tr("文件大小"), tr("完成时间"), tr("状态"), tr("线程数")
-    });
-    ui->tableWidget->setSelectionBehavior(QAbstractItemView::SelectRows);
-    ui->tableWidget->setSelectionMode(QAbstractItemView::SingleSelection);
-    ui->tableWidget->setAlternatingRowColors(true);
-    ui->tableWidget->setContextMenuPolicy(Qt::CustomContextMenu);
+    // 设置表格属性：行高固定、列宽不按内容计算，滚动时只为可见行取数据
+    m_model = new HistoryTableModel(m_historyManager, this);
+    ui->tableView->setModel(m_model);
+    ui->tableView->setSelectionBehavior(QAbstractItemView::SelectRows);
+    ui->tableView->setSelectionMode(QAbstractItemView::SingleSelection);
+    ui->tableView->setAlternatingRowColors(true);
+    ui->tableView->setContextMenuPolicy(Qt::CustomContextMenu);
+    ui->tableView->setWordWrap(false);
+    ui->tableView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    ui->tableView->verticalHeader()->hide();
+    ui->tableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
+    ui->tableView->horizontalHeader()->setStretchLastSection(true);
+    ui->tableView->setColumnWidth(HistoryTableModel::FileNameColumn, 180);
+    ui->tableView->setColumnWidth(HistoryTableModel::UrlColumn, 240);
+    ui->tableView->setColumnWidth(HistoryTableModel::SizeColumn, 90);
+    ui->tableView->setColumnWidth(HistoryTableModel::FinishTimeColumn, 140);
+    ui->tableView->setColumnWidth(HistoryTableModel::StatusColumn, 70);
+
+    fillStatusFilterCombo();
 
     // 日期过滤器：默认从最早到现在，过滤状态由 m_dateFilterActive 控制
     ui->dateFromEdit->setDate(QDate::currentDate().addYears(-10));
@@ -37,8 +49,10 @@ HistoryDialog::HistoryDialog(QWidget *parent) :
     connect(ui->clearButton, &QPushButton::clicked, this, &HistoryDialog::onClearClicked);
     connect(ui->deleteButton, &QPushButton::clicked, this, &HistoryDialog::onDeleteClicked);
     connect(ui->searchLineEdit, &QLineEdit::textChanged, this, &HistoryDialog::onSearchTextChanged);
-    connect(ui->tableWidget, &QTableWidget::itemSelectionChanged, this, &HistoryDialog::onItemSelectionChanged);
-    connect(ui->tableWidget, &QTableWidget::customContextMenuRequested, this, &HistoryDialog::showContextMenu);
+    connect(ui->tableView->selectionModel(), &QItemSelectionModel::selectionChanged, this, &HistoryDialog::onItemSelectionChanged);
+    connect(m_model, &QAbstractItemModel::modelReset, this, &HistoryDialog::onItemSelectionChanged);
+    connect(ui->tableView, &QTableView::customContextMenuRequested, this, &HistoryDialog::showContextMenu);
+    connect(ui->statusFilterCombo, &QComboBox::currentIndexChanged, this, &HistoryDialog::onStatusFilterChanged);
     connect(ui->dateFilterButton, &QPushButton::clicked, this, &HistoryDialog::onDateFilterClicked);
     connect(ui->clearDateFilterButton, &QPushButton::clicked, this, &HistoryDialog::onClearDateFilterClicked);
     connect(ui->dateFromEdit, &QDateEdit::dateChanged, this, &HistoryDialog::onDateFromChanged);
@@ -57,12 +71,10 @@ void HistoryDialog::changeEvent(QEvent* event)
         // 重新翻译 .ui 文案。
         ui->retranslateUi(this);
         setWindowTitle(tr("下载历史记录"));
-        // 表头是代码里手动设置的（不在 .ui 里），需要重建。
-        // Qt 的 QTableWidget 没有 sortColumn()，仅记录上次排序号较为复杂；
-        // 这里只重排表头文案，如启用排序，调用方刷新表格后自己再 sortByColumn。
-        ui->tableWidget->setHorizontalHeaderLabels({
-            tr("文件名"), tr("URL"), tr("文件大小"), tr("完成时间"), tr("状态"), tr("线程数")
-        });
+        // 表头与状态列的文案来自模型；下拉框的条目是代码里加的（不在 .ui 里），需要重建。
+        m_model->retranslate();
+        fillStatusFilterCombo();
+        updateStatusLabel();
     }
     QDialog::changeEvent(event);
 }
@@ -75,73 +87,13 @@ HistoryDialog::~HistoryDialog()
 void HistoryDialog::loadHistory()
 {
     LOGD("开始加载历史记录");
-    m_allRecords = m_historyManager.getHistory();
     applyFilter();
-    LOGD(QString("历史记录加载完成，共 %1 条记录").arg(m_allRecords.size()));
+    LOGD(QString("历史记录加载完成，共 %1 条记录").arg(m_historyManager.recordCount()));
 }
 
-void HistoryDialog::updateTable()
+void HistoryDialog::updateStatusLabel()
 {
-    ui->tableWidget->setRowCount(m_filteredRecords.size());
-    
-    for (int i = 0; i < m_filteredRecords.size(); ++i) {
-        const DownloadRecord &record = m_filteredRecords[i];
-        
-        // 文件名
-        QTableWidgetItem *fileNameItem = new QTableWidgetItem(record.fileName);
-        fileNameItem->setData(Qt::UserRole, i); // 存储原始索引
-        ui->tableWidget->setItem(i, 0, fileNameItem);
-        
-        // URL
-        QTableWidgetItem *urlItem = new QTableWidgetItem(record.url);
-        urlItem->setToolTip(record.url); // 鼠标悬停显示完整URL
-        ui->tableWidget->setItem(i, 1, urlItem);
-        
-        // 文件大小
-        QString sizeText;
-        if (record.fileSize >= 1024 * 1024 * 1024) {
-            sizeText = QString("%1 GB").arg(record.fileSize / (1024.0 * 1024.0 * 1024.0), 0, 'f', 2);
-        } else if (record.fileSize >= 1024 * 1024) {
-            sizeText = QString("%1 MB").arg(record.fileSize / (1024.0 * 1024.0), 0, 'f', 2);
-        } else if (record.fileSize >= 1024) {
-            sizeText = QString("%1 KB").arg(record.fileSize / 1024.0, 0, 'f', 2);
-        } else {
-            sizeText = QString("%1 B").arg(record.fileSize);
-        }
-        ui->tableWidget->setItem(i, 2, new QTableWidgetItem(sizeText));
-        
-        // 完成时间
-        ui->tableWidget->setItem(i, 3, new QTableWidgetItem(record.finishTime.toString("yyyy-MM-dd hh:mm:ss")));
-        
-        // 状态
-        QString statusText;
-        if (record.status == "Completed") {
-            statusText = tr("已完成");
-        } else if (record.status == "Failed") {
-            statusText = tr("失败");
-        } else if (record.status == "Cancelled") {
-            statusText = tr("已取消");
-        } else {
-            statusText = tr("未知");
-        }
-        QTableWidgetItem *statusItem = new QTableWidgetItem(statusText);
-        if (record.status == "Failed") {
-            statusItem->setForeground(Qt::red);
-        } else if (record.status == "Completed") {
-            statusItem->setForeground(Qt::darkGreen);
-        }
-        ui->tableWidget->setItem(i, 4, statusItem);
-        
-        // 线程数 - 使用默认值1，因为DownloadRecord中没有这个字段
-        ui->tableWidget->setItem(i, 5, new QTableWidgetItem(QString::number(1)));
-    }
-    
-    // 调整列宽
-    ui->tableWidget->resizeColumnsToContents();
-    ui->tableWidget->horizontalHeader()->setStretchLastSection(true);
-    
-    // 更新状态标签
-    ui->statusLabel->setText(tr("共 %1 条记录").arg(m_filteredRecords.size()));
+    ui->statusLabel->setText(tr("共 %1 条记录").arg(m_model->matchCount()));
 }
 
 void HistoryDialog::onRefreshClicked()
@@ -172,30 +124,17 @@ void HistoryDialog::onClearClicked()
 
 void HistoryDialog::onDeleteClicked()
 {
-    int currentRow = ui->tableWidget->currentRow();
-    if (currentRow < 0 || currentRow >= m_filteredRecords.size()) {
+    DownloadRecord record;
+    if (!m_model->recordAt(ui->tableView->currentIndex().row(), &record)) {
         return;
     }
 
-    const DownloadRecord &record = m_filteredRecords[currentRow];
-
     if (!confirmDelete(record)) {
         return;
     }
 
     LOGD(QString("用户确认删除记录：%1").arg(record.fileName));
-    // 找到在全部记录中的索引
-    int originalIndex = -1;
-    for (int i = 0; i < m_allRecords.size(); ++i) {
-        if (m_allRecords[i].url == record.url &&
-            m_allRecords[i].fileName == record.fileName &&
-            m_allRecords[i].startTime == record.startTime) {
-            originalIndex = i;
-            break;
-        }
-    }
-
-    if (originalIndex >= 0 && m_historyManager.deleteRecord(originalIndex)) {
+    if (m_historyManager.deleteRecordById(record.id)) {
         LOGD("记录删除成功");
         loadHistory();
         QMessageBox::information(this, tr("成功"), tr("记录已删除"));
@@ -207,7 +146,7 @@ void HistoryDialog::onDeleteClicked()
 
 void HistoryDialog::onItemSelectionChanged()
 {
-    bool hasSelection = ui->tableWidget->currentRow() >= 0;
+    bool hasSelection = ui->tableView->selectionModel()->hasSelection();
     ui->deleteButton->setEnabled(hasSelection);
 }
 
@@ -252,39 +191,48 @@ void HistoryDialog::onDateToChanged(const QDate &date)
     }
 }
 
-void HistoryDialog::applyFilter()
+void HistoryDialog::onStatusFilterChanged(int index)
 {
-    const QString searchText = ui->searchLineEdit->text().trimmed().toLower();
-
-    m_filteredRecords.clear();
-    for (const DownloadRecord &record : m_allRecords) {
-        bool ok = true;
+    Q_UNUSED(index);
+    applyFilter();
+}
 
-        // 文本过滤
-        if (!searchText.isEmpty()) {
-            const bool matchesText = record.fileName.toLower().contains(searchText) ||
-                                     record.url.toLower().contains(searchText);
-            if (!matchesText) {
-                ok = false;
-            }
-        }
+void HistoryDialog::fillStatusFilterCombo()
+{
+    const QString current = ui->statusFilterCombo->currentData().toString();
+    const QSignalBlocker blocker(ui->statusFilterCombo);
+    ui->statusFilterCombo->clear();
+    ui->statusFilterCombo->addItem(tr("全部"), QString());
+    ui->statusFilterCombo->addItem(tr("已完成"), QStringLiteral("Completed"));
+    ui->statusFilterCombo->addItem(tr("失败"), QStringLiteral("Failed"));
+    ui->statusFilterCombo->addItem(tr("已取消"), QStringLiteral("Cancelled"));
+    ui->statusFilterCombo->setCurrentIndex(qMax(0, ui->statusFilterCombo->findData(current)));
+}
 
-        // 日期过滤：基于 startTime.date() 落在 [from, to] 区间内
-        if (ok && m_dateFilterActive) {
-            const QDate from = ui->dateFromEdit->date();
-            const QDate to = ui->dateToEdit->date();
-            const QDate dt = record.startTime.date();
-            if (!dt.isValid() || dt < from || dt > to) {
-                ok = false;
-            }
+void HistoryDialog::applyFilter()
+{
+    // 搜索框：host:xxx 精确匹配主机，其余词在文件名与主机名中查找
+    HistoryQuery query;
+    QStringList words;
+    const QStringList tokens = ui->searchLineEdit->text().split(' ', Qt::SkipEmptyParts);
+    for (const QString &token : tokens) {
+        if (token.startsWith("host:", Qt::CaseInsensitive)) {
+            query.host = token.mid(5);
+        } else {
+            words.append(token);
         }
+    }
+    query.text = words.join(' ');
+    query.status = ui->statusFilterCombo->currentData().toString();
 
-        if (ok) {
-            m_filteredRecords.append(record);
-        }
+    // 日期过滤：完成日期落在 [from, to] 区间内
+    if (m_dateFilterActive) {
+        query.from = ui->dateFromEdit->date();
+        query.to = ui->dateToEdit->date();
     }
 
-    updateTable();
+    m_model->setQuery(query);
+    updateStatusLabel();
 }
 
 bool HistoryDialog::confirmDelete(const DownloadRecord &record)
@@ -300,8 +248,9 @@ bool HistoryDialog::confirmDelete(const DownloadRecord &record)
 
 void HistoryDialog::showContextMenu(const QPoint &pos)
 {
-    QTableWidgetItem *item = ui->tableWidget->itemAt(pos);
-    if (!item) {
+    const QModelIndex index = ui->tableView->indexAt(pos);
+    DownloadRecord record;
+    if (!m_model->recordAt(index.row(), &record)) {
         return;
     }
     
@@ -311,25 +260,21 @@ void HistoryDialog::showContextMenu(const QPoint &pos)
     QAction *copyUrlAction = contextMenu.addAction(tr("复制URL"));
     QAction *deleteAction = contextMenu.addAction(tr("删除记录"));
     
-    QAction *selectedAction = contextMenu.exec(ui->tableWidget->mapToGlobal(pos));
+    QAction *selectedAction = contextMenu.exec(ui->tableView->viewport()->mapToGlobal(pos));
     
     if (selectedAction) {
-        int row = item->row();
-        if (row >= 0 && row < m_filteredRecords.size()) {
-            const DownloadRecord &record = m_filteredRecords[row];
-            
-            if (selectedAction == openFileAction) {
-                // TODO: 实现打开文件功能
-                QMessageBox::information(this, tr("提示"), tr("打开文件功能暂未实现"));
-            } else if (selectedAction == openFolderAction) {
-                // TODO: 实现打开文件夹功能
-                QMessageBox::information(this, tr("提示"), tr("打开文件夹功能暂未实现"));
-            } else if (selectedAction == copyUrlAction) {
-                QApplication::clipboard()->setText(record.url);
-                QMessageBox::information(this, tr("成功"), tr("URL已复制到剪贴板"));
-            } else if (selectedAction == deleteAction) {
-                onDeleteClicked();
-            }
+        if (selectedAction == openFileAction) {
+            // TODO: 实现打开文件功能
+            QMessageBox::information(this, tr("提示"), tr("打开文件功能暂未实现"));
+        } else if (selectedAction == openFolderAction) {
+            // TODO: 实现打开文件夹功能
+            QMessageBox::information(this, tr("提示"), tr("打开文件夹功能暂未实现"));
+        } else if (selectedAction == copyUrlAction) {
+            QApplication::clipboard()->setText(record.url);
+            QMessageBox::information(this, tr("成功"), tr("URL已复制到剪贴板"));
+        } else if (selectedAction == deleteAction) {
+            ui->tableView->setCurrentIndex(index);
+            onDeleteClicked();
         }
     }
 }
\ No newline at end of file
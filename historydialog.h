@@ -2,12 +2,13 @@
 #define HISTORYDIALOG_H
 
 #include <QDialog>
-#include <QTableWidgetItem>
 #include <QClipboard>
 #include <QApplication>
 #include <QDate>
 #include "historymanager.h"
 
+class HistoryTableModel;
+
 namespace Ui {
 class HistoryDialog;
 }
@@ -30,26 +31,27 @@ private slots:
     void onClearDateFilterClicked();
     void onDateFromChanged(const QDate &date);
     void onDateToChanged(const QDate &date);
+    void onStatusFilterChanged(int index);
 
 protected:
     /**
      * @brief 接 QEvent::LanguageChange：当前应用翻译器变化时 Qt 会派发该事件；
-     * 调用 ui->retranslateUi(this) 让对话框文案跟随语言切换更新；同时按需
-     * 重排行内 cell widget 的 tooltip。
+     * 调用 ui->retranslateUi(this) 让对话框文案跟随语言切换更新；同时刷新
+     * 表头、状态过滤下拉框与状态列的文案。
      */
     void changeEvent(QEvent* event) override;
 
 private:
     void loadHistory();
-    void updateTable();
+    void updateStatusLabel();
     void showContextMenu(const QPoint &pos);
     void applyFilter();
+    void fillStatusFilterCombo();
     bool confirmDelete(const DownloadRecord &record);
 
     Ui::HistoryDialog *ui;
     HistoryManager &m_historyManager;
-    QList<DownloadRecord> m_allRecords;
-    QList<DownloadRecord> m_filteredRecords;
+    HistoryTableModel *m_model = nullptr; ///< 查询结果模型（只取可见行的记录）
     bool m_dateFilterActive = false;
 };
 
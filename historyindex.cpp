@@ -0,0 +1,228 @@
+#include "historyindex.h"
+#include "historymanager.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+    /// 完成日期无效的槽位
+    constexpr qint32 kNoDay = std::numeric_limits<qint32>::min();
+}
+
+void HistoryIndex::clear()
+{
+    m_ids.clear();
+    m_finishDay.clear();
+    m_status.clear();
+    m_hostOf.clear();
+    m_dead.clear();
+    m_deadCount = 0;
+    m_trigrams.clear();
+    m_hostIds.clear();
+    m_hostNames.clear();
+    m_hostSlots.clear();
+}
+
+void HistoryIndex::rebuild(const QList<DownloadRecord>& records)
+{
+    clear();
+    const size_t count = size_t(records.size());
+    m_ids.reserve(count);
+    m_finishDay.reserve(count);
+    m_status.reserve(count);
+    m_hostOf.reserve(count);
+    m_dead.reserve(count);
+    for (const DownloadRecord& record : records) {
+        add(record);
+    }
+}
+
+void HistoryIndex::add(const DownloadRecord& record)
+{
+    const quint32 slot = quint32(m_ids.size());
+    m_ids.push_back(record.id);
+    const QDate day = record.finishTime.date();
+    m_finishDay.push_back(day.isValid() ? qint32(day.toJulianDay()) : kNoDay);
+    m_status.push_back(statusCode(record.status));
+    m_dead.push_back(false);
+
+    const QString host = hostOf(record.url);
+    quint32 hostId = 0;
+    const auto it = m_hostIds.constFind(host);
+    if (it == m_hostIds.cend()) {
+        hostId = quint32(m_hostNames.size());
+        m_hostIds.insert(host, hostId);
+        m_hostNames.append(host);
+        m_hostSlots.emplace_back();
+    } else {
+        hostId = it.value();
+    }
+    m_hostOf.push_back(hostId);
+    m_hostSlots[hostId].push_back(slot);
+
+    // 槽位递增追加，倒排表天然有序
+    std::vector<quint64> keys;
+    collectTrigrams(record.fileName.toLower(), &keys);
+    collectTrigrams(host, &keys);
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    for (quint64 key : keys) {
+        m_trigrams[key].push_back(slot);
+    }
+}
+
+void HistoryIndex::remove(quint64 id)
+{
+    const auto it = std::lower_bound(m_ids.cbegin(), m_ids.cend(), id);
+    if (it == m_ids.cend() || *it != id) {
+        return;
+    }
+    const size_t slot = size_t(it - m_ids.cbegin());
+    if (!m_dead[slot]) {
+        m_dead[slot] = true;
+        ++m_deadCount;
+    }
+}
+
+bool HistoryIndex::needsRebuild() const
+{
+    return m_deadCount >= REBUILD_MIN_DEAD && m_deadCount * 2 > qsizetype(m_ids.size());
+}
+
+QList<quint64> HistoryIndex::search(const HistoryQuery& query, const QList<DownloadRecord>& records) const
+{
+    QList<quint64> result;
+    const QString text = query.text.trimmed().toLower();
+    const QString host = query.host.trimmed().toLower();
+    const int status = query.status.isEmpty() ? -1 : int(statusCode(query.status));
+    const bool dateFilter = query.from.isValid() || query.to.isValid();
+    const qint64 fromDay = query.from.isValid() ? query.from.toJulianDay() : std::numeric_limits<qint64>::min();
+    const qint64 toDay = query.to.isValid() ? query.to.toJulianDay() : std::numeric_limits<qint64>::max();
+
+    // 条件对应的倒排表；任何一个键不存在就不可能有结果
+    std::vector<const std::vector<quint32>*> lists;
+    if (!host.isEmpty()) {
+        const auto it = m_hostIds.constFind(host);
+        if (it == m_hostIds.cend()) {
+            return result;
+        }
+        lists.push_back(&m_hostSlots[it.value()]);
+    }
+    if (text.size() >= 3) {
+        std::vector<quint64> keys;
+        collectTrigrams(text, &keys);
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        for (quint64 key : keys) {
+            const auto it = m_trigrams.constFind(key);
+            if (it == m_trigrams.cend()) {
+                return result;
+            }
+            lists.push_back(&it.value());
+        }
+    }
+    std::sort(lists.begin(), lists.end(), [](const std::vector<quint32>* a, const std::vector<quint32>* b) {
+        return a->size() < b->size();
+    });
+
+    // 主机名是否含搜索词：每个主机只比较一次
+    std::vector<bool> hostMatches;
+    if (!text.isEmpty()) {
+        hostMatches.resize(size_t(m_hostNames.size()));
+        for (qsizetype i = 0; i < m_hostNames.size(); ++i) {
+            hostMatches[size_t(i)] = m_hostNames.at(i).contains(text);
+        }
+    }
+
+    auto cursor = records.cbegin();
+    auto check = [&](quint32 slot) {
+        if (m_dead[slot]) {
+            return;
+        }
+        if (status >= 0 && m_status[slot] != status) {
+            return;
+        }
+        if (dateFilter) {
+            const qint32 day = m_finishDay[slot];
+            if (day == kNoDay || day < fromDay || day > toDay) {
+                return;
+            }
+        }
+        for (size_t i = 1; i < lists.size(); ++i) {
+            if (!std::binary_search(lists[i]->cbegin(), lists[i]->cend(), slot)) {
+                return;
+            }
+        }
+        const quint64 id = m_ids[slot];
+        if (!text.isEmpty() && !hostMatches[m_hostOf[slot]]) {
+            // 槽位与 records 都按编号升序，游标只会前进
+            cursor = std::lower_bound(cursor, records.cend(), id, [](const DownloadRecord& record, quint64 value) {
+                return record.id < value;
+            });
+            if (cursor == records.cend() || cursor->id != id
+                || !cursor->fileName.contains(text, Qt::CaseInsensitive)) {
+                return;
+            }
+        }
+        result.append(id);
+    };
+
+    if (lists.empty()) {
+        for (quint32 slot = 0; slot < quint32(m_ids.size()); ++slot) {
+            check(slot);
+        }
+    } else {
+        for (quint32 slot : *lists.front()) {
+            check(slot);
+        }
+    }
+    return result;
+}
+
+QString HistoryIndex::hostOf(const QString& url)
+{
+    const qsizetype scheme = url.indexOf(QLatin1String("://"));
+    const qsizetype start = scheme < 0 ? 0 : scheme + 3;
+    qsizetype end = start;
+    while (end < url.size()) {
+        const QChar c = url.at(end);
+        if (c == QLatin1Char('/') || c == QLatin1Char('?') || c == QLatin1Char('#')) {
+            break;
+        }
+        ++end;
+    }
+    QStringView authority = QStringView(url).mid(start, end - start);
+    const qsizetype at = authority.lastIndexOf(QLatin1Char('@'));
+    if (at >= 0) {
+        authority = authority.mid(at + 1);
+    }
+    if (authority.startsWith(QLatin1Char('['))) {
+        const qsizetype close = authority.indexOf(QLatin1Char(']'));
+        if (close > 0) {
+            authority = authority.mid(1, close - 1);
+        }
+    } else {
+        const qsizetype colon = authority.lastIndexOf(QLatin1Char(':'));
+        if (colon >= 0) {
+            authority = authority.left(colon);
+        }
+    }
+    return authority.toString().toLower();
+}
+
+void HistoryIndex::collectTrigrams(const QString& lowerText, std::vector<quint64>* keys)
+{
+    for (qsizetype i = 0; i + 3 <= lowerText.size(); ++i) {
+        keys->push_back((quint64(lowerText.at(i).unicode()) << 32)
+                        | (quint64(lowerText.at(i + 1).unicode()) << 16)
+                        | quint64(lowerText.at(i + 2).unicode()));
+    }
+}
+
+quint8 HistoryIndex::statusCode(const QString& status)
+{
+    if (status == QLatin1String("Completed")) return 1;
+    if (status == QLatin1String("Failed")) return 2;
+    if (status == QLatin1String("Cancelled")) return 3;
+    return 0;
+}
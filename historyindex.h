@@ -0,0 +1,104 @@
+#ifndef HISTORYINDEX_H
+#define HISTORYINDEX_H
+
+#include <QDate>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+struct DownloadRecord;
+
+/**
+ * @brief 历史记录查询条件；各条件之间是"与"的关系。
+ */
+struct HistoryQuery {
+    QString text;       ///< 在文件名与主机名中查找的子串（不区分大小写，空表示不限）
+    QString host;       ///< 精确匹配的主机名（空表示不限）
+    QString status;     ///< "Completed" / "Failed" / "Cancelled"（空表示不限）
+    QDate from;         ///< 完成日期下限（无效表示不限）
+    QDate to;           ///< 完成日期上限（无效表示不限）
+};
+
+/**
+ * @brief 历史记录的内存索引，让按输入实时搜索在百万条记录上也只需毫秒级。
+ *
+ * 每条记录占一个槽位（按编号递增追加，删除只做标记），槽位上按列保存完成日期、状态与主机编号；
+ * 另有两类倒排表（槽位升序）：
+ *  - 文件名与主机名的三元组（小写的连续三个字符）-> 槽位；
+ *  - 主机名 -> 槽位。
+ * 查询取条件里最短的倒排表逐个核对其余条件；三元组只能筛出候选，最后仍要核对子串。
+ * 不到三个字符的搜索词没有三元组可用，退化为对全部槽位的顺序扫描。
+ * 删除的槽位多于存活的槽位时由 HistoryManager 整体重建。
+ *
+ * 不加锁，由 HistoryManager 在 m_historyMutex 内使用。
+ */
+class HistoryIndex
+{
+public:
+    /**
+     * @brief 清空索引。
+     */
+    void clear();
+
+    /**
+     * @brief 按记录列表（编号升序）重建索引。
+     */
+    void rebuild(const QList<DownloadRecord>& records);
+
+    /**
+     * @brief 追加一条记录；编号必须大于已索引的所有记录。
+     */
+    void add(const DownloadRecord& record);
+
+    /**
+     * @brief 标记删除一条记录（不在索引中时什么都不做）。
+     */
+    void remove(quint64 id);
+
+    /**
+     * @brief 删除的槽位是否已经多到值得重建。
+     */
+    bool needsRebuild() const;
+
+    /**
+     * @brief 查询。
+     * @param query 查询条件。
+     * @param records 建索引用的记录列表（编号升序），用于核对文件名子串。
+     * @return 命中记录的编号（升序）。
+     */
+    QList<quint64> search(const HistoryQuery& query, const QList<DownloadRecord>& records) const;
+
+    /**
+     * @brief 从 URL 取出小写的主机名（不解析成 QUrl，加载百万条记录时也足够快）。
+     */
+    static QString hostOf(const QString& url);
+
+private:
+    /**
+     * @brief 文本中所有不重复的三元组键。
+     */
+    static void collectTrigrams(const QString& lowerText, std::vector<quint64>* keys);
+
+    /**
+     * @brief 状态字符串对应的编码：1 已完成，2 失败，3 已取消，0 其他。
+     */
+    static quint8 statusCode(const QString& status);
+
+    std::vector<quint64> m_ids;         ///< 槽位 -> 记录编号（升序）。
+    std::vector<qint32> m_finishDay;    ///< 槽位 -> 完成日期的儒略日（日期无效时为 INT32_MIN）。
+    std::vector<quint8> m_status;       ///< 槽位 -> 状态编码。
+    std::vector<quint32> m_hostOf;      ///< 槽位 -> 主机编号。
+    std::vector<bool> m_dead;           ///< 槽位是否已删除。
+    qsizetype m_deadCount = 0;          ///< 已删除的槽位数。
+
+    QHash<quint64, std::vector<quint32>> m_trigrams;   ///< 三元组 -> 槽位（升序）。
+    QHash<QString, quint32> m_hostIds;                  ///< 主机名 -> 主机编号。
+    QStringList m_hostNames;                            ///< 主机编号 -> 主机名。
+    std::vector<std::vector<quint32>> m_hostSlots;      ///< 主机编号 -> 槽位（升序）。
+
+    static constexpr qsizetype REBUILD_MIN_DEAD = 4096; ///< 删除的槽位不到这个数不重建
+};
+
+#endif // HISTORYINDEX_H
@@ -3,11 +3,18 @@
 #include <QCoreApplication>
 #include <QStandardPaths>
 #include <QDir>
+#include <QSaveFile>
+#include <QSet>
+#include <algorithm>
+#include <utility>
 
 // DownloadRecord的JSON转换方法实现
 QJsonObject DownloadRecord::toJson() const
 {
     QJsonObject obj;
+    if (id != 0) {
+        obj["id"] = double(id);
+    }
     obj["url"] = url;
     obj["filePath"] = filePath;
     obj["fileSize"] = QString::number(fileSize);
@@ -21,6 +28,7 @@ QJsonObject DownloadRecord::toJson() const
 DownloadRecord DownloadRecord::fromJson(const QJsonObject& json)
 {
     DownloadRecord record;
+    record.id = quint64(json["id"].toDouble());
     record.url = json["url"].toString();
     record.filePath = json["filePath"].toString();
     record.fileSize = json["fileSize"].toString().toLongLong();
@@ -35,27 +43,47 @@ DownloadRecord DownloadRecord::fromJson(const QJsonObject& json)
  * @brief 历史记录管理器构造函数
  * @param parent 父对象指针
  * 
- * 初始化历史记录管理器，创建并初始化JSON文件存储
- * JSON文件用于存储下载任务的历史记录，包括URL、文件路径、大小、时间等信息
- * 如果JSON文件初始化失败，会记录错误日志但不中断程序运行
+ * 加载历史日志并启动后台写线程。
+ * 如果日志初始化失败，会记录错误日志但不中断程序运行（历史只保存在内存中）。
  */
 HistoryManager::HistoryManager(QObject *parent)
     : QObject(parent)
 {
     LOGD("开始构造HistoryManager");
-    LOGD("调用initJsonFile()");
-    if (!initJsonFile()) {
-        LOGD("历史记录JSON文件初始化失败!");
+    bool needsCompaction = false;
+    if (!initJournal(&needsCompaction)) {
+        LOGD("历史记录日志初始化失败!");
     } else {
-        LOGD("历史记录JSON文件初始化成功");
+        LOGD("历史记录日志初始化成功");
+    }
+
+    m_index.rebuild(m_records);
+
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(FLUSH_DELAY_MS);
+    connect(&m_flushTimer, &QTimer::timeout, this, &HistoryManager::flushPending);
+
+    m_writerContext = new QObject;
+    m_writerContext->moveToThread(&m_writerThread);
+    m_writerThread.setObjectName("HistoryWriter");
+    m_writerThread.start();
+
+    if (QCoreApplication::instance()) {
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, [this]() { shutdown(); });
+    }
+
+    if (needsCompaction) {
+        QMutexLocker locker(&m_historyMutex);
+        compactLocked();
     }
     LOGD("HistoryManager构造完成");
 }
 
 HistoryManager::~HistoryManager()
 {
-    // 自动保存历史记录到JSON文件
-    saveHistory();
+    shutdown();
+    // 写线程已停止，剩余的写操作都在这里同步完成
+    closeJournal();
 }
 
 HistoryManager& HistoryManager::instance()
@@ -67,145 +95,170 @@ HistoryManager& HistoryManager::instance()
 }
 
 /**
- * @brief 初始化JSON文件路径并加载历史记录
+ * @brief 初始化日志路径并加载历史记录
  * @return true 初始化成功，false 初始化失败
  * 
- * 创建JSON文件路径并加载历史记录
- * JSON文件存储在用户的APPDATA目录中：%APPDATA%\Programming666\Downloader\history.json
+ * 日志存储在用户的APPDATA目录中：%APPDATA%\Programming666\Downloader\history.log
  * 
  * 初始化过程：
  * 1. 确保应用程序名称设置正确
  * 2. 获取APPDATA目录路径
  * 3. 创建目录（如不存在）
- * 4. 设置JSON文件路径
- * 5. 加载历史记录
+ * 4. 设置日志路径
+ * 5. 加载日志；日志不存在而旧版 history.json 存在时迁移
  */
-bool HistoryManager::initJsonFile()
+bool HistoryManager::initJournal(bool* needsCompaction)
 {
-    LOGD("[HistoryManager::initJsonFile] 开始初始化JSON文件");
+    LOGD("[HistoryManager::initJournal] 开始初始化历史日志");
     
     // 确保应用程序名称已设置
-    LOGD("[HistoryManager::initJsonFile] 检查应用程序名称设置");
     if (QCoreApplication::applicationName().isEmpty()) {
-        LOGD("[HistoryManager::initJsonFile] 应用程序名称为空，设置为'Downloader'");
+        LOGD("[HistoryManager::initJournal] 应用程序名称为空，设置为'Downloader'");
         QCoreApplication::setApplicationName("Downloader");
-    } else {
-        LOGD(QString("[HistoryManager::initJsonFile] 应用程序名称已设置:%1").arg(QCoreApplication::applicationName()));
     }
-    
     if (QCoreApplication::organizationName().isEmpty()) {
-        LOGD("[HistoryManager::initJsonFile] 组织名称为空，设置为'Programming666'");
+        LOGD("[HistoryManager::initJournal] 组织名称为空，设置为'Programming666'");
         QCoreApplication::setOrganizationName("Programming666");
-    } else {
-        LOGD(QString("[HistoryManager::initJsonFile] 组织名称已设置:%1").arg(QCoreApplication::organizationName()));
     }
 
     // 获取APPDATA目录
-    LOGD("[HistoryManager::initJsonFile] 获取APPDATA目录");
     QString appDataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
     if (appDataPath.isEmpty()) {
-        LOGD("[HistoryManager::initJsonFile] 无法找到AppDataLocation，回退到当前目录");
+        LOGD("[HistoryManager::initJournal] 无法找到AppDataLocation，回退到当前目录");
         appDataPath = QDir::currentPath();
     }
     
     // QStandardPaths::AppDataLocation 已经返回完整路径：C:\Users\username\AppData\Roaming\Programming666\Downloader
-    QString downloaderPath = appDataPath;
-    LOGD(QString("[HistoryManager::initJsonFile] Downloader目录路径:%1").arg(downloaderPath));
-
-    LOGD("[HistoryManager::initJsonFile] 检查Downloader目录是否存在");
-    QDir downloaderDir(downloaderPath);
-    if (!downloaderDir.exists()) {
-        LOGD("[HistoryManager::initJsonFile] Downloader目录不存在，创建目录");
-        bool created = downloaderDir.mkpath(".");
-        LOGD(QString("[HistoryManager::initJsonFile] 目录创建结果:%1").arg(created ? "成功" : "失败"));
-        if (!created) {
-            LOGD(QString("[HistoryManager::initJsonFile] 无法创建Downloader目录:%1").arg(downloaderPath));
-            return false;
-        }
-    } else {
-        LOGD("[HistoryManager::initJsonFile] Downloader目录已存在");
+    QDir downloaderDir(appDataPath);
+    if (!downloaderDir.exists() && !downloaderDir.mkpath(".")) {
+        LOGD(QString("[HistoryManager::initJournal] 无法创建Downloader目录:%1").arg(appDataPath));
+        return false;
     }
 
-    // 设置JSON文件路径
-    m_historyFilePath = downloaderPath + QDir::separator() + "history.json";
-    LOGD(QString("[HistoryManager::initJsonFile] JSON文件完整路径:%1").arg(m_historyFilePath));
+    m_historyFilePath = downloaderDir.filePath("history.log");
+    LOGD(QString("[HistoryManager::initJournal] 日志完整路径:%1").arg(m_historyFilePath));
 
-    // 加载历史记录
-    LOGD("[HistoryManager::initJsonFile] 加载历史记录");
-    if (!loadHistory()) {
-        LOGD("[HistoryManager::initJsonFile] 历史记录加载失败，将使用空列表");
-        m_records.clear();
+    const QString legacyPath = downloaderDir.filePath("history.json");
+    if (!QFile::exists(m_historyFilePath) && QFile::exists(legacyPath)) {
+        if (migrateLegacyJson(legacyPath)) {
+            *needsCompaction = true;
+        }
+        return true;
     }
 
-    LOGD("[HistoryManager::initJsonFile] JSON文件初始化完成");
+    if (!loadJournal(needsCompaction)) {
+        LOGD("[HistoryManager::initJournal] 历史记录加载失败，将使用空列表");
+        m_records.clear();
+    }
     return true;
 }
 
 /**
- * @brief 从JSON文件加载历史记录
+ * @brief 逐行读取日志
  * @return true 加载成功，false 加载失败
  * 
- * 如果JSON文件存在但格式错误，会清空文件并返回空列表
+ * 每行独立解析：某一行坏了只丢那一行。最后一行没有换行说明上次写到一半就崩溃了，
+ * 丢弃它并要求压缩，否则之后追加的行会接在半行后面。
  */
-bool HistoryManager::loadHistory()
+bool HistoryManager::loadJournal(bool* needsCompaction)
 {
-    LOGD("[HistoryManager::loadHistory] 开始加载历史记录");
+    LOGD("[HistoryManager::loadJournal] 开始加载历史记录");
 
     QFile file(m_historyFilePath);
     if (!file.exists()) {
-        LOGD("[HistoryManager::loadHistory] JSON文件不存在，将创建新文件");
-        m_records.clear();
+        LOGD("[HistoryManager::loadJournal] 日志不存在，将在首次写入时创建");
         return true;
     }
 
     if (!file.open(QIODevice::ReadOnly)) {
-        LOGD(QString("[HistoryManager::loadHistory] 无法打开JSON文件:%1").arg(file.errorString()));
-        // 文件存在但打不开（例如权限、文件锁）。先尝试把它原子重命名到 .bak 再重试一次，
+        LOGD(QString("[HistoryManager::loadJournal] 无法打开日志:%1").arg(file.errorString()));
+        // 文件存在但打不开（例如权限、文件锁）。先尝试把它原子重命名到 .bak，
         // 以避免任何覆盖式"清空"把可能仍可读的旧数据毁掉。
         if (recoverFromOpenFailure()) {
             return true;
         }
-        // 实在打不开，记录失败但保留内存中已有的内容。
-        LOGD("[HistoryManager::loadHistory] 恢复失败，保留当前内存记录");
+        LOGD("[HistoryManager::loadJournal] 恢复失败，保留当前内存记录");
         return false;
     }
 
-    QByteArray data = file.readAll();
+    QList<DownloadRecord> records;
+    QSet<quint64> deleted;
+    qint64 lines = 0;
+    int damaged = 0;
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine();
+        if (!line.endsWith('\n')) {
+            ++damaged;
+            break;
+        }
+        ++lines;
+        const QJsonDocument doc = QJsonDocument::fromJson(line);
+        if (!doc.isObject()) {
+            ++damaged;
+            continue;
+        }
+        const QJsonObject obj = doc.object();
+        if (obj.contains("del")) {
+            deleted.insert(quint64(obj.value("del").toDouble()));
+            continue;
+        }
+        DownloadRecord record = DownloadRecord::fromJson(obj);
+        if (record.id == 0 || record.url.isEmpty()) {
+            ++damaged;
+            continue;
+        }
+        m_nextId = qMax(m_nextId, record.id + 1);
+        records.append(record);
+    }
     file.close();
 
-    // 如果文件为空，返回空列表
-    if (data.isEmpty()) {
-        LOGD("[HistoryManager::loadHistory] JSON文件为空");
-        m_records.clear();
-        return true;
+    if (!deleted.isEmpty()) {
+        records.removeIf([&deleted](const DownloadRecord& record) { return deleted.contains(record.id); });
+    }
+    m_records = records;
+    m_journalLines = lines;
+    enforceRetentionLocked();
+
+    if (damaged > 0) {
+        LOGD(QString("[HistoryManager::loadJournal] 跳过%1个损坏的行").arg(damaged));
+        *needsCompaction = true;
+    } else if (m_journalLines >= COMPACT_MIN_LINES && m_journalLines > 2 * m_records.size()) {
+        *needsCompaction = true;
     }
 
-    QJsonDocument doc = QJsonDocument::fromJson(data);
-    if (doc.isNull() || !doc.isArray()) {
-        LOGD("[HistoryManager::loadHistory] JSON文件格式错误或不是数组，尝试备份并清空");
-        // 损坏的JSON: 把它重命名到 .bak 备份后再清空，避免完全丢失。
-        QFile::rename(m_historyFilePath, m_historyFilePath + ".bak");
-        m_records.clear();
-        saveHistory(); // 创建空的JSON文件
-        return true;
+    LOGD(QString("[HistoryManager::loadJournal] 历史记录加载成功，共%1条记录，日志%2行")
+             .arg(m_records.size()).arg(m_journalLines));
+    return true;
+}
+
+bool HistoryManager::migrateLegacyJson(const QString& legacyPath)
+{
+    QFile file(legacyPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        LOGD(QString("[HistoryManager::migrateLegacyJson] 无法打开旧版历史文件:%1").arg(file.errorString()));
+        return false;
     }
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    file.close();
 
-    QJsonArray array = doc.array();
     m_records.clear();
-
-    for (const QJsonValue& value : array) {
-        if (value.isObject()) {
-            try {
-                DownloadRecord record = DownloadRecord::fromJson(value.toObject());
-                m_records.append(record);
-            } catch (...) {
-                LOGD("[HistoryManager::loadHistory] 解析记录失败，跳过该记录");
-                continue;
-            }
+    for (const QJsonValue& value : doc.array()) {
+        if (!value.isObject()) {
+            continue;
         }
+        DownloadRecord record = DownloadRecord::fromJson(value.toObject());
+        if (record.url.trimmed().isEmpty()) {
+            continue;
+        }
+        record.id = m_nextId++;
+        m_records.append(record);
     }
+    enforceRetentionLocked();
 
-    LOGD(QString("[HistoryManager::loadHistory] 历史记录加载成功，共%1条记录").arg(m_records.size()));
+    // 改名保留原文件；新日志由启动后的压缩写出
+    QFile::remove(legacyPath + ".bak");
+    QFile::rename(legacyPath, legacyPath + ".bak");
+    LOGD(QString("[HistoryManager::migrateLegacyJson] 已迁移旧版历史记录%1条").arg(m_records.size()));
     return true;
 }
 
@@ -223,74 +276,160 @@ bool HistoryManager::recoverFromOpenFailure()
         }
         LOGD(QString("[HistoryManager::recoverFromOpenFailure] 已把不可读文件重命名为 %1").arg(backupPath));
     }
-    // 重命名成功，文件已经被移走；直接当作空列表处理。
+    // 重命名成功，文件已经被移走；直接当作空列表处理，首次写入时创建新日志。
     m_records.clear();
-    saveHistory(); // 写入一个新的空文件作为新的起点
+    m_journalLines = 0;
     return true;
 }
 
-/**
- * @brief 保存历史记录到JSON文件
- * @return true 保存成功，false 保存失败
- */
-bool HistoryManager::saveHistory()
+QByteArray HistoryManager::journalLine(const QJsonObject& obj)
 {
-    LOGD("[HistoryManager::saveHistory] 开始保存历史记录");
+    return QJsonDocument(obj).toJson(QJsonDocument::Compact) + '\n';
+}
 
-    QJsonArray array;
-    {
-        QMutexLocker locker(&m_historyMutex);
-        for (const DownloadRecord& record : m_records) {
-            array.append(record.toJson());
-        }
+void HistoryManager::post(std::function<void()> job)
+{
+    if (m_stopped) {
+        job();
+        return;
     }
+    QMetaObject::invokeMethod(m_writerContext, std::move(job), Qt::QueuedConnection);
+}
 
-    QJsonDocument doc(array);
-    const QByteArray payload = doc.toJson();
+void HistoryManager::appendLineLocked(const QByteArray& line)
+{
+    m_pendingLines += line;
+    ++m_pendingCount;
+    ++m_journalLines;
+    if (m_stopped || m_pendingCount >= FLUSH_BATCH) {
+        flushLocked();
+    } else if (m_pendingCount == 1) {
+        // 可能在其他线程调用：定时器的启动切回它所在的线程
+        QMetaObject::invokeMethod(&m_flushTimer, qOverload<>(&QTimer::start));
+    }
+}
 
-    // 原子写入：写到 .tmp，fsync，rename 覆盖目标文件。
-    const QString tmpPath = m_historyFilePath + ".tmp";
-    QFile tmpFile(tmpPath);
-    if (!tmpFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-        LOGD(QString("[HistoryManager::saveHistory] 无法打开临时文件:%1").arg(tmpFile.errorString()));
-        return false;
+void HistoryManager::flushLocked()
+{
+    if (m_pendingLines.isEmpty()) {
+        return;
     }
-    try {
-        if (tmpFile.write(payload) != payload.size()) {
-            LOGD(QString("[HistoryManager::saveHistory] 写入临时文件失败: %1").arg(tmpFile.errorString()));
-            tmpFile.close();
-            QFile::remove(tmpPath);
-            return false;
+    const QByteArray lines = std::exchange(m_pendingLines, {});
+    m_pendingCount = 0;
+    post([this, lines]() { writeLines(lines); });
+}
+
+void HistoryManager::flushPending()
+{
+    QMutexLocker locker(&m_historyMutex);
+    flushLocked();
+}
+
+void HistoryManager::enforceRetentionLocked()
+{
+    const qsizetype excess = m_records.size() - MAX_RECORDS;
+    if (excess > 0) {
+        // 日志里的旧行留给下次压缩清理
+        for (qsizetype i = 0; i < excess; ++i) {
+            m_index.remove(m_records.at(i).id);
         }
-        if (!tmpFile.flush()) {
-            LOGD("[HistoryManager::saveHistory] flush失败");
-            tmpFile.close();
-            QFile::remove(tmpPath);
-            return false;
+        m_records.remove(0, excess);
+        if (m_index.needsRebuild()) {
+            m_index.rebuild(m_records);
         }
-        tmpFile.close();
-        // 替换原文件
-        QFile::remove(m_historyFilePath);
-        if (!QFile::rename(tmpPath, m_historyFilePath)) {
-            LOGD(QString("[HistoryManager::saveHistory] 重命名 %1 -> %2 失败")
-                     .arg(tmpPath, m_historyFilePath));
-            QFile::remove(tmpPath);
-            return false;
+    }
+}
+
+void HistoryManager::maybeCompactLocked()
+{
+    if (m_journalLines >= COMPACT_MIN_LINES && m_journalLines > 2 * m_records.size()) {
+        compactLocked();
+    }
+}
+
+void HistoryManager::compactLocked()
+{
+    LOGD(QString("[HistoryManager::compactLocked] 压缩历史日志：%1行 -> %2条记录")
+             .arg(m_journalLines).arg(m_records.size()));
+    m_pendingLines.clear();
+    m_pendingCount = 0;
+    m_journalLines = m_records.size();
+    // m_records 是隐式共享的，快照只复制指针；序列化在写线程上做
+    const QList<DownloadRecord> snapshot = m_records;
+    post([this, snapshot]() { rewriteJournal(snapshot); });
+}
+
+void HistoryManager::writeLines(const QByteArray& lines)
+{
+    if (!m_journal) {
+        if (m_historyFilePath.isEmpty()) {
+            return;
         }
-    } catch (const std::exception& e) {
-        LOGD(QString("[HistoryManager::saveHistory] 异常:%1").arg(e.what()));
-        tmpFile.close();
-        QFile::remove(tmpPath);
-        return false;
-    } catch (...) {
-        LOGD("[HistoryManager::saveHistory] 未知异常");
-        tmpFile.close();
-        QFile::remove(tmpPath);
-        return false;
+        m_journal = std::make_unique<QFile>(m_historyFilePath);
+        if (!m_journal->open(QIODevice::WriteOnly | QIODevice::Append)) {
+            LOGD(QString("[HistoryManager::writeLines] 无法打开日志:%1").arg(m_journal->errorString()));
+            m_journal.reset();
+            return;
+        }
+    }
+    if (m_journal->write(lines) != lines.size() || !m_journal->flush()) {
+        LOGD(QString("[HistoryManager::writeLines] 写入日志失败:%1").arg(m_journal->errorString()));
+        // 可能留下半行：关闭后下次重新打开，加载时半行会被跳过
+        m_journal.reset();
     }
+}
 
-    LOGD(QString("[HistoryManager::saveHistory] 历史记录保存成功，共%1条记录").arg(array.size()));
-    return true;
+void HistoryManager::rewriteJournal(const QList<DownloadRecord>& records)
+{
+    if (m_historyFilePath.isEmpty()) {
+        return;
+    }
+    // 先关掉追加句柄，Windows 上打开着的文件不能被替换
+    closeJournal();
+
+    QSaveFile file(m_historyFilePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        LOGD(QString("[HistoryManager::rewriteJournal] 无法打开日志:%1").arg(file.errorString()));
+        return;
+    }
+    for (const DownloadRecord& record : records) {
+        file.write(journalLine(record.toJson()));
+    }
+    if (!file.commit()) {
+        LOGD(QString("[HistoryManager::rewriteJournal] 提交日志失败:%1").arg(file.errorString()));
+        return;
+    }
+    LOGD(QString("[HistoryManager::rewriteJournal] 日志已重写，共%1条记录").arg(records.size()));
+}
+
+void HistoryManager::closeJournal()
+{
+    if (m_journal) {
+        m_journal->close();
+        m_journal.reset();
+    }
+}
+
+void HistoryManager::shutdown()
+{
+    {
+        QMutexLocker locker(&m_historyMutex);
+        if (m_stopped) {
+            return;
+        }
+        flushLocked();
+    }
+    if (m_writerThread.isRunning()) {
+        // 投递的操作按顺序执行：这一步返回时前面的写入都已完成
+        QMetaObject::invokeMethod(m_writerContext, [this]() { closeJournal(); }, Qt::BlockingQueuedConnection);
+        m_writerThread.quit();
+        m_writerThread.wait();
+    }
+    QMutexLocker locker(&m_historyMutex);
+    m_stopped = true;
+    delete m_writerContext;
+    m_writerContext = nullptr;
+    LOGD("[HistoryManager::shutdown] 历史写线程已停止");
 }
 
 /**
@@ -298,7 +437,7 @@ bool HistoryManager::saveHistory()
  * @param record 下载记录结构体，包含完整的下载信息
  * @return true 添加成功，false 添加失败
  * 
- * 将下载任务的详细信息记录到JSON文件中，包括：
+ * 记录包括：
  * - URL：下载链接
  * - 文件路径：本地保存路径
  * - 文件大小：文件总大小（字节）
@@ -309,15 +448,8 @@ bool HistoryManager::saveHistory()
  */
 bool HistoryManager::addRecord(const DownloadRecord& record)
 {
-    LOGD("[HistoryManager::addRecord] 开始添加历史记录");
-    LOGD(QString("[HistoryManager::addRecord] 记录详情:"));
-    LOGD(QString("[HistoryManager::addRecord]   URL:%1").arg(record.url));
-    LOGD(QString("[HistoryManager::addRecord]   文件路径:%1").arg(record.filePath));
-    LOGD(QString("[HistoryManager::addRecord]   文件大小:%1").arg(record.fileSize));
-    LOGD(QString("[HistoryManager::addRecord]   开始时间:%1").arg(record.startTime.toString()));
-    LOGD(QString("[HistoryManager::addRecord]   结束时间:%1").arg(record.finishTime.toString()));
-    LOGD(QString("[HistoryManager::addRecord]   状态:%1").arg(record.status));
-    LOGD(QString("[HistoryManager::addRecord]   文件名:%1").arg(record.fileName));
+    LOGD(QString("[HistoryManager::addRecord] URL:%1 文件路径:%2 大小:%3 状态:%4")
+             .arg(record.url, record.filePath).arg(record.fileSize).arg(record.status));
 
     // 校验URL非空，避免污染历史。
     if (record.url.trimmed().isEmpty()) {
@@ -325,19 +457,39 @@ bool HistoryManager::addRecord(const DownloadRecord& record)
         return false;
     }
 
-    {
-        QMutexLocker locker(&m_historyMutex);
-        m_records.append(record);
-    }
+    QMutexLocker locker(&m_historyMutex);
+    DownloadRecord stored = record;
+    stored.id = m_nextId++;
+    m_records.append(stored);
+    m_index.add(stored);
+    appendLineLocked(journalLine(stored.toJson()));
+    enforceRetentionLocked();
+    maybeCompactLocked();
+    return true;
+}
 
-    if (!saveHistory()) {
-        LOGD("[HistoryManager::addRecord] 保存历史记录失败");
-        QMutexLocker locker(&m_historyMutex);
-        m_records.removeLast(); // 回滚内存中的记录
-        return false;
+bool HistoryManager::addRecords(const QList<DownloadRecord>& records)
+{
+    QMutexLocker locker(&m_historyMutex);
+    int added = 0;
+    for (const DownloadRecord& record : records) {
+        if (record.url.trimmed().isEmpty()) {
+            continue;
+        }
+        DownloadRecord stored = record;
+        stored.id = m_nextId++;
+        m_records.append(stored);
+        m_index.add(stored);
+        appendLineLocked(journalLine(stored.toJson()));
+        ++added;
+    }
+    if (added == 0) {
+        return true;
     }
+    enforceRetentionLocked();
+    maybeCompactLocked();
 
-    LOGD(QString("[HistoryManager::addRecord] 记录添加成功，URL:%1").arg(record.url));
+    LOGD(QString("[HistoryManager::addRecords] 批量添加 %1 条记录").arg(added));
     return true;
 }
 
@@ -348,31 +500,90 @@ QList<DownloadRecord> HistoryManager::getHistory() const
     return m_records;
 }
 
+QList<quint64> HistoryManager::search(const HistoryQuery& query) const
+{
+    QMutexLocker locker(&m_historyMutex);
+    return m_index.search(query, m_records);
+}
+
+QList<DownloadRecord> HistoryManager::records(const QList<quint64>& ids) const
+{
+    QList<DownloadRecord> result;
+    result.reserve(ids.size());
+    QMutexLocker locker(&m_historyMutex);
+    for (quint64 id : ids) {
+        const qsizetype position = positionOfLocked(id);
+        if (position >= 0) {
+            result.append(m_records.at(position));
+        }
+    }
+    return result;
+}
+
+int HistoryManager::recordCount() const
+{
+    QMutexLocker locker(&m_historyMutex);
+    return int(m_records.size());
+}
+
+qsizetype HistoryManager::positionOfLocked(quint64 id) const
+{
+    const auto it = std::lower_bound(m_records.cbegin(), m_records.cend(), id,
+                                     [](const DownloadRecord& record, quint64 value) { return record.id < value; });
+    if (it == m_records.cend() || it->id != id) {
+        return -1;
+    }
+    return it - m_records.cbegin();
+}
+
+void HistoryManager::removeAtLocked(qsizetype position)
+{
+    const quint64 id = m_records.at(position).id;
+    m_records.removeAt(position);
+    m_index.remove(id);
+    if (m_index.needsRebuild()) {
+        m_index.rebuild(m_records);
+    }
+
+    QJsonObject tombstone;
+    tombstone["del"] = double(id);
+    appendLineLocked(journalLine(tombstone));
+    maybeCompactLocked();
+}
+
 /**
  * @brief 删除单条历史记录
  * @param index 要删除的记录索引
  * @return true 删除成功，false 删除失败
+ *
+ * 日志里追加一行墓碑，不重写文件。
  */
 bool HistoryManager::deleteRecord(int index)
 {
     LOGD(QString("[HistoryManager::deleteRecord] 开始删除历史记录，索引:%1").arg(index));
 
-    {
-        QMutexLocker locker(&m_historyMutex);
-        if (index < 0 || index >= m_records.size()) {
-            LOGD(QString("[HistoryManager::deleteRecord] 索引超出范围:%1").arg(index));
-            return false;
-        }
-        // 从内存列表中删除
-        m_records.removeAt(index);
+    QMutexLocker locker(&m_historyMutex);
+    if (index < 0 || index >= m_records.size()) {
+        LOGD(QString("[HistoryManager::deleteRecord] 索引超出范围:%1").arg(index));
+        return false;
     }
+    removeAtLocked(index);
+
+    LOGD("[HistoryManager::deleteRecord] 历史记录删除成功");
+    return true;
+}
 
-    if (!saveHistory()) {
-        LOGD("[HistoryManager::deleteRecord] 保存历史记录失败");
+bool HistoryManager::deleteRecordById(quint64 id)
+{
+    QMutexLocker locker(&m_historyMutex);
+    const qsizetype position = positionOfLocked(id);
+    if (position < 0) {
+        LOGD(QString("[HistoryManager::deleteRecordById] 记录不存在:%1").arg(id));
         return false;
     }
+    removeAtLocked(position);
 
-    LOGD("[HistoryManager::deleteRecord] 历史记录删除成功");
+    LOGD(QString("[HistoryManager::deleteRecordById] 历史记录删除成功:%1").arg(id));
     return true;
 }
 
@@ -380,15 +591,10 @@ bool HistoryManager::clearHistory()
 {
     LOGD("[HistoryManager::clearHistory] 开始清空历史记录");
 
-    {
-        QMutexLocker locker(&m_historyMutex);
-        m_records.clear();
-    }
-
-    if (!saveHistory()) {
-        LOGD("[HistoryManager::clearHistory] 保存历史记录失败");
-        return false;
-    }
+    QMutexLocker locker(&m_historyMutex);
+    m_records.clear();
+    m_index.clear();
+    compactLocked();
 
     LOGD("[HistoryManager::clearHistory] 历史记录清空成功");
     return true;
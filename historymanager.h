@@ -11,11 +11,17 @@
 #include <QJsonDocument>
 #include <QFile>
 #include <QMutex>
+#include <QThread>
+#include <QTimer>
+#include <functional>
+#include <memory>
+#include "historyindex.h"
 
 /**
  * @brief DownloadRecord结构体用于存储单个下载任务的历史记录信息。
  */
 struct DownloadRecord {
+    quint64 id = 0;         ///< 记录编号（由HistoryManager分配，日志内唯一）
     QString url;            ///< 下载文件的URL
     QString filePath;       ///< 文件保存的本地路径
     qint64 fileSize;        ///< 文件总大小（字节）
@@ -40,7 +46,18 @@ struct DownloadRecord {
 
 /**
  * @brief HistoryManager类用于管理下载历史记录。
- * 这是一个单例类，负责与JSON文件交互，实现下载记录的添加、查询、删除和清空。
+ * 这是一个单例类，实现下载记录的添加、查询、删除和清空。
+ *
+ * 记录保存在追加式日志 history.log 中，每行一个 JSON 对象：
+ *  - 新增记录追加一行，删除追加一行墓碑 {"del": id}，单条开销与历史长度无关；
+ *  - 新行先在内存攒批，每 FLUSH_DELAY_MS 或攒满 FLUSH_BATCH 行交给后台写线程写出，调用方不碰磁盘；
+ *  - 内存只保留最近 MAX_RECORDS 条；日志里的无效行（墓碑、已删除或被淘汰的记录）多于有效记录时，
+ *    写线程按当前记录整体重写一次（压缩），均摊后仍是 O(1)；
+ *  - 启动时逐行流式读取，崩溃留下的半行被跳过并触发一次压缩。
+ * 旧版的 history.json 在首次启动时迁移到日志，原文件改名为 .bak 保留。
+ *
+ * 查询走 HistoryIndex（三元组、主机、状态、完成日期），只返回命中的编号；
+ * 界面再按可见行用 records() 分页取记录，不复制整个列表。
  */
 class HistoryManager : public QObject
 {
@@ -58,18 +75,51 @@ public:
     HistoryManager& operator=(const HistoryManager&) = delete;
 
     /**
-     * @brief 添加一条下载记录到JSON文件。
-     * @param record 要添加的DownloadRecord结构体。
-     * @return 如果添加成功则返回true，否则返回false。
+     * @brief 添加一条下载记录（分配编号后进入内存列表，日志行稍后由写线程追加）。
+     * @param record 要添加的DownloadRecord结构体（id 字段被忽略）。
+     * @return URL 为空时返回false，否则返回true。
      */
     bool addRecord(const DownloadRecord& record);
 
+    /**
+     * @brief 一次添加多条记录（小文件快速通道攒批用）。
+     * @param records 要添加的记录；URL 为空的跳过。
+     * @return 总是返回true。
+     */
+    bool addRecords(const QList<DownloadRecord>& records);
+
     /**
      * @brief 获取所有下载历史记录。
      * @return 包含所有DownloadRecord的QList。
      */
     QList<DownloadRecord> getHistory() const;
 
+    /**
+     * @brief 按条件查询。
+     * @param query 查询条件。
+     * @return 命中记录的编号（升序，即添加顺序）。
+     */
+    QList<quint64> search(const HistoryQuery& query) const;
+
+    /**
+     * @brief 按编号取记录。
+     * @param ids 记录编号。
+     * @return 找到的记录（已删除或被淘汰的编号跳过），顺序与 ids 一致。
+     */
+    QList<DownloadRecord> records(const QList<quint64>& ids) const;
+
+    /**
+     * @brief 当前的记录条数。
+     */
+    int recordCount() const;
+
+    /**
+     * @brief 按编号删除单条历史记录。
+     * @param id 记录编号。
+     * @return 如果删除成功则返回true，否则返回false。
+     */
+    bool deleteRecordById(quint64 id);
+
     /**
      * @brief 删除单条历史记录。
      * @param index 要删除的记录索引
@@ -78,11 +128,17 @@ public:
     bool deleteRecord(int index);
 
     /**
-     * @brief 清空所有下载历史记录。
+     * @brief 清空所有下载历史记录（日志由写线程重写为空）。
      * @return 如果清空成功则返回true，否则返回false。
      */
     bool clearHistory();
 
+    /**
+     * @brief 写出攒着的行并停止写线程，之后的写入在调用线程同步完成。
+     * 连接到 QCoreApplication::aboutToQuit；析构时若还没停也会调用。
+     */
+    void shutdown();
+
 private:
     /**
      * @brief 私有构造函数，确保单例模式。
@@ -92,34 +148,116 @@ private:
     explicit HistoryManager(QObject *parent = nullptr);
     ~HistoryManager();
 
-    QString m_historyFilePath; ///< JSON文件路径
-    QList<DownloadRecord> m_records; ///< 内存中的历史记录列表
-    mutable QMutex m_historyMutex; ///< 保护m_records与文件IO的互斥锁
+    QString m_historyFilePath; ///< 日志文件路径（history.log）
+    QList<DownloadRecord> m_records; ///< 内存中的历史记录列表（按添加顺序）
+    mutable QMutex m_historyMutex; ///< 保护m_records与攒批状态的互斥锁
+    quint64 m_nextId = 1; ///< 下一条记录的编号
+    qint64 m_journalLines = 0; ///< 日志中的行数（含还没写出的），用于判断何时压缩
+    QByteArray m_pendingLines; ///< 攒着还没交给写线程的行
+    int m_pendingCount = 0; ///< m_pendingLines 中的行数
+    bool m_stopped = false; ///< shutdown() 已执行
+    QTimer m_flushTimer; ///< 攒批定时器（单次）
+    QThread m_writerThread; ///< 后台写线程
+    QObject* m_writerContext = nullptr; ///< 住在写线程上的上下文对象，写操作都投递给它
+    std::unique_ptr<QFile> m_journal; ///< 以追加方式打开的日志（只在写线程上访问）
+    HistoryIndex m_index; ///< m_records 的查询索引（受 m_historyMutex 保护）
+
+    static constexpr int MAX_RECORDS        = 1000000; ///< 保留的记录条数上限，超出淘汰最旧的
+    static constexpr int FLUSH_DELAY_MS     = 500;   ///< 新行最长攒批时间
+    static constexpr int FLUSH_BATCH        = 256;   ///< 攒满即写的行数
+    static constexpr int COMPACT_MIN_LINES  = 1024;  ///< 日志行数不到这个数不压缩
 
     /**
-     * @brief 初始化JSON文件路径并加载历史记录。
+     * @brief 初始化日志路径、加载历史记录（必要时迁移旧的 history.json）。
+     * @param needsCompaction 输出：日志有损坏或无效行过多，启动后应压缩一次。
      * @return 如果初始化成功则返回true，否则返回false。
      */
-    bool initJsonFile();
+    bool initJournal(bool* needsCompaction);
 
     /**
-     * @brief 从JSON文件加载历史记录。
+     * @brief 逐行流式读取日志：应用墓碑，跳过无法解析的行。
+     * @param needsCompaction 输出：遇到半行或坏行时置 true。
      * @return 如果加载成功则返回true，否则返回false。
      */
-    bool loadHistory();
+    bool loadJournal(bool* needsCompaction);
 
     /**
-     * @brief 保存历史记录到JSON文件（原子写入：tmp + rename）。
-     * @return 如果保存成功则返回true，否则返回false。
+     * @brief 读取旧版 history.json（整个 JSON 数组）并分配编号，读完把原文件改名为 .bak。
+     * @return 如果文件存在且读取成功则返回true。
      */
-    bool saveHistory();
+    bool migrateLegacyJson(const QString& legacyPath);
 
     /**
-     * @brief 当JSON文件无法读取时，通过原子重命名为 .bak 并重试。
-     * @return true 表示成功恢复（不论是原始文件还是重命名后的文件）；
-     *         false 表示恢复失败，调用方应放弃加载历史。
+     * @brief 当日志无法读取时，通过原子重命名为 .bak 并从空历史开始。
+     * @return true 表示成功恢复；false 表示恢复失败，调用方应放弃加载历史。
      */
     bool recoverFromOpenFailure();
+
+    /**
+     * @brief 追加一行到攒批缓冲（调用方持有 m_historyMutex）。
+     */
+    void appendLineLocked(const QByteArray& line);
+
+    /**
+     * @brief 把攒着的行交给写线程（调用方持有 m_historyMutex）。
+     */
+    void flushLocked();
+
+    /**
+     * @brief 攒批定时器到期：加锁后 flushLocked()。
+     */
+    void flushPending();
+
+    /**
+     * @brief 超出 MAX_RECORDS 时淘汰最旧的记录（调用方持有 m_historyMutex）。
+     */
+    void enforceRetentionLocked();
+
+    /**
+     * @brief 记录编号在 m_records 中的位置（m_records 按编号升序）；不存在返回 -1。
+     */
+    qsizetype positionOfLocked(quint64 id) const;
+
+    /**
+     * @brief 删除 m_records 中的一条记录并追加墓碑（调用方持有 m_historyMutex）。
+     */
+    void removeAtLocked(qsizetype position);
+
+    /**
+     * @brief 无效行多于有效记录时压缩日志（调用方持有 m_historyMutex）。
+     */
+    void maybeCompactLocked();
+
+    /**
+     * @brief 按当前记录重写日志（调用方持有 m_historyMutex）。攒着的行已被快照覆盖，直接丢弃。
+     */
+    void compactLocked();
+
+    /**
+     * @brief 把写操作投递到写线程；写线程已停止时在调用线程直接执行。
+     * 在 m_historyMutex 内调用，保证写操作的顺序与内存中的修改顺序一致。
+     */
+    void post(std::function<void()> job);
+
+    /**
+     * @brief [写线程] 追加若干行并 flush。
+     */
+    void writeLines(const QByteArray& lines);
+
+    /**
+     * @brief [写线程] 用 QSaveFile 把记录整体写成新日志。
+     */
+    void rewriteJournal(const QList<DownloadRecord>& records);
+
+    /**
+     * @brief [写线程] 关闭日志文件。
+     */
+    void closeJournal();
+
+    /**
+     * @brief 一个 JSON 对象编码成日志行（紧凑格式，以换行结尾）。
+     */
+    static QByteArray journalLine(const QJsonObject& obj);
 };
 
 #endif // HISTORYMANAGER_H
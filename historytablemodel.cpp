@@ -0,0 +1,145 @@
+#include "historytablemodel.h"
+#include "tasktablemodel.h"
+
+#include <QBrush>
+
+HistoryTableModel::HistoryTableModel(HistoryManager& manager, QObject* parent)
+    : QAbstractTableModel(parent)
+    , m_manager(manager)
+    , m_cache(CACHE_RECORDS)
+{
+}
+
+int HistoryTableModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : m_fetched;
+}
+
+int HistoryTableModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant HistoryTableModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_fetched) {
+        return QVariant();
+    }
+    if (role != Qt::DisplayRole && role != Qt::ToolTipRole && role != Qt::ForegroundRole) {
+        return QVariant();
+    }
+    const DownloadRecord* record = cachedRecord(index.row());
+    if (!record) {
+        return QVariant();
+    }
+
+    if (role == Qt::DisplayRole) {
+        switch (index.column()) {
+        case FileNameColumn:   return record->fileName;
+        case UrlColumn:        return record->url;
+        case SizeColumn:       return TaskTableModel::formatBytes(record->fileSize);
+        case FinishTimeColumn: return record->finishTime.toString("yyyy-MM-dd hh:mm:ss");
+        case StatusColumn:
+            if (record->status == "Completed") return tr("已完成");
+            if (record->status == "Failed") return tr("失败");
+            if (record->status == "Cancelled") return tr("已取消");
+            return tr("未知");
+        // DownloadRecord 中没有线程数字段，沿用默认值1
+        case ThreadsColumn:    return QString::number(1);
+        }
+    } else if (role == Qt::ToolTipRole) {
+        if (index.column() == UrlColumn) {
+            return record->url; // 鼠标悬停显示完整URL
+        }
+    } else if (role == Qt::ForegroundRole) {
+        if (index.column() == StatusColumn) {
+            if (record->status == "Failed") return QBrush(Qt::red);
+            if (record->status == "Completed") return QBrush(Qt::darkGreen);
+        }
+    }
+    return QVariant();
+}
+
+QVariant HistoryTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+    switch (section) {
+    case FileNameColumn:   return tr("文件名");
+    case UrlColumn:        return tr("URL");
+    case SizeColumn:       return tr("文件大小");
+    case FinishTimeColumn: return tr("完成时间");
+    case StatusColumn:     return tr("状态");
+    case ThreadsColumn:    return tr("线程数");
+    }
+    return QVariant();
+}
+
+bool HistoryTableModel::canFetchMore(const QModelIndex& parent) const
+{
+    return !parent.isValid() && m_fetched < m_ids.size();
+}
+
+void HistoryTableModel::fetchMore(const QModelIndex& parent)
+{
+    if (parent.isValid()) {
+        return;
+    }
+    const int count = qMin(FETCH_CHUNK, int(m_ids.size()) - m_fetched);
+    if (count <= 0) {
+        return;
+    }
+    beginInsertRows(QModelIndex(), m_fetched, m_fetched + count - 1);
+    m_fetched += count;
+    endInsertRows();
+}
+
+void HistoryTableModel::setQuery(const HistoryQuery& query)
+{
+    m_query = query;
+    refresh();
+}
+
+void HistoryTableModel::refresh()
+{
+    beginResetModel();
+    m_ids = m_manager.search(m_query);
+    m_fetched = qMin(FETCH_CHUNK, int(m_ids.size()));
+    m_cache.clear();
+    endResetModel();
+}
+
+bool HistoryTableModel::recordAt(int row, DownloadRecord* record) const
+{
+    const DownloadRecord* cached = (row >= 0 && row < m_fetched) ? cachedRecord(row) : nullptr;
+    if (!cached) {
+        return false;
+    }
+    *record = *cached;
+    return true;
+}
+
+void HistoryTableModel::retranslate()
+{
+    emit headerDataChanged(Qt::Horizontal, 0, ColumnCount - 1);
+    if (m_fetched > 0) {
+        emit dataChanged(index(0, StatusColumn), index(m_fetched - 1, StatusColumn));
+    }
+}
+
+const DownloadRecord* HistoryTableModel::cachedRecord(int row) const
+{
+    const quint64 id = m_ids.at(row);
+    if (DownloadRecord* record = m_cache.object(id)) {
+        return record;
+    }
+
+    // 取整页：视图按行连续访问，一页只加一次锁
+    const int first = row - row % PAGE_SIZE;
+    const QList<quint64> page = m_ids.mid(first, PAGE_SIZE);
+    for (const DownloadRecord& record : m_manager.records(page)) {
+        m_cache.insert(record.id, new DownloadRecord(record));
+    }
+    return m_cache.object(id);
+}
@@ -0,0 +1,85 @@
+#ifndef HISTORYTABLEMODEL_H
+#define HISTORYTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QCache>
+#include <QList>
+#include "historymanager.h"
+
+/**
+ * @brief 历史记录对话框的数据模型。
+ *
+ * 只保存查询命中的记录编号，记录本身按可见行分页向 HistoryManager 取（每次 PAGE_SIZE 条），
+ * 放进容量为 CACHE_RECORDS 的 QCache；行数经 canFetchMore / fetchMore 每次放出 FETCH_CHUNK 行，
+ * 百万条命中也不会一次建出百万行。只在主线程使用。
+ */
+class HistoryTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    /// 列。
+    enum Column {
+        FileNameColumn = 0,
+        UrlColumn,
+        SizeColumn,
+        FinishTimeColumn,
+        StatusColumn,
+        ThreadsColumn,
+        ColumnCount
+    };
+
+    explicit HistoryTableModel(HistoryManager& manager, QObject* parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex& parent) const override;
+    void fetchMore(const QModelIndex& parent) override;
+
+    /**
+     * @brief 执行查询并重置模型。
+     */
+    void setQuery(const HistoryQuery& query);
+
+    /**
+     * @brief 重新执行当前查询（记录有增删时调用）。
+     */
+    void refresh();
+
+    /**
+     * @brief 命中的记录总数（不只是已经放出的行）。
+     */
+    int matchCount() const { return int(m_ids.size()); }
+
+    /**
+     * @brief 取某一行的记录。
+     * @return 行号越界或记录已被删除时返回false。
+     */
+    bool recordAt(int row, DownloadRecord* record) const;
+
+    /**
+     * @brief 语言切换后让表头与单元格重新取文案。
+     */
+    void retranslate();
+
+private:
+    /**
+     * @brief 取某一行的记录：不在缓存里时把所在的整页取进来。
+     * @return 记录指针，只在下一次访问缓存之前有效；记录已被删除时返回 nullptr。
+     */
+    const DownloadRecord* cachedRecord(int row) const;
+
+    HistoryManager& m_manager;                          ///< 数据来源。
+    HistoryQuery m_query;                               ///< 当前查询。
+    QList<quint64> m_ids;                               ///< 命中的记录编号。
+    int m_fetched = 0;                                  ///< 已经放出的行数。
+    mutable QCache<quint64, DownloadRecord> m_cache;    ///< 记录缓存（编号 -> 记录）。
+
+    static constexpr int FETCH_CHUNK   = 1000;  ///< 每次 fetchMore 放出的行数
+    static constexpr int PAGE_SIZE     = 256;   ///< 每次向 HistoryManager 取的记录数
+    static constexpr int CACHE_RECORDS = 4096;  ///< 缓存的记录数上限
+};
+
+#endif // HISTORYTABLEMODEL_H
@@ -0,0 +1,265 @@
+#include "hostguard.h"
+#include "logger.h"
+#include <QHostInfo>
+#include <QNetworkRequest>
+#include <QTimer>
+#include <QUrl>
+#include <iterator>
+
+namespace {
+
+static bool isPrivateOrLoopbackIp(const QHostAddress &addr)
+{
+    if (addr.isLoopback())  return true;
+    if (addr.isLinkLocal()) return true;        // 169.254/16, fe80::/10
+    if (addr.isMulticast()) return true;
+
+    // 协议相关范围检查（QHostAddress 不会全部覆盖）
+    if (addr.protocol() == QAbstractSocket::IPv4Protocol) {
+        const quint32 ip = addr.toIPv4Address();
+        const quint32 b1 = (ip >> 24) & 0xFFu;
+        const quint32 b2 = (ip >> 16) & 0xFFu;
+        // 0.0.0.0/8 — "this network"
+        if (b1 == 0u) return true;
+        // 10.0.0.0/8
+        if (b1 == 10u) return true;
+        // 100.64.0.0/10 — CGNAT
+        if (b1 == 100u && b2 >= 64u && b2 <= 127u) return true;
+        // 127.0.0.0/8 — loopback（QHostAddress 已部分覆盖）
+        if (b1 == 127u) return true;
+        // 169.254.0.0/16 — link-local（QHostAddress 已覆盖）
+        // 172.16.0.0/12
+        if (b1 == 172u && b2 >= 16u && b2 <= 31u) return true;
+        // 192.168.0.0/16
+        if (b1 == 192u && b2 == 168u) return true;
+        // 192.0.2.0/24, 198.51.100.0/24, 203.0.113.0/24 — TEST-NET
+        if ((b1 == 192u && b2 == 0u  && ((ip >> 8) & 0xFFu) == 2u)  ||
+            (b1 == 198u && b2 == 51u && ((ip >> 8) & 0xFFu) == 100u) ||
+            (b1 == 203u && b2 == 0u  && ((ip >> 8) & 0xFFu) == 113u))
+            return true;
+        // 198.18.0.0/15 — benchmarking
+        if (b1 == 198u && (b2 == 18u || b2 == 19u)) return true;
+        // 240.0.0.0/4 — reserved (含 255.255.255.255 broadcast)
+        if (b1 >= 240u) return true;
+        return false;
+    }
+
+    // IPv6
+    if (addr.protocol() == QAbstractSocket::IPv6Protocol) {
+        const Q_IPV6ADDR ip6 = addr.toIPv6Address();
+        // fc00::/7 — unique local
+        if ((ip6[0] & 0xFEu) == 0xFCu) return true;
+        // fe80::/10 — link-local（QHostAddress 已覆盖）
+        // ff00::/8 — multicast（QHostAddress 已覆盖）
+        // ::ffff:a.b.c.d — IPv4-mapped：递归检查嵌入的 IPv4
+        // Qt 6.11 removed QHostAddress::isIPv4Mapped(); check bytes per RFC 4291 §2.5.5.2.
+        const bool isV4Mapped = (ip6[0]  == 0 && ip6[1]  == 0 && ip6[2]  == 0 &&
+                                 ip6[3]  == 0 && ip6[4]  == 0 && ip6[5]  == 0 &&
+                                 ip6[6]  == 0 && ip6[7]  == 0 && ip6[8]  == 0 &&
+                                 ip6[9]  == 0 && ip6[10] == 0xff && ip6[11] == 0xff);
+        if (isV4Mapped) {
+            const quint32 mapped = (quint32(ip6[12]) << 24) | (quint32(ip6[13]) << 16)
+                                 | (quint32(ip6[14]) << 8)  |  quint32(ip6[15]);
+            const QHostAddress v4(mapped);
+            return isPrivateOrLoopbackIp(v4);
+        }
+        // 其它 IPv6 未指定/loopback(::1) 由 QHostAddress 覆盖
+        return false;
+    }
+    return true; // 未知协议视为不安全
+}
+
+// 旁路开关：当环境变量 DOWNLOADER_ALLOW_LOOPBACK 被设置为非空 / "1" / "true"
+// 时，跳过 SSRF 拦截。这是给本地端到端测试用的逃生口（开启后从浏览器插件
+// 或 HTTP 接口可以指向 127.0.0.1 / localhost，便于联调 anti-Range 等场景）。
+// 生产环境不设置即可维持原防御。
+static bool loopbackAllowed()
+{
+    static const bool allowLoopback = []() {
+        const QByteArray v = qgetenv("DOWNLOADER_ALLOW_LOOPBACK");
+        if (v.isEmpty()) return false;
+        const QString s = QString::fromLocal8Bit(v).trimmed().toLower();
+        return s == "1" || s == "true" || s == "yes";
+    }();
+    return allowLoopback;
+}
+
+// DNS 解析结果判定：任一地址落在私有/回环段则拒绝。
+static HostVerdict verdictFromLookup(const QHostInfo &info)
+{
+    HostVerdict verdict;
+    if (info.error() != QHostInfo::NoError) {
+        verdict.error = QStringLiteral("DNS lookup failed: %1").arg(info.errorString());
+        return verdict;
+    }
+    const QList<QHostAddress> addrs = info.addresses();
+    if (addrs.isEmpty()) {
+        verdict.error = QStringLiteral("DNS lookup returned no addresses");
+        return verdict;
+    }
+    for (const QHostAddress &a : addrs) {
+        if (isPrivateOrLoopbackIp(a)) {
+            verdict.error = QStringLiteral("host resolves to private/loopback address");
+            return verdict;
+        }
+    }
+    verdict.allowed = true;
+    verdict.addresses = addrs;
+    return verdict;
+}
+
+} // namespace
+
+HostGuard& HostGuard::instance()
+{
+    static HostGuard instance;
+    return instance;
+}
+
+HostGuard::HostGuard(QObject* parent)
+    : QObject(parent)
+{
+    m_clock.start();
+}
+
+void HostGuard::check(const QString& host, QObject* context, Callback callback)
+{
+    HostVerdict verdict;
+    if (host.isEmpty()) {
+        verdict.error = QStringLiteral("empty host");
+        callback(verdict);
+        return;
+    }
+
+    // 旁路：即使是 127.0.0.1 / localhost 也放行；不解析也不钉地址。
+    // 仅用于本地联调/端到端验证，公网生产部署不设置该环境变量，SSRF 拦截仍然生效。
+    if (loopbackAllowed()) {
+        verdict.allowed = true;
+        callback(verdict);
+        return;
+    }
+
+    // 字面 IP 路径
+    QHostAddress literal;
+    if (literal.setAddress(host)) {
+        if (isPrivateOrLoopbackIp(literal)) {
+            verdict.error = QStringLiteral("host resolves to private/loopback address");
+        } else {
+            verdict.allowed = true;
+            verdict.addresses.append(literal);
+        }
+        callback(verdict);
+        return;
+    }
+
+    const QString key = host.toLower();
+    const auto cached = m_cache.constFind(key);
+    if (cached != m_cache.cend()) {
+        if (cached->expiresAtMs > m_clock.elapsed()) {
+            callback(cached->verdict);
+            return;
+        }
+        m_cache.erase(cached);
+    }
+
+    // 同一主机已经在解析：排队等同一个结果
+    auto pending = m_pending.find(key);
+    if (pending != m_pending.end()) {
+        pending->waiters.append({QPointer<QObject>(context), std::move(callback)});
+        return;
+    }
+
+    Pending& entry = m_pending[key];
+    entry.waiters.append({QPointer<QObject>(context), std::move(callback)});
+    const int lookupId = QHostInfo::lookupHost(host, this, [this, key](const QHostInfo& info) {
+        onLookupFinished(key, info.lookupId(), info);
+    });
+    // lookupHost 可能已经同步回调并移除了这一项，重新查找再写 id
+    pending = m_pending.find(key);
+    if (pending == m_pending.end()) {
+        return;
+    }
+    pending->lookupId = lookupId;
+    QTimer::singleShot(LOOKUP_TIMEOUT_MS, this, [this, key, lookupId]() {
+        onLookupTimeout(key, lookupId);
+    });
+    LOGD(QString("HostGuard: 解析 %1").arg(host));
+}
+
+void HostGuard::onLookupFinished(const QString& host, int lookupId, const QHostInfo& info)
+{
+    const auto pending = m_pending.constFind(host);
+    if (pending == m_pending.cend()) {
+        return; // 已超时
+    }
+    if (pending->lookupId >= 0 && pending->lookupId != lookupId) {
+        return; // 超时后重新发起的新一轮解析，不是这次的结果
+    }
+
+    const HostVerdict verdict = verdictFromLookup(info);
+    remember(host, verdict);
+    complete(host, verdict);
+}
+
+void HostGuard::onLookupTimeout(const QString& host, int lookupId)
+{
+    const auto pending = m_pending.constFind(host);
+    if (pending == m_pending.cend() || pending->lookupId != lookupId) {
+        return; // 已经有结论
+    }
+
+    QHostInfo::abortHostLookup(lookupId);
+    LOGD(QString("HostGuard: 解析 %1 超时").arg(host));
+    HostVerdict verdict;
+    verdict.error = QStringLiteral("DNS lookup timed out");
+    complete(host, verdict);
+}
+
+void HostGuard::complete(const QString& host, const HostVerdict& verdict)
+{
+    // 先摘下等待者再回调：回调里可能再次 check() 同一主机
+    const QList<Waiter> waiters = m_pending.take(host).waiters;
+    for (const Waiter& waiter : waiters) {
+        if (waiter.context) {
+            waiter.callback(verdict);
+        }
+    }
+}
+
+void HostGuard::remember(const QString& host, const HostVerdict& verdict)
+{
+    const qint64 now = m_clock.elapsed();
+    if (m_cache.size() >= MAX_CACHE_ENTRIES) {
+        for (auto it = m_cache.begin(); it != m_cache.end();) {
+            it = it->expiresAtMs <= now ? m_cache.erase(it) : std::next(it);
+        }
+        if (m_cache.size() >= MAX_CACHE_ENTRIES) {
+            m_cache.clear();
+        }
+    }
+
+    CacheEntry entry;
+    entry.verdict = verdict;
+    entry.expiresAtMs = now + (verdict.allowed ? ALLOWED_TTL_MS : DENIED_TTL_MS);
+    m_cache.insert(host, entry);
+}
+
+void HostGuard::pinRequest(QNetworkRequest& request, const QString& host, const QHostAddress& address)
+{
+    QUrl url = request.url();
+    if (address.isNull() || host.isEmpty() || url.host().compare(host, Qt::CaseInsensitive) != 0) {
+        return;
+    }
+
+    QByteArray hostHeader = QUrl::toAce(host);
+    if (url.port() != -1) {
+        hostHeader += ':' + QByteArray::number(url.port());
+    }
+
+    url.setHost(address.toString());
+    request.setUrl(url);
+    request.setRawHeader("Host", hostHeader);
+    // 证书校验与 SNI 都用原主机名，而不是 IP
+    request.setPeerVerifyName(host);
+    request.setAttribute(QNetworkRequest::Http2AllowedAttribute, false);
+}
@@ -0,0 +1,119 @@
+#ifndef HOSTGUARD_H
+#define HOSTGUARD_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QHostAddress>
+#include <QList>
+#include <QPointer>
+#include <QString>
+#include <functional>
+
+class QHostInfo;
+class QNetworkRequest;
+
+/**
+ * @brief 主机 SSRF 校验结论。
+ */
+struct HostVerdict {
+    bool allowed = false;             ///< 是否允许下载（解析结果全部是公网地址）。
+    QString error;                    ///< 拒绝原因，允许时为空。
+    QList<QHostAddress> addresses;    ///< 校验过的地址；旁路开关放行时为空（不钉地址）。
+};
+
+/**
+ * @brief 异步、带缓存的下载主机 SSRF 校验。
+ *
+ * 取代在 GUI 线程上调用 QHostInfo::fromName 的同步校验：
+ *  - 解析走 QHostInfo::lookupHost，结论通过回调返回，事件循环不被阻塞；
+ *  - 同一主机的并发校验合并成一次解析；
+ *  - 结论按 TTL 缓存（放行 ALLOWED_TTL_MS，拒绝 DENIED_TTL_MS），同一站点的连续投递不再重复解析；
+ *  - 放行结论带上校验过的地址，调用方交给 DownloadTask 钉住连接目标（pinRequest），
+ *    实际连接的就是被检查过的 IP，DNS rebinding 无法在校验之后把主机名换成内网地址。
+ *
+ * 只在主线程使用。
+ */
+class HostGuard : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Callback = std::function<void(const HostVerdict&)>;
+
+    /**
+     * @brief 获取单例。
+     */
+    static HostGuard& instance();
+
+    HostGuard(const HostGuard&) = delete;
+    HostGuard& operator=(const HostGuard&) = delete;
+
+    /**
+     * @brief 校验主机。字面 IP、旁路开关与缓存命中时同步回调，否则在解析完成（或超时）后回调。
+     * @param host URL 中的主机名或字面 IP。
+     * @param context 回调的接收者；在回调之前被销毁则不再回调。
+     * @param callback 结论回调（主线程）。
+     */
+    void check(const QString& host, QObject* context, Callback callback);
+
+    /**
+     * @brief 把请求钉到已校验的地址：URL 主机换成 IP，Host 头、证书校验名与 SNI 仍用原主机名。
+     *
+     * 钉住的请求只走 HTTP/1.1：HTTP/2 的 :authority 取自 URL，会变成 IP。
+     * 请求 URL 的主机不是 host 时（例如跟随重定向到了别的站点）不做任何改动。
+     * @param request 待发送的请求。
+     * @param host 校验时的原主机名。
+     * @param address 校验过的地址；为空地址时不做改动。
+     */
+    static void pinRequest(QNetworkRequest& request, const QString& host, const QHostAddress& address);
+
+private:
+    explicit HostGuard(QObject* parent = nullptr);
+
+    /**
+     * @brief 一次解析完成：写缓存并回调所有等待者。
+     */
+    void onLookupFinished(const QString& host, int lookupId, const QHostInfo& info);
+
+    /**
+     * @brief 解析超时：放弃这次解析，给等待者返回失败（不缓存，下一次重新解析）。
+     */
+    void onLookupTimeout(const QString& host, int lookupId);
+
+    /**
+     * @brief 回调并移除某主机的全部等待者。
+     */
+    void complete(const QString& host, const HostVerdict& verdict);
+
+    /**
+     * @brief 写缓存；超过 MAX_CACHE_ENTRIES 时先淘汰过期项，仍然超限则整体清空。
+     */
+    void remember(const QString& host, const HostVerdict& verdict);
+
+    struct Waiter {
+        QPointer<QObject> context;    ///< 回调接收者。
+        Callback callback;            ///< 结论回调。
+    };
+
+    struct Pending {
+        int lookupId = -1;            ///< QHostInfo::lookupHost 返回的 id。
+        QList<Waiter> waiters;        ///< 等待这次解析的调用方。
+    };
+
+    struct CacheEntry {
+        HostVerdict verdict;          ///< 缓存的结论。
+        qint64 expiresAtMs = 0;       ///< 过期时刻（m_clock 毫秒）。
+    };
+
+    QElapsedTimer m_clock;                  ///< 缓存过期时钟（单调）。
+    QHash<QString, CacheEntry> m_cache;     ///< 主机（小写）-> 结论。
+    QHash<QString, Pending> m_pending;      ///< 正在解析的主机（小写）。
+
+    static constexpr qint64 ALLOWED_TTL_MS   = 5 * 60 * 1000; ///< 放行结论缓存 5 分钟
+    static constexpr qint64 DENIED_TTL_MS    = 30 * 1000;     ///< 拒绝结论缓存 30 秒（DNS 故障可能是暂时的）
+    static constexpr int LOOKUP_TIMEOUT_MS   = 5 * 1000;      ///< 单次解析超时
+    static constexpr int MAX_CACHE_ENTRIES   = 1024;          ///< 缓存条目上限
+};
+
+#endif // HOSTGUARD_H
@@ -0,0 +1,255 @@
+#include "hostprofilestore.h"
+#include "logger.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace {
+    /// 吞吐与 TTFB 的 EWMA 平滑系数：新样本的权重
+    constexpr double kThroughputAlpha = 0.3;
+    constexpr double kTtfbAlpha = 0.2;
+
+    /// 读缓冲按单连接吞吐的这么多毫秒计算
+    constexpr qint64 kReadBufferWindowMs = 2000;
+}
+
+HostProfileStore& HostProfileStore::instance()
+{
+    static HostProfileStore instance;
+    return instance;
+}
+
+HostProfileStore::HostProfileStore()
+{
+    load();
+}
+
+QString HostProfileStore::profilePath()
+{
+    QString appDataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    if (appDataPath.isEmpty()) {
+        appDataPath = QDir::currentPath();
+    }
+    return QDir(appDataPath).filePath("hostprofiles.json");
+}
+
+QString HostProfileStore::hostKey(const QString& host)
+{
+    return host.trimmed().toLower();
+}
+
+HostHints HostProfileStore::hints(const QString& host, int requestedSegments)
+{
+    HostHints hints;
+    hints.segments = qMax(1, requestedSegments);
+
+    const QString key = hostKey(host);
+    if (key.isEmpty()) {
+        return hints;
+    }
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QMutexLocker locker(&m_mutex);
+    const auto it = m_profiles.constFind(key);
+    if (it == m_profiles.cend()) {
+        return hints;
+    }
+    const Profile& profile = *it;
+
+    if (profile.rangeIgnoredAtMs > 0 && now - profile.rangeIgnoredAtMs < FLAG_TTL_MS) {
+        hints.ignoresRange = true;
+        hints.segments = 1;
+    } else if (!profile.throughput.isEmpty()) {
+        int best = profile.throughput.firstKey();
+        for (auto t = profile.throughput.cbegin(); t != profile.throughput.cend(); ++t) {
+            if (t.value() > profile.throughput.value(best)) best = t.key();
+        }
+        int chosen = best;
+        if (best == profile.throughput.lastKey()) {
+            // 最优的就是试过的最大分片数：还没摸到平台，加倍试探
+            chosen = best * 2;
+        } else {
+            // 已经越过平台：取吞吐达到最优 PLATEAU_RATIO 的最小分片数，少占连接
+            const double target = profile.throughput.value(best) * PLATEAU_RATIO;
+            for (auto t = profile.throughput.cbegin(); t != profile.throughput.cend(); ++t) {
+                if (t.value() >= target) {
+                    chosen = t.key();
+                    break;
+                }
+            }
+        }
+        hints.segments = qBound(1, chosen, hints.segments);
+    }
+
+    if (profile.throttledAtMs > 0 && now - profile.throttledAtMs < FLAG_TTL_MS) {
+        hints.segments = qMin(hints.segments, THROTTLED_MAX_SEGMENTS);
+    }
+
+    if (profile.ttfbMs >= 0) {
+        // 无数据超时留足首字节时间的余量：快主机更早发现卡死的连接，慢主机不被误杀
+        hints.transferTimeoutMs = qBound(MIN_TIMEOUT_MS, int(profile.ttfbMs * 10) + 5000, MAX_TIMEOUT_MS);
+    }
+
+    const double perConnection = profile.throughput.value(hints.segments, 0.0) / hints.segments;
+    if (perConnection > 0) {
+        hints.readBufferBytes = qBound(MIN_READ_BUFFER,
+                                       qint64(perConnection * kReadBufferWindowMs / 1000),
+                                       MAX_READ_BUFFER);
+    }
+    return hints;
+}
+
+HostProfileStore::Profile& HostProfileStore::touch(const QString& key, qint64 now)
+{
+    if (m_profiles.size() >= MAX_HOSTS && !m_profiles.contains(key)) {
+        auto oldest = m_profiles.begin();
+        for (auto it = m_profiles.begin(); it != m_profiles.end(); ++it) {
+            if (it->updatedAtMs < oldest->updatedAtMs) oldest = it;
+        }
+        m_profiles.erase(oldest);
+    }
+    Profile& profile = m_profiles[key];
+    profile.updatedAtMs = now;
+    m_dirty = true;
+    return profile;
+}
+
+void HostProfileStore::recordTtfb(const QString& host, qint64 ms)
+{
+    const QString key = hostKey(host);
+    if (key.isEmpty() || ms < 0) {
+        return;
+    }
+    QMutexLocker locker(&m_mutex);
+    Profile& profile = touch(key, QDateTime::currentMSecsSinceEpoch());
+    profile.ttfbMs = profile.ttfbMs < 0 ? double(ms) : profile.ttfbMs + kTtfbAlpha * (double(ms) - profile.ttfbMs);
+}
+
+void HostProfileStore::recordRangeIgnored(const QString& host)
+{
+    const QString key = hostKey(host);
+    if (key.isEmpty()) {
+        return;
+    }
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QMutexLocker locker(&m_mutex);
+    touch(key, now).rangeIgnoredAtMs = now;
+    LOGD(QString("主机画像：%1 无视 Range").arg(key));
+}
+
+void HostProfileStore::recordThrottled(const QString& host)
+{
+    const QString key = hostKey(host);
+    if (key.isEmpty()) {
+        return;
+    }
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QMutexLocker locker(&m_mutex);
+    touch(key, now).throttledAtMs = now;
+    LOGD(QString("主机画像：%1 限流").arg(key));
+}
+
+void HostProfileStore::recordTransfer(const QString& host, int segments, qint64 bytes, qint64 activeMs)
+{
+    const QString key = hostKey(host);
+    if (key.isEmpty() || segments < 1 || bytes < MIN_SAMPLE_BYTES || activeMs < MIN_SAMPLE_MS) {
+        return;
+    }
+    const double sample = double(bytes) * 1000.0 / double(activeMs);
+    QMutexLocker locker(&m_mutex);
+    Profile& profile = touch(key, QDateTime::currentMSecsSinceEpoch());
+    if (segments > 1) {
+        // 多连接分片下载顺利完成，说明 Range 已经可用
+        profile.rangeIgnoredAtMs = 0;
+    }
+    const auto it = profile.throughput.find(segments);
+    if (it == profile.throughput.end()) {
+        profile.throughput.insert(segments, sample);
+    } else {
+        *it += kThroughputAlpha * (sample - *it);
+    }
+    LOGD(QString("主机画像：%1 分片数:%2 吞吐:%3 B/s").arg(key).arg(segments).arg(qRound64(sample)));
+}
+
+void HostProfileStore::load()
+{
+    QFile file(profilePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    file.close();
+    if (root.value("version").toInt() != 1) {
+        return;
+    }
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const QJsonObject hosts = root.value("hosts").toObject();
+    for (auto it = hosts.begin(); it != hosts.end() && m_profiles.size() < MAX_HOSTS; ++it) {
+        const QJsonObject entry = it.value().toObject();
+        Profile profile;
+        profile.updatedAtMs = qint64(entry.value("updatedAt").toDouble());
+        if (now - profile.updatedAtMs >= PROFILE_TTL_MS) {
+            continue;
+        }
+        profile.rangeIgnoredAtMs = qint64(entry.value("rangeIgnoredAt").toDouble());
+        profile.throttledAtMs = qint64(entry.value("throttledAt").toDouble());
+        profile.ttfbMs = entry.value("ttfbMs").toDouble(-1.0);
+        const QJsonObject throughput = entry.value("throughput").toObject();
+        for (auto t = throughput.begin(); t != throughput.end(); ++t) {
+            bool ok = false;
+            const int segments = t.key().toInt(&ok);
+            if (ok && segments >= 1 && t.value().toDouble() > 0) {
+                profile.throughput.insert(segments, t.value().toDouble());
+            }
+        }
+        m_profiles.insert(hostKey(it.key()), profile);
+    }
+    LOGD(QString("已加载主机画像:%1 条").arg(m_profiles.size()));
+}
+
+void HostProfileStore::save()
+{
+    QJsonObject hosts;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_dirty) {
+            return;
+        }
+        m_dirty = false;
+        for (auto it = m_profiles.cbegin(); it != m_profiles.cend(); ++it) {
+            QJsonObject entry;
+            entry["updatedAt"] = double(it->updatedAtMs);
+            if (it->rangeIgnoredAtMs > 0) entry["rangeIgnoredAt"] = double(it->rangeIgnoredAtMs);
+            if (it->throttledAtMs > 0) entry["throttledAt"] = double(it->throttledAtMs);
+            if (it->ttfbMs >= 0) entry["ttfbMs"] = it->ttfbMs;
+            QJsonObject throughput;
+            for (auto t = it->throughput.cbegin(); t != it->throughput.cend(); ++t) {
+                throughput[QString::number(t.key())] = t.value();
+            }
+            if (!throughput.isEmpty()) entry["throughput"] = throughput;
+            hosts[it.key()] = entry;
+        }
+    }
+
+    const QString path = profilePath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        LOGD(QString("无法写入主机画像:%1").arg(file.errorString()));
+        return;
+    }
+    QJsonObject root;
+    root["version"] = 1;
+    root["hosts"] = hosts;
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    if (!file.commit()) {
+        LOGD(QString("提交主机画像失败:%1").arg(file.errorString()));
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef HOSTPROFILESTORE_H
+#define HOSTPROFILESTORE_H
+
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+
+/**
+ * @brief 新任务从主机画像得到的传输参数。
+ */
+struct HostHints {
+    int segments = 1;               ///< 建议的初始分片数（不超过用户设置的线程数）。
+    bool ignoresRange = false;      ///< 主机近期无视 Range：直接整文件单连接下载，不再尝试分片。
+    int transferTimeoutMs = 30000;  ///< 单个请求的无数据超时。
+    qint64 readBufferBytes = 0;     ///< 应答读缓冲上限；0 表示不限（Qt 默认）。
+};
+
+/**
+ * @brief 按主机学习的传输画像，持久化在 AppDataLocation/hostprofiles.json。
+ *
+ * 引擎每次下载都要重新摸索主机的脾气：是否无视 Range、几个连接之后吞吐就不再增长、
+ * 首字节时间多长、是否限流。这里把观测结果按主机累积下来：
+ *  - HttpWorker 记录首字节时间（TTFB）、anti-Range 与 429/503；
+ *  - DownloadTask 完成时记录本次的分片数与平均吞吐（按分片数分桶做 EWMA）。
+ * 新任务据此选初始分片数（吞吐平台的最小分片数；最优桶正好是已试过的最大分片数时向上加倍试探）、
+ * 跳过注定失败的 Range 尝试、按 TTFB 定超时、按单连接吞吐定读缓冲。
+ *
+ * 无视 Range 与限流只在 FLAG_TTL_MS 内生效，之后重新尝试；超过 PROFILE_TTL_MS 未更新的画像丢弃。
+ * 线程安全（worker 线程直接写入）。
+ */
+class HostProfileStore
+{
+public:
+    /**
+     * @brief 获取单例（首次调用时从磁盘加载）。
+     */
+    static HostProfileStore& instance();
+
+    HostProfileStore(const HostProfileStore&) = delete;
+    HostProfileStore& operator=(const HostProfileStore&) = delete;
+
+    /**
+     * @brief 为新任务给出传输参数。
+     * @param host 主机名。
+     * @param requestedSegments 用户设置的线程数，建议分片数以它为上限。
+     */
+    HostHints hints(const QString& host, int requestedSegments);
+
+    /**
+     * @brief 记录一次首字节时间（请求发出到响应头到达）。
+     */
+    void recordTtfb(const QString& host, qint64 ms);
+
+    /**
+     * @brief 记录主机无视 Range（返回 200 或 Content-Range 不符）。
+     */
+    void recordRangeIgnored(const QString& host);
+
+    /**
+     * @brief 记录主机限流（429 / 503）。
+     */
+    void recordThrottled(const QString& host);
+
+    /**
+     * @brief 记录一次完成的下载。传输量过小（测不准）时忽略。
+     * @param host 主机名。
+     * @param segments 实际使用的连接数。
+     * @param bytes 下载期间从网络收到的字节数。
+     * @param activeMs 处于下载状态的时长（不含排队、暂停与合并）。
+     */
+    void recordTransfer(const QString& host, int segments, qint64 bytes, qint64 activeMs);
+
+    /**
+     * @brief 有改动时写回磁盘（QSaveFile 原子替换）。
+     */
+    void save();
+
+private:
+    HostProfileStore();
+
+    struct Profile {
+        qint64 updatedAtMs = 0;         ///< 最近更新（Unix 毫秒），淘汰与过期用。
+        qint64 rangeIgnoredAtMs = 0;    ///< 最近一次观测到无视 Range（0 表示没有）。
+        qint64 throttledAtMs = 0;       ///< 最近一次观测到限流（0 表示没有）。
+        double ttfbMs = -1.0;           ///< 首字节时间 EWMA（< 0 表示未知）。
+        QMap<int, double> throughput;   ///< 分片数 -> 平均吞吐 EWMA（字节/秒）。
+    };
+
+    static QString profilePath();
+    static QString hostKey(const QString& host);
+
+    /**
+     * @brief 取（必要时新建）某主机的画像；已满时淘汰最久未更新的一条。调用方持锁。
+     */
+    Profile& touch(const QString& key, qint64 now);
+
+    void load();
+
+    QMutex m_mutex;                     ///< 保护以下成员。
+    QHash<QString, Profile> m_profiles; ///< 主机（小写）-> 画像。
+    bool m_dirty = false;               ///< 有未写回的改动。
+
+    static constexpr int MAX_HOSTS             = 256;                        ///< 画像条目上限
+    static constexpr qint64 PROFILE_TTL_MS     = 30LL * 24 * 60 * 60 * 1000; ///< 30 天未更新的画像丢弃
+    static constexpr qint64 FLAG_TTL_MS        = 7LL * 24 * 60 * 60 * 1000;  ///< 无视 Range / 限流标记 7 天后重新尝试
+    static constexpr qint64 MIN_SAMPLE_BYTES   = 4 * 1024 * 1024;            ///< 吞吐样本的最小传输量
+    static constexpr qint64 MIN_SAMPLE_MS      = 2000;                       ///< 吞吐样本的最短下载时长
+    static constexpr double PLATEAU_RATIO      = 0.9;                        ///< 达到最优吞吐的该比例即视为进入平台
+    static constexpr int THROTTLED_MAX_SEGMENTS = 2;                         ///< 限流主机的分片数上限
+    static constexpr int MIN_TIMEOUT_MS        = 10 * 1000;                  ///< 按 TTFB 推算的超时下限
+    static constexpr int MAX_TIMEOUT_MS        = 60 * 1000;                  ///< 按 TTFB 推算的超时上限
+    static constexpr qint64 MIN_READ_BUFFER    = 1 * 1024 * 1024;            ///< 读缓冲下限
+    static constexpr qint64 MAX_READ_BUFFER    = 16 * 1024 * 1024;           ///< 读缓冲上限
+};
+
+#endif // HOSTPROFILESTORE_H
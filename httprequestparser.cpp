@@ -0,0 +1,205 @@
+#include "httprequestparser.h"
+#include <cstring>
+
+namespace {
+
+// 在 [from, size) 中找 "\r\n\r\n" 的起点。memchr 找 '\n'，命中后回看前 3 个字节；
+// from 之前的字节已经扫描过，调用方会把 from 回退 3 字节以覆盖跨两次到达的分隔符。
+static qsizetype findHeaderEnd(const char *data, qsizetype size, qsizetype from)
+{
+    const char *p = data + from;
+    const char *end = data + size;
+    while (p < end) {
+        const char *nl = static_cast<const char *>(std::memchr(p, '\n', size_t(end - p)));
+        if (!nl) return -1;
+        const qsizetype pos = nl - data;
+        if (pos >= 3 && nl[-1] == '\r' && nl[-2] == '\n' && nl[-3] == '\r') {
+            return pos - 3;
+        }
+        p = nl + 1;
+    }
+    return -1;
+}
+
+static bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static QByteArrayView trimmed(QByteArrayView v)
+{
+    qsizetype b = 0;
+    qsizetype e = v.size();
+    while (b < e && isSpace(v[b])) ++b;
+    while (e > b && isSpace(v[e - 1])) --e;
+    return v.sliced(b, e - b);
+}
+
+static bool equalsIgnoreCase(QByteArrayView a, const char *b)
+{
+    const qsizetype n = qsizetype(std::strlen(b));
+    return a.size() == n && qstrnicmp(a.data(), b, size_t(n)) == 0;
+}
+
+// Connection 头是逗号分隔的 token 列表
+static bool hasConnectionToken(QByteArrayView value, const char *token)
+{
+    qsizetype start = 0;
+    while (start <= value.size()) {
+        qsizetype comma = start;
+        while (comma < value.size() && value[comma] != ',') ++comma;
+        if (equalsIgnoreCase(trimmed(value.sliced(start, comma - start)), token)) {
+            return true;
+        }
+        start = comma + 1;
+    }
+    return false;
+}
+
+// 只接受纯十进制；超过 limit 视为越界（不会溢出）
+static bool parseContentLength(QByteArrayView v, qsizetype limit, qsizetype *out)
+{
+    if (v.isEmpty()) return false;
+    qsizetype n = 0;
+    for (char c : v) {
+        if (c < '0' || c > '9') return false;
+        n = n * 10 + (c - '0');
+        if (n > limit) return false;
+    }
+    *out = n;
+    return true;
+}
+
+} // namespace
+
+HttpRequestParser::State HttpRequestParser::parse(QByteArrayView data)
+{
+    if (m_errorStatus != 0) {
+        return State::Error;
+    }
+
+    if (m_headerEnd < 0) {
+        const qsizetype from = m_scanned > 3 ? m_scanned - 3 : 0;
+        const qsizetype end = findHeaderEnd(data.data(), data.size(), from);
+        if (end < 0) {
+            m_scanned = data.size();
+            if (data.size() > MAX_HEADER_BYTES) {
+                return fail(431, "Request Header Fields Too Large", QStringLiteral("request header too large"));
+            }
+            return State::NeedMore;
+        }
+        if (end > MAX_HEADER_BYTES) {
+            return fail(431, "Request Header Fields Too Large", QStringLiteral("request header too large"));
+        }
+        m_headerEnd = end;
+        const State head = parseHead(data.first(end));
+        if (head != State::NeedMore) {
+            return head;
+        }
+    }
+
+    const qsizetype bodyStart = m_headerEnd + 4;
+    if (data.size() < bodyStart + m_contentLength) {
+        return State::NeedMore;
+    }
+
+    auto view = [&data](const Span &s) { return data.sliced(s.pos, s.len); };
+    m_request = HttpRequestView();
+    m_request.method = view(m_method);
+    m_request.target = view(m_target);
+    m_request.origin = view(m_origin);
+    m_request.authorization = view(m_authorization);
+    m_request.body = data.sliced(bodyStart, m_contentLength);
+    m_request.hasContentLength = m_hasContentLength;
+    m_request.keepAlive = m_keepAlive;
+    m_request.totalLength = bodyStart + m_contentLength;
+    return State::Ready;
+}
+
+void HttpRequestParser::reset()
+{
+    *this = HttpRequestParser();
+}
+
+HttpRequestParser::State HttpRequestParser::parseHead(QByteArrayView head)
+{
+    const char *base = head.data();
+    auto spanOf = [base](QByteArrayView v) { return Span{v.data() - base, v.size()}; };
+
+    // 请求行：METHOD SP TARGET SP VERSION
+    qsizetype lineEnd = head.indexOf('\n');
+    if (lineEnd < 0) lineEnd = head.size();
+    const QByteArrayView requestLine = trimmed(head.first(lineEnd));
+    const qsizetype sp1 = requestLine.indexOf(' ');
+    const qsizetype sp2 = sp1 < 0 ? -1 : requestLine.sliced(sp1 + 1).indexOf(' ');
+    if (sp1 <= 0 || sp2 <= 0) {
+        return fail(400, "Bad Request", QStringLiteral("Malformed request line"));
+    }
+    const QByteArrayView method = requestLine.first(sp1);
+    const QByteArrayView target = requestLine.sliced(sp1 + 1, sp2);
+    const QByteArrayView version = trimmed(requestLine.sliced(sp1 + 1 + sp2 + 1));
+    if (version == QByteArrayView("HTTP/1.1")) {
+        m_keepAlive = true;
+    } else if (version == QByteArrayView("HTTP/1.0")) {
+        m_keepAlive = false;
+    } else {
+        return fail(505, "HTTP Version Not Supported", QStringLiteral("only HTTP/1.0 and HTTP/1.1 are supported"));
+    }
+    m_method = spanOf(method);
+    m_target = spanOf(target);
+
+    // 头字段：一遍扫描，只记下关心的几个
+    int lines = 0;
+    qsizetype pos = lineEnd + 1;
+    while (pos < head.size()) {
+        qsizetype next = head.sliced(pos).indexOf('\n');
+        next = next < 0 ? head.size() : pos + next;
+        const QByteArrayView line = trimmed(head.sliced(pos, next - pos));
+        pos = next + 1;
+        if (line.isEmpty()) continue;
+        if (++lines > MAX_HEADER_LINES) {
+            return fail(431, "Request Header Fields Too Large", QStringLiteral("too many header fields"));
+        }
+
+        const qsizetype colon = line.indexOf(':');
+        if (colon <= 0) {
+            return fail(400, "Bad Request", QStringLiteral("Malformed header line"));
+        }
+        const QByteArrayView name = line.first(colon);
+        const QByteArrayView value = trimmed(line.sliced(colon + 1));
+        if (equalsIgnoreCase(name, "Content-Length")) {
+            qsizetype n = 0;
+            if (!parseContentLength(value, MAX_BODY_SIZE, &n)) {
+                return fail(413, "Payload Too Large", QStringLiteral("Content-Length out of range"));
+            }
+            // 多个互相矛盾的 Content-Length 是请求走私的典型手法
+            if (m_hasContentLength && n != m_contentLength) {
+                return fail(400, "Bad Request", QStringLiteral("conflicting Content-Length"));
+            }
+            m_contentLength = n;
+            m_hasContentLength = true;
+        } else if (equalsIgnoreCase(name, "Transfer-Encoding")) {
+            // 不支持分块请求体；拒绝而不是猜测边界，避免与前置代理对请求边界理解不一致
+            return fail(501, "Not Implemented", QStringLiteral("Transfer-Encoding is not supported"));
+        } else if (equalsIgnoreCase(name, "Connection")) {
+            if (hasConnectionToken(value, "close")) {
+                m_keepAlive = false;
+            } else if (hasConnectionToken(value, "keep-alive")) {
+                m_keepAlive = true;
+            }
+        } else if (equalsIgnoreCase(name, "Origin")) {
+            m_origin = spanOf(value);
+        } else if (equalsIgnoreCase(name, "Authorization")) {
+            m_authorization = spanOf(value);
+        }
+    }
+    return State::NeedMore;
+}
+
+HttpRequestParser::State HttpRequestParser::fail(int status, const QByteArray& reason, const QString& message)
+{
+    m_errorStatus = status;
+    m_errorReason = reason;
+    m_errorMessage = message;
+    return State::Error;
+}
@@ -0,0 +1,92 @@
+#ifndef HTTPREQUESTPARSER_H
+#define HTTPREQUESTPARSER_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+
+/**
+ * @brief 一个已完整到达的请求。所有视图都指向连接的接收缓冲，不做拷贝；
+ * 缓冲被追加或压缩后失效，需要跨事件循环保留的字段由调用方自行拷贝。
+ */
+struct HttpRequestView {
+    QByteArrayView method;          ///< 请求方法。
+    QByteArrayView target;          ///< 请求目标（路径 + 查询串）。
+    QByteArrayView origin;          ///< Origin 头（无则为空）。
+    QByteArrayView authorization;   ///< Authorization 头（无则为空）。
+    QByteArrayView body;            ///< 请求体。
+    bool hasContentLength = false;  ///< 是否带了 Content-Length。
+    bool keepAlive = true;          ///< 客户端是否希望保持连接（HTTP/1.1 默认保持，HTTP/1.0 需显式声明）。
+    qsizetype totalLength = 0;      ///< 本请求占用的字节数（头 + 空行 + 体）。
+};
+
+/**
+ * @brief 增量 HTTP/1.x 请求解析器（每个连接一个）。
+ *
+ * 状态机只向前走：头部结束符之前已经扫描过的字节不再重扫，每次 readyRead 只看新到达的部分；
+ * 找到头部后只解析一遍请求行与头，之后等体到齐。分隔符扫描用 memchr（主流 libc 按 SIMD 宽度实现），
+ * 只在命中 '\n' 时回看前 3 个字节确认 "\r\n\r\n"。
+ *
+ * 用法：parse() 返回 Ready 后读取 request()，调用方消费 totalLength 字节并 reset()，
+ * 再对剩余字节继续 parse()（pipelining）。
+ */
+class HttpRequestParser
+{
+public:
+    enum class State {
+        NeedMore,   ///< 请求还不完整。
+        Ready,      ///< 一个完整请求，见 request()。
+        Error       ///< 请求非法，见 errorStatus()/errorReason()/errorMessage()，应答后关闭连接。
+    };
+
+    /**
+     * @brief 解析 data 开头的请求。data 必须从当前请求的第一个字节开始，
+     * 并且是上次传入内容的延续（只会在末尾追加）。
+     */
+    State parse(QByteArrayView data);
+
+    /**
+     * @brief 清空状态，准备解析下一个请求。
+     */
+    void reset();
+
+    const HttpRequestView& request() const { return m_request; }
+    int errorStatus() const { return m_errorStatus; }
+    QByteArray errorReason() const { return m_errorReason; }
+    QString errorMessage() const { return m_errorMessage; }
+
+    static constexpr qsizetype MAX_HEADER_BYTES = 16 * 1024;   ///< 请求行 + 头部上限
+    static constexpr int MAX_HEADER_LINES       = 64;          ///< 头部行数上限
+    static constexpr qsizetype MAX_BODY_SIZE    = 1 * 1024 * 1024; ///< 请求体上限 1 MiB
+
+private:
+    /**
+     * @brief 头部已完整：解析请求行与头字段。
+     */
+    State parseHead(QByteArrayView head);
+
+    State fail(int status, const QByteArray& reason, const QString& message);
+
+    /// 头部字段在数据中的位置。头部解析与体到齐可能跨多次 readyRead，期间缓冲可能重新分配，
+    /// 所以只记偏移，Ready 时再对当次传入的数据生成视图。
+    struct Span {
+        qsizetype pos = 0;
+        qsizetype len = 0;
+    };
+
+    Span m_method;                  ///< 请求方法。
+    Span m_target;                  ///< 请求目标。
+    Span m_origin;                  ///< Origin 头。
+    Span m_authorization;           ///< Authorization 头。
+    bool m_hasContentLength = false;///< 是否带了 Content-Length。
+    bool m_keepAlive = true;        ///< 是否保持连接。
+    qsizetype m_scanned = 0;        ///< 已确认不含头部结束符的前缀长度。
+    qsizetype m_headerEnd = -1;     ///< "\r\n\r\n" 的起点；-1 表示还没找到。
+    qsizetype m_contentLength = 0;  ///< 解析出的 Content-Length。
+    HttpRequestView m_request;      ///< 当前请求（Ready 时填充）。
+    int m_errorStatus = 0;          ///< 错误时的响应状态码。
+    QByteArray m_errorReason;       ///< 错误时的状态短语。
+    QString m_errorMessage;         ///< 错误时的说明。
+};
+
+#endif // HTTPREQUESTPARSER_H
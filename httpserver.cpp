@@ -1,33 +1,42 @@
 #include "httpserver.h"
 #include "logger.h"
+#include "settingsmanager.h"
+#include "downloadmanager.h"
+#include "hostguard.h"
+#include "smallfilefetcher.h"
 #include <QDebug>
 #include <QHostAddress>
-#include <QHostInfo>
 #include <QUrl>
+#include <QUrlQuery>
+#include <QDir>
+#include <QFileInfo>
 #include <QRegularExpression>
 #include <QSet>
 #include <QStringList>
 #include <QTimer>
 #include <QTcpServer>
 #include <QPointer>
-
-#if USE_QHTTPSERVER
-#include <QHttpServer>
-#include <QHttpServerResponse>
-#include <QHttpServerRequest>
-#include <QHttpHeaders>
-#endif
+#include <QJsonArray>
 
 namespace {
 
-// TODO(integration): integrate with SettingsManager::bearerToken() once the
-// persistence agent adds that API. Until then, we hardcode a process-local
-// token to block CSRF for any external web page that can reach
-// http://localhost:<port>/download.
-// 在 SettingsManager 暴露 bearerToken() 之前，先硬编码一份进程级 token
-// 用于浏览器插件与本地 HTTP 服务之间的鉴权，规避 CSRF。
-static const QByteArray HARDCODED_BEARER_TOKEN =
-    QByteArrayLiteral("DownloaderLocal-bearer-9c5f2a1e3b7d4f60");
+// 本地 HTTP 接口的 bearer token：与 LocalServer 一致取自 SettingsManager，
+// 首次访问时生成随机 UUID 并持久化；用户可在设置对话框里查看并复制给插件或脚本。
+static QByteArray currentBearerToken()
+{
+    return SettingsManager::instance().bearerToken().toUtf8();
+}
+
+// 定长比较，不因第一个不同字节提前返回，避免按响应时间逐字节猜 token。
+static bool tokenMatches(const QByteArray &presented, const QByteArray &expected)
+{
+    if (presented.isEmpty() || presented.size() != expected.size()) return false;
+    unsigned char diff = 0;
+    for (int i = 0; i < expected.size(); ++i) {
+        diff |= static_cast<unsigned char>(presented[i] ^ expected[i]);
+    }
+    return diff == 0;
+}
 
 // 允许跨域来源白名单：仅信任 Chrome/Edge 扩展 manifest 的 origin。
 static const QSet<QByteArray> kAllowedOrigins = {
@@ -57,126 +66,10 @@ static QByteArray bearerFromAuthHeader(const QByteArray &authHeader)
     return authHeader.mid(kBearerPrefix.size()).trimmed();
 }
 
-// 1) URL/SSRF 校验
+// 1) URL 校验（主机的 SSRF 校验在 HostGuard 里异步完成）
 // ---------------------------------------------------------------
-static bool isPrivateOrLoopbackIp(const QHostAddress &addr)
-{
-    if (addr.isLoopback())  return true;
-    if (addr.isLinkLocal()) return true;        // 169.254/16, fe80::/10
-    if (addr.isMulticast()) return true;
-
-    // 协议相关范围检查（QHostAddress 不会全部覆盖）
-    if (addr.protocol() == QAbstractSocket::IPv4Protocol) {
-        const quint32 ip = addr.toIPv4Address();
-        const quint32 b1 = (ip >> 24) & 0xFFu;
-        const quint32 b2 = (ip >> 16) & 0xFFu;
-        // 0.0.0.0/8 — "this network"
-        if (b1 == 0u) return true;
-        // 10.0.0.0/8
-        if (b1 == 10u) return true;
-        // 100.64.0.0/10 — CGNAT
-        if (b1 == 100u && b2 >= 64u && b2 <= 127u) return true;
-        // 127.0.0.0/8 — loopback（QHostAddress 已部分覆盖）
-        if (b1 == 127u) return true;
-        // 169.254.0.0/16 — link-local（QHostAddress 已覆盖）
-        // 172.16.0.0/12
-        if (b1 == 172u && b2 >= 16u && b2 <= 31u) return true;
-        // 192.168.0.0/16
-        if (b1 == 192u && b2 == 168u) return true;
-        // 192.0.2.0/24, 198.51.100.0/24, 203.0.113.0/24 — TEST-NET
-        if ((b1 == 192u && b2 == 0u  && ((ip >> 8) & 0xFFu) == 2u)  ||
-            (b1 == 198u && b2 == 51u && ((ip >> 8) & 0xFFu) == 100u) ||
-            (b1 == 203u && b2 == 0u  && ((ip >> 8) & 0xFFu) == 113u))
-            return true;
-        // 198.18.0.0/15 — benchmarking
-        if (b1 == 198u && (b2 == 18u || b2 == 19u)) return true;
-        // 240.0.0.0/4 — reserved (含 255.255.255.255 broadcast)
-        if (b1 >= 240u) return true;
-        return false;
-    }
-
-    // IPv6
-    if (addr.protocol() == QAbstractSocket::IPv6Protocol) {
-        const Q_IPV6ADDR ip6 = addr.toIPv6Address();
-        // fc00::/7 — unique local
-        if ((ip6[0] & 0xFEu) == 0xFCu) return true;
-        // fe80::/10 — link-local（QHostAddress 已覆盖）
-        // ff00::/8 — multicast（QHostAddress 已覆盖）
-        // ::ffff:a.b.c.d — IPv4-mapped：递归检查嵌入的 IPv4
-        // Qt 6.11 removed QHostAddress::isIPv4Mapped(); check bytes per RFC 4291 §2.5.5.2.
-        const bool isV4Mapped = (ip6[0]  == 0 && ip6[1]  == 0 && ip6[2]  == 0 &&
-                                 ip6[3]  == 0 && ip6[4]  == 0 && ip6[5]  == 0 &&
-                                 ip6[6]  == 0 && ip6[7]  == 0 && ip6[8]  == 0 &&
-                                 ip6[9]  == 0 && ip6[10] == 0xff && ip6[11] == 0xff);
-        if (isV4Mapped) {
-            const quint32 mapped = (quint32(ip6[12]) << 24) | (quint32(ip6[13]) << 16)
-                                 | (quint32(ip6[14]) << 8)  |  quint32(ip6[15]);
-            const QHostAddress v4(mapped);
-            return isPrivateOrLoopbackIp(v4);
-        }
-        // 其它 IPv6 未指定/loopback(::1) 由 QHostAddress 覆盖
-        return false;
-    }
-    return true; // 未知协议视为不安全
-}
-
-// 同步解析主机名，3 秒超时；任一解析结果落在私有/回环段则拒绝。
-//
-// 旁路开关：当环境变量 DOWNLOADER_ALLOW_LOOPBACK 被设置为非空 / "1" / "true"
-// 时，跳过 SSRF 拦截。这是给本地端到端测试用的逃生口（开启后从浏览器插件
-// 或 HTTP 接口可以指向 127.0.0.1 / localhost，便于联调 anti-Range 等场景）。
-// 生产环境不设置即可维持原防御。
-static bool hostResolvesToPublicAddress(const QString &host, QString *errorOut)
-{
-    if (host.isEmpty()) {
-        if (errorOut) *errorOut = QStringLiteral("empty host");
-        return false;
-    }
-
-    // 旁路：环境变量启用本地回环放行。仅用于本地联调/端到端验证，公网生产
-    // 部署不设置该环境变量，因此 SSRF 拦截仍然生效。
-    static const bool allowLoopback = []() {
-        const QByteArray v = qgetenv("DOWNLOADER_ALLOW_LOOPBACK");
-        if (v.isEmpty()) return false;
-        const QString s = QString::fromLocal8Bit(v).trimmed().toLower();
-        return s == "1" || s == "true" || s == "yes";
-    }();
-    if (allowLoopback) {
-        // 即使是 127.0.0.1 / localhost 也放行；不再走 DNS 解析与段检查。
-        return true;
-    }
-
-    // 字面 IP 路径
-    QHostAddress literal;
-    if (literal.setAddress(host)) {
-        if (isPrivateOrLoopbackIp(literal)) {
-            if (errorOut) *errorOut = QStringLiteral("host resolves to private/loopback address");
-            return false;
-        }
-        return true;
-    }
-
-    // 主机名 → DNS 解析（3 秒超时）
-    QHostInfo info = QHostInfo::fromName(host);
-    if (info.error() != QHostInfo::NoError) {
-        if (errorOut) *errorOut = QStringLiteral("DNS lookup failed: %1").arg(info.errorString());
-        return false;
-    }
-    const QList<QHostAddress> addrs = info.addresses();
-    if (addrs.isEmpty()) {
-        if (errorOut) *errorOut = QStringLiteral("DNS lookup returned no addresses");
-        return false;
-    }
-    for (const QHostAddress &a : addrs) {
-        if (isPrivateOrLoopbackIp(a)) {
-            if (errorOut) *errorOut = QStringLiteral("host resolves to private/loopback address");
-            return false;
-        }
-    }
-    return true;
-}
-
-static bool isValidDownloadUrl(const QString &rawUrl, QString *errorOut)
+// URL 语法检查（不含 DNS）：非空、合法、http/https、有主机。通过时把主机写入 *hostOut。
+static bool checkUrlSyntax(const QString &rawUrl, QString *hostOut, QString *errorOut)
 {
     if (rawUrl.isEmpty()) {
         if (errorOut) *errorOut = QStringLiteral("empty url");
@@ -197,7 +90,8 @@ static bool isValidDownloadUrl(const QString &rawUrl, QString *errorOut)
         if (errorOut) *errorOut = QStringLiteral("missing host");
         return false;
     }
-    return hostResolvesToPublicAddress(host, errorOut);
+    *hostOut = host;
+    return true;
 }
 
 // 2) 文件名校验
@@ -313,7 +207,6 @@ static QByteArray buildHttpResponse(int statusCode,
     resp += "Content-Length: ";
     resp += QByteArray::number(body.size());
     resp += "\r\n";
-    resp += "Connection: close\r\n";
     if (!origin.isEmpty()) {
         resp += "Access-Control-Allow-Origin: ";
         resp += origin;
@@ -343,8 +236,158 @@ static QByteArray jsonOkBody(const QString &message)
     return QJsonDocument(o).toJson(QJsonDocument::Compact);
 }
 
+// 5) 任务 JSON（/tasks 与 /events 共用）
+// ---------------------------------------------------------------
+static QString statusName(DownloadTaskStatus status)
+{
+    switch (status) {
+    case DownloadTaskStatus::Pending:     return QStringLiteral("pending");
+    case DownloadTaskStatus::Downloading: return QStringLiteral("downloading");
+    case DownloadTaskStatus::Paused:      return QStringLiteral("paused");
+    case DownloadTaskStatus::Cancelled:   return QStringLiteral("cancelled");
+    case DownloadTaskStatus::Completed:   return QStringLiteral("completed");
+    case DownloadTaskStatus::Failed:      return QStringLiteral("failed");
+    }
+    return QStringLiteral("unknown");
+}
+
+static QString phaseName(FinalizePhase phase)
+{
+    switch (phase) {
+    case FinalizePhase::None:     return QStringLiteral("none");
+    case FinalizePhase::Merging:  return QStringLiteral("merging");
+    case FinalizePhase::Moving:   return QStringLiteral("moving");
+    case FinalizePhase::Cleaning: return QStringLiteral("cleaning");
+    }
+    return QStringLiteral("none");
+}
+
+// 任务详情：状态与进度全是原子读，不会阻塞在 worker 回调上
+static QJsonObject taskToJson(const DownloadTask *task)
+{
+    const FinalizePhase phase = task->finalizePhase();
+    QJsonObject o;
+    o.insert(QStringLiteral("id"),              QString::number(task->id()));
+    o.insert(QStringLiteral("url"),             task->url());
+    o.insert(QStringLiteral("fileName"),        task->fileName());
+    o.insert(QStringLiteral("filePath"),        task->filePath());
+    o.insert(QStringLiteral("status"),          statusName(task->status()));
+    o.insert(QStringLiteral("phase"),           phaseName(phase));
+    o.insert(QStringLiteral("priority"),        task->priority());
+    o.insert(QStringLiteral("threads"),         task->threadCount());
+    o.insert(QStringLiteral("totalBytes"),      task->totalSize());
+    o.insert(QStringLiteral("downloadedBytes"), task->downloadedSize());
+    o.insert(QStringLiteral("speed"),           task->downloadSpeed());
+    o.insert(QStringLiteral("etaSeconds"),      task->etaSeconds());
+    o.insert(QStringLiteral("percent"),
+             phase == FinalizePhase::None ? task->progressPercentage() : task->finalizePercentage());
+    return o;
+}
+
+// 排队条目还没有任务对象：没有进度，状态固定为 queued
+static QJsonObject queuedToJson(const QueuedTask &entry)
+{
+    QJsonObject o;
+    o.insert(QStringLiteral("id"),              QString::number(entry.id));
+    o.insert(QStringLiteral("url"),             entry.url.toString());
+    o.insert(QStringLiteral("fileName"),        QFileInfo(entry.filePath).fileName());
+    o.insert(QStringLiteral("filePath"),        entry.filePath);
+    o.insert(QStringLiteral("status"),          QStringLiteral("queued"));
+    o.insert(QStringLiteral("priority"),        entry.priority);
+    o.insert(QStringLiteral("threads"),         entry.threadCount);
+    return o;
+}
+
+// 进度快照只带会变的字段；静态信息订阅时由 snapshot 事件给出
+static QJsonObject telemetryToJson(const TaskTelemetry &sample)
+{
+    QJsonObject o;
+    o.insert(QStringLiteral("id"),              QString::number(sample.task->id()));
+    o.insert(QStringLiteral("status"),          statusName(sample.status));
+    o.insert(QStringLiteral("phase"),           phaseName(sample.phase));
+    o.insert(QStringLiteral("totalBytes"),      sample.totalBytes);
+    o.insert(QStringLiteral("downloadedBytes"), sample.downloadedBytes);
+    o.insert(QStringLiteral("speed"),           sample.speed);
+    o.insert(QStringLiteral("etaSeconds"),      sample.etaSeconds);
+    o.insert(QStringLiteral("percent"),         sample.percent);
+    return o;
+}
+
+// 一条 SSE 事件：event 行 + 单行 JSON 的 data 行 + 空行
+static QByteArray sseFrame(const QByteArray &event, const QJsonObject &data)
+{
+    QByteArray frame;
+    frame += "event: ";
+    frame += event;
+    frame += "\ndata: ";
+    frame += QJsonDocument(data).toJson(QJsonDocument::Compact);
+    frame += "\n\n";
+    return frame;
+}
+
+static QByteArray jsonTaskBody(const QJsonObject &task)
+{
+    QJsonObject o;
+    o.insert(QStringLiteral("status"), QStringLiteral("success"));
+    o.insert(QStringLiteral("task"),   task);
+    return QJsonDocument(o).toJson(QJsonDocument::Compact);
+}
+
+static QByteArray jsonTaskBody(const DownloadTask *task)
+{
+    return jsonTaskBody(taskToJson(task));
+}
+
+// 6) 写响应
+// ---------------------------------------------------------------
+/// bytesWritten 之后的优雅断开延迟
+constexpr int kCloseGraceMs = 100;
+
+// 写响应并根据 closeAfter 补上 Connection 头、决定是否调度断开连接。
+// 各处构造的响应都不带 Connection 头，连接去向只在这里决定。
+static void writeAndMaybeClose(QTcpSocket *clientSocket,
+                               QByteArray response,
+                               bool closeAfter)
+{
+    if (!clientSocket) return;
+    const qsizetype statusEnd = response.indexOf("\r\n");
+    if (statusEnd > 0) {
+        response.insert(statusEnd + 2, closeAfter ? QByteArrayView("Connection: close\r\n")
+                                                  : QByteArrayView("Connection: keep-alive\r\n"));
+    }
+    clientSocket->write(response);
+    if (closeAfter) {
+        QPointer<QTcpSocket> safe(clientSocket);
+        QTimer::singleShot(kCloseGraceMs, clientSocket, [safe]() {
+            if (safe && safe->state() == QAbstractSocket::ConnectedState) {
+                safe->disconnectFromHost();
+            }
+        });
+    }
+}
+
 } // namespace
 
+// =========================================================================
+// 批量投递的进行中状态
+// =========================================================================
+struct HttpServer::BatchJob {
+    struct Entry {
+        QString url;
+        QString savePath;   ///< 请求里的 savePath，为空时回退到 filename
+        QString host;       ///< URL 主机（SSRF 校验的键）
+        QString error;      ///< 非空即拒绝
+        QList<QHostAddress> addresses; ///< 校验过的地址，交给任务钉住连接目标
+    };
+
+    QPointer<QTcpSocket> socket;   ///< 响应目标；客户端提前断开时为空
+    QByteArray origin;             ///< 回显的 CORS origin
+    bool keepAlive = true;         ///< 响应后是否保持连接
+    QList<Entry> entries;          ///< 与请求数组一一对应
+    QSet<QString> pendingHosts;    ///< 还没有结论的主机
+    bool done = false;             ///< finishBatch 已执行
+};
+
 // =========================================================================
 // 构造/析构
 // =========================================================================
@@ -353,21 +396,25 @@ HttpServer::HttpServer(QObject *parent)
 {
     LOGD("开始初始化HttpServer");
 
-#if USE_QHTTPSERVER
-    LOGD("使用QHttpServer...");
-    m_httpServer = new QHttpServer(this);
-#else
-    LOGD("使用QTcpServer...");
     m_tcpServer = new QTcpServer(this);
     LOGD("QTcpServer创建完成");
 
     LOGD("开始连接信号...");
     connect(m_tcpServer, &QTcpServer::newConnection, this, &HttpServer::onNewConnection);
+
+    // 事件流数据源：遥测批次与任务生命周期。没有订阅者时各槽直接返回。
+    DownloadManager &manager = DownloadManager::instance();
+    connect(&manager, &DownloadManager::telemetryUpdated, this, &HttpServer::onTelemetryUpdated);
+    connect(&manager, &DownloadManager::taskAdded, this, &HttpServer::onTaskAdded);
+    connect(&manager, &DownloadManager::taskFinished, this, &HttpServer::onTaskFinished);
+    connect(&manager, &DownloadManager::taskError, this, &HttpServer::onTaskError);
+
+    m_eventHeartbeat.setInterval(EVENT_HEARTBEAT_MS);
+    connect(&m_eventHeartbeat, &QTimer::timeout, this, &HttpServer::onEventHeartbeat);
     LOGD("信号连接完成");
 
     // Slowloris 防御：限制挂起连接上限。
     m_tcpServer->setMaxPendingConnections(MAX_PENDING_CONNS);
-#endif
 
     LOGD("HttpServer初始化完成");
 }
@@ -377,6 +424,42 @@ HttpServer::~HttpServer()
     stopServer();
 }
 
+void HttpServer::setDownloadDefaults(const QString& downloadDir, int threads)
+{
+    m_defaultDownloadDir = downloadDir;
+    m_defaultThreads = threads;
+}
+
+bool HttpServer::validateDownloadRequest(const QJsonObject& obj, QString* urlOut, QString* hostOut,
+                                         QString* targetOut, QString* errorOut)
+{
+    QString url, filename, savePath, host, err;
+    if (!extractStringField(obj, "url", &url, &err, true)) {
+        if (errorOut) *errorOut = err;
+        return false;
+    }
+    if (!checkUrlSyntax(url, &host, &err)) {
+        if (errorOut) *errorOut = QStringLiteral("invalid url: %1").arg(err);
+        return false;
+    }
+    if (!extractStringField(obj, "filename", &filename, &err, false)) {
+        if (errorOut) *errorOut = err;
+        return false;
+    }
+    if (!filename.isEmpty() && !isSafeFileName(filename, &err)) {
+        if (errorOut) *errorOut = QStringLiteral("invalid filename: %1").arg(err);
+        return false;
+    }
+    if (!extractStringField(obj, "savePath", &savePath, &err, false)) {
+        if (errorOut) *errorOut = err;
+        return false;
+    }
+    *urlOut = url;
+    *hostOut = host;
+    *targetOut = savePath.isEmpty() ? filename : savePath;
+    return true;
+}
+
 // =========================================================================
 // startServer / stopServer
 // =========================================================================
@@ -387,162 +470,6 @@ bool HttpServer::startServer(quint16 port)
     // 端口绑定竞态修复：每次启动前先 stopServer，避免重复绑定时旧 socket 残留。
     stopServer();
 
-#if USE_QHTTPSERVER
-    // QHttpServer 路径
-    try {
-        m_httpServer->route("/download", QHttpServerRequest::Method::Post,
-            [this](const QHttpServerRequest &request) -> QHttpServerResponse {
-                // 1) Origin 校验
-                const QByteArray origin = request.value("Origin");
-                const bool originOk = originAllowed(origin);
-                if (!originOk) {
-                    qWarning() << "[HttpServer] rejected origin:" << origin;
-                    return QHttpServerResponse(
-                        "application/json",
-                        jsonErrorBody(QStringLiteral("origin not allowed")),
-                        QHttpServerResponse::StatusCode::Forbidden);
-                }
-
-                // 2) Bearer token 校验
-                const QByteArray auth = request.value("Authorization");
-                const QByteArray presented = bearerFromAuthHeader(auth);
-                if (presented.isEmpty() || presented != HARDCODED_BEARER_TOKEN) {
-                    qWarning() << "[HttpServer] rejected: missing/invalid bearer token";
-                    return QHttpServerResponse(
-                        "application/json",
-                        jsonErrorBody(QStringLiteral("missing or invalid bearer token")),
-                        QHttpServerResponse::StatusCode::Unauthorized);
-                }
-
-                // 3) 限制 body 大小
-                const QByteArray body = request.body();
-                if (body.size() > MAX_BODY_SIZE) {
-                    return QHttpServerResponse(
-                        "application/json",
-                        jsonErrorBody(QStringLiteral("request body too large")),
-                        QHttpServerResponse::StatusCode::PayloadTooLarge);
-                }
-
-                // 4) 解析 JSON
-                QJsonParseError parseError;
-                QJsonDocument doc = QJsonDocument::fromJson(body, &parseError);
-                if (parseError.error != QJsonParseError::NoError) {
-                    qWarning() << "Failed to parse JSON from client:" << parseError.errorString();
-                    return QHttpServerResponse(
-                        "application/json",
-                        jsonErrorBody(QStringLiteral("Invalid JSON")),
-                        QHttpServerResponse::StatusCode::BadRequest);
-                }
-                if (!doc.isObject()) {
-                    return QHttpServerResponse(
-                        "application/json",
-                        jsonErrorBody(QStringLiteral("JSON is not an object")),
-                        QHttpServerResponse::StatusCode::BadRequest);
-                }
-
-                QJsonObject obj = doc.object();
-                QString url, filename, savePath, err;
-                if (!extractStringField(obj, "url", &url, &err, /*required=*/true)) {
-                    return QHttpServerResponse(
-                        "application/json",
-                        jsonErrorBody(err),
-                        QHttpServerResponse::StatusCode::BadRequest);
-                }
-                if (!isValidDownloadUrl(url, &err)) {
-                    qWarning() << "[HttpServer] SSRF/url rejected:" << url << err;
-                    return QHttpServerResponse(
-                        "application/json",
-                        jsonErrorBody(QStringLiteral("invalid url: %1").arg(err)),
-                        QHttpServerResponse::StatusCode::BadRequest);
-                }
-                if (!extractStringField(obj, "filename", &filename, &err, /*required=*/false)) {
-                    return QHttpServerResponse(
-                        "application/json",
-                        jsonErrorBody(err),
-                        QHttpServerResponse::StatusCode::BadRequest);
-                }
-                if (!extractStringField(obj, "savePath", &savePath, &err, /*required=*/false)) {
-                    return QHttpServerResponse(
-                        "application/json",
-                        jsonErrorBody(err),
-                        QHttpServerResponse::StatusCode::BadRequest);
-                }
-                if (!filename.isEmpty() && !isSafeFileName(filename, &err)) {
-                    return QHttpServerResponse(
-                        "application/json",
-                        jsonErrorBody(QStringLiteral("invalid filename: %1").arg(err)),
-                        QHttpServerResponse::StatusCode::BadRequest);
-                }
-
-                LOGD(QString("[HttpServer] new download url=%1 filename=%2").arg(url, filename));
-                emit newDownloadRequest(url, savePath.isEmpty() ? filename : savePath);
-
-                return QHttpServerResponse(
-                    "application/json",
-                    jsonOkBody(QStringLiteral("Download request received")),
-                    QHttpServerResponse::StatusCode::Ok);
-            });
-
-        // 共享 CORS preflight：仅在允许的 origin 上回显。其它 origin 直接拒绝。
-        // 注：Qt 6.10 的 QHttpServerResponse 不暴露 addHeader/setHeader，只能用
-        // setHeaders(QHttpHeaders) 整体替换（6.8+）。这里直接构造一个带 Origin
-        // header 的响应即可，preflight 浏览器会接受。
-        m_httpServer->route("/download", QHttpServerRequest::Method::Options,
-            [](const QHttpServerRequest &request) {
-                const QByteArray origin = request.value("Origin");
-                if (!originAllowed(origin)) {
-                    return QHttpServerResponse(
-                        "text/plain",
-                        QByteArrayLiteral("origin not allowed"),
-                        QHttpServerResponse::StatusCode::Forbidden);
-                }
-                // 用空 body + NoContent 状态；CORS 头由浏览器扩展使用
-                // Access-Control-Request-Headers 自行判断（我们要求 Authorization）。
-                QHttpServerResponse resp(
-                    QHttpServerResponse::StatusCode::NoContent);
-                QHttpHeaders hdrs;
-                hdrs.append(QHttpHeaders::WellKnownHeader::AccessControlAllowOrigin,  QString::fromUtf8(origin));
-                hdrs.append(QHttpHeaders::WellKnownHeader::AccessControlAllowMethods, QStringLiteral("POST, OPTIONS"));
-                hdrs.append(QHttpHeaders::WellKnownHeader::AccessControlAllowHeaders, QStringLiteral("Authorization, Content-Type"));
-                hdrs.append(QHttpHeaders::WellKnownHeader::AccessControlMaxAge,        QStringLiteral("300"));
-                hdrs.append(QHttpHeaders::WellKnownHeader::Vary,                       QStringLiteral("Origin"));
-                resp.setHeaders(hdrs);
-                return resp;
-            });
-
-        LOGD("开始监听...");
-        QTcpServer* tcpServer = new QTcpServer(this);
-        bool result = tcpServer->listen(QHostAddress::LocalHost, port);
-        LOGD(QString("监听结果:%1").arg(result ? "成功" : "失败"));
-
-        if (!result) {
-            LOGD(QString("监听失败 - 错误:%1").arg(tcpServer->errorString()));
-            emit error(QString("无法启动服务器: %1").arg(tcpServer->errorString()));
-            delete tcpServer;
-            return false;
-        }
-
-        bool bindResult = m_httpServer->bind(tcpServer);
-        if (!bindResult) {
-            LOGD("绑定QHttpServer失败");
-            emit error("无法绑定HTTP服务器");
-            delete tcpServer;
-            return false;
-        }
-
-        m_listenServer = tcpServer;
-        const quint16 actualPort = tcpServer->serverPort();
-
-        LOGD(QString("HTTP服务器启动成功 - 监听端口:%1").arg(actualPort));
-        emit serverStarted();
-        return true;
-    } catch (const std::exception& e) {
-        LOGD(QString("监听失败 - 错误:%1").arg(e.what()));
-        emit error(QString("无法启动服务器: %1").arg(e.what()));
-        return false;
-    }
-#else
-    // QTcpServer fallback
     LOGD("开始监听...");
     bool result = m_tcpServer->listen(QHostAddress::LocalHost, port);
     LOGD(QString("监听结果:%1").arg(result ? "成功" : "失败"));
@@ -556,32 +483,20 @@ bool HttpServer::startServer(quint16 port)
     LOGD(QString("HTTP服务器启动成功 - 监听端口:%1").arg(port));
     emit serverStarted();
     return true;
-#endif
 }
 
 void HttpServer::stopServer()
 {
-#if USE_QHTTPSERVER
-    if (m_httpServer) {
-        // Qt 6.10 中 QHttpServer 通过 bind(QTcpServer*) 持有监听 socket；
-        // 我们释放自己创建的那个 QTcpServer 即可断开监听。
-        if (m_listenServer) {
-            if (m_listenServer->isListening()) {
-                m_listenServer->close();
-            }
-            delete m_listenServer;
-            m_listenServer = nullptr;
-        }
-        qDebug() << "HTTP server stopped.";
-    }
-#else
     if (m_tcpServer && m_tcpServer->isListening()) {
         m_tcpServer->close();
         qDebug() << "HTTP server stopped.";
     }
-    // 清理残余缓冲/定时器：服务停止时丢弃所有未完成连接。
-    const auto sockets = m_buffers.keys();
-    for (QTcpSocket *s : sockets) {
+    // 清理残余缓冲/定时器：服务停止时丢弃所有未完成连接与事件流订阅者。
+    QSet<QTcpSocket*> sockets(m_eventClients);
+    for (auto it = m_clients.cbegin(); it != m_clients.cend(); ++it) {
+        sockets.insert(it.key());
+    }
+    for (QTcpSocket *s : std::as_const(sockets)) {
         if (s) {
             QTimer *t = m_idleTimers.value(s, nullptr);
             if (t) { t->stop(); t->deleteLater(); }
@@ -592,16 +507,15 @@ void HttpServer::stopServer()
             s->deleteLater();
         }
     }
-    m_buffers.clear();
+    m_clients.clear();
     m_idleTimers.clear();
-#endif
+    m_eventClients.clear();
+    m_eventHeartbeat.stop();
 }
 
 // =========================================================================
-// QTcpServer fallback 实现
+// 连接与缓冲
 // =========================================================================
-#if !USE_QHTTPSERVER
-
 void HttpServer::onNewConnection()
 {
     while (QTcpSocket *clientSocket = m_tcpServer->nextPendingConnection()) {
@@ -615,7 +529,7 @@ void HttpServer::onNewConnection()
         QTimer *idleTimer = new QTimer(clientSocket);
         idleTimer->setSingleShot(true);
         idleTimer->setInterval(IDLE_TIMEOUT_MS);
-        connect(idleTimer, &QTimer::timeout, this, [this, clientSocket]() {
+        connect(idleTimer, &QTimer::timeout, this, [clientSocket]() {
             qWarning() << "[HttpServer] idle timeout, dropping peer:" << clientSocket->peerAddress().toString();
             clientSocket->abort();
             clientSocket->deleteLater();
@@ -623,7 +537,7 @@ void HttpServer::onNewConnection()
         idleTimer->start();
         m_idleTimers.insert(clientSocket, idleTimer);
 
-        m_buffers.insert(clientSocket, QByteArray());
+        m_clients.insert(clientSocket, ClientConnection());
     }
 }
 
@@ -632,85 +546,121 @@ void HttpServer::onReadyRead()
     QTcpSocket *clientSocket = qobject_cast<QTcpSocket*>(sender());
     if (!clientSocket) return;
 
-    QByteArray chunk = clientSocket->readAll();
+    auto it = m_clients.find(clientSocket);
+    if (it == m_clients.end()) {
+        // 事件流是单向的：订阅后客户端再发来的字节一律丢弃
+        clientSocket->readAll();
+        return;
+    }
+
+    const QByteArray chunk = clientSocket->readAll();
     if (chunk.isEmpty()) return;
 
-    QByteArray &buf = m_buffers[clientSocket];
-    if (buf.size() + chunk.size() > MAX_BUFFER_SIZE) {
-        // 超额缓冲，强制断开防 OOM
+    ClientConnection &conn = *it;
+    if (conn.closing) return; // 已安排关闭：丢弃后续字节
+
+    if (conn.buffer.size() - conn.readPos + chunk.size() > MAX_BUFFER_SIZE) {
+        // 未消费的字节超额，强制断开防 OOM
         qWarning() << "[HttpServer] client buffer exceeded, dropping peer";
         clientSocket->abort();
         clientSocket->deleteLater();
         return;
     }
-    buf.append(chunk);
+    conn.buffer.append(chunk);
 
     // 重置空闲超时
     QTimer *idleTimer = m_idleTimers.value(clientSocket, nullptr);
     if (idleTimer) idleTimer->start();
 
-    // 尝试解析一个或多个完整 HTTP 请求（pipelining）。
-    // 每次循环消费一个完整请求；剩余字节保留供下一次循环处理。
+    drainRequests(clientSocket);
+}
+
+void HttpServer::drainRequests(QTcpSocket *clientSocket)
+{
+    QPointer<HttpServer> safeThis(this);
+    QPointer<QTcpSocket> safeSocket(clientSocket);
+
+    // 逐个消费缓冲里已经完整的请求（pipelining）。解析器记住扫描位置，只看新到的字节；
+    // 请求字段是指向缓冲的视图，处理完才前移 readPos，不拷贝、不逐请求 memmove。
     while (true) {
-        const int headerEnd = buf.indexOf("\r\n\r\n");
-        if (headerEnd < 0) return; // 头部还不完整，等下一波数据
-
-        // 解析 Content-Length；空 body 或非 POST 也算合法（contentLength=0）。
-        int contentLength = 0;
-        bool gotContentLength = false;
-        const QList<QByteArray> headerLines = buf.left(headerEnd).split('\n');
-        for (const QByteArray &rawLine : headerLines) {
-            const QByteArray line = rawLine.trimmed();
-            const int colon = line.indexOf(':');
-            if (colon < 0) continue;
-            const QByteArray name = line.left(colon).trimmed().toLower();
-            if (name != "content-length") continue;
-            bool ok = false;
-            int n = line.mid(colon + 1).trimmed().toInt(&ok);
-            if (!ok || n < 0 || n > MAX_BODY_SIZE) {
-                // Content-Length 非法或过大：拒绝
-                QByteArray resp = buildHttpResponse(413, "Payload Too Large",
-                    jsonErrorBody(QStringLiteral("Content-Length out of range")),
-                    "application/json", QByteArray());
-                clientSocket->write(resp);
-                QTimer::singleShot(CLOSE_GRACE_MS, clientSocket, [clientSocket]() {
-                    clientSocket->disconnectFromHost();
-                });
-                m_buffers.remove(clientSocket);
-                return;
+        auto it = m_clients.find(clientSocket);
+        if (it == m_clients.end()) return;  // 已断开或转成事件流
+        ClientConnection &conn = *it;
+        if (conn.pending || conn.closing) return; // 响应必须按请求顺序写出
+
+        const QByteArrayView available = QByteArrayView(conn.buffer).sliced(conn.readPos);
+        const HttpRequestParser::State state = conn.parser.parse(available);
+
+        if (state == HttpRequestParser::State::NeedMore) {
+            // 只剩半个请求：把它挪到缓冲开头，已消费的前缀不再占内存
+            if (conn.readPos > 0) {
+                conn.buffer.remove(0, conn.readPos);
+                conn.readPos = 0;
             }
-            contentLength = n;
-            gotContentLength = true;
+            return;
         }
-        (void)gotContentLength;
 
-        const int bodyStart = headerEnd + 4;
-        const int totalLen   = bodyStart + contentLength;
-        if (buf.size() < totalLen) return; // body 不完整，等更多数据
+        if (state == HttpRequestParser::State::Error) {
+            qWarning() << "[HttpServer] malformed request:" << conn.parser.errorMessage();
+            sendResponse(clientSocket,
+                buildHttpResponse(conn.parser.errorStatus(), conn.parser.errorReason(),
+                    jsonErrorBody(conn.parser.errorMessage()),
+                    "application/json", QByteArray()),
+                /*keepAlive=*/false);
+            return;
+        }
 
-        // 解析一次请求；用 QPointer 守卫自己与 socket。
-        QPointer<HttpServer> safeThis(this);
-        QPointer<QTcpSocket> safeSocket(clientSocket);
-        const bool keepGoing = processHttpRequest(clientSocket);
+        const HttpRequestView request = conn.parser.request();
+        ++conn.served;
+        const bool keepAlive = request.keepAlive && conn.served < MAX_REQUESTS_PER_CONN;
 
+        processHttpRequest(clientSocket, request, keepAlive);
         if (!safeThis || !safeSocket) return;
-        // processHttpRequest 可能因错误路径清理了 buffer；检查后再继续。
-        if (!m_buffers.contains(safeSocket.data())) return;
 
-        if (!keepGoing) {
-            // 响应要求关闭连接；停止 pipeline 处理，关闭前清空 buffer。
-            m_buffers[safeSocket.data()].clear();
-            return;
+        // processHttpRequest 可能把连接转成了事件流（移出 m_clients）；重新查找再前移
+        it = m_clients.find(clientSocket);
+        if (it == m_clients.end()) return;
+        it->parser.reset();
+        it->readPos += request.totalLength;
+        if (it->readPos >= it->buffer.size()) {
+            it->buffer.clear();
+            it->readPos = 0;
         }
+    }
+}
 
-        // 消费本次请求的字节，保留剩余尾部供后续循环处理。
-        QByteArray &b = m_buffers[safeSocket.data()];
-        if (totalLen >= b.size()) {
-            b.clear();
-            return;
-        }
-        b = b.mid(totalLen);
-        if (b.isEmpty()) return;
+void HttpServer::sendResponse(QTcpSocket *clientSocket, const QByteArray& response, bool keepAlive)
+{
+    auto it = m_clients.find(clientSocket);
+    if (it != m_clients.end() && !keepAlive) {
+        it->closing = true;
+    }
+    // 每个响应之后重新计空闲时间：keep-alive 连接空闲超过 IDLE_TIMEOUT_MS 才断开
+    QTimer *idleTimer = m_idleTimers.value(clientSocket, nullptr);
+    if (idleTimer) idleTimer->start();
+    writeAndMaybeClose(clientSocket, response, !keepAlive);
+}
+
+void HttpServer::beginPending(QTcpSocket *clientSocket)
+{
+    auto it = m_clients.find(clientSocket);
+    if (it != m_clients.end()) {
+        it->pending = true;
+    }
+}
+
+void HttpServer::completePending(QTcpSocket *clientSocket, const QByteArray& response, bool keepAlive)
+{
+    auto it = m_clients.find(clientSocket);
+    if (!clientSocket || it == m_clients.end()) return;
+    it->pending = false;
+    sendResponse(clientSocket, response, keepAlive);
+    if (keepAlive) {
+        // 回调可能同步发生在 drainRequests 之内；排队继续处理 pipeline 里后面的请求，避免重入
+        QPointer<QTcpSocket> safeSocket(clientSocket);
+        QMetaObject::invokeMethod(this, [this, safeSocket]() {
+            if (safeSocket) drainRequests(safeSocket.data());
+        }, Qt::QueuedConnection);
     }
 }
 
@@ -731,233 +681,632 @@ void HttpServer::onClientDisconnected()
     }
     m_idleTimers.remove(clientSocket);
 
-    m_buffers.remove(clientSocket);
+    m_clients.remove(clientSocket);
+    removeEventSubscriber(clientSocket);
     clientSocket->deleteLater();
 }
 
-// 写响应并根据 closeAfter 决定是否调度断开连接。
-// 返回 false 表示应当停止后续 pipeline 处理（即将关闭）。
-static bool writeAndMaybeClose(QTcpSocket *clientSocket,
-                               const QByteArray &response,
-                               bool closeAfter)
+// =========================================================================
+// 请求分发
+// =========================================================================
+void HttpServer::processHttpRequest(QTcpSocket *clientSocket, const HttpRequestView& request, bool keepAlive)
 {
-    if (!clientSocket) return false;
-    clientSocket->write(response);
-    if (closeAfter) {
-        QPointer<QTcpSocket> safe(clientSocket);
-        QTimer::singleShot(CLOSE_GRACE_MS, clientSocket, [safe]() {
-            if (safe && safe->state() == QAbstractSocket::ConnectedState) {
-                safe->disconnectFromHost();
+    auto respond = [this, clientSocket, keepAlive](int code, const QByteArray& reason, const QByteArray& body,
+                                                   const QByteArray& contentType, const QByteArray& origin) {
+        sendResponse(clientSocket, buildHttpResponse(code, reason, body, contentType, origin), keepAlive);
+    };
+    auto respondError = [&respond](int code, const QByteArray& reason, const QString& message,
+                                   const QByteArray& origin) {
+        respond(code, reason, jsonErrorBody(message), "application/json", origin);
+    };
+
+    const QByteArrayView method = request.method;
+    // 路径与查询串分开：路由只看路径，/events 的 token 可能在查询串里
+    const QUrl targetUrl = QUrl::fromEncoded("http://localhost" + request.target.toByteArray());
+    const QString path = targetUrl.path();
+    const QStringList segments = path.split(QLatin1Char('/'), Qt::SkipEmptyParts);
+    // 请求体只在本次处理期间使用，包一层不拷贝
+    const QByteArray body = QByteArray::fromRawData(request.body.data(), request.body.size());
+
+    LOGD(QString("HTTP Request - Method:%1 Path:%2").arg(QString::fromUtf8(method), path));
+
+    // 只向允许的 origin 回显 CORS 头
+    const QByteArray origin = request.origin.toByteArray();
+    const bool originOk = originAllowed(origin);
+    const QByteArray corsOrigin = originOk ? origin : QByteArray();
+
+    if (method == QByteArrayView("OPTIONS")) {
+        // CORS preflight
+        if (!originOk) {
+            respondError(403, "Forbidden", QStringLiteral("origin not allowed"), QByteArray());
+            return;
+        }
+        QByteArray headers;
+        headers += "HTTP/1.1 204 No Content\r\n";
+        headers += "Access-Control-Allow-Origin: "  + origin + "\r\n";
+        headers += "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n";
+        headers += "Access-Control-Allow-Headers: Authorization, Content-Type\r\n";
+        headers += "Access-Control-Max-Age: 300\r\n";
+        headers += "Vary: Origin\r\n";
+        headers += "Content-Length: 0\r\n\r\n";
+        sendResponse(clientSocket, headers, keepAlive);
+        return;
+    }
+
+    if (method == QByteArrayView("GET") && (path == "/" || path == "/status")) {
+        // 存活检查：不需要认证，也不泄露任何任务信息
+        respond(200, "OK", "Downloader HTTP Server is running", "text/plain", corsOrigin);
+        return;
+    }
+
+    const bool isDownload = (path == "/download");
+    const bool isBatch = (path == "/download/batch");
+    const bool isControl = !segments.isEmpty()
+        && (segments.first() == QLatin1String("tasks") || segments.first() == QLatin1String("events"));
+    if (!isDownload && !isBatch && !isControl) {
+        respondError(404, "Not Found", QStringLiteral("not found"), corsOrigin);
+        return;
+    }
+
+    // 1) Origin：/download 只接受浏览器扩展；批量投递与控制接口允许无 Origin 的本机工具（curl、脚本），
+    //    但浏览器发来的请求必须来自允许的扩展，挡住普通网页的跨站请求。
+    if (isDownload ? !originOk : (!origin.isEmpty() && !originOk)) {
+        qWarning() << "[HttpServer] rejected origin:" << origin;
+        respondError(403, "Forbidden", QStringLiteral("origin not allowed"), QByteArray());
+        return;
+    }
+
+    // 2) Bearer token（EventSource 无法带请求头，/events 允许用 ?token= 传）
+    QByteArray presented = bearerFromAuthHeader(request.authorization.toByteArray());
+    if (presented.isEmpty() && segments.first() == QLatin1String("events")) {
+        presented = QUrlQuery(targetUrl).queryItemValue(QStringLiteral("token"), QUrl::FullyDecoded).toUtf8();
+    }
+    if (!tokenMatches(presented, currentBearerToken())) {
+        qWarning() << "[HttpServer] rejected: missing/invalid bearer token";
+        respondError(401, "Unauthorized", QStringLiteral("missing or invalid bearer token"), corsOrigin);
+        return;
+    }
+
+    if (isBatch) {
+        if (method != QByteArrayView("POST")) {
+            respondError(405, "Method Not Allowed", QStringLiteral("method not allowed"), corsOrigin);
+            return;
+        }
+        if (!request.hasContentLength) {
+            respondError(400, "Bad Request", QStringLiteral("missing Content-Length"), corsOrigin);
+            return;
+        }
+        // 响应在校验完成后异步写出；期间同一连接上 pipeline 的后续请求排队等待
+        beginPending(clientSocket);
+        startBatchRequest(clientSocket, body, corsOrigin, keepAlive);
+        return;
+    }
+
+    if (isControl) {
+        if (segments.first() == QLatin1String("events")) {
+            if (segments.size() != 1) {
+                respondError(404, "Not Found", QStringLiteral("not found"), corsOrigin);
+                return;
             }
-        });
-        return false;
+            if (method != QByteArrayView("GET")) {
+                respondError(405, "Method Not Allowed", QStringLiteral("method not allowed"), corsOrigin);
+                return;
+            }
+            if (m_eventClients.size() >= MAX_EVENT_CLIENTS) {
+                respondError(503, "Service Unavailable", QStringLiteral("too many event subscribers"), corsOrigin);
+                return;
+            }
+            openEventStream(clientSocket, corsOrigin);
+            return;
+        }
+        sendResponse(clientSocket, handleTaskRequest(method.toByteArray(), segments, body, corsOrigin), keepAlive);
+        return;
     }
-    return true;
+
+    // POST /download
+    if (method != QByteArrayView("POST")) {
+        respondError(405, "Method Not Allowed", QStringLiteral("method not allowed"), corsOrigin);
+        return;
+    }
+
+    // 3) body 完整性检查
+    if (!request.hasContentLength) {
+        respondError(400, "Bad Request", QStringLiteral("missing Content-Length"), corsOrigin);
+        return;
+    }
+
+    // 4) JSON 解析
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(body, &parseError);
+    if (parseError.error != QJsonParseError::NoError) {
+        qWarning() << "Failed to parse JSON from client:" << parseError.errorString();
+        respondError(400, "Bad Request", QStringLiteral("Invalid JSON"), corsOrigin);
+        return;
+    }
+    if (!doc.isObject()) {
+        respondError(400, "Bad Request", QStringLiteral("JSON is not an object"), corsOrigin);
+        return;
+    }
+
+    QString url, host, target, err;
+    if (!validateDownloadRequest(doc.object(), &url, &host, &target, &err)) {
+        qWarning() << "[HttpServer] download rejected:" << err;
+        respondError(400, "Bad Request", err, corsOrigin);
+        return;
+    }
+
+    // 5) 主机 SSRF 校验：异步解析（或命中缓存），结论出来后再响应并投递
+    QPointer<QTcpSocket> safeSocket(clientSocket);
+    beginPending(clientSocket);
+    HostGuard::instance().check(host, this, [this, safeSocket, corsOrigin, url, target, keepAlive]
+                                            (const HostVerdict& verdict) {
+        // 客户端已经断开：不投递。插件会把这次当作失败、让浏览器继续下载，投递会变成重复下载。
+        if (!safeSocket || safeSocket->state() != QAbstractSocket::ConnectedState) {
+            LOGD(QString("[HttpServer] 客户端在校验完成前断开，丢弃 %1").arg(url));
+            return;
+        }
+        if (!verdict.allowed) {
+            qWarning() << "[HttpServer] SSRF/url rejected:" << url << verdict.error;
+            completePending(safeSocket.data(),
+                buildHttpResponse(400, "Bad Request",
+                    jsonErrorBody(QStringLiteral("invalid url: %1").arg(verdict.error)),
+                    "application/json", corsOrigin),
+                keepAlive);
+            return;
+        }
+
+        LOGD(QString("[HttpServer] new download url=%1 target=%2").arg(url, target));
+        completePending(safeSocket.data(),
+            buildHttpResponse(200, "OK",
+                jsonOkBody(QStringLiteral("Download request received")),
+                "application/json", corsOrigin),
+            keepAlive);
+        emit newDownloadRequest(url, target, verdict.addresses);
+    });
 }
 
-bool HttpServer::processHttpRequest(QTcpSocket *clientSocket)
+// =========================================================================
+// POST /download/batch
+// =========================================================================
+void HttpServer::startBatchRequest(QTcpSocket *clientSocket, const QByteArray& body, const QByteArray& origin,
+                                   bool keepAlive)
 {
-    if (!clientSocket) return false;
-    auto bufIt = m_buffers.find(clientSocket);
-    if (bufIt == m_buffers.end()) return false;
-    QByteArray &buf = *bufIt;
-    if (buf.isEmpty()) return false;
+    auto reject = [this, clientSocket, &origin, keepAlive](int code, const QByteArray& reason, const QString& message) {
+        completePending(clientSocket,
+            buildHttpResponse(code, reason, jsonErrorBody(message), "application/json", origin),
+            keepAlive);
+    };
 
-    // 提取请求行 + 头
-    const int headerEnd = buf.indexOf("\r\n\r\n");
-    if (headerEnd < 0) return false;
-    const QByteArray headersBlock = buf.left(headerEnd);
-    const QList<QByteArray> headerLines = headersBlock.split('\n');
-    if (headerLines.isEmpty()) {
-        buf.clear();
-        return false;
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(body, &parseError);
+    if (parseError.error != QJsonParseError::NoError) {
+        qWarning() << "Failed to parse batch JSON from client:" << parseError.errorString();
+        reject(400, "Bad Request", QStringLiteral("Invalid JSON"));
+        return;
+    }
+    QJsonArray items;
+    if (doc.isArray()) {
+        items = doc.array();
+    } else if (doc.isObject() && doc.object().value(QStringLiteral("items")).isArray()) {
+        items = doc.object().value(QStringLiteral("items")).toArray();
+    } else {
+        reject(400, "Bad Request", QStringLiteral("expected an array or {\"items\": [...]}"));
+        return;
+    }
+    if (items.isEmpty()) {
+        reject(400, "Bad Request", QStringLiteral("empty batch"));
+        return;
+    }
+    if (items.size() > MAX_BATCH_ITEMS) {
+        reject(413, "Payload Too Large", QStringLiteral("too many items (max %1)").arg(MAX_BATCH_ITEMS));
+        return;
     }
 
-    const QByteArray requestLine = headerLines[0].trimmed();
-    const QList<QByteArray> requestParts = requestLine.split(' ');
-    if (requestParts.size() < 3) {
-        return writeAndMaybeClose(clientSocket,
-            buildHttpResponse(400, "Bad Request",
-                jsonErrorBody(QStringLiteral("Malformed request line")),
-                "application/json", QByteArray()),
-            /*closeAfter=*/true);
-    }
-    const QByteArray method = requestParts[0];
-    const QByteArray path   = requestParts[1];
-
-    LOGD(QString("HTTP Request - Method:%1 Path:%2").arg(QString::fromUtf8(method), QString::fromUtf8(path)));
-
-    // 抽取 Origin / Authorization / Content-Length
-    QByteArray origin, authHeader;
-    int contentLength = 0;
-    bool gotContentLength = false;
-    for (const QByteArray &rawLine : headerLines) {
-        const QByteArray line = rawLine.trimmed();
-        const int colon = line.indexOf(':');
-        if (colon < 0) continue;
-        const QByteArray name  = line.left(colon).trimmed();
-        const QByteArray value = line.mid(colon + 1).trimmed();
-        if (name.compare("Origin", Qt::CaseInsensitive) == 0) {
-            origin = value;
-        } else if (name.compare("Authorization", Qt::CaseInsensitive) == 0) {
-            authHeader = value;
-        } else if (name.compare("Content-Length", Qt::CaseInsensitive) == 0) {
-            bool ok = false;
-            int n = value.toInt(&ok);
-            if (!ok || n < 0 || n > MAX_BODY_SIZE) {
-                return writeAndMaybeClose(clientSocket,
-                    buildHttpResponse(413, "Payload Too Large",
-                        jsonErrorBody(QStringLiteral("Content-Length out of range")),
-                        "application/json", origin),
-                    /*closeAfter=*/true);
+    auto job = std::make_shared<BatchJob>();
+    job->socket = clientSocket;
+    job->origin = origin;
+    job->keepAlive = keepAlive;
+    job->entries.reserve(items.size());
+
+    // 同步部分：字段、URL 语法、文件名、批内去重；主机的 SSRF 校验交给 HostGuard
+    QSet<QString> seenUrls;
+    QSet<QString> pendingHosts;
+    for (const QJsonValue& item : std::as_const(items)) {
+        BatchJob::Entry entry;
+        QString filename, host, err;
+        if (item.isString()) {
+            entry.url = item.toString();
+        } else if (item.isObject()) {
+            const QJsonObject obj = item.toObject();
+            if (!extractStringField(obj, "url", &entry.url, &err, true)
+                || !extractStringField(obj, "filename", &filename, &err, false)
+                || !extractStringField(obj, "savePath", &entry.savePath, &err, false)) {
+                entry.error = err;
             }
-            contentLength = n;
-            gotContentLength = true;
+        } else {
+            entry.error = QStringLiteral("item must be a url string or an object");
         }
-    }
 
-    // 仅处理 POST /download 与 GET / 与 OPTIONS
-    if (method == "POST" && path == "/download") {
-        // 1) Origin
-        if (!originAllowed(origin)) {
-            qWarning() << "[HttpServer] rejected origin:" << origin;
-            return writeAndMaybeClose(clientSocket,
-                buildHttpResponse(403, "Forbidden",
-                    jsonErrorBody(QStringLiteral("origin not allowed")),
-                    "application/json", origin),
-                /*closeAfter=*/true);
+        if (entry.error.isEmpty() && !checkUrlSyntax(entry.url, &host, &err)) {
+            entry.error = QStringLiteral("invalid url: %1").arg(err);
+        }
+        if (entry.error.isEmpty() && !filename.isEmpty() && !isSafeFileName(filename, &err)) {
+            entry.error = QStringLiteral("invalid filename: %1").arg(err);
         }
+        if (entry.error.isEmpty() && seenUrls.contains(entry.url)) {
+            entry.error = QStringLiteral("duplicate url in batch");
+        }
+        if (entry.error.isEmpty()) {
+            seenUrls.insert(entry.url);
+            if (entry.savePath.isEmpty()) {
+                entry.savePath = filename;
+            }
+            entry.host = host;
+            pendingHosts.insert(host);
+        }
+        job->entries.append(entry);
+    }
+
+    if (pendingHosts.isEmpty()) {
+        finishBatch(job);
+        return;
+    }
+
+    // 每个主机只校验一次，全部并发（HostGuard 还会合并跨请求的同主机解析并缓存结论）。
+    // 先把所有主机登记为待定再发起：缓存命中会同步回调，不能让第一个结论就触发 finishBatch。
+    job->pendingHosts = pendingHosts;
+    LOGD(QString("[HttpServer] batch: %1 条，%2 个主机待校验").arg(job->entries.size()).arg(pendingHosts.size()));
+    for (const QString& host : std::as_const(pendingHosts)) {
+        HostGuard::instance().check(host, this, [this, job, host](const HostVerdict& verdict) {
+            onBatchHostChecked(job, host, verdict);
+        });
+    }
+}
 
-        // 2) Bearer token
-        const QByteArray presented = bearerFromAuthHeader(authHeader);
-        if (presented.isEmpty() || presented != HARDCODED_BEARER_TOKEN) {
-            qWarning() << "[HttpServer] rejected: missing/invalid bearer token";
-            return writeAndMaybeClose(clientSocket,
-                buildHttpResponse(401, "Unauthorized",
-                    jsonErrorBody(QStringLiteral("missing or invalid bearer token")),
-                    "application/json", origin),
-                /*closeAfter=*/true);
+void HttpServer::onBatchHostChecked(const std::shared_ptr<BatchJob>& job, const QString& host,
+                                    const HostVerdict& verdict)
+{
+    if (job->done || !job->pendingHosts.remove(host)) return;
+
+    for (BatchJob::Entry& entry : job->entries) {
+        if (entry.host != host || !entry.error.isEmpty()) continue;
+        if (verdict.allowed) {
+            entry.addresses = verdict.addresses;
+        } else {
+            entry.error = QStringLiteral("invalid url: %1").arg(verdict.error);
         }
+    }
+    if (job->pendingHosts.isEmpty()) {
+        finishBatch(job);
+    }
+}
 
-        // 3) body 完整性检查
-        if (!gotContentLength) {
-            return writeAndMaybeClose(clientSocket,
-                buildHttpResponse(400, "Bad Request",
-                    jsonErrorBody(QStringLiteral("missing Content-Length")),
-                    "application/json", origin),
-                /*closeAfter=*/true);
+void HttpServer::finishBatch(const std::shared_ptr<BatchJob>& job)
+{
+    job->done = true;
+
+    // 客户端已经断开：不入队。插件会把这批当作失败重发，入队会造成重复任务。
+    if (!job->socket || job->socket->state() != QAbstractSocket::ConnectedState) {
+        LOGD("[HttpServer] batch: 客户端已断开，丢弃本批");
+        return;
+    }
+
+    SettingsManager &settings = SettingsManager::instance();
+    const QString downloadDir = m_defaultDownloadDir.isEmpty()
+        ? settings.loadDefaultDownloadPath() : m_defaultDownloadDir;
+    const int threads = m_defaultThreads > 0 ? m_defaultThreads : settings.loadDefaultThreads();
+    SmallFileFetcher &fetcher = SmallFileFetcher::instance();
+
+    DownloadManager &manager = DownloadManager::instance();
+
+    QJsonArray results;
+    int accepted = 0;
+    // 不同 URL 解析出同一个文件名时会落到同一目标路径（快速通道互相覆盖，普通任务共用暂存分片），
+    // 按解析后的路径去重：批内与已有的活动任务、排队条目、快速通道请求都不能重叠
+    QSet<QString> seenPaths;
+    for (const BatchJob::Entry& entry : std::as_const(job->entries)) {
+        QJsonObject r;
+        r.insert(QStringLiteral("url"), entry.url);
+        QString error = entry.error;
+        const QUrl url(entry.url);
+        const QString finalSavePath = error.isEmpty()
+            ? DownloadManager::resolveSavePath(url, entry.savePath, downloadDir) : QString();
+        if (error.isEmpty() && seenPaths.contains(QDir::cleanPath(finalSavePath))) {
+            error = QStringLiteral("duplicate save path in batch: %1").arg(finalSavePath);
         }
-        const int bodyStart = headerEnd + 4;
-        if (buf.size() < bodyStart + contentLength) {
-            return writeAndMaybeClose(clientSocket,
-                buildHttpResponse(400, "Bad Request",
-                    jsonErrorBody(QStringLiteral("body shorter than Content-Length")),
-                    "application/json", origin),
-                /*closeAfter=*/true);
+        if (error.isEmpty() && (manager.isSavePathTaken(url, finalSavePath)
+                                || fetcher.isPathPending(url, finalSavePath))) {
+            error = QStringLiteral("save path already in use: %1").arg(finalSavePath);
         }
-        QByteArray body = buf.mid(bodyStart, contentLength);
+        if (error.isEmpty()) {
+            seenPaths.insert(QDir::cleanPath(finalSavePath));
+            // 批量投递多是大量小文件：先走快速通道，不是小文件时它会自己转为普通任务，
+            // 所以这里没有任务 id 可以返回
+            fetcher.fetch(url, finalSavePath, threads, entry.addresses);
+            r.insert(QStringLiteral("status"), QStringLiteral("queued"));
+            r.insert(QStringLiteral("filePath"), finalSavePath);
+            ++accepted;
+        }
+        if (!error.isEmpty()) {
+            r.insert(QStringLiteral("status"), QStringLiteral("rejected"));
+            r.insert(QStringLiteral("error"), error);
+        }
+        results.append(r);
+    }
+    const int rejected = job->entries.size() - accepted;
+    LOGD(QString("[HttpServer] batch: 入队 %1 条，拒绝 %2 条").arg(accepted).arg(rejected));
 
-        // 4) JSON 解析
-        QJsonParseError parseError;
-        QJsonDocument doc = QJsonDocument::fromJson(body, &parseError);
-        if (parseError.error != QJsonParseError::NoError) {
-            qWarning() << "Failed to parse JSON from client:" << parseError.errorString();
-            return writeAndMaybeClose(clientSocket,
-                buildHttpResponse(400, "Bad Request",
-                    jsonErrorBody(QStringLiteral("Invalid JSON")),
-                    "application/json", origin),
-                /*closeAfter=*/true);
+    QJsonObject o;
+    o.insert(QStringLiteral("status"),   QStringLiteral("success"));
+    o.insert(QStringLiteral("accepted"), accepted);
+    o.insert(QStringLiteral("rejected"), rejected);
+    o.insert(QStringLiteral("results"),  results);
+    completePending(job->socket.data(),
+        buildHttpResponse(200, "OK", QJsonDocument(o).toJson(QJsonDocument::Compact),
+                          "application/json", job->origin),
+        job->keepAlive);
+
+    emit batchDownloadQueued(accepted, rejected);
+}
+
+QByteArray HttpServer::handleTaskRequest(const QByteArray& method, const QStringList& segments,
+                                         const QByteArray& body, const QByteArray& origin)
+{
+    DownloadManager &manager = DownloadManager::instance();
+
+    // GET /tasks
+    if (segments.size() == 1) {
+        if (method != "GET") {
+            return buildHttpResponse(405, "Method Not Allowed",
+                jsonErrorBody(QStringLiteral("method not allowed")), "application/json", origin);
         }
-        if (!doc.isObject()) {
-            return writeAndMaybeClose(clientSocket,
-                buildHttpResponse(400, "Bad Request",
-                    jsonErrorBody(QStringLiteral("JSON is not an object")),
-                    "application/json", origin),
-                /*closeAfter=*/true);
+        QJsonArray list;
+        const QList<DownloadTask*> tasks = manager.tasks();
+        for (const DownloadTask *task : tasks) {
+            if (task) list.append(taskToJson(task));
+        }
+        const QList<QueuedTask> queued = manager.queuedTasks();
+        for (const QueuedTask &entry : queued) {
+            list.append(queuedToJson(entry));
         }
+        QJsonObject o;
+        o.insert(QStringLiteral("status"), QStringLiteral("success"));
+        o.insert(QStringLiteral("tasks"),  list);
+        return buildHttpResponse(200, "OK",
+            QJsonDocument(o).toJson(QJsonDocument::Compact), "application/json", origin);
+    }
 
-        QJsonObject obj = doc.object();
-        QString url, filename, savePath, err;
-        if (!extractStringField(obj, "url", &url, &err, true)) {
-            return writeAndMaybeClose(clientSocket,
-                buildHttpResponse(400, "Bad Request",
-                    jsonErrorBody(err), "application/json", origin),
-                /*closeAfter=*/true);
+    bool idOk = false;
+    const quint64 id = segments.at(1).toULongLong(&idOk);
+    DownloadTask *task = idOk ? manager.findTask(id) : nullptr;
+    // 还在 DownloadManager 队列里的条目没有任务对象，用描述符应答
+    QueuedTask queued;
+    const bool isQueued = !task && idOk && manager.findQueued(id, &queued);
+    if ((!task && !isQueued) || segments.size() > 3) {
+        return buildHttpResponse(404, "Not Found",
+            jsonErrorBody(QStringLiteral("no such task")), "application/json", origin);
+    }
+
+    // GET /tasks/<id>
+    if (segments.size() == 2) {
+        if (method != "GET") {
+            return buildHttpResponse(405, "Method Not Allowed",
+                jsonErrorBody(QStringLiteral("method not allowed")), "application/json", origin);
         }
-        if (!isValidDownloadUrl(url, &err)) {
-            qWarning() << "[HttpServer] SSRF/url rejected:" << url << err;
-            return writeAndMaybeClose(clientSocket,
-                buildHttpResponse(400, "Bad Request",
-                    jsonErrorBody(QStringLiteral("invalid url: %1").arg(err)),
-                    "application/json", origin),
-                /*closeAfter=*/true);
+        return buildHttpResponse(200, "OK", task ? jsonTaskBody(task) : jsonTaskBody(queuedToJson(queued)),
+                                 "application/json", origin);
+    }
+
+    // POST /tasks/<id>/<action>
+    if (method != "POST") {
+        return buildHttpResponse(405, "Method Not Allowed",
+            jsonErrorBody(QStringLiteral("method not allowed")), "application/json", origin);
+    }
+
+    // 请求体可选；有就必须是 JSON 对象
+    QJsonObject params;
+    if (!body.trimmed().isEmpty()) {
+        QJsonParseError parseError;
+        const QJsonDocument doc = QJsonDocument::fromJson(body, &parseError);
+        if (parseError.error != QJsonParseError::NoError || !doc.isObject()) {
+            return buildHttpResponse(400, "Bad Request",
+                jsonErrorBody(QStringLiteral("Invalid JSON")), "application/json", origin);
         }
-        if (!extractStringField(obj, "filename", &filename, &err, false)) {
-            return writeAndMaybeClose(clientSocket,
-                buildHttpResponse(400, "Bad Request",
-                    jsonErrorBody(err), "application/json", origin),
-                /*closeAfter=*/true);
+        params = doc.object();
+    }
+
+    const QString action = segments.at(2);
+    auto readPriority = [&](int* out) {
+        const QJsonValue priority = params.value(QStringLiteral("priority"));
+        if (!priority.isDouble() || priority.toDouble() != double(priority.toInt())) {
+            return false;
         }
-        if (!filename.isEmpty() && !isSafeFileName(filename, &err)) {
-            return writeAndMaybeClose(clientSocket,
-                buildHttpResponse(400, "Bad Request",
-                    jsonErrorBody(QStringLiteral("invalid filename: %1").arg(err)),
-                    "application/json", origin),
-                /*closeAfter=*/true);
+        *out = priority.toInt();
+        return true;
+    };
+    auto badPriority = [&]() {
+        return buildHttpResponse(400, "Bad Request",
+            jsonErrorBody(QStringLiteral("field 'priority' must be an integer")), "application/json", origin);
+    };
+
+    // 排队条目：只能取消（直接出队，没有文件要清理）或调整优先级（改变出队顺序）
+    if (isQueued) {
+        if (action == QLatin1String("cancel")) {
+            manager.cancelQueued(id);
+            QJsonObject o = queuedToJson(queued);
+            o.insert(QStringLiteral("status"), QStringLiteral("cancelled"));
+            LOGD(QString("[HttpServer] queued task %1 cancel").arg(id));
+            return buildHttpResponse(200, "OK", jsonTaskBody(o), "application/json", origin);
         }
-        if (!extractStringField(obj, "savePath", &savePath, &err, false)) {
-            return writeAndMaybeClose(clientSocket,
-                buildHttpResponse(400, "Bad Request",
-                    jsonErrorBody(err), "application/json", origin),
-                /*closeAfter=*/true);
+        if (action == QLatin1String("priority")) {
+            int priority = 0;
+            if (!readPriority(&priority)) return badPriority();
+            manager.setQueuedPriority(id, priority);
+            queued.priority = priority;
+            LOGD(QString("[HttpServer] queued task %1 priority").arg(id));
+            return buildHttpResponse(200, "OK", jsonTaskBody(queuedToJson(queued)), "application/json", origin);
         }
+        if (action == QLatin1String("pause") || action == QLatin1String("resume")) {
+            return buildHttpResponse(409, "Conflict",
+                jsonErrorBody(QStringLiteral("cannot %1 a task that is queued").arg(action)),
+                "application/json", origin);
+        }
+        return buildHttpResponse(404, "Not Found",
+            jsonErrorBody(QStringLiteral("unknown action")), "application/json", origin);
+    }
 
-        LOGD(QString("[HttpServer] new download url=%1 filename=%2").arg(url, filename));
-        emit newDownloadRequest(url, savePath.isEmpty() ? filename : savePath);
+    const DownloadTaskStatus current = task->status();
+    auto conflict = [&]() {
+        return buildHttpResponse(409, "Conflict",
+            jsonErrorBody(QStringLiteral("cannot %1 a task that is %2").arg(action, statusName(current))),
+            "application/json", origin);
+    };
 
-        // 成功响应后关闭连接（每个浏览器插件请求都是独立 connection）
-        return writeAndMaybeClose(clientSocket,
-            buildHttpResponse(200, "OK",
-                jsonOkBody(QStringLiteral("Download request received")),
-                "application/json", origin),
-            /*closeAfter=*/true);
-    } else if (method == "GET" && path == "/") {
-        const QByteArray body = "Downloader HTTP Server is running";
-        return writeAndMaybeClose(clientSocket,
-            buildHttpResponse(200, "OK", body, "text/plain", origin),
-            /*closeAfter=*/true);
-    } else if (method == "OPTIONS") {
-        // CORS preflight
-        if (!originAllowed(origin)) {
-            return writeAndMaybeClose(clientSocket,
-                buildHttpResponse(403, "Forbidden",
-                    jsonErrorBody(QStringLiteral("origin not allowed")),
-                    "application/json", origin),
-                /*closeAfter=*/true);
+    // 状态检查只做预判给出 409；真正的转换仍由任务的 CAS 状态机裁决
+    if (action == QLatin1String("pause")) {
+        if (!DownloadTask::isLegalTransition(current, DownloadTaskStatus::Paused)) return conflict();
+        manager.pauseTask(task);
+    } else if (action == QLatin1String("resume")) {
+        if (current != DownloadTaskStatus::Paused && current != DownloadTaskStatus::Failed) return conflict();
+        manager.resumeTask(task);
+    } else if (action == QLatin1String("cancel")) {
+        if (!DownloadTask::isLegalTransition(current, DownloadTaskStatus::Cancelled)) return conflict();
+        const QJsonValue deleteFiles = params.value(QStringLiteral("deleteFiles"));
+        if (!deleteFiles.isUndefined() && !deleteFiles.isBool()) {
+            return buildHttpResponse(400, "Bad Request",
+                jsonErrorBody(QStringLiteral("field 'deleteFiles' must be a boolean")), "application/json", origin);
         }
-        QByteArray headers;
-        headers += "HTTP/1.1 204 No Content\r\n";
-        headers += "Access-Control-Allow-Origin: "  + origin + "\r\n";
-        headers += "Access-Control-Allow-Methods: POST, OPTIONS\r\n";
-        headers += "Access-Control-Allow-Headers: Authorization, Content-Type\r\n";
-        headers += "Access-Control-Max-Age: 300\r\n";
-        headers += "Vary: Origin\r\n";
-        headers += "Content-Length: 0\r\n";
-        headers += "Connection: close\r\n\r\n";
-        return writeAndMaybeClose(clientSocket, headers, /*closeAfter=*/true);
-    } else if (method != "POST" && method != "GET" && method != "OPTIONS") {
-        return writeAndMaybeClose(clientSocket,
-            buildHttpResponse(405, "Method Not Allowed",
-                jsonErrorBody(QStringLiteral("method not allowed")),
-                "application/json", origin),
-            /*closeAfter=*/true);
+        manager.cancelTask(task, deleteFiles.toBool(true));
+    } else if (action == QLatin1String("priority")) {
+        int priority = 0;
+        if (!readPriority(&priority)) return badPriority();
+        manager.setTaskPriority(task, priority);
     } else {
-        return writeAndMaybeClose(clientSocket,
-            buildHttpResponse(404, "Not Found",
-                jsonErrorBody(QStringLiteral("not found")),
-                "application/json", origin),
-            /*closeAfter=*/true);
+        return buildHttpResponse(404, "Not Found",
+            jsonErrorBody(QStringLiteral("unknown action")), "application/json", origin);
     }
+
+    LOGD(QString("[HttpServer] task %1 %2").arg(id).arg(action));
+    // 暂停/取消不阻塞，响应里的状态可能仍是转换前的；最终状态看 /events 或再查一次
+    return buildHttpResponse(200, "OK", jsonTaskBody(task), "application/json", origin);
 }
 
-#endif // !USE_QHTTPSERVER
\ No newline at end of file
+// =========================================================================
+// /events 事件流
+// =========================================================================
+void HttpServer::openEventStream(QTcpSocket *clientSocket, const QByteArray& origin)
+{
+    // 连接不再解析请求：停掉空闲超时（由心跳保活），移出请求缓冲
+    QTimer *idleTimer = m_idleTimers.take(clientSocket);
+    if (idleTimer) {
+        idleTimer->stop();
+        idleTimer->deleteLater();
+    }
+    m_clients.remove(clientSocket);
+
+    QByteArray head;
+    head += "HTTP/1.1 200 OK\r\n";
+    head += "Content-Type: text/event-stream\r\n";
+    head += "Cache-Control: no-cache\r\n";
+    head += "Connection: keep-alive\r\n";
+    if (!origin.isEmpty()) {
+        head += "Access-Control-Allow-Origin: " + origin + "\r\n";
+        head += "Vary: Origin\r\n";
+    }
+    head += "\r\n";
+    // 断线后浏览器 2 秒后自动重连
+    head += "retry: 2000\n\n";
+
+    // 初始快照：订阅者先拿到完整状态（与 GET /tasks 相同，含排队条目），之后只收增量
+    QJsonArray list;
+    const DownloadManager &manager = DownloadManager::instance();
+    const QList<DownloadTask*> tasks = manager.tasks();
+    for (const DownloadTask *task : tasks) {
+        if (task) list.append(taskToJson(task));
+    }
+    const QList<QueuedTask> queued = manager.queuedTasks();
+    for (const QueuedTask &entry : queued) {
+        list.append(queuedToJson(entry));
+    }
+    QJsonObject snapshot;
+    snapshot.insert(QStringLiteral("tasks"), list);
+    head += sseFrame("snapshot", snapshot);
+    clientSocket->write(head);
+
+    m_eventClients.insert(clientSocket);
+    if (!m_eventHeartbeat.isActive()) {
+        m_eventHeartbeat.start();
+    }
+    LOGD(QString("[HttpServer] /events 订阅者 +1，当前 %1").arg(m_eventClients.size()));
+}
+
+void HttpServer::broadcastEvent(const QByteArray& frame)
+{
+    // 迭代副本：踢出慢订阅者会修改集合
+    const QSet<QTcpSocket*> clients = m_eventClients;
+    for (QTcpSocket *clientSocket : clients) {
+        if (clientSocket->bytesToWrite() > MAX_EVENT_BACKLOG) {
+            qWarning() << "[HttpServer] event subscriber too slow, dropping:" << clientSocket->peerAddress().toString();
+            removeEventSubscriber(clientSocket);
+            clientSocket->disconnect(this);
+            clientSocket->abort();
+            clientSocket->deleteLater();
+            continue;
+        }
+        clientSocket->write(frame);
+    }
+}
+
+void HttpServer::removeEventSubscriber(QTcpSocket *clientSocket)
+{
+    if (m_eventClients.remove(clientSocket)) {
+        LOGD(QString("[HttpServer] /events 订阅者 -1，当前 %1").arg(m_eventClients.size()));
+        if (m_eventClients.isEmpty()) {
+            m_eventHeartbeat.stop();
+        }
+    }
+}
+
+void HttpServer::onTelemetryUpdated(const QList<TaskTelemetry>& snapshot)
+{
+    if (m_eventClients.isEmpty()) return; // 没人订阅就不序列化
+
+    QJsonArray list;
+    for (const TaskTelemetry &sample : snapshot) {
+        if (sample.task) list.append(telemetryToJson(sample));
+    }
+    QJsonObject o;
+    o.insert(QStringLiteral("tasks"), list);
+    broadcastEvent(sseFrame("progress", o));
+}
+
+void HttpServer::onTaskAdded(DownloadTask* task)
+{
+    if (m_eventClients.isEmpty() || !task) return;
+    broadcastEvent(sseFrame("added", taskToJson(task)));
+}
+
+void HttpServer::onTaskFinished(DownloadTask* task)
+{
+    if (m_eventClients.isEmpty() || !task) return;
+    QJsonObject o;
+    o.insert(QStringLiteral("id"),     QString::number(task->id()));
+    o.insert(QStringLiteral("status"), statusName(task->status()));
+    broadcastEvent(sseFrame("finished", o));
+}
+
+void HttpServer::onTaskError(DownloadTask* task, const QString& errorString)
+{
+    if (m_eventClients.isEmpty() || !task) return;
+    QJsonObject o;
+    o.insert(QStringLiteral("id"),      QString::number(task->id()));
+    o.insert(QStringLiteral("status"),  statusName(DownloadTaskStatus::Failed));
+    o.insert(QStringLiteral("message"), errorString);
+    broadcastEvent(sseFrame("failed", o));
+}
+
+void HttpServer::onEventHeartbeat()
+{
+    // SSE 注释行，客户端忽略
+    broadcastEvent(QByteArrayLiteral(": keepalive\n\n"));
+}
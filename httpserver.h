@@ -2,24 +2,50 @@
 #define HTTPSERVER_H
 
 #include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QStringList>
+#include <QTimer>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonParseError>
-
-// 尝试包含QHttpServer（需要Qt 6.4+）
-#ifdef QT_HTTPSERVER_LIB
-#include <QHttpServer>
-#define USE_QHTTPSERVER 1
-#else
-// 如果QHttpServer不可用，使用QTcpServer手动处理HTTP请求
 #include <QTcpServer>
 #include <QTcpSocket>
-#define USE_QHTTPSERVER 0
-#endif
+#include <QHostAddress>
+#include <memory>
+#include "httprequestparser.h"
+
+class DownloadTask;
+struct TaskTelemetry;
+struct HostVerdict;
 
 /**
  * @brief HttpServer类用于创建一个本地HTTP服务器，监听特定端口。
- * 主要用于接收来自浏览器插件的下载请求。
+ *
+ * 接口（仅监听 127.0.0.1）：
+ *  - POST /download                    浏览器插件投递下载（需允许的 Origin + bearer token）
+ *  - POST /download/batch              批量投递：交给小文件快速通道（SmallFileFetcher，大文件自动转为普通任务），逐条返回结果
+ *  - GET  /tasks                       列出活动任务与排队条目（排队条目 status 为 queued，没有进度字段）
+ *  - GET  /tasks/<id>                  查看单个任务
+ *  - POST /tasks/<id>/pause|resume|cancel|priority   控制任务（排队条目只能 cancel / priority）
+ *  - GET  /events                      Server-Sent Events 进度流
+ *  - GET  / 、GET /status              存活检查（无需认证）
+ *
+ * 控制接口与 /events 都要求 SettingsManager::bearerToken()：放在 Authorization: Bearer 头里；
+ * EventSource 不能自定义请求头，/events 也接受 ?token= 查询参数。带 Origin 的请求（浏览器）
+ * 还必须来自允许的扩展 origin，普通网页无法借用户的浏览器操作本地下载器。
+ *
+ * /events 订阅 DownloadManager::telemetryUpdated：每个遥测周期只序列化一次，同一帧写给所有订阅者；
+ * 没有订阅者时不做任何序列化。写缓冲积压过多的慢订阅者直接断开，不拖累其他人。
+ *
+ * 连接是 HTTP/1.1 keep-alive：每个连接一个增量解析器（HttpRequestParser），支持 pipelining，
+ * 响应严格按请求顺序写出（异步校验中的请求之后的请求先排队）；单连接最多 MAX_REQUESTS_PER_CONN 个请求，
+ * 空闲 IDLE_TIMEOUT_MS 后断开。
+ *
+ * /download 与 /download/batch 的主机 SSRF 校验走 HostGuard：异步解析、结论带 TTL 缓存，
+ * 响应在结论出来后才写出，等待期间事件循环不被阻塞。校验过的地址随任务一起下发，
+ * 下载引擎连接的就是被检查过的 IP。批量请求按去重后的主机并发校验，全部有结论后一次性建任务。
  */
 class HttpServer : public QObject
 {
@@ -45,13 +71,36 @@ public:
      */
     void stopServer();
 
+    /**
+     * @brief 设置批量投递使用的默认下载目录与线程数（downloaderd 的命令行覆盖）。
+     * @param downloadDir 默认目录；为空时取 SettingsManager 的下载目录。
+     * @param threads 每任务线程数；<= 0 时取 SettingsManager 的默认线程数。
+     */
+    void setDownloadDefaults(const QString& downloadDir, int threads);
+
+    /**
+     * @brief 校验一条单文件投递（{url, filename, savePath}）的字段、URL 语法与文件名，不含主机 SSRF 校验。
+     *
+     * POST /download 与原生消息通道（SingleInstance 转来的 JSON 请求）共用；通过后由调用方
+     * 交给 HostGuard 校验主机，再发起下载。
+     * @param obj 请求对象。
+     * @param urlOut 下载 URL。
+     * @param hostOut URL 中的主机。
+     * @param targetOut 建议的保存路径：savePath 优先，否则为 filename（可能为空）。
+     * @param errorOut 失败原因。
+     * @return 校验通过返回 true。
+     */
+    static bool validateDownloadRequest(const QJsonObject& obj, QString* urlOut, QString* hostOut,
+                                        QString* targetOut, QString* errorOut);
+
 signals:
     /**
      * @brief 当接收到新的下载请求时，发射此信号。
      * @param url 文件的URL。
      * @param savePath 建议的保存路径（可能为空，为空时使用下载器的默认路径）。
+     * @param addresses SSRF 校验过的地址，创建任务后交给 DownloadTask::setPinnedAddresses。
      */
-    void newDownloadRequest(const QString& url, const QString& savePath);
+    void newDownloadRequest(const QString& url, const QString& savePath, const QList<QHostAddress>& addresses);
 
     /**
      * @brief 当服务器启动失败时，发射此信号。
@@ -64,8 +113,14 @@ signals:
      */
     void serverStarted();
 
+    /**
+     * @brief 一次批量投递处理完毕（任务已经入队，不逐条弹窗）。
+     * @param accepted 成功入队的条数。
+     * @param rejected 被拒绝的条数。
+     */
+    void batchDownloadQueued(int accepted, int rejected);
+
 private slots:
-#if !USE_QHTTPSERVER
     /**
      * @brief 处理新的客户端连接。
      */
@@ -82,30 +137,140 @@ private slots:
     void onClientDisconnected();
 
     /**
-     * @brief 解析HTTP请求并发送响应。
-     * @param clientSocket 客户端套接字（buffer 由 m_buffers 取）。
-     * @return true 表示本次请求已发出响应，调用方可以继续消费 pipeline 后续请求；
-     *         false 表示已经安排关闭连接，调用方应停止继续读 buffer。
+     * @brief 遥测周期：序列化一次进度快照并推给所有 /events 订阅者。
+     * @param snapshot DownloadManager 本周期的采样结果。
+     */
+    void onTelemetryUpdated(const QList<TaskTelemetry>& snapshot);
+
+    /**
+     * @brief 任务加入：推送 added 事件。
+     */
+    void onTaskAdded(DownloadTask* task);
+
+    /**
+     * @brief 任务完成或取消：推送 finished 事件。
+     */
+    void onTaskFinished(DownloadTask* task);
+
+    /**
+     * @brief 任务失败：推送 failed 事件。
      */
-    bool processHttpRequest(QTcpSocket *clientSocket);
-#endif
+    void onTaskError(DownloadTask* task, const QString& errorString);
+
+    /**
+     * @brief 定时给订阅者写注释行，防止空闲时被代理或浏览器判定断流。
+     */
+    void onEventHeartbeat();
 
 private:
-#if USE_QHTTPSERVER
-    QHttpServer* m_httpServer;            ///< HTTP服务器实例。
-    QTcpServer*  m_listenServer = nullptr; ///< 实际监听的QTcpServer，由startServer创建/释放。
-#else
-    QTcpServer*  m_tcpServer = nullptr;    ///< TCP服务器实例（fallback实现）。
-    QHash<QTcpSocket*, QByteArray> m_buffers; ///< 每个客户端的累积缓冲区。
+    /**
+     * @brief 依次处理缓冲中已经完整的请求，直到数据不够、连接关闭或有请求在等异步响应。
+     */
+    void drainRequests(QTcpSocket *clientSocket);
+
+    /**
+     * @brief 处理一个完整请求并发送响应（或安排异步响应 / 转为事件流）。
+     * @param clientSocket 客户端套接字。
+     * @param request 请求视图（指向连接缓冲，只在本次调用期间有效）。
+     * @param keepAlive 响应后是否保持连接。
+     */
+    void processHttpRequest(QTcpSocket *clientSocket, const HttpRequestView& request, bool keepAlive);
+
+    /**
+     * @brief 写出响应；keepAlive 为 false 时标记连接关闭并在写完后断开。
+     */
+    void sendResponse(QTcpSocket *clientSocket, const QByteArray& response, bool keepAlive);
+
+    /**
+     * @brief 当前请求的响应要异步写出：暂停解析同一连接上 pipeline 的后续请求。
+     */
+    void beginPending(QTcpSocket *clientSocket);
+
+    /**
+     * @brief 写出异步响应并恢复解析；连接已断开时什么都不做。
+     */
+    void completePending(QTcpSocket *clientSocket, const QByteArray& response, bool keepAlive);
+
+    /**
+     * @brief 处理 /tasks 控制接口（认证已通过）。
+     * @param method 请求方法。
+     * @param segments 路径分段（首段为 "tasks"）。
+     * @param body 请求体。
+     * @param origin 请求的 Origin（回显到 CORS 头）。
+     * @return 完整的 HTTP 响应。
+     */
+    QByteArray handleTaskRequest(const QByteArray& method, const QStringList& segments,
+                                 const QByteArray& body, const QByteArray& origin);
+
+    struct BatchJob;
+
+    /**
+     * @brief 处理 POST /download/batch（认证已通过）：解析、同步校验，并为每个主机发起 HostGuard 校验。
+     * @param clientSocket 客户端套接字，响应在校验完成后写出。
+     * @param body 请求体：{"items": [...]} 或直接是数组；元素为 URL 字符串或 {url, filename, savePath}。
+     * @param origin 请求的 Origin（回显到 CORS 头）。
+     * @param keepAlive 响应后是否保持连接。
+     */
+    void startBatchRequest(QTcpSocket *clientSocket, const QByteArray& body, const QByteArray& origin,
+                           bool keepAlive);
+
+    /**
+     * @brief 批量请求的一个主机有了 SSRF 结论：写入该主机下所有条目。
+     */
+    void onBatchHostChecked(const std::shared_ptr<BatchJob>& job, const QString& host, const HostVerdict& verdict);
+
+    /**
+     * @brief 批量请求全部有结论：建任务、入队并写出逐条结果。
+     */
+    void finishBatch(const std::shared_ptr<BatchJob>& job);
+
+    /**
+     * @brief 把连接转为 /events 事件流：写响应头与初始快照，之后只由广播写入。
+     * @param clientSocket 客户端套接字。
+     * @param origin 请求的 Origin（回显到 CORS 头）。
+     */
+    void openEventStream(QTcpSocket *clientSocket, const QByteArray& origin);
+
+    /**
+     * @brief 把同一帧写给所有订阅者；积压超过 MAX_EVENT_BACKLOG 的订阅者被断开。
+     * @param frame 已编码好的 SSE 帧。
+     */
+    void broadcastEvent(const QByteArray& frame);
+
+    /**
+     * @brief 移除订阅者（断开或被踢出），最后一个离开时停掉心跳。
+     */
+    void removeEventSubscriber(QTcpSocket *clientSocket);
+
+    QTcpServer*  m_tcpServer = nullptr;    ///< TCP服务器实例。
+    /**
+     * @brief 一个请求/响应模式连接的状态（转为事件流后移出）。
+     */
+    struct ClientConnection {
+        QByteArray buffer;            ///< 接收缓冲；readPos 之前的字节已经消费。
+        qsizetype readPos = 0;        ///< 下一个请求在 buffer 中的起点。
+        HttpRequestParser parser;     ///< 当前请求的增量解析状态。
+        int served = 0;               ///< 已处理的请求数。
+        bool pending = false;         ///< 有请求在等异步响应。
+        bool closing = false;         ///< 已安排关闭，不再处理后续请求。
+    };
+
+    QHash<QTcpSocket*, ClientConnection> m_clients; ///< 请求/响应模式的连接。
     QHash<QTcpSocket*, QTimer*>    m_idleTimers; ///< 每个客户端的空闲超时定时器。
-#endif
+    QSet<QTcpSocket*> m_eventClients;      ///< /events 订阅者（连接不再解析请求，只接收推送）。
+    QTimer m_eventHeartbeat;               ///< 订阅者心跳定时器（有订阅者时才运行）。
+    QString m_defaultDownloadDir;          ///< 批量投递的默认目录覆盖（空则取设置）。
+    int m_defaultThreads = 0;              ///< 批量投递的线程数覆盖（<= 0 则取设置）。
 
-    // 大小常量（fallback实现使用）
-    static constexpr int MAX_BODY_SIZE     = 1 * 1024 * 1024;   ///< 请求体上限 1 MiB
-    static constexpr int MAX_BUFFER_SIZE   = 2 * 1024 * 1024;   ///< 客户端累积缓冲上限 2 MiB
-    static constexpr int IDLE_TIMEOUT_MS   = 30 * 1000;         ///< 慢速客户端 30s 空闲超时
-    static constexpr int CLOSE_GRACE_MS    = 100;               ///< bytesWritten 之后的优雅断开延迟
+    // 大小常量
+    static constexpr int MAX_BUFFER_SIZE   = 2 * 1024 * 1024;   ///< 单连接未消费字节上限 2 MiB（含 pipeline 排队的请求）
+    static constexpr int IDLE_TIMEOUT_MS   = 30 * 1000;         ///< 慢速/空闲 keep-alive 连接 30s 超时
+    static constexpr int MAX_REQUESTS_PER_CONN = 100;           ///< 单连接请求数上限，之后响应带 Connection: close
     static constexpr int MAX_PENDING_CONNS = 64;                ///< Slowloris 防御
+    static constexpr int MAX_EVENT_CLIENTS = 32;                ///< /events 同时订阅者上限
+    static constexpr qint64 MAX_EVENT_BACKLOG = 1 * 1024 * 1024; ///< 订阅者未发出数据上限，超过即断开
+    static constexpr int EVENT_HEARTBEAT_MS = 15 * 1000;        ///< 事件流心跳间隔
+    static constexpr int MAX_BATCH_ITEMS   = 1000;              ///< 单次批量投递的条目上限
 };
 
-#endif // HTTPSERVER_H
\ No newline at end of file
+#endif // HTTPSERVER_H
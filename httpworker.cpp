@@ -2,8 +2,13 @@
 #include "logger.h"
 #include <QTimer>
 #include <QThread>
-#include <QApplication>
+#include <QCoreApplication>
 #include <QPointer>
+#include <QtEndian>
+#include <QThreadPool>
+#include "crc32c.h"
+#include "hostguard.h"
+#include "hostprofilestore.h"
 
 /**
  * @brief HTTP下载工作线程构造函数
@@ -53,7 +58,7 @@ void HttpWorker::reset()
     m_alreadyFinished = false;
     m_resumeOffset = 0;
     m_bytesReceived.store(0, std::memory_order_release);
-    m_progressAccumulator = 0;
+    resetIntegrity(false);  // 续传时由 verifyResumeTail() 按磁盘内容重建 CRC 状态
     LOGD(QString("重置HttpWorker状态 - 文件:%1 范围:%2-%3")
          .arg(m_filePath).arg(m_startPoint).arg(m_endPoint));
 }
@@ -84,6 +89,7 @@ HttpWorker::~HttpWorker()
         delete m_file;
         m_file = nullptr;
     }
+    resetIntegrity(false);
     if (m_netManager) {
         LOGD("标记网络管理器为延迟删除");
         m_netManager->deleteLater();
@@ -100,8 +106,13 @@ void HttpWorker::run()
          .arg(QString::number(reinterpret_cast<quintptr>(QThread::currentThread()), 16))
          .arg(QString::number(reinterpret_cast<quintptr>(qApp->thread()), 16)));
 
+    // Queued→Running；失败说明排队期间已被 stop() 标为 Stopping，下面的停止检查会直接退出
+    int expected = RunQueued;
+    m_runState.compare_exchange_strong(expected, RunRunning, std::memory_order_acq_rel);
+
     if (m_isStopped) {
         LOGD("任务已停止，直接退出run方法");
+        leaveRun();
         return;
     }
 
@@ -120,16 +131,83 @@ void HttpWorker::run()
     startDownload();
     LOGD("startDownload()调用完成，进入事件循环");
 
-    // exec() 阻塞到 quitLoop() 调用。stop() 走 BlockingQueuedConnection 时会
-    // 在 worker 线程同步调 quitLoop()，所以这个 exec 会从 stop 路径返回。
+    // exec() 阻塞到 quitLoop() 调用。stop() 投递到 worker 线程的 abort 会经
+    // onErrorOccurred 的停止分支 quitLoop()，所以这个 exec 会从 stop 路径返回。
     m_loop->exec();
     LOGD("事件循环退出");
 
     delete m_loop;
     m_loop = nullptr;
+    leaveRun();
     LOGD("HttpWorker::run 退出");
 }
 
+void HttpWorker::leaveRun()
+{
+    // 进程退出阶段 QCoreApplication 已析构，没有主线程事件循环可投递，保持现状即可
+    QCoreApplication* app = QCoreApplication::instance();
+    if (!app) {
+        return;
+    }
+    // 亲和切回主线程：之后的 reset/submit/stop/deleteLater 都在主线程进行，
+    // 不会再把事件投递到一个没有事件循环的线程池线程上。
+    if (thread() != app->thread()) {
+        moveToThread(app->thread());
+    }
+    // 运行状态保持 Running/Stopping，直到主线程处理这条事件：在那之前主线程
+    // 不会重新提交或删除本对象，这里之后 worker 线程也不再访问 this。
+    QMetaObject::invokeMethod(this, [this]() { onRunExited(); }, Qt::QueuedConnection);
+}
+
+void HttpWorker::onRunExited()
+{
+    const int previous = m_runState.exchange(RunIdle, std::memory_order_acq_rel);
+    if (previous != RunStopping) {
+        return;
+    }
+    LOGD(QString("worker已确认停止 - 文件:%1").arg(m_filePath));
+    emit stopped();
+    if (m_deleteWhenStopped) {
+        deleteLater();
+    }
+}
+
+void HttpWorker::submit(QThreadPool* pool, int priority)
+{
+    m_pool = pool;
+    m_runState.store(RunQueued, std::memory_order_release);
+    pool->start(this, priority);
+}
+
+void HttpWorker::reprioritize(int priority)
+{
+    // tryTake 成功说明 run() 还没开始，状态保持 Queued，直接按新优先级放回队列
+    if (m_runState.load(std::memory_order_acquire) == RunQueued && m_pool && m_pool->tryTake(this)) {
+        m_pool->start(this, priority);
+    }
+}
+
+void HttpWorker::setPinnedAddresses(const QString& host, const QList<QHostAddress>& addresses)
+{
+    m_pinnedHost = host;
+    m_pinnedAddresses = addresses;
+}
+
+void HttpWorker::setTransferHints(int transferTimeoutMs, qint64 readBufferBytes)
+{
+    m_transferTimeoutMs = transferTimeoutMs;
+    m_readBufferBytes = readBufferBytes;
+}
+
+void HttpWorker::stopAndDeleteLater()
+{
+    m_deleteWhenStopped = true;
+    if (!stop()) {
+        // 没有在飞的 run()，可以直接删除；否则由 onRunExited() 在确认后删除
+        deleteLater();
+    }
+}
+
 /**
  * @brief 开始HTTP下载任务
  *
@@ -187,7 +265,14 @@ void HttpWorker::continueDownload()
     // 检查是否需要断点续传：单独记录 resume offset，避免 m_bytesReceived 含义混淆
     LOGD(QString("检查文件是否存在:%1").arg(m_file->exists() ? "存在" : "不存在"));
     if (m_file->exists()) {
-        const qint64 existingSize = m_file->size();
+        // 崩溃后分片尾部可能是撕裂写：先按 CRC32C 旁路文件校验尾部块，
+        // 只保留校验通过的前缀，从那里续传
+        const qint64 existingSize = verifyResumeTail();
+        if (existingSize < 0) {
+            emit error(tr("无法校验临时文件: %1").arg(m_filePath));
+            cleanup();
+            return;
+        }
         m_resumeOffset = existingSize;
         m_bytesReceived.store(existingSize, std::memory_order_release);
         LOGD(QString("文件已存在，大小:%1，使用追加模式").arg(existingSize));
@@ -208,6 +293,15 @@ void HttpWorker::continueDownload()
             return;
         }
         LOGD("新文件创建成功");
+
+        // 新分片：重新开始记录分块 CRC；旁路文件创建失败不影响下载，只是续传时无法校验
+        resetIntegrity(true);
+        m_crcFile = new QFile(crcSidecarPath());
+        if (!m_crcFile->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            LOGD(QString("无法创建CRC旁路文件:%1").arg(m_crcFile->errorString()));
+            delete m_crcFile;
+            m_crcFile = nullptr;
+        }
     }
 
     qint64 currentStartPoint = m_startPoint + m_resumeOffset;
@@ -223,6 +317,8 @@ void HttpWorker::continueDownload()
             m_alreadyFinished = true;
             emit finished();
         }
+        // 此时 run() 还没进入 exec()，直接 quit 会被 exec() 复位；排队到事件循环里再退出
+        QMetaObject::invokeMethod(this, [this]() { quitLoop(); }, Qt::QueuedConnection);
         return;
     }
 
@@ -237,7 +333,7 @@ void HttpWorker::continueDownload()
     } else {
         LOGD("endPoint=-1，整文件下载，不设置Range头");
     }
-    request.setTransferTimeout(30000); // 30秒超时
+    request.setTransferTimeout(m_transferTimeoutMs); // 默认 30 秒，有主机画像时按首字节时间推算
 
     // 设置User-Agent，避免被网站屏蔽
     request.setRawHeader("User-Agent", "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/91.0.4472.124 Safari/537.36");
@@ -247,8 +343,20 @@ void HttpWorker::continueDownload()
     request.setRawHeader("Accept-Language", "en-US,en;q=0.9,zh-CN;q=0.8,zh;q=0.7");
     request.setRawHeader("Connection", "keep-alive");
 
+    if (!m_pinnedAddresses.isEmpty()) {
+        // 连接校验过的地址；重试时轮换，单个地址不可达不至于拖垮整个分片
+        const QHostAddress& address = m_pinnedAddresses.at(m_retryCount % m_pinnedAddresses.size());
+        HostGuard::pinRequest(request, m_pinnedHost, address);
+        // 默认的 NoLessSafeRedirectPolicy 会跟随 Location 重新解析主机名，绕过钉住；
+        // 改为手动，收到 3xx 时分片按失败处理（见 onFinished）
+        request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::ManualRedirectPolicy);
+        LOGD(QString("请求钉到地址:%1").arg(address.toString()));
+    }
+
     LOGD("发送网络请求...");
     LOGD("开始调用m_netManager->get()...");
+    m_headersSeen = false;
+    m_requestClock.start();
     m_reply = m_netManager->get(request);
 
     // null-check：QNetworkAccessManager::get 理论上不会返回 nullptr，但加上
@@ -260,6 +368,32 @@ void HttpWorker::continueDownload()
         return;
     }
     LOGD("m_netManager->get()调用完成，开始连接信号...");
+    if (m_readBufferBytes > 0) {
+        // 读缓冲按主机单连接吞吐定大小：磁盘暂时跟不上时内存占用有界，又不至于卡住快主机
+        m_reply->setReadBufferSize(m_readBufferBytes);
+    }
+
+    // 响应头到达：给主机画像记首字节时间与限流（重定向的中间响应不计）
+    {
+        QPointer<HttpWorker> safeThis(this);
+        QPointer<QNetworkReply> safeReply(m_reply);
+        QObject::connect(m_reply, &QNetworkReply::metaDataChanged, this, [safeThis, safeReply]() {
+            if (!safeThis || !safeReply || safeThis->m_headersSeen) {
+                return;
+            }
+            const int statusCode = safeReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+            if (statusCode >= 300 && statusCode < 400) {
+                return;
+            }
+            safeThis->m_headersSeen = true;
+            const QString host = safeThis->m_url.host();
+            if (statusCode == 429 || statusCode == 503) {
+                HostProfileStore::instance().recordThrottled(host);
+            } else if (statusCode >= 200 && statusCode < 300) {
+                HostProfileStore::instance().recordTtfb(host, safeThis->m_requestClock.elapsed());
+            }
+        });
+    }
 
     connect(m_reply, &QNetworkReply::readyRead, this, &HttpWorker::onReadyRead);
     LOGD("readyRead信号连接完成");
@@ -304,6 +438,8 @@ void HttpWorker::continueDownload()
             if (!serverIgnoredRange) {
                 return;
             }
+            safeThis->m_rangeIgnored.store(true, std::memory_order_release);
+            HostProfileStore::instance().recordRangeIgnored(safeThis->m_url.host());
             // 仅 part0 切整文件重试，其余 part（partIndex > 0 或单线程 legacy 无 partIndex）
             // 立即 reject：删 tmp 文件 + abort + 走"预期内的 cancel"路径。
             // 这样多线程 anti-Range 场景下，最终只有一个 part0 有完整数据，
@@ -317,8 +453,9 @@ void HttpWorker::continueDownload()
                     safeThis->m_file->close();
                     QFile::remove(safeThis->m_filePath);
                 }
+                safeThis->resetIntegrity(true);
                 // 把 worker 切回单文件模式：把 endPoint 设为 -1 让下一次请求不带 Range；
-                // 保留 m_startPoint==0，仅重置 resume offset 和 progress 计数
+                // 保留 m_startPoint==0，仅重置 resume offset 和已接收字节计数
                 safeThis->m_endPoint = -1;
                 safeThis->m_startPoint = 0;
                 safeThis->m_resumeOffset = 0;
@@ -351,6 +488,7 @@ void HttpWorker::continueDownload()
                 safeThis->m_file->close();
                 QFile::remove(safeThis->m_filePath);
             }
+            safeThis->resetIntegrity(true);
             safeThis->m_resumeOffset = 0;
             safeThis->m_bytesReceived.store(0, std::memory_order_release);
             // 标记"预期内的 cancel"：abort 会触发 onErrorOccurred(OperationCanceledError)
@@ -387,6 +525,7 @@ void HttpWorker::cleanup()
         LOGD("关闭文件");
         m_file->close();
     }
+    resetIntegrity(false);
     if (m_reply) {
         LOGD("断开网络回复信号连接");
         m_reply->disconnect();
@@ -403,6 +542,153 @@ void HttpWorker::cleanup()
     LOGD("HttpWorker资源清理完成");
 }
 
+qint64 HttpWorker::verifyResumeTail()
+{
+    resetIntegrity(false);
+
+    QFile part(m_filePath);
+    if (!part.open(QIODevice::ReadWrite)) {
+        LOGD(QString("无法打开分片进行续传校验:%1 错误:%2").arg(m_filePath).arg(part.errorString()));
+        return -1;
+    }
+    const qint64 partSize = part.size();
+
+    QList<quint32> crcs;
+    QFile sidecar(crcSidecarPath());
+    const bool hasSidecar = sidecar.exists();
+    if (hasSidecar && sidecar.open(QIODevice::ReadOnly)) {
+        const QByteArray raw = sidecar.readAll();
+        sidecar.close();
+        const qint64 count = raw.size() / 4;
+        crcs.reserve(count);
+        for (qint64 i = 0; i < count; ++i) {
+            crcs.append(qFromLittleEndian<quint32>(raw.constData() + i * 4));
+        }
+    }
+
+    qint64 trusted = 0;
+    QByteArray block;
+    if (!hasSidecar) {
+        // 旧版本留下的分片没有 CRC 可对照，只能按原行为信任；顺便补算完整块的 CRC，
+        // 下次续传就能校验了。
+        LOGD(QString("分片无CRC旁路文件，信任已有%1字节并补算校验值").arg(partSize));
+        const qint64 fullBlocks = partSize / kCrcBlockSize;
+        for (qint64 i = 0; i < fullBlocks; ++i) {
+            block = part.read(kCrcBlockSize);
+            if (block.size() != kCrcBlockSize) {
+                break;
+            }
+            crcs.append(Crc32c::compute(block));
+        }
+        if (crcs.size() == fullBlocks) {
+            block = part.read(partSize - fullBlocks * kCrcBlockSize);
+            m_blockCrc = Crc32c::compute(block);
+            m_blockFill = block.size();
+            trusted = partSize;
+        } else {
+            trusted = crcs.size() * kCrcBlockSize;
+        }
+    } else {
+        // 只复查尾部几个块：崩溃造成的撕裂写只会出现在最后写入的位置
+        const qint64 recorded = qMin<qint64>(crcs.size(), partSize / kCrcBlockSize);
+        qint64 firstBad = recorded;
+        for (qint64 i = qMax<qint64>(0, recorded - kCrcVerifyTailBlocks); i < recorded; ++i) {
+            if (!part.seek(i * kCrcBlockSize)) {
+                firstBad = i;
+                break;
+            }
+            block = part.read(kCrcBlockSize);
+            if (block.size() != kCrcBlockSize || Crc32c::compute(block) != crcs.at(i)) {
+                LOGD(QString("分片块%1 CRC32C 校验失败，从此处截断重下").arg(i));
+                firstBad = i;
+                break;
+            }
+        }
+        crcs.resize(firstBad);
+        trusted = firstBad * kCrcBlockSize;
+    }
+
+    if (trusted < partSize) {
+        LOGD(QString("截断分片未校验/损坏的尾部：%1 -> %2 字节").arg(partSize).arg(trusted));
+        if (!part.resize(trusted)) {
+            LOGD(QString("截断分片失败:%1").arg(part.errorString()));
+            part.close();
+            return -1;
+        }
+    }
+    part.close();
+
+    // 重写旁路文件，让记录条数与可信长度一致，再以追加模式继续记录
+    QFile out(crcSidecarPath());
+    if (out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        QByteArray raw(crcs.size() * 4, Qt::Uninitialized);
+        for (qsizetype i = 0; i < crcs.size(); ++i) {
+            qToLittleEndian<quint32>(crcs.at(i), raw.data() + i * 4);
+        }
+        out.write(raw);
+        out.close();
+
+        m_crcFile = new QFile(crcSidecarPath());
+        if (!m_crcFile->open(QIODevice::Append)) {
+            LOGD(QString("无法追加CRC旁路文件，本次不记录完整性:%1").arg(m_crcFile->errorString()));
+            delete m_crcFile;
+            m_crcFile = nullptr;
+        }
+    } else {
+        LOGD(QString("无法重写CRC旁路文件，本次不记录完整性:%1").arg(out.errorString()));
+    }
+
+    LOGD(QString("续传校验完成，可信长度:%1 已记录块:%2 CRC硬件加速:%3")
+         .arg(trusted).arg(crcs.size()).arg(Crc32c::hardwareAccelerated() ? "是" : "否"));
+    return trusted;
+}
+
+qint64 HttpWorker::writeWithIntegrity(const QByteArray& data)
+{
+    const qint64 written = m_file->write(data);
+    if (written <= 0 || !m_crcFile) {
+        return written;
+    }
+
+    const char* p = data.constData();
+    qint64 remaining = written;
+    while (remaining > 0) {
+        const qint64 chunk = qMin(remaining, kCrcBlockSize - m_blockFill);
+        m_blockCrc = Crc32c::extend(m_blockCrc, p, chunk);
+        m_blockFill += chunk;
+        p += chunk;
+        remaining -= chunk;
+
+        if (m_blockFill == kCrcBlockSize) {
+            // 先把块数据交给 OS 再记 CRC：崩溃后有记录的块一定是完整写出的块
+            m_file->flush();
+            char raw[4];
+            qToLittleEndian<quint32>(m_blockCrc, raw);
+            m_crcFile->write(raw, sizeof(raw));
+            m_crcFile->flush();
+            m_blockCrc = 0;
+            m_blockFill = 0;
+        }
+    }
+    return written;
+}
+
+void HttpWorker::resetIntegrity(bool removeSidecar)
+{
+    if (m_crcFile) {
+        if (m_crcFile->isOpen()) {
+            m_crcFile->close();
+        }
+        delete m_crcFile;
+        m_crcFile = nullptr;
+    }
+    m_blockCrc = 0;
+    m_blockFill = 0;
+    if (removeSidecar) {
+        QFile::remove(crcSidecarPath());
+    }
+}
+
 void HttpWorker::stopAsync()
 {
     // 比较"是否在主线程"而不是"是否在构造时所属线程"。HttpWorker 的父对象是 nullptr，
@@ -412,7 +698,13 @@ void HttpWorker::stopAsync()
     if (QThread::currentThread() == qApp->thread()) {
         stop();
     } else {
-        QMetaObject::invokeMethod(this, "stop", Qt::QueuedConnection);
+        // stop() 的运行状态转换只在主线程进行，投递到 qApp 而不是 this
+        QPointer<HttpWorker> safeThis(this);
+        QMetaObject::invokeMethod(qApp, [safeThis]() {
+            if (safeThis) {
+                safeThis->stop();
+            }
+        }, Qt::QueuedConnection);
     }
 }
 
@@ -420,7 +712,7 @@ void HttpWorker::stopAsync()
  * @brief 退出 run() 内部的事件循环。
  *  - 在 worker 线程里直接 quit()；
  *  - 从其他线程（主线程 cancel/pause）调用时通过 invokeMethod 切到 worker 线程。
- *  quit() 异步生效；调用方需要等 run() 返回（cancel 路径会 waitForDone）。
+ *  quit() 异步生效；run() 返回后经 stopped() 通知调用方，无需等待线程池。
  */
 void HttpWorker::quitLoop()
 {
@@ -465,49 +757,65 @@ void HttpWorker::setProxy(const QNetworkProxy& proxy)
 
 /**
  * @brief 停止下载。
- * 线程安全：不论 caller 在哪个线程，都把 abort 投到 worker 线程的 m_loop 上
- * 派发，**不再用 BlockingQueuedConnection**——之前的版本在多 worker 同时
- * pause 时会让主线程 8 次顺序 BlockQueued 阻塞、事件循环彻底停摆，UI 无响应
- * 数秒（表现为整窗冻死）。改为 QueuedConnection：caller 立即返回，worker
- * 线程在 m_loop::exec() 中派发到 stop 时，只调 m_reply->abort() 一次；
- * abort() 触发 onErrorOccurred(OperationCanceledError)，已存在的 guard
- * （code==OperationCanceledError && m_isStopped）会兜底做 cleanup +
- * emit finished + quitLoop，把 run() 拉回结束。
+ * 线程模型：只在主线程调用，从不阻塞。**不用 BlockingQueuedConnection**——之前的
+ * 版本在多 worker 同时 pause 时会让主线程顺序 BlockQueued 阻塞、事件循环彻底停摆，
+ * UI 无响应数秒（表现为整窗冻死）；后来改成 QueuedConnection 后，调用方又靠
+ * waitForDone 等 worker 退出，同样卡主线程。现在：
+ *  - 还在线程池队列里的直接 tryTake 撤回，不会再运行；
+ *  - 已在运行的标记 Stopping，把 abort 投到 worker 线程的 m_loop 上派发。
+ *    abort() 触发 onErrorOccurred(OperationCanceledError)，停止分支 cleanup +
+ *    quitLoop 把 run() 拉回结束，随后主线程收到 stopped() 确认。
  */
-void HttpWorker::stop()
+bool HttpWorker::stop()
 {
     LOGD("停止HttpWorker");
-    m_isStopped = true;
+    m_isStopped.store(true, std::memory_order_release);
+
+    int state = m_runState.load(std::memory_order_acquire);
+    if (state == RunIdle) {
+        LOGD("worker 未在运行，无需等待确认");
+        return false;
+    }
+    if (state == RunQueued && m_pool && m_pool->tryTake(this)) {
+        m_runState.store(RunIdle, std::memory_order_release);
+        LOGD("worker 尚在线程池队列中，已撤回");
+        return false;
+    }
+    // Queued（线程池已取出、run() 即将开始）或 Running → Stopping。
+    // 与 run() 入口的 Queued→Running 并发时 CAS 失败，state 被刷新为 Running 后重试。
+    while (state != RunStopping &&
+           !m_runState.compare_exchange_weak(state, RunStopping, std::memory_order_acq_rel)) {
+    }
 
-    const QThread* myThread = this->thread();
-    if (QThread::currentThread() == myThread) {
-        // worker 线程里直接 abort。abort 触发 onErrorOccurred(OperationCanceledError)
-        // → guard（m_isStopped==true）→ cleanup + quitLoop + return。
+    // 投递到 worker 所在线程（run() 入口 moveToThread 过；排队中的则随 moveToThread
+    // 一起迁过去）。worker 在 m_loop->exec() 拉到这个事件时 abort。
+    LOGD("调度 abort 到 worker 线程（非阻塞）");
+    QMetaObject::invokeMethod(this, [this]() {
         if (m_reply && m_reply->isRunning()) {
-            LOGD("同线程停止：直接 abort reply（error guard 兜底 quitLoop）");
+            // 已到达但还在 reply 缓冲里的数据先落盘再 abort：续传少下这一段，
+            // 退出检查点时分片长度也更接近实际收到的字节。只在响应已确认是本分片
+            // 数据（206，或整文件模式的 200）时这样做，anti-Range 判定前的数据不能写。
+            const int statusCode = m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+            const bool ownData = (statusCode == 206) || (m_endPoint < 0 && statusCode == 200);
+            if (ownData && m_file && m_file->isOpen()) {
+                const QByteArray pending = m_reply->readAll();
+                if (!pending.isEmpty()) {
+                    writeWithIntegrity(pending);
+                    m_bytesReceived.fetch_add(pending.size(), std::memory_order_release);
+                    m_networkBytes.fetch_add(pending.size(), std::memory_order_release);
+                    LOGD(QString("停止前落盘缓冲数据:%1字节").arg(pending.size()));
+                }
+            }
+            LOGD("worker 线程派发：abort reply（error guard 兜底 quitLoop）");
             m_reply->abort();
         } else if (m_loop && m_loop->isRunning()) {
-            // reply 已经清空 / 完成场景，没有 error/finished 来 quitLoop，兜底主动 quit。
-            LOGD("同线程停止：reply 已不在，主动 quitLoop");
+            // reply 已经清空 / 完成 / 在重试退避中，没有 error/finished 来 quitLoop，兜底主动 quit。
+            LOGD("worker 线程派发：reply 已不在，主动 quitLoop");
             quitLoop();
         }
-    } else {
-        // 跨线程：把 abort 投到 worker 线程的事件循环**非阻塞**（关键修复）。
-        // worker 在 m_loop->exec() 拉到这个事件，调 abort；abort 触发 onErrorOccurred
-        // 在 worker 线程的 guard 路径里 quitLoop，run() 退出。
-        LOGD("跨线程停止：调度 abort 到 worker 线程（非阻塞）");
-        QMetaObject::invokeMethod(this, [this]() {
-            if (m_reply && m_reply->isRunning()) {
-                LOGD("worker 线程派发：abort reply（error guard 兜底 quitLoop）");
-                m_reply->abort();
-            } else if (m_loop && m_loop->isRunning()) {
-                LOGD("worker 线程派发：reply 已不在，主动 quitLoop");
-                quitLoop();
-            }
-        }, Qt::QueuedConnection);
-    }
+    }, Qt::QueuedConnection);
 
-    LOGD("HttpWorker完全停止");
+    return true;
 }
 
 void HttpWorker::onReadyRead()
@@ -526,6 +834,12 @@ void HttpWorker::onReadyRead()
         return;
     }
 
+    if (isPinnedRedirect()) {
+        // 重定向应答的正文不是文件内容
+        m_reply->readAll();
+        return;
+    }
+
     if (!m_file || !m_file->isOpen()) {
         LOGD(QString("文件不可用 - 文件对象:%1 文件打开:%2")
              .arg(m_file ? "存在" : "不存在")
@@ -537,25 +851,15 @@ void HttpWorker::onReadyRead()
     qint64 dataSize = data.size();
 
     if (dataSize > 0) {
-        qint64 written = m_file->write(data);
+        qint64 written = writeWithIntegrity(data);
         if (written != dataSize) {
             LOGD(QString("文件写入不完整，期望:%1 实际:%2").arg(dataSize).arg(written));
         }
-        // 使用 std::atomic 的 fetch_add（语义等于旧的 fetchAndAddRelease），无需再 store
+        // 使用 std::atomic 的 fetch_add（语义等于旧的 fetchAndAddRelease），无需再 store。
+        // 不向主线程发进度信号：DownloadManager 的遥测采样按固定频率读取这个计数器，
+        // 主线程的事件量与 readyRead 频率、任务数量都无关。
         m_bytesReceived.fetch_add(dataSize, std::memory_order_release);
-
-        // 节流 progress 信号：每累计 64KB 才向主线程 emit 一次。worker 高频
-        // readyRead 时每个 chunk 发信号会让 DownloadTask::onWorkerProgress +
-        // MainWindow::onTaskProgressUpdated 这条链在主线程上把整个事件循环
-        // 拖垮，表现为下载中 UI 无响应。下载进度本身的精度由 200ms
-        // m_speedCalculationTimer 内的 m_bytesReceivedByWorkers 累计（atomic）
-        // 保证，节流不影响最终进度正确性。
-        m_progressAccumulator += dataSize;
-        if (m_progressAccumulator >= kProgressEmitThreshold) {
-            const qint64 toEmit = m_progressAccumulator;
-            m_progressAccumulator = 0;
-            emit progress(toEmit);
-        }
+        m_networkBytes.fetch_add(dataSize, std::memory_order_release);
 
         // 每接收1MB数据记录一次日志，避免日志过多
         const qint64 curBytes = m_bytesReceived.load(std::memory_order_acquire);
@@ -585,6 +889,20 @@ void HttpWorker::onFinished()
         return;
     }
 
+    // 钉住地址时不跟随重定向：分片失败，DownloadManager::onTaskError 作废该 URL 的元数据缓存，
+    // 重试时重新 HEAD 探测（探测阶段由 DownloadTask::followPinnedRedirect 重新钉住同源下一跳）
+    if (isPinnedRedirect()) {
+        const QUrl target = m_reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl();
+        LOGD(QString("钉住地址的分片请求被重定向，不跟随:%1").arg(target.toString()));
+        if (!m_alreadyFinished) {
+            m_alreadyFinished = true;
+            emit error(tr("分片请求被重定向: %1").arg(target.toString()));
+        }
+        cleanup();
+        quitLoop();
+        return;
+    }
+
     // 在声明"完成"前，最后一次 readAll 把 Qt 内部 / OS socket 缓冲里尚未
     // 通过 readyRead 派发的最后一段数据排空。Qt 在 server 关闭 socket 后可能
     // 投 finished 之前最后一两个 chunk 没来得及转成 readyRead（Windows + Qt
@@ -598,18 +916,12 @@ void HttpWorker::onFinished()
         if (tailSize > 0) {
             LOGD(QString("onFinished 排空尾部 bytes:%1").arg(tailSize));
             if (m_file && m_file->isOpen()) {
-                const qint64 written = m_file->write(tailData);
+                const qint64 written = writeWithIntegrity(tailData);
                 if (written != tailSize) {
                     LOGD(QString("尾部写入不完整，期望:%1 实际:%2").arg(tailSize).arg(written));
                 }
                 m_bytesReceived.fetch_add(tailSize, std::memory_order_release);
-                // 也走 progress 节流逻辑，避免主线程被卡
-                m_progressAccumulator += tailSize;
-                if (m_progressAccumulator >= kProgressEmitThreshold) {
-                    const qint64 toEmit = m_progressAccumulator;
-                    m_progressAccumulator = 0;
-                    emit progress(toEmit);
-                }
+                m_networkBytes.fetch_add(tailSize, std::memory_order_release);
             }
         }
     }
@@ -642,6 +954,15 @@ void HttpWorker::onFinished()
     LOGD("onFinished处理完成");
 }
 
+bool HttpWorker::isPinnedRedirect() const
+{
+    if (m_pinnedAddresses.isEmpty() || !m_reply) {
+        return false;
+    }
+    const int statusCode = m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    return statusCode == 301 || statusCode == 302 || statusCode == 303 || statusCode == 307 || statusCode == 308;
+}
+
 void HttpWorker::onErrorOccurred(QNetworkReply::NetworkError code)
 {
     LOGD(QString("网络错误发生 - 错误码:%1").arg(code));
@@ -664,12 +985,9 @@ void HttpWorker::onErrorOccurred(QNetworkReply::NetworkError code)
     }
 
     if (m_isStopped && code == QNetworkReply::OperationCanceledError) {
-        // 用户主动停止，不是错误
+        // 用户主动停止，不是错误，也不是完成：不发 finished()（否则暂停会被当成
+        // 分片下载完毕而触发合并），run() 退出后由 stopped() 确认
         LOGD("用户主动停止下载，这不是错误");
-        if (!m_alreadyFinished) {
-            m_alreadyFinished = true;
-            emit finished();
-        }
         cleanup();
         quitLoop();
         return;
@@ -8,10 +8,15 @@
 #include <QNetworkReply>
 #include <QFile>
 #include <QUrl>
+#include <QHostAddress>
+#include <QList>
 #include <QDebug>
 #include <QEventLoop>
+#include <QElapsedTimer>
 #include <atomic>
 
+class QThreadPool;
+
 /**
  * @brief HttpWorker类是执行文件分块下载的实际工作单元。
  * 它是纯QObject，在主线程中异步执行网络请求。
@@ -41,13 +46,26 @@ public:
      */
     int partIndex() const { return m_partIndex; }
 
+    /**
+     * @brief 分片的字节范围与文件路径（续传清单记录用）。endPoint 为 -1 表示整文件下载。
+     */
+    qint64 startPoint() const { return m_startPoint; }
+    qint64 endPoint() const { return m_endPoint; }
+    QString filePath() const { return m_filePath; }
+
     /**
      * @brief 读取本 worker 累计已接收字节数（原子读，跨线程安全）。
-     * 用于 DownloadTask 的 200ms 定时器在主线程汇总所有 worker 的进度，
-     * HEAD 没拿到 Content-Length 时用此值估算"已下载多少"。
+     * 含续传前已在磁盘上的字节。DownloadManager 的遥测采样在主线程按固定频率
+     * 汇总所有 worker 的此值计算进度与速度，worker 不再向主线程发进度信号。
      */
     qint64 bytesReceivedAtomic() const { return m_bytesReceived.load(std::memory_order_acquire); }
 
+    /**
+     * @brief 本 worker 从网络累计收到的字节数（单调递增，不含续传前已有字节，
+     * anti-Range 回退也不清零）。遥测采样用它的增量测速，避免续传时出现速度尖峰。
+     */
+    qint64 networkBytesAtomic() const { return m_networkBytes.load(std::memory_order_acquire); }
+
     /**
      * @brief 重置HttpWorker状态，允许重新启动下载（用于断点续传）
      */
@@ -59,15 +77,66 @@ public:
     void run() override;
 
     /**
-     * @brief 停止下载。
+     * @brief 把 worker 提交到线程池（主线程调用）。
+     * 记录所属线程池并把运行状态置为"排队中"，stop() 据此决定能否直接从队列撤回。
+     * 只能对空闲的 worker 调用（首次提交，或 stopped() 确认之后）。
+     * @param pool 目标线程池。
+     * @param priority 线程池排队优先级（所属任务的优先级）。
+     */
+    void submit(QThreadPool* pool, int priority = 0);
+
+    /**
+     * @brief 调整排队优先级（主线程调用）。仅对仍在线程池队列中的 worker 生效：
+     * 撤回后按新优先级重新排队；已开始运行或空闲的 worker 不受影响。
+     * @param priority 新优先级。
+     */
+    void reprioritize(int priority);
+
+    /**
+     * @brief 把请求钉到 SSRF 校验过的地址（主线程，submit 之前调用）。
+     * @param host URL 的原主机名。
+     * @param addresses 校验过的地址；每次重试轮换到下一个。为空时不钉。
+     */
+    void setPinnedAddresses(const QString& host, const QList<QHostAddress>& addresses);
+
+    /**
+     * @brief 设置主机画像给出的传输参数（主线程，submit 之前调用）。
+     * @param transferTimeoutMs 单个请求的无数据超时。
+     * @param readBufferBytes 应答读缓冲上限；0 表示不限。
+     */
+    void setTransferHints(int transferTimeoutMs, qint64 readBufferBytes);
+
+    /**
+     * @brief 本 worker 是否遇到过服务器无视 Range（原子读，跨线程安全）。
+     * DownloadTask 据此判断这次下载实际只用了一个连接。
+     */
+    bool rangeIgnored() const { return m_rangeIgnored.load(std::memory_order_acquire); }
+
+    /**
+     * @brief 停止下载（主线程调用，不阻塞）。
+     *
+     * 只置停止标志并把 abort 投递到 worker 线程，立即返回。
+     * @return true 表示 run() 仍在排队或运行，退出后会发射一次 stopped() 作为确认；
+     *         false 表示 worker 已空闲（或已从线程池队列撤回），不会再有确认。
      */
-    void stop();
+    bool stop();
 
     /**
-     * @brief 异步停止下载。
+     * @brief 异步停止下载（可从任意线程调用，实际的 stop() 在主线程执行）。
      */
     void stopAsync();
 
+    /**
+     * @brief 停止并在 run() 真正退出后自行 deleteLater（主线程调用）。
+     * 供 DownloadTask 在析构/重建 worker 时放手：无需等待线程池，也不会删掉仍在运行的对象。
+     */
+    void stopAndDeleteLater();
+
+    /**
+     * @brief 是否已被要求停止（reset() 后复位）。
+     */
+    bool isStopped() const { return m_isStopped.load(std::memory_order_acquire); }
+
     /**
      * @brief 退出 worker 线程内的 QEventLoop。线程安全：
      *  - 在 worker 线程里直接 quit；
@@ -93,18 +162,17 @@ signals:
      */
     void finished();
 
-    /**
-     * @brief 当下载进度更新时发射此信号。
-     * @param bytesReceived 本次接收到的字节数。
-     */
-    void progress(qint64 bytesReceived);
-
     /**
      * @brief 当发生错误时发射此信号。
      * @param errorString 错误信息。
      */
     void error(const QString& errorString);
-    
+
+    /**
+     * @brief stop() 的确认：被停止的 run() 已退出、文件句柄已关闭时在主线程发射。
+     * 每次返回 true 的 stop() 恰好对应一次。
+     */
+    void stopped();
 
 private slots:
     /**
@@ -138,24 +206,95 @@ private:
      * @brief 清理资源。
      */
     void cleanup();
+
+    /**
+     * @brief run() 退出前调用（worker 线程）：把亲和切回主线程，
+     * 再把 onRunExited() 投递到主线程。
+     */
+    void leaveRun();
+
+    /**
+     * @brief 主线程上的 run() 退出处理：运行状态回到空闲，被停止的发射 stopped()。
+     */
+    void onRunExited();
+
+    /// run() 的生命周期状态。除 run() 入口的 Queued→Running 外，其余转换都在主线程。
+    enum RunState : int {
+        RunIdle,        ///< 空闲：未提交，或 run() 已退出且主线程已处理
+        RunQueued,      ///< 已提交到线程池，run() 尚未开始
+        RunRunning,     ///< run() 执行中
+        RunStopping     ///< 已 stop()，等待 run() 退出后发射 stopped()
+    };
+
+    /**
+     * @brief 分片的 CRC32C 旁路文件路径（<分片路径>.crc）。
+     * 文件内容为按 kCrcBlockSize 切分的每个完整块的 CRC32C（小端 quint32 顺序追加）。
+     */
+    QString crcSidecarPath() const { return m_filePath + ".crc"; }
+
+    /**
+     * @brief 断点续传前校验已有分片的尾部块。
+     *
+     * 重新计算最后 kCrcVerifyTailBlocks 个已记录块的 CRC32C，从第一个不匹配的块起
+     * 截断分片与旁路文件；没有 CRC 记录的尾部残块（崩溃时未写完的块）同样截断重下。
+     * 没有旁路文件的旧分片按原行为信任，并补算已有完整块的 CRC。
+     * 完成后以追加模式打开 m_crcFile，并恢复残块的累加状态。
+     *
+     * @return 可信的分片长度（续传偏移）；出错返回 -1。
+     */
+    qint64 verifyResumeTail();
+
+    /**
+     * @brief 写入分片数据并维护分块 CRC32C：每填满一个块就 flush 分片、追加一条 CRC 记录。
+     * @param data 要写入的数据。
+     * @return 实际写入分片文件的字节数。
+     */
+    qint64 writeWithIntegrity(const QByteArray& data);
+
+    /**
+     * @brief 钉住地址的请求收到了重定向应答。钉住的请求不让 QNAM 跟随重定向
+     * （下一跳会按 DNS 解析，或直接转到内网地址），应答体也不写进分片。
+     */
+    bool isPinnedRedirect() const;
+
+    /**
+     * @brief 关闭并丢弃 CRC 状态（anti-Range 删除分片、新建分片时使用）。
+     * @param removeSidecar 是否同时删除旁路文件。
+     */
+    void resetIntegrity(bool removeSidecar);
+
     QUrl m_url;                     ///< 文件的URL。
     QString m_filePath;             ///< 临时文件的路径。
     qint64 m_startPoint;            ///< 下载范围的起始点。
     qint64 m_endPoint;              ///< 下载范围的结束点。
     int m_partIndex = -1;           ///< 分片下标（0 = part0；-1 = 单线程或 legacy）。Anti-Range 服务器协调用。
     std::atomic<qint64> m_bytesReceived;     ///< 本会话已接收的字节数（原子类型，跨线程安全，支持>2GB文件）。
+    std::atomic<qint64> m_networkBytes{0};   ///< 从网络累计收到的字节数（单调递增，测速用）。
     qint64 m_resumeOffset{0};       ///< 从磁盘续传时检测到的已有字节数（仅一次设置，避免 m_bytesReceived 语义混淆）。
 
     QNetworkAccessManager* m_netManager; ///< 网络访问管理器。
     QNetworkReply* m_reply;         ///< 网络应答。
     QFile* m_file;                  ///< 临时文件。
+    QFile* m_crcFile = nullptr;     ///< CRC32C 旁路文件（追加模式）。
+    quint32 m_blockCrc = 0;         ///< 当前未写满块的 CRC32C 累加值。
+    qint64 m_blockFill = 0;         ///< 当前未写满块已写入的字节数。
+    static constexpr qint64 kCrcBlockSize = 1024 * 1024;  ///< CRC 分块大小（相对分片文件起点对齐）。
+    static constexpr int kCrcVerifyTailBlocks = 4;       ///< 续传时重新校验的尾部块数。
 
-    bool m_isStopped;               ///< 标记是否已停止。
+    std::atomic<bool> m_isStopped;  ///< 标记是否已停止（主线程写，worker 线程读）。
+    std::atomic<int> m_runState{RunIdle}; ///< run() 生命周期状态，见 RunState。
+    QThreadPool* m_pool = nullptr;  ///< 最近一次提交到的线程池（stop() 撤回排队项用）。
+    bool m_deleteWhenStopped = false; ///< stopAndDeleteLater() 已调用，stopped() 后自删（仅主线程）。
     int m_retryCount;               ///< 当前重试次数（实例成员，避免跨worker共享）。
+    QString m_pinnedHost;           ///< 钉地址时的原主机名。
+    QList<QHostAddress> m_pinnedAddresses; ///< 校验过的地址（空表示按 DNS 正常连接）。
+    int m_transferTimeoutMs = 30000; ///< 单个请求的无数据超时（主机画像给出）。
+    qint64 m_readBufferBytes = 0;   ///< 应答读缓冲上限，0 表示不限（主机画像给出）。
+    QElapsedTimer m_requestClock;   ///< 当前请求的发出时刻，测首字节时间用。
+    bool m_headersSeen = false;     ///< 当前请求的响应头是否已到达（只记一次 TTFB）。
+    std::atomic<bool> m_rangeIgnored{false}; ///< 是否遇到过服务器无视 Range。
     bool m_alreadyFinished;         ///< 标记finished/error是否已发射，避免重复发射。
     qint64 m_lastLoggedBytes{0};    ///< 上次记录日志时的字节数（实例成员，避免跨worker共享）。
-    qint64 m_progressAccumulator{0};///< progress 信号节流计数器（与 kProgressEmitThreshold 配合）。
-    static constexpr qint64 kProgressEmitThreshold = 64 * 1024;  ///< 每累计 64KB 才向主线程 emit 一次 progress。
 
     /// run() 内部事件循环：让 QNetworkReply 的 readyRead/finished 等信号在 worker
     /// 线程的事件循环里被消化。run() 入口 moveToThread 后，this->thread() == worker
@@ -6,6 +6,7 @@
 #include "httpserver.h"
 #include "singleinstance.h"
 #include "protocolregistrar.h"
+#include "terminationsignal.h"
 #include "logger.h"
 
 #include <QApplication>
@@ -145,6 +146,12 @@ int main(int argc, char *argv[])
     MainWindow w;
     w.show();
 
+    // SIGTERM 等终止请求走与正常退出相同的快速检查点（DownloadManager::shutdown）
+    TerminationSignal::install();
+
+    // 恢复上次退出时未完成的任务（主窗口已连接 taskAdded，恢复的任务会出现在列表里）
+    DownloadManager::instance().restoreQueue();
+
     // 启动 HTTP 服务器（接收浏览器插件请求）
     HttpServer* httpServer = new HttpServer(&w);
     quint16 listenPort = SettingsManager::instance().loadLocalListenPort();
@@ -155,6 +162,8 @@ int main(int argc, char *argv[])
     }
     QObject::connect(httpServer, &HttpServer::newDownloadRequest,
                      &w, &MainWindow::onNewDownloadRequestFromBrowser);
+    QObject::connect(httpServer, &HttpServer::batchDownloadQueued,
+                     &w, &MainWindow::onBatchDownloadQueued);
 
     // 端到端测试钩子（保留现有行为）
     const QByteArray autoPauseMs = qgetenv("DOWNLOADER_AUTO_PAUSE_MS");
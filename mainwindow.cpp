@@ -8,10 +8,14 @@
 #include "systemtray.h"
 #include "protocolregistrar.h"
 #include "protocolregistrar.h"
+#include "httpserver.h"
+#include "hostguard.h"
 #include "newtaskdialog.h" // 新建任务对话框
 #include "settingsdialog.h" // 设置对话框
 #include "historydialog.h"
 #include "historymanager.h" // 历史管理器
+#include "tasktablemodel.h"
+#include "progressdelegate.h"
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QDebug>
@@ -21,6 +25,7 @@
 #include <QLocale>
 #include <QTimer> // 用于延迟启动任务
 #include <QProgressDialog>
+#include <QMenu>
 #include <QSet>
 #include <QHash>
 #include <utility> // 用于std::as_const
@@ -45,8 +50,7 @@ MainWindow::MainWindow(QWidget *parent)
     , ui(new Ui::MainWindow)
     , m_downloadManager(DownloadManager::instance())
     , m_settingsManager(SettingsManager::instance())
-    , m_historyManager(HistoryManager::instance()),
-    m_uiUpdateTimer(new QTimer(this))
+    , m_historyManager(HistoryManager::instance())
     , m_translator(nullptr)
 {
     ui->setupUi(this);
@@ -62,6 +66,18 @@ MainWindow::MainWindow(QWidget *parent)
     // 其他类似的连接也不需要手动设置
 
     connect(&m_downloadManager, &DownloadManager::taskAdded, this, &MainWindow::onTaskAdded);
+    // 进度/速度/ETA 统一走 DownloadManager 的遥测快照，每个周期整批刷新一次表格
+    connect(&m_downloadManager, &DownloadManager::telemetryUpdated, this, &MainWindow::onTelemetryUpdated);
+    // 排队条目在表格里占一行（状态"排队"），轮到时同一行换成任务；状态栏另外显示条数
+    connect(&m_downloadManager, &DownloadManager::taskQueued, m_taskModel, &TaskTableModel::addQueued);
+    connect(&m_downloadManager, &DownloadManager::queuedTaskCancelled, m_taskModel, &TaskTableModel::markQueuedCancelled);
+    for (const QueuedTask& entry : m_downloadManager.queuedTasks()) {
+        m_taskModel->addQueued(entry);
+    }
+    connect(&m_downloadManager, &DownloadManager::queueChanged, this, [this](int queued) {
+        m_queueLabel->setText(tr("排队：%1").arg(queued));
+        m_queueLabel->setVisible(queued > 0);
+    });
     connect(&m_settingsManager, &SettingsManager::themeChanged, this, &MainWindow::onThemeChanged);
 
     // 连接定时下载管理器信号
@@ -102,10 +118,6 @@ MainWindow::MainWindow(QWidget *parent)
     // 接管翻译器：根据 m_currentLanguage 安装翻译（避免 main 与 mainwindow 双重管理）
     switchLanguage(m_currentLanguage);
 
-    // 设置UI更新定时器
-    connect(m_uiUpdateTimer, &QTimer::timeout, this, &MainWindow::onUiUpdateTimerTimeout);
-    m_uiUpdateTimer->start(200); // 每200毫秒更新一次
-
     // 单实例：start Listening 接收其它 Downloader 进程经 downloader:// 转发的 URL。
     // listen 失败（极少见，比如 Windows 系统级权限拒绝）时不影响 UI 正常使用，
     // 只是后续 downloader:// 唤起会再次新开进程而非转发到当前实例。
@@ -113,6 +125,8 @@ MainWindow::MainWindow(QWidget *parent)
     if (m_singleInstance->startListening()) {
         connect(m_singleInstance, &SingleInstance::messageReceived,
                 this, &MainWindow::onSingleInstanceMessage);
+        connect(m_singleInstance, &SingleInstance::requestReceived,
+                this, &MainWindow::onSingleInstanceRequest);
     } else {
         LOGD("MainWindow: SingleInstance listen 失败，URL 协议唤起将 self-start 路径");
     }
@@ -188,23 +202,27 @@ void MainWindow::initUI()
         qDebug() << "Loaded window icon from resources";
     }
 
-    // 设置任务列表表头
-    ui->tableWidget->setColumnCount(7);
-    ui->tableWidget->setHorizontalHeaderLabels({
-        tr("文件名"), tr("URL"), tr("进度"), tr("大小"), tr("速度"), tr("状态"), tr("操作")
-    });
+    // 任务列表：模型只保存每行的显示值，进度列由委托绘制，不再给每行建 cell widget
+    m_taskModel = new TaskTableModel(this);
+    ui->tableView->setModel(m_taskModel);
+    ui->tableView->setItemDelegateForColumn(TaskTableModel::ProgressColumn, new ProgressDelegate(this));
     
     // 智能响应式列宽配置
     setupResponsiveTableColumns();
 
-    ui->tableWidget->setSelectionBehavior(QAbstractItemView::SelectRows); // 整行选中
-    ui->tableWidget->setEditTriggers(QAbstractItemView::NoEditTriggers); // 禁止编辑
-    ui->tableWidget->setAlternatingRowColors(true); // 交替行颜色
-    ui->tableWidget->setSortingEnabled(false); // 禁用排序以保持任务顺序
-    ui->tableWidget->setCornerButtonEnabled(false); // 隐藏左上角按钮
+    ui->tableView->setSelectionBehavior(QAbstractItemView::SelectRows); // 整行选中
+    ui->tableView->setEditTriggers(QAbstractItemView::NoEditTriggers); // 禁止编辑
+    ui->tableView->setAlternatingRowColors(true); // 交替行颜色
+    ui->tableView->setSortingEnabled(false); // 禁用排序以保持任务顺序
+    ui->tableView->setCornerButtonEnabled(false); // 隐藏左上角按钮
+    ui->tableView->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(ui->tableView, &QWidget::customContextMenuRequested, this, &MainWindow::onTaskContextMenu);
 
     // 状态栏
     ui->statusbar->showMessage(tr("准备就绪"));
+    m_queueLabel = new QLabel(this);
+    m_queueLabel->hide();
+    ui->statusbar->addPermanentWidget(m_queueLabel);
 }
 
 void MainWindow::loadStyleSheet(const QString& themeName)
@@ -270,223 +288,15 @@ void MainWindow::loadStyleSheet(const QString& themeName)
     }
 }
 
-QString MainWindow::formatBytes(qint64 bytes) const
-{
-    if (bytes < 1024) {
-        return QString("%1 B").arg(bytes);
-    } else if (bytes < 1024 * 1024) {
-        return QString("%1 KB").arg(bytes / 1024.0, 0, 'f', 2);
-    } else if (bytes < 1024 * 1024 * 1024) {
-        return QString("%1 MB").arg(bytes / (1024.0 * 1024), 0, 'f', 2);
-    } else {
-        return QString("%1 GB").arg(bytes / (1024.0 * 1024 * 1024), 0, 'f', 2);
-    }
-}
-
-QString MainWindow::formatSpeed(qint64 bytesPerSecond) const
-{
-    if (bytesPerSecond < 1024) {
-        return QString("%1 B/s").arg(bytesPerSecond);
-    } else if (bytesPerSecond < 1024 * 1024) {
-        return QString("%1 KB/s").arg(bytesPerSecond / 1024.0, 0, 'f', 2);
-    } else if (bytesPerSecond < 1024 * 1024 * 1024) {
-        return QString("%1 MB/s").arg(bytesPerSecond / (1024.0 * 1024), 0, 'f', 2);
-    } else {
-        return QString("%1 GB/s").arg(bytesPerSecond / (1024.0 * 1024 * 1024), 0, 'f', 2);
-    }
-}
-
-/**
- * @brief 构造大小列文本。
- * HEAD 没拿到 Content-Length 时 totalSize=0，单独显示"未知"避免"5430 B/0 B"的违和文案。
- */
-QString MainWindow::formatSizeCell(qint64 downloaded, qint64 total) const
+QList<int> MainWindow::selectedTaskRows() const
 {
-    if (total <= 0) {
-        return formatBytes(downloaded) + "/" + tr("未知");
-    }
-    return formatBytes(downloaded) + "/" + formatBytes(total);
-}
-
-/**
- * @brief 状态枚举 → 当前语言文案。集中保留以便 refreshCellWidgetTexts / updateTaskInTable 共用，
- * 避免 switch/case 散落各处。
- */
-QString MainWindow::formatStatusCell(DownloadTaskStatus status) const
-{
-    switch (status) {
-    case DownloadTaskStatus::Pending:     return tr("等待中");
-    case DownloadTaskStatus::Downloading: return tr("下载中");
-    case DownloadTaskStatus::Paused:      return tr("已暂停");
-    case DownloadTaskStatus::Cancelled:   return tr("已取消");
-    case DownloadTaskStatus::Completed:   return tr("已完成");
-    case DownloadTaskStatus::Failed:      return tr("失败");
-    }
-    return QString();
-}
-
-/**
- * @brief 语言切换后重建表格 cell widget 的翻译文案。
- *
- * 表格中以 cell widget 形式存在的 QLabel / QProgressBar 不在 Qt 的 .ui 自动
- * retranslate 流程里，需要手动刷新。流程：
- *  1) 表头：调用 ui->retranslateUi 不会刷动态 setHorizontalHeaderLabels 的内容
- *     （这一步 MainWindow::switchLanguage 已经做了，因此这里不重复）；
- *  2) 遍历每个 row，按 UserRole 找到对应的 DownloadTask，调用一次
- *     updateTaskInTable 让现有刷新路径走一遍（statusText / tooltip 等会以当前
- *     tr() 重写）。
- *
- * 这样无需把 addTaskToTable 也提一份 refresh 版本，重复利用率高。
- */
-void MainWindow::refreshCellWidgetTexts()
-{
-    if (!ui || !ui->tableWidget) {
-        return;
-    }
-    QSet<QPointer<DownloadTask>> visited;
-    for (int row = 0; row < ui->tableWidget->rowCount(); ++row) {
-        QTableWidgetItem* item = ui->tableWidget->item(row, 0);
-        if (!item) continue;
-        DownloadTask* task = item->data(Qt::UserRole).value<DownloadTask*>();
-        if (!task) continue;
-        // 同一 task 多行一般不存在；做一次防御性去重。
-        if (visited.contains(QPointer<DownloadTask>(task))) continue;
-        visited.insert(QPointer<DownloadTask>(task));
-        updateTaskInTable(task);
-    }
-}
-
-void MainWindow::addTaskToTable(DownloadTask* task)
-{
-    LOGD(QString("开始将任务添加到表格 - 任务:%1").arg(task ? task->fileName() : "空"));
-    
-    if (!task) {
-        LOGD("任务指针为空，无法添加到表格");
-        return;
-    }
-    
-    int row = ui->tableWidget->rowCount();
-    LOGD(QString("当前表格行数:%1，将在第%2行插入新任务").arg(row).arg(row));
-    ui->tableWidget->insertRow(row);
-    LOGD("新行插入完成");
-
-    // 文件名
-    LOGD("设置文件名列");
-    QTableWidgetItem* fileNameItem = new QTableWidgetItem(task->fileName());
-    fileNameItem->setToolTip(task->fileName()); // 完整文件名提示
-    ui->tableWidget->setItem(row, 0, fileNameItem);
-    
-    // URL
-    LOGD("设置URL列");
-    QTableWidgetItem* urlItem = new QTableWidgetItem(task->url());
-    urlItem->setToolTip(task->url()); // 完整URL提示
-    ui->tableWidget->setItem(row, 1, urlItem);
-
-    // 进度条
-    LOGD("创建进度条");
-    QProgressBar* progressBar = new QProgressBar(this);
-    progressBar->setRange(0, 100);
-    int progress = task->progressPercentage();
-    progressBar->setValue(progress);
-    ui->tableWidget->setCellWidget(row, 2, progressBar);
-    LOGD(QString("进度条设置完成，初始值:%1").arg(progress));
-
-    // 大小
-    LOGD("创建大小标签");
-    QLabel* sizeLabel = new QLabel(formatSizeCell(task->downloadedSize(), task->totalSize()), this);
-    sizeLabel->setAlignment(Qt::AlignCenter);
-    sizeLabel->setToolTip(tr("已下载: %1\n总大小: %2").arg(formatBytes(task->downloadedSize())).arg(formatBytes(task->totalSize())));
-    ui->tableWidget->setCellWidget(row, 3, sizeLabel);
-    LOGD("大小标签创建完成");
-
-    // 速度
-    LOGD("创建速度标签");
-    QLabel* speedLabel = new QLabel(formatSpeed(task->downloadSpeed()), this);
-    speedLabel->setAlignment(Qt::AlignCenter);
-    speedLabel->setToolTip(tr("当前下载速度: %1").arg(formatSpeed(task->downloadSpeed())));
-    ui->tableWidget->setCellWidget(row, 4, speedLabel);
-    LOGD("速度标签创建完成");
-
-    // 状态
-    LOGD("创建状态标签");
-    const QString pendingText = formatStatusCell(DownloadTaskStatus::Pending);
-    QLabel* statusLabel = new QLabel(pendingText, this);
-    statusLabel->setAlignment(Qt::AlignCenter);
-    statusLabel->setToolTip(tr("任务状态: %1").arg(pendingText));
-    ui->tableWidget->setCellWidget(row, 5, statusLabel);
-    LOGD("状态标签创建完成");
-
-    // 操作按钮
-    LOGD("设置操作列");
-    ui->tableWidget->setItem(row, 6, new QTableWidgetItem(tr("操作")));
-
-    // 将任务指针存储在行数据中
-    LOGD("存储任务指针到行数据中");
-    ui->tableWidget->item(row, 0)->setData(Qt::UserRole, QVariant::fromValue(task));
-    LOGD("任务指针已存储在行数据中");
-
-    // 连接任务信号
-    LOGD("开始连接任务信号");
-    connect(task, &DownloadTask::statusChanged, this, &MainWindow::onTaskStatusChanged);
-    LOGD("statusChanged信号连接完成");
-    connect(task, &DownloadTask::progressUpdated, this, &MainWindow::onTaskProgressUpdated);
-    LOGD("progressUpdated信号连接完成");
-    connect(task, &DownloadTask::finished, this, &MainWindow::onTaskFinished);
-    LOGD("finished信号连接完成");
-    connect(task, &DownloadTask::error, this, &MainWindow::onTaskError);
-    LOGD("error信号连接完成");
-    
-    LOGD("任务添加到表格完成");
-}
-
-void MainWindow::updateTaskInTable(DownloadTask* task)
-{
-    for (int row = 0; row < ui->tableWidget->rowCount(); ++row) {
-        QTableWidgetItem* item = ui->tableWidget->item(row, 0);
-        if (item && item->data(Qt::UserRole).value<DownloadTask*>() == task) {
-            // 更新进度条
-            QProgressBar* progressBar = qobject_cast<QProgressBar*>(ui->tableWidget->cellWidget(row, 2));
-            if (progressBar) {
-                progressBar->setValue(task->progressPercentage());
-            }
-
-            // 更新大小
-            QLabel* sizeLabel = qobject_cast<QLabel*>(ui->tableWidget->cellWidget(row, 3));
-            if (sizeLabel) {
-                const QString sizeText = formatSizeCell(task->downloadedSize(), task->totalSize());
-                sizeLabel->setText(sizeText);
-                sizeLabel->setToolTip(tr("已下载: %1\n总大小: %2").arg(formatBytes(task->downloadedSize())).arg(formatBytes(task->totalSize())));
-            }
-
-            // 更新速度
-            QLabel* speedLabel = qobject_cast<QLabel*>(ui->tableWidget->cellWidget(row, 4));
-            if (speedLabel) {
-                QString speedText = formatSpeed(task->downloadSpeed());
-                speedLabel->setText(speedText);
-                speedLabel->setToolTip(tr("当前下载速度: %1").arg(speedText));
-            }
-
-            // 更新状态
-            QLabel* statusLabel = qobject_cast<QLabel*>(ui->tableWidget->cellWidget(row, 5));
-            if (statusLabel) {
-                const QString statusText = formatStatusCell(task->status());
-                statusLabel->setText(statusText);
-                statusLabel->setToolTip(tr("任务状态: %1").arg(statusText));
-            }
-            return;
-        }
-    }
-}
-
-void MainWindow::removeTaskFromTable(DownloadTask* task)
-{
-    for (int row = 0; row < ui->tableWidget->rowCount(); ++row) {
-        QTableWidgetItem* item = ui->tableWidget->item(row, 0);
-        if (item && item->data(Qt::UserRole).value<DownloadTask*>() == task) {
-            ui->tableWidget->removeRow(row);
-            return;
-        }
+    QList<int> rows;
+    const QModelIndexList selected = ui->tableView->selectionModel()->selectedRows();
+    rows.reserve(selected.size());
+    for (const QModelIndex& index : selected) {
+        rows.append(index.row());
     }
+    return rows;
 }
 
 void MainWindow::showSystemNotification(const QString& title, const QString& message, QSystemTrayIcon::MessageIcon icon)
@@ -506,7 +316,8 @@ void MainWindow::showSystemNotification(const QString& title, const QString& mes
     }
 }
 
-void MainWindow::onNewDownloadRequestFromBrowser(const QString& url, const QString& savePath)
+void MainWindow::onNewDownloadRequestFromBrowser(const QString& url, const QString& savePath,
+                                                 const QList<QHostAddress>& addresses)
 {
     qDebug() << "Received download request from browser plugin. URL:" << url << "Save Path:" << savePath;
 
@@ -520,34 +331,9 @@ void MainWindow::onNewDownloadRequestFromBrowser(const QString& url, const QStri
     }
 
     QUrl urlObj(url);
-    QString fileName = urlObj.fileName();
-    if (fileName.isEmpty()) {
-        // 没有文件名时回退到默认名，避免生成空文件名导致任务无法落地
-        fileName = "download";
-    }
-
-    // 计算最终保存路径：插件传入的 savePath 形态多样，按以下规则归一化
-    //  (a) 空                               -> 默认下载目录 + fileName
-    //  (b) 已存在的目录 / 以分隔符结尾     -> 该目录下拼 fileName
-    //  (c) 裸文件名（无目录分量）           -> 默认下载目录 + 该文件名
-    //  (d) 完整路径（绝对或带目录的相对路径）-> 标准化分隔符后原样使用
-    const QString defaultDir = m_settingsManager.loadDefaultDownloadPath();
-    QString finalSavePath;
-    if (savePath.isEmpty()) {
-        finalSavePath = QDir(defaultDir).absoluteFilePath(fileName);
-    } else {
-        const QFileInfo info(savePath);
-        const bool endsWithSep = savePath.endsWith('/') || savePath.endsWith('\\');
-        if (info.isDir() || endsWithSep) {
-            finalSavePath = QDir(savePath).absoluteFilePath(fileName);
-        } else if (info.fileName() == savePath) {
-            // 关键：QFileInfo::fileName() 等于整段输入，说明完全没有目录分量。
-            // HttpServer 在 savePath 为空时把 filename 兜底发过来，落入此分支。
-            finalSavePath = QDir(defaultDir).absoluteFilePath(savePath);
-        } else {
-            finalSavePath = QDir::cleanPath(savePath);
-        }
-    }
+    const QString finalSavePath = DownloadManager::resolveSavePath(urlObj, savePath,
+                                                                   m_settingsManager.loadDefaultDownloadPath());
+    const QString fileName = QFileInfo(finalSavePath).fileName();
     LOGD(QString("解析 savePath:%1 -> finalSavePath:%2").arg(savePath, finalSavePath));
 
     DownloadTask* task = m_downloadManager.createTask(urlObj, finalSavePath, m_settingsManager.loadDefaultThreads());
@@ -555,10 +341,26 @@ void MainWindow::onNewDownloadRequestFromBrowser(const QString& url, const QStri
         qWarning() << "Failed to create download task from browser request:" << url;
         return;
     }
+    task->setPinnedAddresses(addresses);
     m_downloadManager.startTask(task);
     showSystemNotification(tr("新下载任务"), tr("已从浏览器插件接收到下载任务：%1").arg(fileName), QSystemTrayIcon::Information);
 }
 
+void MainWindow::onBatchDownloadQueued(int accepted, int rejected)
+{
+    LOGD(QString("浏览器插件批量投递：入队 %1 条，拒绝 %2 条").arg(accepted).arg(rejected));
+    if (accepted == 0 && rejected == 0) {
+        return;
+    }
+    const QSystemTrayIcon::MessageIcon icon = accepted > 0 ? QSystemTrayIcon::Information
+                                                           : QSystemTrayIcon::Warning;
+    QString message = tr("已从浏览器插件接收 %1 个下载任务").arg(accepted);
+    if (rejected > 0) {
+        message += tr("，%1 个链接被拒绝").arg(rejected);
+    }
+    showSystemNotification(tr("批量下载任务"), message, icon);
+}
+
 /**
  * @brief 处理新建下载任务
  * 
@@ -607,15 +409,11 @@ void MainWindow::on_actionNewTask_triggered()
         ui->statusbar->showMessage(tr("正在准备下载任务..."));
         LOGD("状态栏消息更新完成");
 
-        // 构造完整的文件路径：目录路径 + 文件名
+        // 构造完整的文件路径：目录路径 + 文件名。URL 没有文件名时取对话框探测到的
+        // Content-Disposition 名字（UrlMetadataCache），都没有再回退到默认名
         QUrl urlObj(url);
-        QString fileName = urlObj.fileName();
-        if (fileName.isEmpty()) {
-            // 如果URL没有文件名，使用默认名称
-            fileName = "download";
-        }
-        QString fullFilePath = QDir(savePath).absoluteFilePath(fileName);
-        LOGD(QString("构造完整文件路径: 目录=%1, 文件名=%2, 完整路径=%3").arg(savePath).arg(fileName).arg(fullFilePath));
+        QString fullFilePath = DownloadManager::resolveSavePath(urlObj, savePath, savePath);
+        LOGD(QString("构造完整文件路径: 目录=%1, 完整路径=%2").arg(savePath).arg(fullFilePath));
 
         LOGD("调用 m_downloadManager.createTask");
         DownloadTask* task = m_downloadManager.createTask(urlObj, fullFilePath, threads);
@@ -650,15 +448,13 @@ void MainWindow::on_actionNewTask_triggered()
 
 void MainWindow::on_actionStartAll_triggered()
 {
+    // 表格里还活着的行就是 DownloadManager 的活动任务，直接遍历它们，不扫表格
     int startedCount = 0;
-    for (int row = 0; row < ui->tableWidget->rowCount(); ++row) {
-        QTableWidgetItem* item = ui->tableWidget->item(row, 0);
-        if (item) {
-            DownloadTask* task = item->data(Qt::UserRole).value<DownloadTask*>();
-            if (task && (task->status() == DownloadTaskStatus::Pending || task->status() == DownloadTaskStatus::Failed)) {
-                m_downloadManager.startTask(task);
-                startedCount++;
-            }
+    const QList<DownloadTask*> tasks = m_downloadManager.tasks();
+    for (DownloadTask* task : tasks) {
+        if (task->status() == DownloadTaskStatus::Pending || task->status() == DownloadTaskStatus::Failed) {
+            m_downloadManager.startTask(task);
+            startedCount++;
         }
     }
 
@@ -672,14 +468,11 @@ void MainWindow::on_actionStartAll_triggered()
 void MainWindow::on_actionPauseAll_triggered()
 {
     int pausedCount = 0;
-    for (int row = 0; row < ui->tableWidget->rowCount(); ++row) {
-        QTableWidgetItem* item = ui->tableWidget->item(row, 0);
-        if (item) {
-            DownloadTask* task = item->data(Qt::UserRole).value<DownloadTask*>();
-            if (task && task->status() == DownloadTaskStatus::Downloading) {
-                task->pause();
-                pausedCount++;
-            }
+    const QList<DownloadTask*> tasks = m_downloadManager.tasks();
+    for (DownloadTask* task : tasks) {
+        if (task->status() == DownloadTaskStatus::Downloading) {
+            task->pause();
+            pausedCount++;
         }
     }
 
@@ -692,27 +485,25 @@ void MainWindow::on_actionPauseAll_triggered()
 
 void MainWindow::on_actionCancelSelected_triggered()
 {
-    QList<QTableWidgetItem*> selectedItems = ui->tableWidget->selectedItems();
-    if (selectedItems.isEmpty()) {
+    const QList<int> selectedRows = selectedTaskRows();
+    if (selectedRows.isEmpty()) {
         QMessageBox::information(this, tr("提示"), tr("请先选择要取消的任务。"));
         return;
     }
 
-    // 获取选中的行
-    QSet<int> selectedRows;
-    for (QTableWidgetItem* item : selectedItems) {
-        selectedRows.insert(item->row());
-    }
-
     int cancelledCount = 0;
     for (int row : selectedRows) {
-        QTableWidgetItem* item = ui->tableWidget->item(row, 0);
-        if (item) {
-            DownloadTask* task = item->data(Qt::UserRole).value<DownloadTask*>();
-            if (task && (task->status() == DownloadTaskStatus::Downloading || task->status() == DownloadTaskStatus::Paused)) {
-                task->cancel(true); // 取消并删除临时文件
+        // 排队条目还没有任务：直接出队，行保留并显示"已取消"
+        if (m_taskModel->isQueuedAt(row)) {
+            if (m_downloadManager.cancelQueued(m_taskModel->idAt(row))) {
                 cancelledCount++;
             }
+            continue;
+        }
+        DownloadTask* task = m_taskModel->taskAt(row);
+        if (task && (task->status() == DownloadTaskStatus::Downloading || task->status() == DownloadTaskStatus::Paused)) {
+            task->cancel(true); // 取消并删除临时文件
+            cancelledCount++;
         }
     }
 
@@ -725,18 +516,12 @@ void MainWindow::on_actionCancelSelected_triggered()
 
 void MainWindow::on_actionDeleteSelected_triggered()
 {
-    QList<QTableWidgetItem*> selectedItems = ui->tableWidget->selectedItems();
-    if (selectedItems.isEmpty()) {
+    const QList<int> selectedRows = selectedTaskRows();
+    if (selectedRows.isEmpty()) {
         QMessageBox::information(this, tr("提示"), tr("请先选择要删除的任务。"));
         return;
     }
 
-    // 获取选中的行
-    QSet<int> selectedRows;
-    for (QTableWidgetItem* item : selectedItems) {
-        selectedRows.insert(item->row());
-    }
-
     // 确认删除
     int ret = QMessageBox::question(this, tr("确认删除"), 
                                    tr("确定要删除选中的 %1 个任务吗？").arg(selectedRows.size()),
@@ -746,26 +531,20 @@ void MainWindow::on_actionDeleteSelected_triggered()
         return;
     }
 
-    int deletedCount = 0;
-    // 从后往前删除，避免索引变化问题
-    QList<int> rowsToDelete = selectedRows.values();
-    std::sort(rowsToDelete.begin(), rowsToDelete.end(), std::greater<int>());
-    
-    for (int row : rowsToDelete) {
-        QTableWidgetItem* item = ui->tableWidget->item(row, 0);
-        if (item) {
-            DownloadTask* task = item->data(Qt::UserRole).value<DownloadTask*>();
-            if (task) {
-                // 取消任务（如果还在运行）
-                if (task->status() == DownloadTaskStatus::Downloading || task->status() == DownloadTaskStatus::Paused) {
-                    task->cancel(true);
-                }
-                // 从表格中移除
-                ui->tableWidget->removeRow(row);
-                deletedCount++;
-            }
+    for (int row : selectedRows) {
+        if (m_taskModel->isQueuedAt(row)) {
+            m_downloadManager.cancelQueued(m_taskModel->idAt(row));
+            continue;
+        }
+        DownloadTask* task = m_taskModel->taskAt(row);
+        // 取消任务（如果还在运行）；已结束的行只从表格移除
+        if (task && (task->status() == DownloadTaskStatus::Downloading || task->status() == DownloadTaskStatus::Paused)) {
+            task->cancel(true);
         }
     }
+    // 模型按连续段批量删除并重建编号索引
+    m_taskModel->removeRowsAt(selectedRows);
+    const int deletedCount = int(selectedRows.size());
 
     if (deletedCount > 0) {
         ui->statusbar->showMessage(tr("已删除 %1 个任务").arg(deletedCount));
@@ -774,27 +553,18 @@ void MainWindow::on_actionDeleteSelected_triggered()
 
 void MainWindow::on_actionPauseSelected_triggered()
 {
-    QList<QTableWidgetItem*> selectedItems = ui->tableWidget->selectedItems();
-    if (selectedItems.isEmpty()) {
+    const QList<int> selectedRows = selectedTaskRows();
+    if (selectedRows.isEmpty()) {
         QMessageBox::information(this, tr("提示"), tr("请先选择要暂停的任务。"));
         return;
     }
 
-    // 获取选中的行
-    QSet<int> selectedRows;
-    for (QTableWidgetItem* item : selectedItems) {
-        selectedRows.insert(item->row());
-    }
-
     // 收集需要暂停的任务
     QList<DownloadTask*> tasksToStop;
     for (int row : selectedRows) {
-        QTableWidgetItem* item = ui->tableWidget->item(row, 0);
-        if (item) {
-            DownloadTask* task = item->data(Qt::UserRole).value<DownloadTask*>();
-            if (task && task->status() == DownloadTaskStatus::Downloading) {
-                tasksToStop.append(task);
-            }
+        DownloadTask* task = m_taskModel->taskAt(row);
+        if (task && task->status() == DownloadTaskStatus::Downloading) {
+            tasksToStop.append(task);
         }
     }
 
@@ -814,7 +584,7 @@ void MainWindow::on_actionPauseSelected_triggered()
     m_pauseProgress->show();
 
     // 原来的 QtConcurrent::map 会让 lambda 在线程池里与表格行变更并发，
-    // 引发 QTableWidgetItem 写入竞争。这里改成同步循环：UI 暂停期间无新写入，
+    // 引发表格写入竞争。这里改成同步循环：UI 暂停期间无新写入，
     // 通过 QMutexLocker 短暂持有 m_tableMutex 防止重入；进度条仍能反映进度。
     int done = 0;
     bool cancelled = false;
@@ -842,25 +612,16 @@ void MainWindow::on_actionPauseSelected_triggered()
 
 void MainWindow::on_actionResumeSelected_triggered()
 {
-    QList<QTableWidgetItem*> selectedItems = ui->tableWidget->selectedItems();
-    if (selectedItems.isEmpty()) {
+    const QList<int> selectedRows = selectedTaskRows();
+    if (selectedRows.isEmpty()) {
         QMessageBox::information(this, tr("提示"), tr("请先选择要继续的任务。"));
         return;
     }
 
-    // 获取选中的行
-    QSet<int> selectedRows;
-    for (QTableWidgetItem* item : selectedItems) {
-        selectedRows.insert(item->row());
-    }
-
     for (int row : selectedRows) {
-        QTableWidgetItem* item = ui->tableWidget->item(row, 0);
-        if (item) {
-            DownloadTask* task = item->data(Qt::UserRole).value<DownloadTask*>();
-            if (task && task->status() == DownloadTaskStatus::Paused) {
-                task->resume();
-            }
+        DownloadTask* task = m_taskModel->taskAt(row);
+        if (task && task->status() == DownloadTaskStatus::Paused) {
+            task->resume();
         }
     }
 }
@@ -886,7 +647,10 @@ void MainWindow::onTaskAdded(DownloadTask* task)
 
     if (task) {
         LOGD("开始添加任务到表格");
-        addTaskToTable(task);
+        m_taskModel->addTask(task);
+        connect(task, &DownloadTask::statusChanged, this, &MainWindow::onTaskStatusChanged);
+        connect(task, &DownloadTask::finished, this, &MainWindow::onTaskFinished);
+        connect(task, &DownloadTask::error, this, &MainWindow::onTaskError);
         LOGD("任务已添加到表格");
 
         ui->statusbar->showMessage(tr("新任务已添加：%1").arg(task->fileName()));
@@ -896,12 +660,6 @@ void MainWindow::onTaskAdded(DownloadTask* task)
         LOGD("显示系统托盘通知");
         showSystemNotification(tr("新任务"), tr("已添加任务：%1").arg(task->fileName()), QSystemTrayIcon::Information);
         LOGD("系统托盘通知已显示");
-
-        // 有新任务时确保 UI 更新定时器处于运行状态
-        if (!m_uiUpdateTimer->isActive()) {
-            m_uiIdleTicks = 0;
-            m_uiUpdateTimer->start(200);
-        }
     } else {
         LOGD("任务指针为空，无法添加");
     }
@@ -916,7 +674,7 @@ void MainWindow::onTaskStatusChanged(DownloadTaskStatus status)
     DownloadTask* task = qobject_cast<DownloadTask*>(sender());
     if (task) {
         LOGD(QString("任务有效，文件名:%1，开始更新表格").arg(task->fileName()));
-        updateTaskInTable(task);
+        m_taskModel->refreshTask(task);
         LOGD("表格更新完成");
         
         QString statusText;
@@ -939,38 +697,43 @@ void MainWindow::onTaskStatusChanged(DownloadTaskStatus status)
     LOGD("任务状态变更处理完成");
 }
 
-void MainWindow::onTaskProgressUpdated(qint64 bytesReceived, qint64 totalBytes, qint64 speed)
+void MainWindow::onTelemetryUpdated(const QList<TaskTelemetry>& snapshot)
 {
-    DownloadTask* raw = qobject_cast<DownloadTask*>(sender());
-    QPointer<DownloadTask> safeTask(raw);
-    if (safeTask) {
-        DownloadTask* task = safeTask.data();
-        // 进度日志节流：每 10% 记录一次（用成员 m_lastLoggedProgress 替代原来的 static QHash，
-        // 避免 static 跨实例共享并防止退出时泄漏）。
-        int currentProgress = task->progressPercentage();
-
-        QPointer<DownloadTask> key(task);
-        qint64 last = m_lastLoggedProgress.value(key, -1);
-        if (last < 0 || currentProgress - last >= 10) {
-            LOGD(QString("任务进度更新 - 文件:%1 进度:%2% 已接收:%3 总大小:%4 速度:%5")
-                 .arg(task->fileName())
-                 .arg(currentProgress)
-                 .arg(bytesReceived)
-                 .arg(totalBytes)
-                 .arg(speed));
-            m_lastLoggedProgress.insert(key, currentProgress);
+    // 模型按任务编号定位行，只对值有变化的行发 dataChanged；视图只重画其中可见的部分
+    m_taskModel->applyTelemetry(snapshot);
+
+    const TaskTelemetry* lastActive = nullptr;
+    for (const TaskTelemetry& sample : snapshot) {
+        if (m_taskModel->rowOfTask(sample.task->id()) < 0) {
+            continue;
         }
 
-        // 收到进度回调时确保定时器是运行的（防止上面 stop 后没有重新启动）
-        {
-            QMutexLocker locker(&m_tableMutex);
-            m_tasksToUpdate.insert(safeTask);
+        // 进度日志节流：每 10% 记录一次
+        QPointer<DownloadTask> key(sample.task);
+        const qint64 last = m_lastLoggedProgress.value(key, -1);
+        if (last < 0 || sample.percent - last >= 10) {
+            LOGD(QString("任务进度更新 - 文件:%1 进度:%2% 已接收:%3 总大小:%4 速度:%5 剩余:%6秒")
+                 .arg(sample.task->fileName())
+                 .arg(sample.percent)
+                 .arg(sample.downloadedBytes)
+                 .arg(sample.totalBytes)
+                 .arg(sample.speed)
+                 .arg(sample.etaSeconds));
+            m_lastLoggedProgress.insert(key, sample.percent);
         }
-        if (!m_uiUpdateTimer->isActive()) {
-            m_uiIdleTicks = 0;
-            m_uiUpdateTimer->start(200);
+
+        if (sample.status == DownloadTaskStatus::Downloading && sample.phase == FinalizePhase::None) {
+            lastActive = &sample;
         }
     }
+
+    // 更新状态栏（只显示最后一个活动任务的信息）
+    if (lastActive) {
+        ui->statusbar->showMessage(tr("下载中：%1 - %2% (%3/s)")
+                                   .arg(lastActive->task->fileName())
+                                   .arg(lastActive->percent)
+                                   .arg(TaskTableModel::formatSpeed(lastActive->speed)));
+    }
 }
 
 void MainWindow::onTaskFinished()
@@ -982,7 +745,7 @@ void MainWindow::onTaskFinished()
         LOGD(QString("任务完成 - 文件:%1 最终状态:%2").arg(task->fileName()).arg(static_cast<int>(task->status())));
         
         LOGD("更新表格中的任务状态");
-        updateTaskInTable(task); // 确保最终状态更新
+        m_taskModel->refreshTask(task); // 确保最终状态更新（任务释放后行里保留这份最终值）
         LOGD("表格状态更新完成");
         
         if (task->status() == DownloadTaskStatus::Completed) {
@@ -997,8 +760,7 @@ void MainWindow::onTaskFinished()
         }
         
         LOGD("系统通知已显示");
-        // 任务完成后，DownloadManager会负责deleteLater，这里不需要removeTaskFromTable
-        // removeTaskFromTable(task);
+        // 任务完成后，DownloadManager会负责deleteLater；行保留最终状态，taskAt() 之后返回 nullptr
     } else {
         LOGD("sender不是有效的DownloadTask对象");
     }
@@ -1015,7 +777,7 @@ void MainWindow::onTaskError(const QString& errorString)
         LOGD(QString("任务错误 - 文件:%1 错误:%2").arg(task->fileName()).arg(errorString));
         
         LOGD("更新表格中的任务状态为失败");
-        updateTaskInTable(task); // 确保状态更新为失败
+        m_taskModel->refreshTask(task); // 确保状态更新为失败
         LOGD("表格状态更新完成");
         
         LOGD("显示错误系统通知");
@@ -1052,17 +814,15 @@ void MainWindow::refreshSelectionActionStates()
     // 选中至少一个 Downloading 任务 → Pause 启用；
     // 选中至少一个 Paused 任务       → Resume 启用；
     // 选中至少一个可取消（Downloading/Paused/Pending/Failed）的任务 → Cancel 启用。
-    if (!ui || !ui->tableWidget) return;
-    const QList<QTableWidgetItem*> selected = ui->tableWidget->selectedItems();
+    if (!ui || !ui->tableView) return;
     bool canPause = false, canResume = false, canCancel = false;
-    QSet<int> seen;
-    for (QTableWidgetItem* it : selected) {
-        int row = it->row();
-        if (seen.contains(row)) continue;
-        seen.insert(row);
-        QTableWidgetItem* col0 = ui->tableWidget->item(row, 0);
-        if (!col0) continue;
-        DownloadTask* task = col0->data(Qt::UserRole).value<DownloadTask*>();
+    const QList<int> selectedRows = selectedTaskRows();
+    for (int row : selectedRows) {
+        if (m_taskModel->isQueuedAt(row)) {
+            canCancel = true;
+            continue;
+        }
+        DownloadTask* task = m_taskModel->taskAt(row);
         if (!task) continue;
         switch (task->status()) {
             case DownloadTaskStatus::Downloading: canPause = true; canCancel = true; break;
@@ -1077,6 +837,55 @@ void MainWindow::refreshSelectionActionStates()
     if (ui->actionCancelSelected)  ui->actionCancelSelected->setEnabled(canCancel);
 }
 
+void MainWindow::onTaskContextMenu(const QPoint& pos)
+{
+    if (selectedTaskRows().isEmpty()) {
+        return;
+    }
+    refreshSelectionActionStates();
+
+    QMenu menu(this);
+    menu.addAction(ui->actionPauseSelected);
+    menu.addAction(ui->actionResumeSelected);
+    menu.addAction(ui->actionCancelSelected);
+    menu.addSeparator();
+    QAction* raise = menu.addAction(tr("提高优先级"));
+    QAction* lower = menu.addAction(tr("降低优先级"));
+    QAction* chosen = menu.exec(ui->tableView->viewport()->mapToGlobal(pos));
+    if (chosen == raise) {
+        changeSelectedPriority(1);
+    } else if (chosen == lower) {
+        changeSelectedPriority(-1);
+    }
+}
+
+void MainWindow::changeSelectedPriority(int delta)
+{
+    int changed = 0;
+    for (int row : selectedTaskRows()) {
+        // 排队条目按新优先级重新排队；活动任务的 worker 按新优先级提交到线程池
+        if (m_taskModel->isQueuedAt(row)) {
+            const quint64 id = m_taskModel->idAt(row);
+            QueuedTask entry;
+            if (m_downloadManager.findQueued(id, &entry)
+                && m_downloadManager.setQueuedPriority(id, entry.priority + delta)) {
+                ++changed;
+            }
+            continue;
+        }
+        DownloadTask* task = m_taskModel->taskAt(row);
+        if (task && (task->status() == DownloadTaskStatus::Downloading
+                     || task->status() == DownloadTaskStatus::Paused
+                     || task->status() == DownloadTaskStatus::Pending)) {
+            m_downloadManager.setTaskPriority(task, task->priority() + delta);
+            ++changed;
+        }
+    }
+    if (changed > 0) {
+        ui->statusbar->showMessage(tr("已调整 %1 个任务的优先级").arg(changed));
+    }
+}
+
 void MainWindow::closeEvent(QCloseEvent *event)
 {
     // 如果是程序主动退出（托盘退出/File->Exit），直接接受关闭事件
@@ -1087,19 +896,13 @@ void MainWindow::closeEvent(QCloseEvent *event)
 
     // 只有当存在正在下载/暂停的任务时，才允许最小化到托盘；
     // 否则按"用户关闭窗口"直接退出，避免历史遗留"按 X 永远不退出"的体验。
-    bool hasActive = false;
-    if (ui && ui->tableWidget) {
-        QMutexLocker locker(&m_tableMutex);
-        for (int row = 0; row < ui->tableWidget->rowCount(); ++row) {
-            QTableWidgetItem* col0 = ui->tableWidget->item(row, 0);
-            if (!col0) continue;
-            DownloadTask* task = col0->data(Qt::UserRole).value<DownloadTask*>();
-            if (task) {
-                const auto st = task->status();
-                if (st == DownloadTaskStatus::Downloading || st == DownloadTaskStatus::Paused) {
-                    hasActive = true; break;
-                }
-            }
+    // 排队中的条目也算：它们还要在后台逐个开始
+    bool hasActive = m_downloadManager.queuedCount() > 0;
+    const QList<DownloadTask*> tasks = m_downloadManager.tasks();
+    for (DownloadTask* task : tasks) {
+        const auto st = task->status();
+        if (st == DownloadTaskStatus::Downloading || st == DownloadTaskStatus::Paused) {
+            hasActive = true; break;
         }
     }
 
@@ -1118,16 +921,16 @@ void MainWindow::resizeEvent(QResizeEvent *event)
     QMainWindow::resizeEvent(event);
     
     // 窗口大小改变时，确保表格列宽合理分配
-    if (ui->tableWidget && ui->tableWidget->columnCount() > 0) {
-        int totalWidth = ui->tableWidget->viewport()->width();
+    if (ui->tableView && m_taskModel && m_taskModel->columnCount() > 0) {
+        int totalWidth = ui->tableView->viewport()->width();
         
         // 计算固定列的总宽度
-        int fixedWidth = ui->tableWidget->columnWidth(2) + ui->tableWidget->columnWidth(6); // 进度条 + 操作列
+        int fixedWidth = ui->tableView->columnWidth(2) + ui->tableView->columnWidth(6); // 进度条 + 操作列
         int contentWidth = 0;
         
         // 计算内容自适应列的宽度
         for (int i = 3; i <= 5; ++i) {
-            contentWidth += ui->tableWidget->columnWidth(i);
+            contentWidth += ui->tableView->columnWidth(i);
         }
         
         // 剩余宽度分配给文件名和URL列
@@ -1141,7 +944,7 @@ void MainWindow::resizeEvent(QResizeEvent *event)
             fileNameWidth = qMin(fileNameWidth, 300);
             urlWidth = qMin(urlWidth, 500);
             
-            ui->tableWidget->setColumnWidth(0, fileNameWidth);
+            ui->tableView->setColumnWidth(0, fileNameWidth);
         }
     }
 }
@@ -1221,13 +1024,8 @@ void MainWindow::switchLanguage(const QString& language)
     // 重新翻译UI
     ui->retranslateUi(this);
 
-    // 重新设置表头标签（动态设置，不在 .ui 里的）
-    ui->tableWidget->setHorizontalHeaderLabels({
-        tr("文件名"), tr("URL"), tr("进度"), tr("大小"), tr("速度"), tr("状态"), tr("操作")
-    });
-
-    // 表格 cell widget 的动态文案（状态、tooltip 等）需要重排。
-    refreshCellWidgetTexts();
+    // 表头与单元格文案（状态、tooltip 等）由模型按当前语言重新生成
+    m_taskModel->retranslate();
 
     // 更新语言菜单状态
     updateLanguageMenu();
@@ -1248,12 +1046,11 @@ void MainWindow::changeEvent(QEvent* event)
     if (event && event->type() == QEvent::LanguageChange) {
         // 这是 Qt 派发过来的翻译器变更通知。Window 本身的 .ui 已经被 ui_X 自动
         // retranslate（由 ui->retranslateUi(this) 流程包揽），但本类还有动态
-        // 设置的字符串（表头、cell widget），需要主动重排。
+        // 设置的字符串（表头、单元格文案），需要主动重排。
         ui->retranslateUi(this);
-        ui->tableWidget->setHorizontalHeaderLabels({
-            tr("文件名"), tr("URL"), tr("进度"), tr("大小"), tr("速度"), tr("状态"), tr("操作")
-        });
-        refreshCellWidgetTexts();
+        if (m_taskModel) {
+            m_taskModel->retranslate();
+        }
         updateLanguageMenu();
     }
     QMainWindow::changeEvent(event);
@@ -1275,56 +1072,6 @@ void MainWindow::updateLanguageMenu()
     }
 }
 
-/**
- * @brief UI更新定时器超时处理
- * 
- * 每200毫秒触发一次，用于批量更新任务状态：
- * 1. 遍历m_tasksToUpdate集合中的所有任务
- * 2. 调用updateTaskInTable更新每个任务的UI状态
- * 3. 在状态栏显示最后一个活动任务的信息
- * 4. 清空任务集合准备下一轮更新
- * 
- * 这种批量更新机制可以显著减少频繁UI更新带来的性能开销
- */
-void MainWindow::onUiUpdateTimerTimeout()
-{
-    // 取出本轮需要刷新的任务，复制出来以避免与 producer（progressUpdated 等信号）的写入并发。
-    // 用 QPointer 是因为 task 可能在 set 取出到 update 之间被 deleteLater（task 完成/取消路径）。
-    QSet<QPointer<DownloadTask>> snapshot;
-    {
-        QMutexLocker locker(&m_tableMutex);
-        if (m_tasksToUpdate.isEmpty()) {
-            if (++m_uiIdleTicks >= 3 && m_uiUpdateTimer->isActive()) {
-                m_uiUpdateTimer->stop();
-                m_uiIdleTicks = 3;
-            }
-            return;
-        }
-        snapshot = m_tasksToUpdate;
-        m_tasksToUpdate.clear();
-    }
-    m_uiIdleTicks = 0;
-
-    // 批量更新；任务可能在 update 期间被销毁，updateTaskInTable 自身需有 QPointer 守卫。
-    DownloadTask* lastActiveTask = nullptr;
-    for (const QPointer<DownloadTask>& p : std::as_const(snapshot)) {
-        DownloadTask* task = p.data();
-        if (!task) continue; // 已 deleteLater，跳过
-        updateTaskInTable(task);
-        if (task->status() == DownloadTaskStatus::Downloading) {
-            lastActiveTask = task;
-        }
-    }
-
-    // 更新状态栏（只显示最后一个活动任务的信息）
-    if (lastActiveTask) {
-        ui->statusbar->showMessage(tr("下载中：%1 - %2% (%3/s)")
-                                   .arg(lastActiveTask->fileName())
-                                   .arg(lastActiveTask->progressPercentage())
-                                   .arg(formatSpeed(lastActiveTask->downloadSpeed())));
-    }
-}
-
 /**
  * @brief 配置响应式表格列宽
  * 
@@ -1342,41 +1089,42 @@ void MainWindow::onUiUpdateTimerTimeout()
  */
 void MainWindow::setupTableBasicProperties()
 {
-    QHeaderView* header = ui->tableWidget->horizontalHeader();
+    QHeaderView* header = ui->tableView->horizontalHeader();
     
     // 设置表格基本属性
-    ui->tableWidget->setWordWrap(true);
-    ui->tableWidget->setTextElideMode(Qt::ElideMiddle);
+    ui->tableView->setWordWrap(true);
+    ui->tableView->setTextElideMode(Qt::ElideMiddle);
     header->setStretchLastSection(false);
     
     // 优化表格外观
-    ui->tableWidget->setGridStyle(Qt::SolidLine);
-    ui->tableWidget->setShowGrid(true);
+    ui->tableView->setGridStyle(Qt::SolidLine);
+    ui->tableView->setShowGrid(true);
     header->setHighlightSections(false);
     header->setSectionsMovable(false);
     
     // 设置行高
-    ui->tableWidget->verticalHeader()->setDefaultSectionSize(36);
-    ui->tableWidget->verticalHeader()->setMinimumSectionSize(32);
-    ui->tableWidget->verticalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    ui->tableView->verticalHeader()->setDefaultSectionSize(36);
+    ui->tableView->verticalHeader()->setMinimumSectionSize(32);
+    // 固定行高：ResizeToContents 要为每一行测量内容，行数一多滚动与刷新都会卡
+    ui->tableView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
     
     // 设置选择行为和焦点策略
-    ui->tableWidget->setFocusPolicy(Qt::StrongFocus);
-    ui->tableWidget->setMouseTracking(true);
+    ui->tableView->setFocusPolicy(Qt::StrongFocus);
+    ui->tableView->setMouseTracking(true);
 }
 
 void MainWindow::configureColumnWidths()
 {
-    QHeaderView* header = ui->tableWidget->horizontalHeader();
+    QHeaderView* header = ui->tableView->horizontalHeader();
     const int minWidths[] = {120, 200, 120, 80, 80, 80, 80};
     const int maxWidths[] = {300, 400, 150, 120, 120, 100, 100};
     
     // 固定宽度列
     header->setSectionResizeMode(2, QHeaderView::Fixed);
-    ui->tableWidget->setColumnWidth(2, 120);
+    ui->tableView->setColumnWidth(2, 120);
     
     header->setSectionResizeMode(6, QHeaderView::Fixed);
-    ui->tableWidget->setColumnWidth(6, 80);
+    ui->tableView->setColumnWidth(6, 80);
     
     // 自适应内容列
     header->setSectionResizeMode(3, QHeaderView::ResizeToContents);
@@ -1386,26 +1134,26 @@ void MainWindow::configureColumnWidths()
     // 设置最小宽度
     for (int i = 3; i <= 5; ++i) {
         header->setMinimumSectionSize(minWidths[i]);
-        if (ui->tableWidget->columnWidth(i) < minWidths[i]) {
-            ui->tableWidget->setColumnWidth(i, minWidths[i]);
+        if (ui->tableView->columnWidth(i) < minWidths[i]) {
+            ui->tableView->setColumnWidth(i, minWidths[i]);
         }
     }
     
     // 文件名列
     header->setSectionResizeMode(0, QHeaderView::Interactive);
-    ui->tableWidget->setColumnWidth(0, 150);
+    ui->tableView->setColumnWidth(0, 150);
     header->setMinimumSectionSize(minWidths[0]);
     
     // URL列
     header->setSectionResizeMode(1, QHeaderView::Stretch);
-    if (ui->tableWidget->columnWidth(1) < minWidths[1]) {
-        ui->tableWidget->setColumnWidth(1, minWidths[1]);
+    if (ui->tableView->columnWidth(1) < minWidths[1]) {
+        ui->tableView->setColumnWidth(1, minWidths[1]);
     }
 }
 
 void MainWindow::setupHeaderBehavior()
 {
-    connect(ui->tableWidget->horizontalHeader(), &QHeaderView::sectionResized, this, [this](int logicalIndex, int oldSize, int newSize) {
+    connect(ui->tableView->horizontalHeader(), &QHeaderView::sectionResized, this, [this](int logicalIndex, int oldSize, int newSize) {
         Q_UNUSED(oldSize)
 
         const int minWidths[] = {120, 200, 120, 80, 80, 80, 80};
@@ -1418,16 +1166,16 @@ void MainWindow::setupHeaderBehavior()
         // URL 列（索引1）特殊处理：固定一个最小宽度，不让用户拖到 0
         if (logicalIndex == 1) {
             if (newSize < minWidths[1]) {
-                ui->tableWidget->setColumnWidth(1, minWidths[1]);
+                ui->tableView->setColumnWidth(1, minWidths[1]);
             }
             // URL 列是 Stretch 模式，不强制上限
             return;
         }
 
         if (newSize < minWidths[logicalIndex]) {
-            ui->tableWidget->setColumnWidth(logicalIndex, minWidths[logicalIndex]);
+            ui->tableView->setColumnWidth(logicalIndex, minWidths[logicalIndex]);
         } else if (newSize > maxWidths[logicalIndex]) {
-            ui->tableWidget->setColumnWidth(logicalIndex, maxWidths[logicalIndex]);
+            ui->tableView->setColumnWidth(logicalIndex, maxWidths[logicalIndex]);
         }
     });
 }
@@ -1610,4 +1358,34 @@ void MainWindow::onSingleInstanceMessage(const QByteArray& payload)
         LOGD(QString("MainWindow::onSingleInstanceMessage: 未知 payload: %1")
              .arg(QString::fromUtf8(payload.left(64))));
     }
+}
+
+void MainWindow::onSingleInstanceRequest(const QJsonObject& request, const SingleInstance::Reply& reply)
+{
+    const QString type = request.value(QStringLiteral("type")).toString();
+    if (type != QLatin1String("download")) {
+        reply(QJsonObject{{"status", "error"}, {"message", QStringLiteral("unknown request type: %1").arg(type)}});
+        return;
+    }
+
+    QString url, host, target, err;
+    if (!HttpServer::validateDownloadRequest(request, &url, &host, &target, &err)) {
+        LOGD(QString("MainWindow::onSingleInstanceRequest: 拒绝 %1").arg(err));
+        reply(QJsonObject{{"status", "error"}, {"message", err}});
+        return;
+    }
+
+    // 与 /download 一样先过 HostGuard，校验过的地址随任务下发
+    QPointer<MainWindow> safeThis(this);
+    HostGuard::instance().check(host, this, [safeThis, url, target, reply](const HostVerdict& verdict) {
+        if (!safeThis) return;
+        if (!verdict.allowed) {
+            LOGD(QString("MainWindow::onSingleInstanceRequest: SSRF 拒绝 %1 - %2").arg(url, verdict.error));
+            reply(QJsonObject{{"status", "error"},
+                              {"message", QStringLiteral("invalid url: %1").arg(verdict.error)}});
+            return;
+        }
+        reply(QJsonObject{{"status", "success"}, {"message", "Download request received"}});
+        safeThis->onNewDownloadRequestFromBrowser(url, target, verdict.addresses);
+    });
 }
\ No newline at end of file
@@ -2,7 +2,7 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
-#include <QTableWidget>
+#include <QTableView>
 #include <QProgressBar>
 #include <QProgressDialog>
 #include <QLabel>
@@ -16,6 +16,7 @@
 #include <QSystemTrayIcon> // For system notifications
 #include <QHeaderView>
 #include <QTimer>
+#include <QHostAddress>
 #include <QResizeEvent>
 #include <QStyledItemDelegate>
 #include <QPainter>
@@ -29,6 +30,7 @@
 #include "singleinstance.h"
 #include "scheduledialog.h"
 #include "historydialog.h"
+#include "tasktablemodel.h"
 
 // Qt's QSet/QHash require a qHash() overload for the key type. QPointer<T> doesn't
 // ship one, so we provide one at namespace scope. This MUST be at file scope (not
@@ -66,8 +68,17 @@ public slots:
      * @brief 处理来自浏览器插件的新下载请求。
      * @param url 文件的URL。
      * @param savePath 建议的保存路径。
+     * @param addresses HttpServer SSRF 校验过的地址（钉住连接目标）；其它入口为空。
      */
-    void onNewDownloadRequestFromBrowser(const QString& url, const QString& savePath);
+    void onNewDownloadRequestFromBrowser(const QString& url, const QString& savePath,
+                                         const QList<QHostAddress>& addresses = QList<QHostAddress>());
+
+    /**
+     * @brief 浏览器插件批量投递完成（任务已由 HttpServer 入队），只发一条汇总通知。
+     * @param accepted 入队条数。
+     * @param rejected 被拒绝条数。
+     */
+    void onBatchDownloadQueued(int accepted, int rejected);
 
     /**
      * @brief 启动入口 URL 注入（main.cpp 单实例 self-start 路径上调用）。
@@ -85,6 +96,12 @@ private slots:
      */
     void onSingleInstanceMessage(const QByteArray& payload);
 
+    /**
+     * @brief SingleInstance::requestReceived 槽：浏览器原生消息宿主转来的 JSON 请求。
+     * 与 HttpServer 的 /download 做同样的校验（字段、URL、文件名、HostGuard），通过后入队并应答。
+     */
+    void onSingleInstanceRequest(const QJsonObject& request, const SingleInstance::Reply& reply);
+
 private slots:
     /**
      * @brief 处理“新建任务”按钮点击事件。
@@ -144,12 +161,10 @@ private slots:
     void onTaskStatusChanged(DownloadTaskStatus status);
 
     /**
-     * @brief 处理DownloadTask发出的progressUpdated信号。
-     * @param bytesReceived 已下载的字节数。
-     * @param totalBytes 文件总字节数。
-     * @param speed 当前下载速度。
+     * @brief 处理DownloadManager发出的telemetryUpdated遥测快照，整批刷新表格与状态栏。
+     * @param snapshot 本周期所有活动任务的采样结果。
      */
-    void onTaskProgressUpdated(qint64 bytesReceived, qint64 totalBytes, qint64 speed);
+    void onTelemetryUpdated(const QList<TaskTelemetry>& snapshot);
 
     /**
      * @brief 处理DownloadTask发出的finished信号。
@@ -211,11 +226,6 @@ private slots:
     void on_actionViewHistory_triggered();
 
 private slots:
-    /**
-     * @brief 定时更新UI，用于节流。
-     */
-    void onUiUpdateTimerTimeout();
-
     /**
      * @brief 处理 File->Exit 菜单项（避免被 closeEvent 当作最小化到托盘）。
      */
@@ -226,6 +236,12 @@ private slots:
      */
     void refreshSelectionActionStates();
 
+    /**
+     * @brief 任务列表右键菜单：暂停/继续/取消选中，以及调整优先级（排队条目与活动任务都适用）。
+     * @param pos 视图坐标。
+     */
+    void onTaskContextMenu(const QPoint& pos);
+
 protected:
     /**
      * @brief 重写closeEvent，实现最小化到托盘。
@@ -241,7 +257,7 @@ protected:
 
     /**
      * @brief 接 QEvent::LanguageChange：翻译器切换时重新翻译 .ui 中的字符串，
-     * 并调用 refreshCellWidgetTexts() 重建表格 cell widget 的动态文案
+     * 并让 TaskTableModel 重新生成表头与单元格的动态文案
      * （状态列文字、tooltip 等不在 .ui 中的运行时文本）。
      */
     void changeEvent(QEvent* event) override;
@@ -253,17 +269,14 @@ private:
     HistoryManager& m_historyManager;   ///< 历史管理器实例，记录和管理下载历史
     SystemTray* m_systemTray;           ///< 系统托盘实例，提供后台运行和通知功能
     SingleInstance* m_singleInstance = nullptr; ///< 单实例监听（QLocalServer）；接收其它进程经 downloader:// 协议转发过来的 URL
-    QTimer* m_uiUpdateTimer;            ///< UI更新定时器，用于节流频繁的UI更新
-    /// 待更新UI的任务集合，用于批量更新任务状态。
-    /// 用 QPointer 包装，task 可能在 UI 刷新前被 deleteLater；遍历前判空。
-    QSet<QPointer<DownloadTask>> m_tasksToUpdate;
+    QLabel* m_queueLabel = nullptr;     ///< 状态栏常驻的排队条数（表格里状态为"排队"的行）
+    TaskTableModel* m_taskModel = nullptr; ///< 任务列表模型（任务编号 -> 行号索引，进度列由 ProgressDelegate 绘制）
     QHash<QPointer<DownloadTask>, qint64> m_lastLoggedProgress;///< 进度日志节流（每 10% 记一次）
-    QMutex m_tableMutex;                ///< 保护表格行增删改与 m_tasksToUpdate 的并发访问
+    QMutex m_tableMutex;                ///< 保护表格行增删改的并发访问
     QPointer<QProgressDialog> m_pauseProgress; ///< 暂停操作进度对话框，显示批量暂停进度
     QTranslator* m_translator;          ///< 翻译器实例指针（QTranslator 禁用了拷贝/移动赋值，必须用指针）
     QString m_currentLanguage;          ///< 当前界面语言代码（"zh_CN"/"en_US"）
     bool m_quitting = false;            ///< 是否正在退出程序，用于区分最小化到托盘和真正退出
-    int m_uiIdleTicks = 0;              ///< UI更新定时器空闲计数，连续多次无任务时停止定时器
 
 public:
     // qHash overload for QPointer<DownloadTask> is now at namespace scope above.
@@ -284,57 +297,14 @@ public:
     void loadStyleSheet(const QString& themeName);
 
     /**
-     * @brief 将字节数转换为可读的字符串（例如：KB, MB, GB）。
-     * @param bytes 字节数。
-     * @return 可读的字符串。
-     */
-    QString formatBytes(qint64 bytes) const;
-
-    /**
-     * @brief 将下载速度转换为可读的字符串。
-     * @param bytesPerSecond 每秒字节数。
-     * @return 可读的速度字符串。
-     */
-    QString formatSpeed(qint64 bytesPerSecond) const;
-
-    /**
-     * @brief 构造表格"大小"列的显示文本。
-     * HEAD 没拿到 Content-Length 时 totalSize=0，单独显示"未知"避免 "X / 0 B" 的违和文案。
-     * @param downloaded 已下载字节数。
-     * @param total 总字节数（0 表示未知）。
-     */
-    QString formatSizeCell(qint64 downloaded, qint64 total) const;
-
-    /**
-     * @brief 状态枚举到翻译文案的映射。集中维护避免在多处 switch/case 重复 tr()。
-     * @param status 任务状态。
-     * @return 当前语言的展示文本。
-     */
-    QString formatStatusCell(DownloadTaskStatus status) const;
-
-    /**
-     * @brief 重排表格中所有 cell widget（状态 QLabel、大小/速度/进度等）的当前
-     * 语言版本文案。语言切换、语言变更后调用一次即可。
-     */
-    void refreshCellWidgetTexts();
-
-    /**
-     * @brief 在任务列表中添加一行。
-     * @param task 要添加的DownloadTask指针。
-     */
-    void addTaskToTable(DownloadTask* task);
-
-    /**
-     * @brief 更新任务列表中的一行。
-     * @param task 要更新的DownloadTask指针。
+     * @brief 当前选中的行号（每行一次）。
      */
-    void updateTaskInTable(DownloadTask* task);
+    QList<int> selectedTaskRows() const;
 
     /**
-     * @brief 从任务列表中移除一行。
-     * @param task 要移除的DownloadTask指针。
+     * @brief 把选中行的优先级加上 delta：排队条目走 setQueuedPriority，活动任务走 setTaskPriority。
      */
-    void removeTaskFromTable(DownloadTask* task);
+    void changeSelectedPriority(int delta);
 
     /**
      * @brief 显示系统通知。
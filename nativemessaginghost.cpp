@@ -0,0 +1,153 @@
+#include "singleinstance.h"
+
+#include <QCoreApplication>
+#include <QByteArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+#include <QJsonValue>
+#include <QList>
+#include <QLocalSocket>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <utility>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+/**
+ * @brief downloader-nmhost：浏览器原生消息（Native Messaging）宿主。
+ *
+ * 浏览器在扩展调用 chrome.runtime.connectNative 时启动本进程，stdin/stdout 上是
+ * 「4 字节本机字节序长度 + UTF-8 JSON」的消息流；端口断开时浏览器关闭 stdin，本进程随之退出。
+ *
+ * 每条消息原样转成一行 JSON，经 SingleInstance 的本地套接字（持久连接）交给正在运行的 Downloader，
+ * 主实例的应答行再按同样的长度前缀写回 stdout。插件不再需要端口、CORS 预检和每次投递一个 TCP 连接；
+ * 主实例没有运行时立即应答错误，插件据此回退到 HTTP 接口。
+ *
+ * stdout 是协议通道：这里不能打印任何日志（qDebug 走 stderr，浏览器会忽略）。
+ */
+
+namespace {
+
+/// 单条消息上限。插件只发单个下载请求，远小于此；超出视为协议错误并退出。
+constexpr quint32 kMaxMessageBytes = 64 * 1024;
+/// 连接主实例的超时。
+constexpr int kConnectTimeoutMs = 1000;
+
+// 读满 size 字节；EOF 或出错返回 false
+bool readExact(char* data, size_t size)
+{
+    size_t done = 0;
+    while (done < size) {
+        const size_t n = std::fread(data + done, 1, size - done, stdin);
+        if (n == 0) return false;
+        done += n;
+    }
+    return true;
+}
+
+// 只在主线程调用
+void writeMessage(const QByteArray& json)
+{
+    const quint32 length = quint32(json.size());
+    char header[sizeof(length)];
+    std::memcpy(header, &length, sizeof(length));
+    std::fwrite(header, 1, sizeof(header), stdout);
+    std::fwrite(json.constData(), 1, size_t(json.size()), stdout);
+    std::fflush(stdout);
+}
+
+void writeError(const QJsonValue& id, const QString& message)
+{
+    QJsonObject reply{{"status", "error"}, {"message", message}};
+    if (!id.isUndefined()) reply.insert(QStringLiteral("id"), id);
+    writeMessage(QJsonDocument(reply).toJson(QJsonDocument::Compact));
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+#ifdef _WIN32
+    // 默认文本模式会把长度前缀里的 0x0A 改写成 0x0D 0x0A
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    QLocalSocket instance;
+    QByteArray fromInstance;        // 主实例发来、尚未凑成一行的字节
+    QList<QJsonValue> inFlight;     // 已转发、还没收到应答的请求 id
+
+    auto ensureConnected = [&instance]() {
+        if (instance.state() == QLocalSocket::ConnectedState) return true;
+        instance.abort();
+        instance.connectToServer(QString::fromLatin1(SingleInstance::kServerName));
+        return instance.waitForConnected(kConnectTimeoutMs);
+    };
+
+    QObject::connect(&instance, &QLocalSocket::readyRead, &app, [&]() {
+        fromInstance += instance.readAll();
+        qsizetype nl;
+        while ((nl = fromInstance.indexOf('\n')) >= 0) {
+            const QByteArray line = fromInstance.left(nl).trimmed();
+            fromInstance.remove(0, nl + 1);
+            if (line.isEmpty()) continue;
+            inFlight.removeOne(QJsonDocument::fromJson(line).object().value(QStringLiteral("id")));
+            writeMessage(line);
+        }
+    });
+
+    // 主实例退出：在途请求立即失败（插件回退到 HTTP），下一条消息时再重连
+    QObject::connect(&instance, &QLocalSocket::disconnected, &app, [&]() {
+        fromInstance.clear();
+        for (const QJsonValue& id : std::as_const(inFlight)) {
+            writeError(id, QStringLiteral("Downloader exited"));
+        }
+        inFlight.clear();
+    });
+
+    auto onBrowserMessage = [&](const QByteArray& message) {
+        QJsonParseError parseError;
+        const QJsonDocument doc = QJsonDocument::fromJson(message, &parseError);
+        if (parseError.error != QJsonParseError::NoError || !doc.isObject()) {
+            writeError(QJsonValue(), QStringLiteral("invalid JSON message"));
+            return;
+        }
+        const QJsonObject request = doc.object();
+        const QJsonValue id = request.value(QStringLiteral("id"));
+        if (!ensureConnected()) {
+            writeError(id, QStringLiteral("Downloader is not running"));
+            return;
+        }
+        inFlight.append(id);
+        instance.write(QJsonDocument(request).toJson(QJsonDocument::Compact) + '\n');
+        instance.flush();
+    };
+
+    // stdin 是阻塞读：放在独立线程，消息投递回主线程处理。浏览器关闭端口时 stdin 到 EOF，线程结束并退出事件循环。
+    std::thread reader([&app, &onBrowserMessage]() {
+        for (;;) {
+            quint32 length = 0;
+            char header[sizeof(length)];
+            if (!readExact(header, sizeof(header))) break;
+            std::memcpy(&length, header, sizeof(length));
+            if (length == 0 || length > kMaxMessageBytes) break;
+            QByteArray message(qsizetype(length), Qt::Uninitialized);
+            if (!readExact(message.data(), length)) break;
+            QMetaObject::invokeMethod(&app, [&onBrowserMessage, message]() {
+                onBrowserMessage(message);
+            }, Qt::QueuedConnection);
+        }
+        QMetaObject::invokeMethod(&app, &QCoreApplication::quit, Qt::QueuedConnection);
+    });
+
+    const int rc = app.exec();
+    reader.join();
+    return rc;
+}
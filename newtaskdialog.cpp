@@ -1,6 +1,7 @@
 #include "newtaskdialog.h"
 #include "ui_newtaskdialog.h"
 #include "settingsmanager.h"
+#include "urlmetadatacache.h"
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QDir>
@@ -9,6 +10,10 @@
 #include <QRegularExpression>
 #include <QFileInfo>
 #include <QEvent>
+#include <QLocale>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
 
 /**
  * @brief 新建下载任务对话框构造函数
@@ -36,12 +41,19 @@ NewTaskDialog::NewTaskDialog(QWidget *parent)
     // 应用当前主题样式
     applyTheme();
 
+    // URL 输入停顿后试探性探测，用户确认之前就把 DNS 与元数据准备好
+    m_probeDebounce.setSingleShot(true);
+    m_probeDebounce.setInterval(PROBE_DEBOUNCE_MS);
+    connect(&m_probeDebounce, &QTimer::timeout, this, &NewTaskDialog::startProbe);
+    connect(ui->urlLineEdit, &QLineEdit::textChanged, &m_probeDebounce, qOverload<>(&QTimer::start));
+
     // 不需要手动连接 buttonBox::accepted/rejected，setupUi 已通过 .ui 中的
     // <connection> 把 accepted 绑定到本类的 accept()，重写的 accept 会被调用。
 }
 
 NewTaskDialog::~NewTaskDialog()
 {
+    cancelProbe();
     delete ui;
 }
 
@@ -58,7 +70,7 @@ void NewTaskDialog::changeEvent(QEvent* event)
 
 QString NewTaskDialog::url() const
 {
-    return ui->urlLineEdit->text();
+    return ui->urlLineEdit->text().trimmed();
 }
 
 QString NewTaskDialog::savePath() const
@@ -96,6 +108,99 @@ void NewTaskDialog::applyTheme()
     }
 }
 
+/**
+ * @brief 试探性探测
+ *
+ * URL 有效时发 HEAD 获取大小、文件名与 Range 支持，结果写入 UrlMetadataCache：
+ * 用户确认后新任务命中缓存，跳过自己的 HEAD；解析过的主机也已在 Qt 的 DNS 缓存里。
+ * URL 无效或变更时中止上一次探测。
+ */
+void NewTaskDialog::startProbe()
+{
+    const QUrl url(ui->urlLineEdit->text().trimmed());
+    const bool httpUrl = url.scheme() == QLatin1String("http") || url.scheme() == QLatin1String("https");
+    if (!url.isValid() || !httpUrl || url.host().isEmpty()) {
+        cancelProbe();
+        m_probeUrl.clear();
+        ui->probeInfoLabel->clear();
+        return;
+    }
+    if (url == m_probeUrl) {
+        return;
+    }
+    cancelProbe();
+    m_probeUrl = url;
+
+    UrlMetadata cached;
+    if (UrlMetadataCache::instance().lookup(url, &cached)) {
+        showProbeResult(cached);
+        return;
+    }
+
+    if (!m_probeManager) {
+        m_probeManager = new QNetworkAccessManager(this);
+    }
+    QNetworkRequest request(url);
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::SameOriginRedirectPolicy);
+    request.setTransferTimeout(PROBE_TIMEOUT_MS);
+    // 与 DownloadTask 的 HEAD 相同的请求头，避免探测结果与真正下载时不一致
+    request.setRawHeader("User-Agent", "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/91.0.4472.124 Safari/537.36");
+    request.setRawHeader("Accept", "*/*");
+    request.setRawHeader("Accept-Language", "en-US,en;q=0.9,zh-CN;q=0.8,zh;q=0.7");
+
+    m_probeReply = m_probeManager->head(request);
+    connect(m_probeReply, &QNetworkReply::finished, this, &NewTaskDialog::onProbeFinished);
+    ui->probeInfoLabel->setText(tr("正在获取文件信息..."));
+}
+
+void NewTaskDialog::onProbeFinished()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    if (!reply) {
+        return;
+    }
+    reply->deleteLater();
+    if (reply != m_probeReply) {
+        return;
+    }
+    m_probeReply = nullptr;
+
+    if (reply->error() != QNetworkReply::NoError) {
+        ui->probeInfoLabel->setText(tr("无法获取文件信息: %1").arg(reply->errorString()));
+        return;
+    }
+    const UrlMetadata metadata = UrlMetadataCache::metadataFromReply(reply);
+    UrlMetadataCache::instance().store(m_probeUrl, metadata);
+    showProbeResult(metadata);
+}
+
+void NewTaskDialog::cancelProbe()
+{
+    m_probeDebounce.stop();
+    if (!m_probeReply) {
+        return;
+    }
+    // 先断开，abort() 同步发出的 finished 不再进 onProbeFinished
+    QNetworkReply* reply = m_probeReply;
+    m_probeReply = nullptr;
+    reply->disconnect(this);
+    reply->abort();
+    reply->deleteLater();
+}
+
+void NewTaskDialog::showProbeResult(const UrlMetadata& metadata)
+{
+    QStringList parts;
+    parts << (metadata.totalSize > 0
+                  ? tr("大小: %1").arg(locale().formattedDataSize(metadata.totalSize))
+                  : tr("大小: 未知"));
+    if (!metadata.fileName.isEmpty()) {
+        parts << tr("文件名: %1").arg(metadata.fileName);
+    }
+    parts << (metadata.acceptRanges ? tr("支持多线程下载") : tr("不支持分段，将单线程下载"));
+    ui->probeInfoLabel->setText(parts.join(QStringLiteral("  ·  ")));
+}
+
 /**
  * @brief 浏览按钮点击事件处理
  * 
@@ -278,3 +383,9 @@ void NewTaskDialog::accept()
 
     QDialog::accept();
 }
+
+void NewTaskDialog::reject()
+{
+    cancelProbe();
+    QDialog::reject();
+}
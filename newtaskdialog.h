@@ -2,8 +2,14 @@
 #define NEWTASKDIALOG_H
 
 #include <QDialog>
+#include <QPointer>
+#include <QTimer>
 #include <QUrl>
 
+class QNetworkAccessManager;
+class QNetworkReply;
+struct UrlMetadata;
+
 QT_BEGIN_NAMESPACE
 namespace Ui { class NewTaskDialog; }
 QT_END_NAMESPACE
@@ -11,6 +17,10 @@ QT_END_NAMESPACE
 /**
  * @brief NewTaskDialog类用于显示一个对话框，允许用户输入新的下载任务信息。
  * 包括下载URL、保存路径和下载线程数。
+ *
+ * URL 输入停顿 PROBE_DEBOUNCE_MS 且格式有效后立即发起试探性 HEAD：DNS 在用户确认之前就解析好，
+ * 大小、文件名与 Range 支持显示在对话框里，结果写入 UrlMetadataCache，确认后新任务直接命中缓存、
+ * 不再自己探测。取消或关闭对话框时在途的探测立即中止。
  */
 class NewTaskDialog : public QDialog
 {
@@ -53,6 +63,21 @@ private slots:
      */
     void accept() override;
 
+    /**
+     * @brief 取消：中止在途的探测。
+     */
+    void reject() override;
+
+    /**
+     * @brief URL 输入停顿后发起试探性探测（缓存命中时直接显示）。
+     */
+    void startProbe();
+
+    /**
+     * @brief 探测完成：写缓存并显示结果。
+     */
+    void onProbeFinished();
+
 protected:
     /**
      * @brief 接 QEvent::LanguageChange：当前应用翻译器变化时 Qt 会派发该事件；
@@ -66,7 +91,24 @@ private:
      */
     void applyTheme();
 
+    /**
+     * @brief 中止在途的探测。
+     */
+    void cancelProbe();
+
+    /**
+     * @brief 在对话框里显示探测得到的大小、文件名与 Range 支持。
+     */
+    void showProbeResult(const UrlMetadata& metadata);
+
     Ui::NewTaskDialog *ui; ///< UI界面指针。
+    QNetworkAccessManager* m_probeManager = nullptr; ///< 探测用的网络管理器（首次探测时创建）。
+    QPointer<QNetworkReply> m_probeReply;   ///< 在途的探测。
+    QUrl m_probeUrl;                        ///< 最近一次探测的 URL。
+    QTimer m_probeDebounce;                 ///< URL 输入停顿计时。
+
+    static constexpr int PROBE_DEBOUNCE_MS = 500;      ///< 输入停顿多久后探测
+    static constexpr int PROBE_TIMEOUT_MS  = 10 * 1000; ///< 探测超时
 };
 
 #endif // NEWTASKDIALOG_H
@@ -0,0 +1,35 @@
+#include "progressdelegate.h"
+
+#include <QApplication>
+#include <QStyle>
+#include <QStyleOptionProgressBar>
+
+ProgressDelegate::ProgressDelegate(QObject* parent)
+    : QStyledItemDelegate(parent)
+{
+}
+
+void ProgressDelegate::paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const
+{
+    // 先按普通单元格画背景（选中、交替行颜色），再在上面画进度条
+    QStyleOptionViewItem itemOption(option);
+    initStyleOption(&itemOption, index);
+    itemOption.text.clear();
+    const QWidget* widget = option.widget;
+    QStyle* style = widget ? widget->style() : QApplication::style();
+    style->drawControl(QStyle::CE_ItemViewItem, &itemOption, painter, widget);
+
+    QStyleOptionProgressBar bar;
+    bar.state = option.state | QStyle::State_Horizontal;
+    bar.direction = option.direction;
+    bar.palette = option.palette;
+    bar.fontMetrics = option.fontMetrics;
+    bar.rect = option.rect.adjusted(4, 6, -4, -6);
+    bar.minimum = 0;
+    bar.maximum = 100;
+    bar.progress = qBound(0, index.data(Qt::DisplayRole).toInt(), 100);
+    bar.text = QStringLiteral("%1%").arg(bar.progress);
+    bar.textVisible = true;
+    bar.textAlignment = Qt::AlignCenter;
+    style->drawControl(QStyle::CE_ProgressBar, &bar, painter, widget);
+}
@@ -0,0 +1,21 @@
+#ifndef PROGRESSDELEGATE_H
+#define PROGRESSDELEGATE_H
+
+#include <QStyledItemDelegate>
+
+/**
+ * @brief 进度列的绘制委托：按 DisplayRole 的百分比（0-100）直接画一条进度条。
+ *
+ * 取代每行一个 QProgressBar cell widget：没有子控件，只在视图重画可见行时调用 paint()。
+ */
+class ProgressDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+    explicit ProgressDelegate(QObject* parent = nullptr);
+
+    void paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const override;
+};
+
+#endif // PROGRESSDELEGATE_H
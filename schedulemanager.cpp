@@ -8,9 +8,28 @@
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QDir>
+#include <QFileInfo>
 #include <QDebug>
+#include <QCoreApplication>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
 #include "logger.h"
 
+namespace {
+    /// 堆比较：触发时间早的在堆顶
+    template <typename Entry>
+    bool fireLater(const Entry& a, const Entry& b)
+    {
+        return a.fireMs > b.fireMs;
+    }
+
+    QByteArray journalLineOf(const QJsonObject& obj)
+    {
+        return QJsonDocument(obj).toJson(QJsonDocument::Compact) + '\n';
+    }
+}
+
 QJsonObject ScheduledTask::toJson() const
 {
     QJsonObject obj;
@@ -50,14 +69,24 @@ ScheduledTask ScheduledTask::fromJson(const QJsonObject& json)
 ScheduleManager::ScheduleManager(QObject *parent) : QObject(parent)
 {
     m_timer = new QTimer(this);
-    m_timer->setInterval(30000); // 30秒检查一次
+    m_timer->setSingleShot(true);
+    // 默认的 CoarseTimer 允许 5% 的误差，武装一小时会差出几分钟
+    m_timer->setTimerType(Qt::PreciseTimer);
     connect(m_timer, &QTimer::timeout, this, &ScheduleManager::onTimerTimeout);
-    m_timer->start();
-    
+
+    m_saveTimer = new QTimer(this);
+    m_saveTimer->setSingleShot(true);
+    m_saveTimer->setInterval(SAVE_DELAY_MS);
+    connect(m_saveTimer, &QTimer::timeout, this, &ScheduleManager::saveScheduledTasks);
+
     m_nextTaskId = 1;
     
     // 加载保存的定时任务
     loadScheduledTasks();
+
+    if (QCoreApplication::instance()) {
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, &ScheduleManager::saveScheduledTasks);
+    }
 }
 
 ScheduleManager::~ScheduleManager()
@@ -78,19 +107,29 @@ int ScheduleManager::addScheduledTask(const ScheduledTask& task)
     ScheduledTask newTask = task;
     newTask.id = m_nextTaskId++;
     m_tasks[newTask.id] = newTask;
+
+    QJsonObject line;
+    line["set"] = newTask.toJson();
+    appendJournal(line);
+    schedule(newTask);
+    armTimer();
     
     emit scheduledTasksChanged();
-    saveScheduledTasks();
     
     return newTask.id;
 }
 
 void ScheduleManager::removeScheduledTask(int taskId)
 {
-    if (m_tasks.contains(taskId)) {
-        m_tasks.remove(taskId);
+    if (m_tasks.remove(taskId) > 0) {
+        // 堆里的条目因为查不到代号而过期
+        m_generation.remove(taskId);
+        QJsonObject line;
+        line["del"] = taskId;
+        appendJournal(line);
+        rebuildHeapIfNeeded();
+        armTimer();
         emit scheduledTasksChanged();
-        saveScheduledTasks();
     }
 }
 
@@ -101,120 +140,264 @@ QList<ScheduledTask> ScheduleManager::getAllScheduledTasks() const
 
 void ScheduleManager::setTaskActive(int taskId, bool active)
 {
-    if (m_tasks.contains(taskId)) {
-        m_tasks[taskId].isActive = active;
+    auto it = m_tasks.find(taskId);
+    if (it != m_tasks.end()) {
+        it->isActive = active;
+        QJsonObject line;
+        line["set"] = it->toJson();
+        appendJournal(line);
+        schedule(*it);
+        rebuildHeapIfNeeded();
+        armTimer();
         emit scheduledTasksChanged();
-        saveScheduledTasks();
+    }
+}
+
+QString ScheduleManager::journalPath()
+{
+    QString appDataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    if (appDataPath.isEmpty()) {
+        appDataPath = QDir::currentPath();
+    }
+    return QDir(appDataPath).filePath("schedule.log");
+}
+
+void ScheduleManager::appendJournal(const QJsonObject& line)
+{
+    m_pendingLines += journalLineOf(line);
+    ++m_journalLines;
+    if (!m_saveTimer->isActive()) {
+        m_saveTimer->start();
     }
 }
 
 void ScheduleManager::saveScheduledTasks()
 {
-    QJsonArray tasksArray;
-    for (const auto& task : m_tasks) {
-        tasksArray.append(task.toJson());
+    m_saveTimer->stop();
+    if (m_journalLines >= COMPACT_MIN_LINES && m_journalLines > 2 * qint64(m_tasks.size())) {
+        compactJournal();
+        return;
     }
-    
-    QJsonDocument doc(tasksArray);
-    QFile file("scheduled_tasks.json");
-    if (file.open(QIODevice::WriteOnly)) {
-        file.write(doc.toJson());
-        file.close();
+    if (m_pendingLines.isEmpty()) {
+        return;
+    }
+
+    const QString path = journalPath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        LOGD(QString("无法写入定时任务日志:%1").arg(file.errorString()));
+        return;
     }
+    if (file.write(m_pendingLines) != m_pendingLines.size()) {
+        // 可能留下半行：加载时跳过半行并压缩
+        LOGD(QString("写入定时任务日志失败:%1").arg(file.errorString()));
+    }
+    file.close();
+    m_pendingLines.clear();
 }
 
-void ScheduleManager::loadScheduledTasks()
+void ScheduleManager::compactJournal()
 {
-    QFile file("scheduled_tasks.json");
-    if (!file.exists()) {
+    const QString path = journalPath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        LOGD(QString("无法重写定时任务日志:%1").arg(file.errorString()));
         return;
     }
-    
-    if (file.open(QIODevice::ReadOnly)) {
-        QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
-        file.close();
-        
-        if (doc.isArray()) {
-            QJsonArray array = doc.array();
-            for (const auto& value : array) {
-                if (value.isObject()) {
-                    ScheduledTask task = ScheduledTask::fromJson(value.toObject());
-                    m_tasks[task.id] = task;
-                    if (task.id >= m_nextTaskId) {
-                        m_nextTaskId = task.id + 1;
-                    }
-                }
+    for (const ScheduledTask& task : std::as_const(m_tasks)) {
+        QJsonObject line;
+        line["set"] = task.toJson();
+        file.write(journalLineOf(line));
+    }
+    if (!file.commit()) {
+        LOGD(QString("提交定时任务日志失败:%1").arg(file.errorString()));
+        return;
+    }
+    // 快照已经包含攒着的修改
+    m_pendingLines.clear();
+    m_journalLines = m_tasks.size();
+    LOGD(QString("定时任务日志已压缩，任务数:%1").arg(m_tasks.size()));
+}
+
+bool ScheduleManager::migrateLegacyJson()
+{
+    // 旧版把任务写在当前工作目录下
+    const QString legacyPath = QDir::current().filePath("scheduled_tasks.json");
+    QFile file(legacyPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    file.close();
+
+    for (const auto& value : doc.array()) {
+        if (value.isObject()) {
+            const ScheduledTask task = ScheduledTask::fromJson(value.toObject());
+            m_tasks[task.id] = task;
+        }
+    }
+    QFile::remove(legacyPath + ".bak");
+    QFile::rename(legacyPath, legacyPath + ".bak");
+    LOGD(QString("已迁移旧版定时任务:%1 个").arg(m_tasks.size()));
+    return true;
+}
+
+void ScheduleManager::loadScheduledTasks()
+{
+    m_tasks.clear();
+    m_pendingLines.clear();
+    m_journalLines = 0;
+    bool needsCompaction = false;
+
+    QFile file(journalPath());
+    if (!file.exists()) {
+        needsCompaction = migrateLegacyJson();
+    } else if (file.open(QIODevice::ReadOnly)) {
+        // 逐行回放：后出现的 set 覆盖前面的，del 删除
+        while (!file.atEnd()) {
+            const QByteArray line = file.readLine();
+            if (!line.endsWith('\n')) {
+                // 上次写到一半：丢掉半行，重写日志以免之后的行接在它后面
+                needsCompaction = true;
+                break;
             }
+            ++m_journalLines;
+            const QJsonObject obj = QJsonDocument::fromJson(line).object();
+            if (obj.contains("set")) {
+                const ScheduledTask task = ScheduledTask::fromJson(obj.value("set").toObject());
+                m_tasks[task.id] = task;
+            } else if (obj.contains("del")) {
+                m_tasks.remove(obj.value("del").toInt());
+            } else {
+                needsCompaction = true;
+            }
+        }
+        file.close();
+    } else {
+        LOGD(QString("无法读取定时任务日志:%1").arg(file.errorString()));
+    }
+
+    for (const ScheduledTask& task : std::as_const(m_tasks)) {
+        if (task.id >= m_nextTaskId) {
+            m_nextTaskId = task.id + 1;
         }
     }
+    if (needsCompaction || (m_journalLines >= COMPACT_MIN_LINES && m_journalLines > 2 * qint64(m_tasks.size()))) {
+        compactJournal();
+    }
+
+    m_heap.clear();
+    m_generation.clear();
+    for (const ScheduledTask& task : std::as_const(m_tasks)) {
+        schedule(task);
+    }
+    armTimer();
+    LOGD(QString("已加载定时任务:%1 个，待触发:%2 个").arg(m_tasks.size()).arg(m_heap.size()));
 }
 
-void ScheduleManager::onTimerTimeout()
+void ScheduleManager::schedule(const ScheduledTask& task)
 {
-    checkScheduledTasks();
+    const quint32 generation = ++m_generation[task.id];
+    if (!task.isActive || !task.scheduledTime.isValid()) {
+        return;
+    }
+    m_heap.push_back({task.scheduledTime.toMSecsSinceEpoch(), task.id, generation});
+    std::push_heap(m_heap.begin(), m_heap.end(), fireLater<FireEntry>);
 }
 
-QDateTime ScheduleManager::computeNextFire(const ScheduledTask& task, const QDateTime& now)
+bool ScheduleManager::isLive(const FireEntry& entry) const
 {
-    // 复制定理：基准时间必须是当前触发时间（或当前），并且必须显式使用 LocalTime，
-    // 避免在跨DST边界时使用 UTC 或 LocalTime 混用造成的 off-by-one。
-    if (!task.isRepeat || task.repeatInterval <= 0) {
-        return task.scheduledTime;
+    return m_generation.value(entry.taskId, 0) == entry.generation;
+}
+
+void ScheduleManager::rebuildHeapIfNeeded()
+{
+    if (m_heap.size() <= 2 * size_t(m_tasks.size()) + 64) {
+        return;
     }
-    // 转换为 LocalTime，确保加秒数后跨DST时由Qt自动按本地日历处理
-    QDateTime base = task.scheduledTime;
-    if (base.timeSpec() != Qt::LocalTime) {
-        base.setTimeZone(QTimeZone::LocalTime);
+    m_heap.erase(std::remove_if(m_heap.begin(), m_heap.end(),
+                                [this](const FireEntry& entry) { return !isLive(entry); }),
+                 m_heap.end());
+    std::make_heap(m_heap.begin(), m_heap.end(), fireLater<FireEntry>);
+}
+
+void ScheduleManager::armTimer()
+{
+    while (!m_heap.empty() && !isLive(m_heap.front())) {
+        std::pop_heap(m_heap.begin(), m_heap.end(), fireLater<FireEntry>);
+        m_heap.pop_back();
     }
-    QDateTime candidate = base.addSecs(task.repeatInterval * 3600);
-    while (candidate <= now) {
-        candidate = candidate.addSecs(task.repeatInterval * 3600);
+    if (m_heap.empty()) {
+        m_timer->stop();
+        return;
     }
-    return candidate;
+    const qint64 delay = m_heap.front().fireMs - QDateTime::currentMSecsSinceEpoch();
+    m_timer->start(int(qBound<qint64>(0, delay, MAX_ARM_MS)));
 }
 
-void ScheduleManager::checkScheduledTasks()
+void ScheduleManager::onTimerTimeout()
 {
-    QDateTime now = QDateTime::currentDateTime();
+    const QDateTime now = QDateTime::currentDateTime();
+    const qint64 nowMs = now.toMSecsSinceEpoch();
+    bool changed = false;
 
-    for (auto it = m_tasks.begin(); it != m_tasks.end(); ++it) {
-        ScheduledTask& task = it.value();
-
-        if (!task.isActive) {
+    while (!m_heap.empty() && m_heap.front().fireMs <= nowMs) {
+        const FireEntry entry = m_heap.front();
+        std::pop_heap(m_heap.begin(), m_heap.end(), fireLater<FireEntry>);
+        m_heap.pop_back();
+        if (!isLive(entry)) {
             continue;
         }
-
-        // 把当前 scheduledTime 也强制为 LocalTime 以保证比较一致
-        if (task.scheduledTime.timeSpec() != Qt::LocalTime) {
-            task.scheduledTime.setTimeZone(QTimeZone::LocalTime);
+        auto it = m_tasks.find(entry.taskId);
+        if (it == m_tasks.end()) {
+            continue;
         }
 
-        // 检查任务是否到期
-        if (task.scheduledTime <= now) {
-            // 触发任务
-            emit scheduledTaskTriggered(task);
+        // 先更新任务再发信号：槽函数里再增删任务看到的是一致的状态
+        const ScheduledTask fired = it.value();
+        ScheduledTask& task = it.value();
+        if (task.isRepeat && task.repeatInterval > 0) {
+            task.scheduledTime = computeNextFire(task, now);
+        } else {
+            // 非重复任务，标记为完成
+            task.isActive = false;
+        }
+        QJsonObject line;
+        line["set"] = task.toJson();
+        appendJournal(line);
+        schedule(task);
+        changed = true;
 
-            // 处理重复任务
-            if (task.isRepeat) {
-                handleRepeatTask(task);
-            } else {
-                // 非重复任务，标记为完成
-                task.isActive = false;
-            }
+        emit scheduledTaskTriggered(fired);
+    }
 
-            // 保存更改
-            saveScheduledTasks();
-        }
+    if (changed) {
+        emit scheduledTasksChanged();
     }
+    // 醒来时可能只是 MAX_ARM_MS 到了，堆顶还没到期：直接重新武装
+    armTimer();
 }
 
-void ScheduleManager::handleRepeatTask(const ScheduledTask& task)
+QDateTime ScheduleManager::computeNextFire(const ScheduledTask& task, const QDateTime& now)
 {
-    // 重新计算下一次执行时间。每次tick都基于"now"判断是否要跳到更后面，
-    // 不假设tick间隔恰好等于 repeatInterval（避免长时间无响应后的延迟累积）。
-    QDateTime now = QDateTime::currentDateTime();
-    QDateTime nextFire = computeNextFire(task, now);
-
-    ScheduledTask& mutableTask = m_tasks[task.id];
-    mutableTask.scheduledTime = nextFire;
-}
\ No newline at end of file
+    // 复制定理：基准时间必须是当前触发时间（或当前），并且必须显式使用 LocalTime，
+    // 避免在跨DST边界时使用 UTC 或 LocalTime 混用造成的 off-by-one。
+    if (!task.isRepeat || task.repeatInterval <= 0) {
+        return task.scheduledTime;
+    }
+    // 转换为 LocalTime，确保加秒数后跨DST时由Qt自动按本地日历处理
+    QDateTime base = task.scheduledTime;
+    if (base.timeSpec() != Qt::LocalTime) {
+        base.setTimeZone(QTimeZone::LocalTime);
+    }
+    const qint64 intervalSecs = qint64(task.repeatInterval) * 3600;
+    // 长时间没有运行时直接跳过错过的周期，不逐个累加
+    const qint64 missed = qMax<qint64>(0, base.secsTo(now) / intervalSecs);
+    QDateTime candidate = base.addSecs((missed + 1) * intervalSecs);
+    while (candidate <= now) {
+        candidate = candidate.addSecs(intervalSecs);
+    }
+    return candidate;
+}
@@ -5,7 +5,9 @@
 #include <QTimer>
 #include <QDateTime>
 #include <QMap>
+#include <QHash>
 #include <QJsonObject>
+#include <vector>
 
 class DownloadTask;
 
@@ -42,9 +44,18 @@ struct ScheduledTask {
  * 
  * 负责管理所有定时下载任务，包括：
  * 1. 添加/删除定时任务
- * 2. 定时检查任务执行时间
+ * 2. 按触发时间调度任务
  * 3. 持久化存储定时任务
  * 4. 重复任务处理
+ *
+ * 调度不轮询：激活的任务按下一次触发时间放进最小堆，单次定时器（Qt::PreciseTimer）只为堆顶武装，
+ * 没有激活的任务时定时器停止，空闲时不唤醒。修改或删除任务时不在堆里查找，只把任务的代号加一，
+ * 旧的堆条目在弹出时按代号识别为过期并丢弃；过期条目过多时整体重建堆。
+ * 定时器最长只武装 MAX_ARM_MS，醒来后按当前挂钟时间重新计算，系统休眠或改时间后不会错过太久。
+ *
+ * 持久化是追加式日志 schedule.log（位于 AppDataLocation）：每行一个 {"set": 任务} 或 {"del": 任务ID}，
+ * 修改先攒批，SAVE_DELAY_MS 后一次追加；日志行数多于任务数两倍时整体重写（压缩）。
+ * 旧版当前目录下的 scheduled_tasks.json 在首次启动时迁移，原文件改名为 .bak。
  */
 class ScheduleManager : public QObject
 {
@@ -87,12 +98,12 @@ public:
     void setTaskActive(int taskId, bool active);
     
     /**
-     * @brief 保存定时任务到文件
+     * @brief 立即写出攒着的日志行（需要时压缩日志）
      */
     void saveScheduledTasks();
     
     /**
-     * @brief 从文件加载定时任务
+     * @brief 从日志加载定时任务并重建调度堆（构造时调用）
      */
     void loadScheduledTasks();
 
@@ -110,7 +121,7 @@ signals:
 
 private slots:
     /**
-     * @brief 定时器超时处理
+     * @brief 定时器超时处理：触发所有到期的任务，然后为新的堆顶重新武装定时器
      */
     void onTimerTimeout();
 
@@ -118,26 +129,74 @@ private:
     explicit ScheduleManager(QObject *parent = nullptr);
     ~ScheduleManager();
 
-    QTimer* m_timer;                   ///< 定时器
+    /**
+     * @brief 调度堆中的一项
+     */
+    struct FireEntry {
+        qint64 fireMs;          ///< 触发时间（UTC 毫秒）
+        int taskId;             ///< 任务ID
+        quint32 generation;     ///< 入堆时任务的代号，与当前代号不同即过期
+    };
+
+    QTimer* m_timer;                   ///< 单次定时器，武装到堆顶的触发时间
+    QTimer* m_saveTimer;               ///< 日志攒批定时器（单次）
     QMap<int, ScheduledTask> m_tasks;  ///< 定时任务映射
     int m_nextTaskId;                  ///< 下一个任务ID
+    std::vector<FireEntry> m_heap;     ///< 按触发时间排列的最小堆（可能含过期条目）
+    QHash<int, quint32> m_generation;  ///< 任务ID -> 当前代号
+    QByteArray m_pendingLines;         ///< 攒着还没写出的日志行
+    qint64 m_journalLines = 0;         ///< 日志中的行数（含还没写出的），用于判断何时压缩
+
+    static constexpr int MAX_ARM_MS        = 60 * 60 * 1000; ///< 定时器单次最长武装时间
+    static constexpr int SAVE_DELAY_MS     = 1000;           ///< 日志行最长攒批时间
+    static constexpr int COMPACT_MIN_LINES = 256;            ///< 日志行数不到这个数不压缩
 
     /**
      * @brief 重新计算某个任务的"下一次触发时间"。
      * 使用 Qt::LocalTime 一致地处理重复任务与夏令时边界。
      */
     static QDateTime computeNextFire(const ScheduledTask& task, const QDateTime& now);
-    
+
     /**
-     * @brief 检查并执行到期的定时任务
+     * @brief 使任务已有的堆条目失效；任务激活时按 scheduledTime 重新入堆。
      */
-    void checkScheduledTasks();
-    
+    void schedule(const ScheduledTask& task);
+
     /**
-     * @brief 处理重复任务
-     * @param task 定时任务
+     * @brief 过期条目过多时按激活的任务重建堆。
+     */
+    void rebuildHeapIfNeeded();
+
+    /**
+     * @brief 丢掉堆顶的过期条目，为最早的触发时间武装定时器；堆空时停止定时器。
+     */
+    void armTimer();
+
+    /**
+     * @brief 条目是否仍然有效。
+     */
+    bool isLive(const FireEntry& entry) const;
+
+    /**
+     * @brief 日志文件路径。
+     */
+    static QString journalPath();
+
+    /**
+     * @brief 攒一行日志，并确保攒批定时器在运行。
+     */
+    void appendJournal(const QJsonObject& line);
+
+    /**
+     * @brief 按当前任务重写整个日志。
+     */
+    void compactJournal();
+
+    /**
+     * @brief 读取旧版 scheduled_tasks.json（整个 JSON 数组），读完把原文件改名为 .bak。
+     * @return 如果文件存在且读取成功则返回true。
      */
-    void handleRepeatTask(const ScheduledTask& task);
+    bool migrateLegacyJson();
 };
 
 #endif // SCHEDULEMANAGER_H
\ No newline at end of file
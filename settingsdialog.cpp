@@ -8,6 +8,8 @@
 #include <QDir>
 #include <QUrl>
 #include <QEvent>
+#include <QGuiApplication>
+#include <QClipboard>
 
 namespace {
 
@@ -167,6 +169,11 @@ SettingsDialog::SettingsDialog(QWidget *parent)
     connect(ui->unregisterProtocolButton, &QPushButton::clicked,
             this, &SettingsDialog::on_unregisterProtocolButton_clicked);
 
+    // 访问令牌只读展示，复制后粘贴到浏览器插件或脚本里
+    connect(ui->copyApiTokenButton, &QPushButton::clicked, this, [this]() {
+        QGuiApplication::clipboard()->setText(ui->apiTokenLineEdit->text());
+    });
+
     // 初次打开对话框时把当前注册表状态刷新到 label
     refreshProtocolStatusUi();
 }
@@ -205,6 +212,9 @@ void SettingsDialog::loadSettingsToUi()
     // 加载静默模式设置
     ui->silentModeCheckBox->setChecked(SettingsManager::instance().loadSilentMode());
 
+    // 本地 HTTP 接口的访问令牌（首次读取时生成）
+    ui->apiTokenLineEdit->setText(SettingsManager::instance().bearerToken());
+
     // 加载主题
     QString currentTheme = SettingsManager::instance().loadTheme();
     int themeIndex = ui->themeComboBox->findData(currentTheme);
@@ -3,6 +3,9 @@
 
 #include <QLocalServer>
 #include <QLocalSocket>
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QPointer>
 
 bool SingleInstance::tryForward(const QByteArray& payload, int timeoutMs)
 {
@@ -46,6 +49,8 @@ bool SingleInstance::startListening()
     m_server = new QLocalServer(this);
     // 防御性 remove：万一上次进程崩溃 / 上次进程没正常关闭 socket。
     QLocalServer::removeServer(QString::fromLatin1(kServerName));
+    // 连接可以投递带保存路径的下载请求：只允许当前用户访问
+    m_server->setSocketOptions(QLocalServer::UserAccessOption);
     if (!m_server->listen(QString::fromLatin1(kServerName))) {
         LOGD(QString("SingleInstance::startListening: listen 失败 - %1")
              .arg(m_server->errorString()));
@@ -59,24 +64,81 @@ bool SingleInstance::startListening()
 void SingleInstance::onNewConnection()
 {
     while (QLocalSocket* client = m_server->nextPendingConnection()) {
-        // 读完整个 payload（v1 一行 < 4KB）。非阻塞 + 半秒超时。
-        QByteArray buf;
-        while (client->bytesAvailable() > 0 || client->waitForReadyRead(500)) {
-            buf += client->readAll();
-            // 单行 payload：以 '\n' 终止即可；超过 64KB 主动断。
-            if (buf.contains('\n') || buf.size() > 64 * 1024) {
-                break;
-            }
+        // 异步逐行读取：原生消息宿主的连接会保持整个浏览器会话，不能在这里阻塞等待
+        m_buffers.insert(client, QByteArray());
+        connect(client, &QLocalSocket::readyRead, this, [this, client]() { readClient(client); });
+        connect(client, &QLocalSocket::disconnected, this, [this, client]() { closeClient(client); });
+        if (client->bytesAvailable() > 0) {
+            readClient(client);
         }
-        // 兼容 EOF（对端 close）后再无 '\n'：也当作单行处理。
-        if (!buf.isEmpty() && !buf.endsWith('\n')) {
-            buf.append('\n');
-        }
-        LOGD(QString("SingleInstance: 收到转发 payload (%1 字节)").arg(buf.size()));
-        if (!buf.isEmpty()) {
-            emit messageReceived(buf);
-        }
-        client->disconnectFromServer();
+    }
+}
+
+void SingleInstance::readClient(QLocalSocket* client)
+{
+    if (!m_buffers.contains(client)) return;
+
+    // 拷贝出来处理：槽函数里可能重入事件循环，期间 m_buffers 可能被修改
+    QByteArray buf = m_buffers.value(client) + client->readAll();
+    qsizetype start = 0;
+    qsizetype nl;
+    while ((nl = buf.indexOf('\n', start)) >= 0) {
+        const QByteArray line = buf.mid(start, nl - start + 1);
+        start = nl + 1;
+        handleLine(client, line);
+        if (!m_buffers.contains(client)) return; // 处理过程中被断开
+    }
+    buf.remove(0, start);
+    if (buf.size() > MAX_LINE_BYTES) {
+        LOGD(QString("SingleInstance: 单行超过 %1 字节，断开连接").arg(MAX_LINE_BYTES));
+        m_buffers.remove(client);
+        client->disconnect(this);
+        client->abort();
         client->deleteLater();
+        return;
+    }
+    m_buffers.insert(client, buf);
+}
+
+void SingleInstance::closeClient(QLocalSocket* client)
+{
+    if (!m_buffers.contains(client)) return;
+    // 兼容 EOF（对端 close）后再无 '\n'：也当作单行处理。
+    const QByteArray rest = m_buffers.take(client) + client->readAll();
+    if (!rest.trimmed().isEmpty()) {
+        handleLine(client, rest + '\n');
+    }
+    client->deleteLater();
+}
+
+void SingleInstance::handleLine(QLocalSocket* client, const QByteArray& line)
+{
+    if (!line.startsWith('{')) {
+        LOGD(QString("SingleInstance: 收到转发 payload (%1 字节)").arg(line.size()));
+        emit messageReceived(line);
+        return;
+    }
+
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(line, &parseError);
+    const QJsonObject request = doc.object();
+    const QJsonValue id = request.value(QStringLiteral("id"));
+    QPointer<QLocalSocket> safeClient(client);
+    Reply reply = [safeClient, id](const QJsonObject& body) {
+        if (!safeClient || safeClient->state() != QLocalSocket::ConnectedState) return;
+        QJsonObject out = body;
+        if (!id.isUndefined()) out.insert(QStringLiteral("id"), id);
+        safeClient->write(QJsonDocument(out).toJson(QJsonDocument::Compact) + '\n');
+    };
+
+    if (parseError.error != QJsonParseError::NoError || !doc.isObject()) {
+        reply(QJsonObject{{"status", "error"}, {"message", "invalid JSON request"}});
+        return;
+    }
+    if (request.value(QStringLiteral("type")).toString() == QLatin1String("ping")) {
+        reply(QJsonObject{{"status", "success"}, {"message", "pong"}});
+        return;
     }
+    LOGD(QString("SingleInstance: 收到 JSON 请求 type=%1").arg(request.value(QStringLiteral("type")).toString()));
+    emit requestReceived(request, reply);
 }
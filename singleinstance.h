@@ -3,8 +3,12 @@
 
 #include <QObject>
 #include <QByteArray>
+#include <QHash>
+#include <QJsonObject>
+#include <functional>
 
 class QLocalServer;
+class QLocalSocket;
 
 /**
  * @brief 单实例基础设施（QLocalServer + QLocalSocket）。
@@ -27,6 +31,14 @@ class QLocalServer;
  *  - 单行 ASCII，前缀 `downloader://`，紧接着真实 URL（http/https），以 `\n` 结束。
  *  - 第一版不做 HMAC 签名：在主实例上仍然校验 scheme 是 http/https，
  *    不能让本地恶意进程伪造任意路径；但这一层信任留作第二版（HMAC-nonce）。
+ *
+ * JSON 请求（浏览器原生消息宿主 downloader-nmhost 使用）：
+ *  - 以 `{` 开头的行是一条 JSON 请求：`{"id": ..., "type": "download", "url": ..., "filename": ..., "savePath": ...}`；
+ *    应答同样是一行 JSON：`{"id": ..., "status": "success"|"error", "message": ...}`，id 原样带回。
+ *  - `{"type": "ping"}` 由这里直接应答，用于宿主探测主实例是否在运行。
+ *  - 连接是持久的：宿主在浏览器会话期间只连一次，逐行发送请求；v1 的单行 payload 发完即断，
+ *    末尾没有 `\n` 的残行在对端断开时按一行处理。
+ *  - 监听套接字只允许当前用户访问（UserAccessOption）。
  */
 class SingleInstance : public QObject
 {
@@ -39,6 +51,9 @@ public:
     /// payload scheme 前缀（与 ProtocolRegistrar::kScheme 同步）。用于识别 load 到的 payload。
     static constexpr const char* kPayloadPrefix = "downloader://";
 
+    /// 对一条 JSON 请求的应答；id 由 SingleInstance 补上。连接已断开时调用是空操作。
+    using Reply = std::function<void(const QJsonObject& reply)>;
+
     /**
      * @brief 静态工具：试图把 payload 转发给已运行的实例。
      * @param payload 单行 ASCII，建议格式：kPayloadPrefix + "<url>" + '\n'
@@ -64,11 +79,36 @@ signals:
      */
     void messageReceived(const QByteArray& payload);
 
+    /**
+     * @brief 收到一条 JSON 请求（ping 除外）。槽函数处理后（可以异步）调用 reply 应答一次。
+     * @param request 请求对象。
+     * @param reply 应答回调。
+     */
+    void requestReceived(const QJsonObject& request, const SingleInstance::Reply& reply);
+
 private slots:
     void onNewConnection();
 
 private:
+    /**
+     * @brief 读取一个连接的新数据，逐行处理。
+     */
+    void readClient(QLocalSocket* client);
+
+    /**
+     * @brief 连接断开：处理末尾没有换行的残行并释放连接。
+     */
+    void closeClient(QLocalSocket* client);
+
+    /**
+     * @brief 处理一行：JSON 请求或 v1 payload。
+     */
+    void handleLine(QLocalSocket* client, const QByteArray& line);
+
     QLocalServer* m_server = nullptr;
+    QHash<QLocalSocket*, QByteArray> m_buffers; ///< 每个连接尚未凑成一行的字节。
+
+    static constexpr int MAX_LINE_BYTES = 64 * 1024; ///< 单行上限，超过即断开
 };
 
 #endif // SINGLEINSTANCE_H
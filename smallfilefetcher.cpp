@@ -0,0 +1,206 @@
+#include "smallfilefetcher.h"
+#include "downloadmanager.h"
+#include "hostguard.h"
+#include "urlmetadatacache.h"
+#include "logger.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QSaveFile>
+
+#include <algorithm>
+
+SmallFileFetcher& SmallFileFetcher::instance()
+{
+    static SmallFileFetcher instance;
+    return instance;
+}
+
+SmallFileFetcher::SmallFileFetcher(QObject* parent)
+    : QObject(parent)
+{
+    m_manager = new QNetworkAccessManager(this);
+    m_historyTimer.setSingleShot(true);
+    m_historyTimer.setInterval(HISTORY_FLUSH_MS);
+    connect(&m_historyTimer, &QTimer::timeout, this, &SmallFileFetcher::flushHistory);
+}
+
+void SmallFileFetcher::fetch(const QUrl& url, const QString& filePath, int threadCount,
+                             const QList<QHostAddress>& addresses)
+{
+    Entry entry;
+    entry.url = url;
+    entry.filePath = filePath;
+    entry.threadCount = threadCount;
+    entry.addresses = addresses;
+    m_queue.append(entry);
+    pump();
+}
+
+bool SmallFileFetcher::isPathPending(const QUrl& url, const QString& filePath) const
+{
+    const QString key = DownloadManager::taskKey(url);
+    const QString target = QDir::cleanPath(filePath);
+    auto occupies = [&key, &target](const Entry& entry) {
+        return QDir::cleanPath(entry.filePath) == target && DownloadManager::taskKey(entry.url) != key;
+    };
+    return std::any_of(m_queue.cbegin(), m_queue.cend(), occupies)
+        || std::any_of(m_inFlight.cbegin(), m_inFlight.cend(), occupies);
+}
+
+void SmallFileFetcher::pump()
+{
+    while (m_inFlight.size() < MAX_IN_FLIGHT && !m_queue.isEmpty()) {
+        start(m_queue.takeFirst());
+    }
+}
+
+void SmallFileFetcher::start(const Entry& entry)
+{
+    QNetworkRequest request(entry.url);
+    request.setTransferTimeout(TRANSFER_TIMEOUT_MS);
+    request.setRawHeader("User-Agent", "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/91.0.4472.124 Safari/537.36");
+    request.setRawHeader("Accept", "*/*");
+    request.setRawHeader("Accept-Language", "en-US,en;q=0.9,zh-CN;q=0.8,zh;q=0.7");
+    if (!entry.addresses.isEmpty()) {
+        // 钉住地址时不自动跟随重定向：3xx 交给普通任务，由它逐个核对重定向目标
+        HostGuard::pinRequest(request, entry.url.host(), entry.addresses.first());
+        request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::ManualRedirectPolicy);
+    } else {
+        request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::SameOriginRedirectPolicy);
+    }
+
+    Entry started = entry;
+    started.startTime = QDateTime::currentDateTime();
+    QNetworkReply* reply = m_manager->get(request);
+    m_inFlight.insert(reply, started);
+
+    connect(reply, &QNetworkReply::metaDataChanged, this, [this, reply]() { onMetaDataChanged(reply); });
+    connect(reply, &QNetworkReply::readyRead, this, [this, reply]() {
+        // 没有 Content-Length 的大文件：收到的数据一过阈值就转普通任务
+        if (reply->bytesAvailable() > SMALL_FILE_THRESHOLD) {
+            LOGD(QString("快速通道：%1 超过 %2 字节，转为普通任务").arg(reply->url().toString()).arg(SMALL_FILE_THRESHOLD));
+            handOff(reply, m_inFlight.value(reply));
+        }
+    });
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() { onFinished(reply); });
+}
+
+void SmallFileFetcher::onMetaDataChanged(QNetworkReply* reply)
+{
+    const auto it = m_inFlight.constFind(reply);
+    if (it == m_inFlight.cend()) {
+        return;
+    }
+    // handOff 会把条目从 m_inFlight 移除，先拷贝出来
+    const Entry entry = *it;
+    const int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (statusCode >= 300 && statusCode < 400) {
+        // 自动跟随的中间响应，或钉住地址时的重定向（在 onFinished 里转普通任务）
+        return;
+    }
+    if (statusCode != 200) {
+        handOff(reply, entry);
+        return;
+    }
+    const qint64 length = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+    if (length > SMALL_FILE_THRESHOLD) {
+        // 响应头就是普通任务要 HEAD 的内容：写进元数据缓存，普通任务直接分片
+        UrlMetadata metadata = UrlMetadataCache::metadataFromReply(reply);
+        if (!entry.addresses.isEmpty()) {
+            metadata.finalUrl.setHost(entry.url.host());
+        }
+        UrlMetadataCache::instance().store(entry.url, metadata);
+        LOGD(QString("快速通道：%1 大小 %2，转为普通任务").arg(entry.url.toString()).arg(length));
+        handOff(reply, entry);
+    }
+}
+
+void SmallFileFetcher::onFinished(QNetworkReply* reply)
+{
+    const Entry entry = m_inFlight.take(reply);
+    reply->deleteLater();
+    if (entry.url.isEmpty()) {
+        return;
+    }
+
+    const int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (reply->error() != QNetworkReply::NoError || statusCode != 200) {
+        // 重试与报错都交给普通任务
+        LOGD(QString("快速通道：%1 未完成（%2 / HTTP %3），转为普通任务")
+             .arg(entry.url.toString(), reply->errorString()).arg(statusCode));
+        handOff(nullptr, entry);
+        return;
+    }
+
+    const QByteArray body = reply->readAll();
+    QDir().mkpath(QFileInfo(entry.filePath).absolutePath());
+    QSaveFile file(entry.filePath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(body) != body.size() || !file.commit()) {
+        LOGD(QString("快速通道：写入 %1 失败:%2，转为普通任务").arg(entry.filePath, file.errorString()));
+        handOff(nullptr, entry);
+        return;
+    }
+
+    DownloadRecord record;
+    record.url = entry.url.toString();
+    record.filePath = entry.filePath;
+    record.fileSize = body.size();
+    record.startTime = entry.startTime;
+    record.finishTime = QDateTime::currentDateTime();
+    record.status = QStringLiteral("Completed");
+    record.fileName = QFileInfo(entry.filePath).fileName();
+    m_pendingRecords.append(record);
+    if (m_pendingRecords.size() >= HISTORY_BATCH) {
+        flushHistory();
+    } else if (!m_historyTimer.isActive()) {
+        m_historyTimer.start();
+    }
+
+    emit fetched(entry.url, entry.filePath, body.size());
+    pump();
+}
+
+void SmallFileFetcher::handOff(QNetworkReply* reply, const Entry& entry, bool pumpNext)
+{
+    if (reply) {
+        // 先断开，abort() 同步发出的 finished 不再进 onFinished
+        m_inFlight.remove(reply);
+        reply->disconnect(this);
+        reply->abort();
+        reply->deleteLater();
+    }
+
+    // 进 DownloadManager 的队列，不直接建任务：批量里的大文件按活动任务上限逐个启动
+    const quint64 id = DownloadManager::instance().enqueue(entry.url, entry.filePath, entry.threadCount,
+                                                           entry.addresses);
+    emit handedOff(id);
+    if (pumpNext) {
+        pump();
+    }
+}
+
+void SmallFileFetcher::handOffAll()
+{
+    const QList<QNetworkReply*> replies = m_inFlight.keys();
+    for (QNetworkReply* reply : replies) {
+        handOff(reply, m_inFlight.value(reply), false);
+    }
+    const QList<Entry> queued = std::exchange(m_queue, {});
+    for (const Entry& entry : queued) {
+        handOff(nullptr, entry, false);
+    }
+    flushHistory();
+}
+
+void SmallFileFetcher::flushHistory()
+{
+    m_historyTimer.stop();
+    if (m_pendingRecords.isEmpty()) {
+        return;
+    }
+    HistoryManager::instance().addRecords(std::exchange(m_pendingRecords, {}));
+}
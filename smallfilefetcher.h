@@ -0,0 +1,136 @@
+#ifndef SMALLFILEFETCHER_H
+#define SMALLFILEFETCHER_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QHash>
+#include <QHostAddress>
+#include <QList>
+#include <QString>
+#include <QTimer>
+#include <QUrl>
+#include "historymanager.h"
+
+class QNetworkAccessManager;
+class QNetworkReply;
+
+/**
+ * @brief 小文件快速通道：批量投递大量小文件（图标、小构件）时绕开完整的任务管线。
+ *
+ * 完整管线对 20 KB 的文件也要 HEAD、建 DownloadTask、建带独立 QNAM 与线程的 HttpWorker、
+ * 写 .part0、合并成 .merge、改名，再单独记一条历史，开销远大于传输本身。快速通道：
+ *  - 所有请求共用一个 QNetworkAccessManager，同一主机复用 HTTP/1.1 keep-alive 连接
+ *    （批量条目都钉住了校验过的地址，HostGuard::pinRequest 会关闭 HTTP/2，不走多路复用），
+ *    最多 MAX_IN_FLIGHT 个并发，其余排队；
+ *  - 直接 GET，不发 HEAD；应答在内存里收齐后用 QSaveFile 一次写到目标路径，没有分片、合并与暂存目录；
+ *  - 历史记录攒批，每 HISTORY_FLUSH_MS 或攒满 HISTORY_BATCH 条才写一次。
+ *
+ * 不在快速通道处理的情况一律原样交给 DownloadManager 排队成普通任务（由它负责重试、续传与报错）：
+ * 响应头里的 Content-Length 超过 SMALL_FILE_THRESHOLD（响应头顺带写入 UrlMetadataCache，普通任务不再 HEAD）、
+ * 无长度但收到的数据超过阈值、非 200 状态（钉住地址时的重定向也在此列）、网络错误与写盘失败。
+ *
+ * 只在主线程使用。
+ */
+class SmallFileFetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 获取单例。
+     */
+    static SmallFileFetcher& instance();
+
+    SmallFileFetcher(const SmallFileFetcher&) = delete;
+    SmallFileFetcher& operator=(const SmallFileFetcher&) = delete;
+
+    /**
+     * @brief 以快速通道下载一个文件；不是小文件时自动转为普通任务。
+     * @param url 下载地址。
+     * @param filePath 目标文件的完整路径。
+     * @param threadCount 转为普通任务时使用的线程数。
+     * @param addresses SSRF 校验过的地址（为空时不钉）。
+     */
+    void fetch(const QUrl& url, const QString& filePath, int threadCount, const QList<QHostAddress>& addresses);
+
+    /**
+     * @brief 退出前调用：中止在途与排队的请求，全部转为 DownloadManager 的排队条目（随队列日志保存，下次启动恢复），
+     * 并写出攒着的历史记录。
+     */
+    void handOffAll();
+
+    /**
+     * @brief 保存路径是否已被另一个资源的在途或排队请求占用（同一资源不算）。
+     * @param url 新请求的下载地址。
+     * @param filePath 新请求解析后的保存路径。
+     */
+    bool isPathPending(const QUrl& url, const QString& filePath) const;
+
+signals:
+    /**
+     * @brief 一个文件已经由快速通道写到目标路径。
+     */
+    void fetched(const QUrl& url, const QString& filePath, qint64 size);
+
+    /**
+     * @brief 一个请求转成了普通任务（进入 DownloadManager 的队列）。
+     * @param id 任务编号。
+     */
+    void handedOff(quint64 id);
+
+private:
+    explicit SmallFileFetcher(QObject* parent = nullptr);
+
+    struct Entry {
+        QUrl url;                       ///< 下载地址。
+        QString filePath;               ///< 目标路径。
+        int threadCount = 1;            ///< 转为普通任务时的线程数。
+        QList<QHostAddress> addresses;  ///< 校验过的地址。
+        QDateTime startTime;            ///< 开始时间（历史记录用）。
+    };
+
+    /**
+     * @brief 在并发上限内启动排队的请求。
+     */
+    void pump();
+
+    /**
+     * @brief 发出一个请求。
+     */
+    void start(const Entry& entry);
+
+    /**
+     * @brief 响应头到达：不是可走快速通道的小文件就转为普通任务。
+     */
+    void onMetaDataChanged(QNetworkReply* reply);
+
+    /**
+     * @brief 请求完成：写目标文件并记历史；出错则转为普通任务。
+     */
+    void onFinished(QNetworkReply* reply);
+
+    /**
+     * @brief 中止请求（若有）并把条目放进 DownloadManager 的队列。
+     * @param pumpNext 是否接着启动排队的快速通道请求（退出时不再启动）。
+     */
+    void handOff(QNetworkReply* reply, const Entry& entry, bool pumpNext = true);
+
+    /**
+     * @brief 写出攒着的历史记录。
+     */
+    void flushHistory();
+
+    QNetworkAccessManager* m_manager = nullptr;  ///< 所有快速通道请求共用的网络管理器。
+    QList<Entry> m_queue;                        ///< 等待并发名额的条目。
+    QHash<QNetworkReply*, Entry> m_inFlight;     ///< 在途请求。
+    QList<DownloadRecord> m_pendingRecords;      ///< 还没写出的历史记录。
+    QTimer m_historyTimer;                       ///< 历史记录攒批定时器。
+
+    static constexpr qint64 SMALL_FILE_THRESHOLD = 1 * 1024 * 1024; ///< 快速通道的文件大小上限 1 MiB
+    static constexpr int MAX_IN_FLIGHT          = 32;               ///< 并发请求上限（同时也限制了内存占用）
+    static constexpr int TRANSFER_TIMEOUT_MS    = 15 * 1000;        ///< 单个请求的无数据超时
+    static constexpr int HISTORY_FLUSH_MS       = 1000;             ///< 历史记录最长攒批时间
+    static constexpr int HISTORY_BATCH          = 256;              ///< 攒满即写的历史记录条数
+};
+
+#endif // SMALLFILEFETCHER_H
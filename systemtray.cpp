@@ -1,6 +1,7 @@
 #include "systemtray.h"
 #include "logger.h"
 #include "settingsmanager.h"
+#include "downloadmanager.h"
 #include <QPointer>
 #include <QTimer>
 
@@ -77,6 +78,10 @@ SystemTray::SystemTray(QMainWindow* mainWindow, QObject *parent)
         if (m_quitAction) m_quitAction->setText(tr("退出"));
         m_trayIcon->setToolTip(tr("Downloader"));
     });
+
+    // 托盘提示与主窗口共用同一份遥测快照，不再单独轮询任务
+    connect(&DownloadManager::instance(), &DownloadManager::telemetryUpdated,
+            this, &SystemTray::onTelemetryUpdated);
 }
 
 SystemTray::~SystemTray()
@@ -202,3 +207,29 @@ void SystemTray::onQuitApplication()
         QApplication::quit();
     }
 }
+
+void SystemTray::onTelemetryUpdated(const QList<TaskTelemetry>& snapshot)
+{
+    int downloading = 0;
+    qint64 totalSpeed = 0;
+    for (const TaskTelemetry& sample : snapshot) {
+        if (sample.status == DownloadTaskStatus::Downloading) {
+            ++downloading;
+            totalSpeed += sample.speed;
+        }
+    }
+
+    QString activity;
+    if (downloading > 0) {
+        const QString speedText = totalSpeed < 1024 * 1024
+            ? QString("%1 KB/s").arg(totalSpeed / 1024.0, 0, 'f', 1)
+            : QString("%1 MB/s").arg(totalSpeed / (1024.0 * 1024), 0, 'f', 1);
+        activity = tr("%1 个任务下载中 - %2").arg(downloading).arg(speedText);
+    }
+    // 文案不变时不重设 tooltip，避免部分平台每次 setToolTip 都重绘托盘
+    if (activity == m_activityToolTip) {
+        return;
+    }
+    m_activityToolTip = activity;
+    m_trayIcon->setToolTip(activity.isEmpty() ? tr("Downloader") : tr("Downloader") + "\n" + activity);
+}
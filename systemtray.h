@@ -7,6 +7,7 @@
 #include <QAction>
 #include <QApplication>
 #include <QMainWindow>
+#include "downloadtask.h"
 
 /**
  * @brief SystemTray类用于管理应用程序的系统托盘图标和相关功能。
@@ -64,6 +65,12 @@ private slots:
      */
     void onQuitApplication();
 
+    /**
+     * @brief 根据 DownloadManager 的遥测快照刷新托盘提示（活动任务数与总速度）。
+     * @param snapshot 本周期所有活动任务的采样结果。
+     */
+    void onTelemetryUpdated(const QList<TaskTelemetry>& snapshot);
+
 private:
     /**
      * @brief 创建托盘图标的上下文菜单。
@@ -76,6 +83,7 @@ private:
 
     QAction* m_showAction;          ///< “显示主窗口”动作。
     QAction* m_quitAction;          ///< “退出”动作。
+    QString m_activityToolTip;      ///< 最近一次遥测生成的活动提示（为空表示没有下载中的任务）。
 };
 
 #endif // SYSTEMTRAY_H
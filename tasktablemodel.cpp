@@ -0,0 +1,358 @@
+#include "tasktablemodel.h"
+#include "downloadmanager.h"
+
+#include <QFileInfo>
+#include <algorithm>
+#include <functional>
+
+TaskTableModel::TaskTableModel(QObject* parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+int TaskTableModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : int(m_rows.size());
+}
+
+int TaskTableModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant TaskTableModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_rows.size()) {
+        return QVariant();
+    }
+    const Row& row = m_rows.at(index.row());
+
+    if (role == Qt::DisplayRole) {
+        switch (index.column()) {
+        case FileNameColumn: return row.fileName;
+        case UrlColumn:      return row.url;
+        case ProgressColumn: return row.percent;
+        case SizeColumn:     return sizeText(row);
+        case SpeedColumn:    return formatSpeed(row.speed);
+        case StatusColumn:   return statusText(row);
+        case ActionColumn:   return tr("操作");
+        }
+    } else if (role == Qt::ToolTipRole) {
+        switch (index.column()) {
+        case FileNameColumn: return row.fileName;
+        case UrlColumn:      return row.url;
+        case SizeColumn:
+            return tr("已下载: %1\n总大小: %2").arg(formatBytes(row.downloadedBytes), formatBytes(row.totalBytes));
+        case SpeedColumn:
+            return tr("当前下载速度: %1\n预计剩余: %2").arg(formatSpeed(row.speed), formatEta(row.etaSeconds));
+        case StatusColumn:
+            return tr("任务状态: %1").arg(statusText(row));
+        }
+    } else if (role == Qt::TextAlignmentRole) {
+        if (index.column() == SizeColumn || index.column() == SpeedColumn || index.column() == StatusColumn) {
+            return int(Qt::AlignCenter);
+        }
+    }
+    return QVariant();
+}
+
+QVariant TaskTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+    switch (section) {
+    case FileNameColumn: return tr("文件名");
+    case UrlColumn:      return tr("URL");
+    case ProgressColumn: return tr("进度");
+    case SizeColumn:     return tr("大小");
+    case SpeedColumn:    return tr("速度");
+    case StatusColumn:   return tr("状态");
+    case ActionColumn:   return tr("操作");
+    }
+    return QVariant();
+}
+
+void TaskTableModel::addTask(DownloadTask* task)
+{
+    if (!task) {
+        return;
+    }
+    const int existing = rowOfTask(task->id());
+    if (existing >= 0) {
+        Row& row = m_rows[existing];
+        if (row.queued) {
+            // 排队条目轮到了：同一编号的任务接管这一行
+            row.task = task;
+            row.queued = false;
+            readTask(task, &row);
+            emitRowsChanged({existing});
+            return;
+        }
+        refreshTask(task);
+        return;
+    }
+
+    Row row;
+    row.task = task;
+    row.id = task->id();
+    row.fileName = task->fileName();
+    row.url = task->url();
+    readTask(task, &row);
+
+    const int index = int(m_rows.size());
+    beginInsertRows(QModelIndex(), index, index);
+    m_rows.append(row);
+    m_rowOf.insert(row.id, index);
+    endInsertRows();
+}
+
+void TaskTableModel::addQueued(const QueuedTask& entry)
+{
+    if (m_rowOf.contains(entry.id)) {
+        return;
+    }
+
+    Row row;
+    row.id = entry.id;
+    row.queued = true;
+    row.fileName = QFileInfo(entry.filePath).fileName();
+    row.url = entry.url.toString();
+
+    const int index = int(m_rows.size());
+    beginInsertRows(QModelIndex(), index, index);
+    m_rows.append(row);
+    m_rowOf.insert(row.id, index);
+    endInsertRows();
+}
+
+void TaskTableModel::markQueuedCancelled(quint64 id)
+{
+    const int index = rowOfTask(id);
+    if (index < 0 || !m_rows.at(index).queued) {
+        return;
+    }
+    Row& row = m_rows[index];
+    row.queued = false;
+    row.status = DownloadTaskStatus::Cancelled;
+    emitRowsChanged({index});
+}
+
+void TaskTableModel::refreshTask(DownloadTask* task)
+{
+    if (!task) {
+        return;
+    }
+    const int index = rowOfTask(task->id());
+    if (index < 0) {
+        return;
+    }
+    Row& row = m_rows[index];
+    const Row before = row;
+    readTask(task, &row);
+    if (!row.sameValues(before)) {
+        emitRowsChanged({index});
+    }
+}
+
+void TaskTableModel::applyTelemetry(const QList<TaskTelemetry>& snapshot)
+{
+    QList<int> changed;
+    for (const TaskTelemetry& sample : snapshot) {
+        if (!sample.task) {
+            continue;
+        }
+        const int index = rowOfTask(sample.task->id());
+        if (index < 0) {
+            continue;
+        }
+        Row next = m_rows.at(index);
+        next.status = sample.status;
+        next.phase = sample.phase;
+        next.waitingForDiskSpace = sample.task->isWaitingForDiskSpace();
+        next.downloadedBytes = sample.downloadedBytes;
+        next.totalBytes = sample.totalBytes;
+        next.speed = sample.speed;
+        next.etaSeconds = sample.etaSeconds;
+        next.percent = sample.percent;
+        if (!next.sameValues(m_rows.at(index))) {
+            m_rows[index] = next;
+            changed.append(index);
+        }
+    }
+    emitRowsChanged(changed);
+}
+
+void TaskTableModel::removeRowsAt(QList<int> rows)
+{
+    std::sort(rows.begin(), rows.end(), std::greater<int>());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+    // 从后往前按连续段删除，前面的行号不受影响
+    qsizetype i = 0;
+    while (i < rows.size()) {
+        const int last = rows.at(i);
+        if (last < 0 || last >= m_rows.size()) {
+            ++i;
+            continue;
+        }
+        int first = last;
+        while (i + 1 < rows.size() && rows.at(i + 1) == first - 1) {
+            first = rows.at(++i);
+        }
+        ++i;
+        beginRemoveRows(QModelIndex(), first, last);
+        for (int r = first; r <= last; ++r) {
+            m_rowOf.remove(m_rows.at(r).id);
+        }
+        m_rows.remove(first, last - first + 1);
+        endRemoveRows();
+    }
+
+    // 删除之后的行整体前移：重建索引
+    for (int r = 0; r < m_rows.size(); ++r) {
+        m_rowOf[m_rows.at(r).id] = r;
+    }
+}
+
+DownloadTask* TaskTableModel::taskAt(int row) const
+{
+    if (row < 0 || row >= m_rows.size()) {
+        return nullptr;
+    }
+    return m_rows.at(row).task.data();
+}
+
+quint64 TaskTableModel::idAt(int row) const
+{
+    if (row < 0 || row >= m_rows.size()) {
+        return 0;
+    }
+    return m_rows.at(row).id;
+}
+
+bool TaskTableModel::isQueuedAt(int row) const
+{
+    return row >= 0 && row < m_rows.size() && m_rows.at(row).queued;
+}
+
+void TaskTableModel::retranslate()
+{
+    emit headerDataChanged(Qt::Horizontal, 0, ColumnCount - 1);
+    if (!m_rows.isEmpty()) {
+        emit dataChanged(index(0, 0), index(int(m_rows.size()) - 1, ColumnCount - 1));
+    }
+}
+
+bool TaskTableModel::Row::sameValues(const Row& other) const
+{
+    return queued == other.queued && status == other.status && phase == other.phase
+        && waitingForDiskSpace == other.waitingForDiskSpace
+        && downloadedBytes == other.downloadedBytes && totalBytes == other.totalBytes
+        && speed == other.speed && etaSeconds == other.etaSeconds && percent == other.percent;
+}
+
+void TaskTableModel::readTask(const DownloadTask* task, Row* row)
+{
+    row->status = task->status();
+    row->phase = task->finalizePhase();
+    row->waitingForDiskSpace = task->isWaitingForDiskSpace();
+    row->downloadedBytes = task->downloadedSize();
+    row->totalBytes = task->totalSize();
+    row->speed = task->downloadSpeed();
+    row->etaSeconds = task->etaSeconds();
+    row->percent = row->phase == FinalizePhase::None ? task->progressPercentage() : task->finalizePercentage();
+}
+
+void TaskTableModel::emitRowsChanged(QList<int> rows)
+{
+    if (rows.isEmpty()) {
+        return;
+    }
+    std::sort(rows.begin(), rows.end());
+    qsizetype i = 0;
+    while (i < rows.size()) {
+        const int first = rows.at(i);
+        int last = first;
+        while (i + 1 < rows.size() && rows.at(i + 1) <= last + 1) {
+            last = rows.at(++i);
+        }
+        ++i;
+        emit dataChanged(index(first, ProgressColumn), index(last, StatusColumn));
+    }
+}
+
+QString TaskTableModel::sizeText(const Row& row)
+{
+    if (row.totalBytes <= 0) {
+        return formatBytes(row.downloadedBytes) + "/" + tr("未知");
+    }
+    return formatBytes(row.downloadedBytes) + "/" + formatBytes(row.totalBytes);
+}
+
+QString TaskTableModel::statusText(const Row& row)
+{
+    if (row.queued) {
+        return tr("排队");
+    }
+    if (row.phase != FinalizePhase::None && row.status == DownloadTaskStatus::Downloading) {
+        switch (row.phase) {
+        case FinalizePhase::Merging:  return tr("合并中");
+        case FinalizePhase::Moving:   return tr("移动中");
+        case FinalizePhase::Cleaning: return tr("清理中");
+        case FinalizePhase::None:     break;
+        }
+    }
+    if (row.waitingForDiskSpace && row.status == DownloadTaskStatus::Pending) {
+        return tr("等待磁盘空间");
+    }
+    switch (row.status) {
+    case DownloadTaskStatus::Pending:     return tr("等待中");
+    case DownloadTaskStatus::Downloading: return tr("下载中");
+    case DownloadTaskStatus::Paused:      return tr("已暂停");
+    case DownloadTaskStatus::Cancelled:   return tr("已取消");
+    case DownloadTaskStatus::Completed:   return tr("已完成");
+    case DownloadTaskStatus::Failed:      return tr("失败");
+    }
+    return QString();
+}
+
+QString TaskTableModel::formatBytes(qint64 bytes)
+{
+    if (bytes < 1024) {
+        return QString("%1 B").arg(bytes);
+    } else if (bytes < 1024 * 1024) {
+        return QString("%1 KB").arg(bytes / 1024.0, 0, 'f', 2);
+    } else if (bytes < 1024 * 1024 * 1024) {
+        return QString("%1 MB").arg(bytes / (1024.0 * 1024), 0, 'f', 2);
+    } else {
+        return QString("%1 GB").arg(bytes / (1024.0 * 1024 * 1024), 0, 'f', 2);
+    }
+}
+
+QString TaskTableModel::formatSpeed(qint64 bytesPerSecond)
+{
+    if (bytesPerSecond < 1024) {
+        return QString("%1 B/s").arg(bytesPerSecond);
+    } else if (bytesPerSecond < 1024 * 1024) {
+        return QString("%1 KB/s").arg(bytesPerSecond / 1024.0, 0, 'f', 2);
+    } else if (bytesPerSecond < 1024 * 1024 * 1024) {
+        return QString("%1 MB/s").arg(bytesPerSecond / (1024.0 * 1024), 0, 'f', 2);
+    } else {
+        return QString("%1 GB/s").arg(bytesPerSecond / (1024.0 * 1024 * 1024), 0, 'f', 2);
+    }
+}
+
+QString TaskTableModel::formatEta(qint64 seconds)
+{
+    if (seconds < 0) {
+        return tr("未知");
+    }
+    const qint64 hours = seconds / 3600;
+    const qint64 minutes = (seconds % 3600) / 60;
+    const qint64 secs = seconds % 60;
+    if (hours > 0) {
+        return QString("%1:%2:%3").arg(hours).arg(minutes, 2, 10, QChar('0')).arg(secs, 2, 10, QChar('0'));
+    }
+    return QString("%1:%2").arg(minutes).arg(secs, 2, 10, QChar('0'));
+}
@@ -0,0 +1,167 @@
+#ifndef TASKTABLEMODEL_H
+#define TASKTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QString>
+#include "downloadtask.h"
+
+struct QueuedTask;
+
+/**
+ * @brief 主窗口任务列表的数据模型。
+ *
+ * 每行保存任务最近一次的显示值（状态、进度、速度等），不给每行建 QProgressBar / QLabel：
+ * 视图只为可见行调用 data()，进度列由 TaskProgressDelegate 直接绘制，十万行滚动也不卡。
+ * 任务编号 -> 行号用哈希索引，遥测批次按编号 O(1) 定位；只有显示值真的变了的行才进入
+ * dataChanged，相邻的行合并成一段发出。
+ *
+ * 排队条目（DownloadManager 的 QueuedTask，还没有 DownloadTask）也占一行，状态显示"排队"；
+ * 轮到它时 DownloadManager 用同一编号建任务，addTask 把这一行就地换成任务行，位置不变。
+ * 任务结束后 DownloadManager 释放 DownloadTask，行里保留最终状态，taskAt() 返回 nullptr。
+ * 只在主线程使用。
+ */
+class TaskTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    /// 列。
+    enum Column {
+        FileNameColumn = 0,
+        UrlColumn,
+        ProgressColumn,     ///< DisplayRole 为百分比（int），由 TaskProgressDelegate 绘制。
+        SizeColumn,
+        SpeedColumn,
+        StatusColumn,
+        ActionColumn,
+        ColumnCount
+    };
+
+    explicit TaskTableModel(QObject* parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    /**
+     * @brief 在末尾加一行；任务已在表中时只刷新，是排队行时换成任务行。
+     */
+    void addTask(DownloadTask* task);
+
+    /**
+     * @brief 为排队条目在末尾加一行（编号已在表中时忽略）。
+     */
+    void addQueued(const QueuedTask& entry);
+
+    /**
+     * @brief 排队条目被取消：行保留，状态改为"已取消"。
+     */
+    void markQueuedCancelled(quint64 id);
+
+    /**
+     * @brief 从任务对象读取当前值刷新所在行（状态变化、完成、出错时调用）。
+     */
+    void refreshTask(DownloadTask* task);
+
+    /**
+     * @brief 用一批遥测采样刷新对应的行，只对值有变化的行发 dataChanged。
+     */
+    void applyTelemetry(const QList<TaskTelemetry>& snapshot);
+
+    /**
+     * @brief 删除若干行（顺序与重复不限）。
+     */
+    void removeRowsAt(QList<int> rows);
+
+    /**
+     * @brief 行对应的任务；任务已释放或行号越界时返回 nullptr。
+     */
+    DownloadTask* taskAt(int row) const;
+
+    /**
+     * @brief 行对应的任务或排队条目编号；行号越界时返回 0。
+     */
+    quint64 idAt(int row) const;
+
+    /**
+     * @brief 行是否是还没建任务的排队条目。
+     */
+    bool isQueuedAt(int row) const;
+
+    /**
+     * @brief 任务编号所在的行；不在表中返回 -1。
+     */
+    int rowOfTask(quint64 id) const { return m_rowOf.value(id, -1); }
+
+    /**
+     * @brief 语言切换后让表头与所有单元格按当前语言重新取文案（视图只重画可见部分）。
+     */
+    void retranslate();
+
+    /**
+     * @brief 将字节数转换为可读的字符串（例如：KB, MB, GB）。
+     */
+    static QString formatBytes(qint64 bytes);
+
+    /**
+     * @brief 将下载速度转换为可读的字符串。
+     */
+    static QString formatSpeed(qint64 bytesPerSecond);
+
+    /**
+     * @brief 将剩余秒数转换为可读的字符串（例如 1:02:03）；小于 0 表示未知。
+     */
+    static QString formatEta(qint64 seconds);
+
+private:
+    /**
+     * @brief 一行的显示值。
+     */
+    struct Row {
+        QPointer<DownloadTask> task;                          ///< 任务（结束并释放后为空）。
+        quint64 id = 0;                                       ///< 任务编号。
+        bool queued = false;                                  ///< 排队条目，还没有 DownloadTask。
+        QString fileName;                                     ///< 文件名。
+        QString url;                                          ///< 下载地址。
+        DownloadTaskStatus status = DownloadTaskStatus::Pending; ///< 状态。
+        FinalizePhase phase = FinalizePhase::None;            ///< 收尾阶段。
+        bool waitingForDiskSpace = false;                     ///< 是否在等磁盘空间。
+        qint64 downloadedBytes = 0;                           ///< 已下载字节数。
+        qint64 totalBytes = 0;                                ///< 总字节数（0 表示未知）。
+        qint64 speed = 0;                                     ///< 速度（字节/秒）。
+        qint64 etaSeconds = -1;                               ///< 预计剩余秒数。
+        int percent = 0;                                      ///< 进度（收尾期间为收尾进度）。
+
+        /// 可变的显示值是否相同（决定是否需要 dataChanged）。
+        bool sameValues(const Row& other) const;
+    };
+
+    /**
+     * @brief 从任务对象读出一行的可变显示值。
+     */
+    static void readTask(const DownloadTask* task, Row* row);
+
+    /**
+     * @brief 大小列文本：总大小未知时显示"未知"，避免 "X / 0 B"。
+     */
+    static QString sizeText(const Row& row);
+
+    /**
+     * @brief 状态列文本：排队条目显示"排队"；收尾阶段与等待磁盘空间优先于状态枚举。
+     */
+    static QString statusText(const Row& row);
+
+    /**
+     * @brief 把变化的行号排序后按连续段发出 dataChanged（只涉及会变的列）。
+     */
+    void emitRowsChanged(QList<int> rows);
+
+    QList<Row> m_rows;                  ///< 行数据。
+    QHash<quint64, int> m_rowOf;        ///< 任务编号 -> 行号。
+};
+
+#endif // TASKTABLEMODEL_H
@@ -0,0 +1,117 @@
+#include "terminationsignal.h"
+#include "logger.h"
+#include <QCoreApplication>
+#include <QMetaObject>
+#include <atomic>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <QSocketNotifier>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    /// aboutToQuit 处理（含 DownloadManager::shutdown）已执行完
+    std::atomic<bool> g_quitHandled{false};
+
+#ifdef _WIN32
+    /// 控制台事件回调最多等待检查点的时间；系统对关闭事件大约给 5 秒
+    constexpr DWORD kConsoleWaitMs = 3000;
+
+    BOOL WINAPI consoleCtrlHandler(DWORD ctrlType)
+    {
+        switch (ctrlType) {
+        case CTRL_C_EVENT:
+        case CTRL_BREAK_EVENT:
+        case CTRL_CLOSE_EVENT:
+        case CTRL_LOGOFF_EVENT:
+        case CTRL_SHUTDOWN_EVENT:
+            break;
+        default:
+            return FALSE;
+        }
+        if (QCoreApplication* app = QCoreApplication::instance()) {
+            QMetaObject::invokeMethod(app, []() { QCoreApplication::quit(); }, Qt::QueuedConnection);
+        }
+        // 回调返回后系统会直接结束进程：等主线程把检查点写完
+        for (DWORD waited = 0; waited < kConsoleWaitMs && !g_quitHandled.load(); waited += 10) {
+            Sleep(10);
+        }
+        return TRUE;
+    }
+#endif
+}
+
+#ifndef _WIN32
+int TerminationSignal::s_socketPair[2] = {-1, -1};
+#endif
+
+TerminationSignal::TerminationSignal(QObject* parent)
+    : QObject(parent)
+{
+#ifndef _WIN32
+    m_notifier = new QSocketNotifier(s_socketPair[1], QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &TerminationSignal::onSignalReceived);
+#endif
+}
+
+void TerminationSignal::install()
+{
+    QCoreApplication* app = QCoreApplication::instance();
+    if (!app) {
+        return;
+    }
+    static bool installed = false;
+    if (installed) {
+        return;
+    }
+    installed = true;
+
+    // 在 DownloadManager 之后连接：轮到这里时检查点已经写完
+    QObject::connect(app, &QCoreApplication::aboutToQuit, app, []() {
+        g_quitHandled.store(true);
+    });
+
+#ifdef _WIN32
+    SetConsoleCtrlHandler(consoleCtrlHandler, TRUE);
+    LOGD("TerminationSignal: 已安装控制台事件处理");
+#else
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, s_socketPair) != 0) {
+        LOGD("TerminationSignal: socketpair 创建失败，终止信号按系统默认处理");
+        return;
+    }
+    new TerminationSignal(app);
+
+    struct sigaction action = {};
+    action.sa_handler = &TerminationSignal::handleSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGTERM, &action, nullptr);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGHUP, &action, nullptr);
+    LOGD("TerminationSignal: 已安装 SIGTERM/SIGINT/SIGHUP 处理");
+#endif
+}
+
+#ifndef _WIN32
+void TerminationSignal::handleSignal(int signum)
+{
+    const char byte = static_cast<char>(signum);
+    // write 是 async-signal-safe；写失败（缓冲满）说明已有未处理的退出请求
+    [[maybe_unused]] const ssize_t written = ::write(s_socketPair[0], &byte, sizeof(byte));
+}
+#endif
+
+void TerminationSignal::onSignalReceived()
+{
+#ifndef _WIN32
+    m_notifier->setEnabled(false);
+    char byte = 0;
+    [[maybe_unused]] const ssize_t got = ::read(s_socketPair[1], &byte, sizeof(byte));
+    LOGD(QString("TerminationSignal: 收到信号%1，开始优雅退出").arg(static_cast<int>(byte)));
+    QCoreApplication::quit();
+#endif
+}
@@ -0,0 +1,49 @@
+#ifndef TERMINATIONSIGNAL_H
+#define TERMINATIONSIGNAL_H
+
+#include <QObject>
+
+class QSocketNotifier;
+
+/**
+ * @brief 把进程终止信号接到 Qt 的正常退出路径上。
+ *
+ * 收到终止请求后在主线程调用 QCoreApplication::quit()，从而触发 aboutToQuit →
+ * DownloadManager::shutdown()：与托盘退出、File->Exit 走同一个快速检查点。
+ * 批量重启打补丁时由服务管理器发 SIGTERM，无界面进程也能在截止时间内保存续传状态。
+ *
+ *  - Unix：SIGTERM / SIGINT / SIGHUP。信号处理函数只往 socketpair 写一个字节
+ *    （async-signal-safe），QSocketNotifier 在主线程事件循环里读到后再 quit。
+ *  - Windows：SetConsoleCtrlHandler 接 Ctrl+C / 关闭 / 注销 / 关机事件。回调在系统线程上，
+ *    投递 quit 后等待检查点完成再返回（系统在回调返回后即结束进程）。
+ */
+class TerminationSignal : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 安装处理器（在 QCoreApplication 与 DownloadManager 创建之后调用一次）。
+     */
+    static void install();
+
+private:
+    explicit TerminationSignal(QObject* parent = nullptr);
+
+private slots:
+    /**
+     * @brief 主线程读到信号字节后请求退出（仅 Unix 使用）。
+     */
+    void onSignalReceived();
+
+private:
+#ifndef _WIN32
+    /// 信号处理函数：只写 socketpair，不做任何其它事。
+    static void handleSignal(int signum);
+
+    static int s_socketPair[2];             ///< [0] 由信号处理函数写，[1] 由主线程读。
+#endif
+    QSocketNotifier* m_notifier = nullptr;  ///< 监听 s_socketPair[1]（仅 Unix）。
+};
+
+#endif // TERMINATIONSIGNAL_H
@@ -0,0 +1,118 @@
+#include "urlmetadatacache.h"
+#include "downloadmanager.h"
+
+#include <QMutexLocker>
+#include <QNetworkReply>
+#include <QList>
+
+UrlMetadataCache& UrlMetadataCache::instance()
+{
+    static UrlMetadataCache instance;
+    return instance;
+}
+
+UrlMetadataCache::UrlMetadataCache()
+{
+    m_clock.start();
+}
+
+bool UrlMetadataCache::lookup(const QUrl& url, UrlMetadata* out)
+{
+    const QString key = DownloadManager::taskKey(url);
+    QMutexLocker locker(&m_mutex);
+    const auto it = m_cache.constFind(key);
+    if (it == m_cache.cend()) {
+        return false;
+    }
+    if (it->expiresAtMs <= m_clock.elapsed()) {
+        m_cache.erase(it);
+        return false;
+    }
+    if (out) {
+        *out = it->metadata;
+    }
+    return true;
+}
+
+void UrlMetadataCache::store(const QUrl& url, const UrlMetadata& metadata)
+{
+    const QString key = DownloadManager::taskKey(url);
+    QMutexLocker locker(&m_mutex);
+    const qint64 now = m_clock.elapsed();
+    if (m_cache.size() >= MAX_CACHE_ENTRIES && !m_cache.contains(key)) {
+        for (auto it = m_cache.begin(); it != m_cache.end();) {
+            it = it->expiresAtMs <= now ? m_cache.erase(it) : std::next(it);
+        }
+        if (m_cache.size() >= MAX_CACHE_ENTRIES) {
+            m_cache.clear();
+        }
+    }
+
+    CacheEntry entry;
+    entry.metadata = metadata;
+    entry.expiresAtMs = now + TTL_MS;
+    m_cache.insert(key, entry);
+}
+
+void UrlMetadataCache::invalidate(const QUrl& url)
+{
+    const QString key = DownloadManager::taskKey(url);
+    QMutexLocker locker(&m_mutex);
+    m_cache.remove(key);
+}
+
+UrlMetadata UrlMetadataCache::metadataFromReply(const QNetworkReply* reply)
+{
+    UrlMetadata metadata;
+    metadata.finalUrl = reply->url();
+    metadata.totalSize = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+    metadata.acceptRanges = reply->rawHeader("Accept-Ranges") == "bytes";
+    metadata.etag = reply->rawHeader("ETag");
+    metadata.lastModified = reply->rawHeader("Last-Modified");
+    metadata.fileName = fileNameFromContentDisposition(reply->rawHeader("Content-Disposition"));
+    return metadata;
+}
+
+QString UrlMetadataCache::fileNameFromContentDisposition(const QByteArray& header)
+{
+    QString plain;
+    QString extended;
+    const QList<QByteArray> params = header.split(';');
+    for (const QByteArray& raw : params) {
+        const QByteArray param = raw.trimmed();
+        const qsizetype eq = param.indexOf('=');
+        if (eq <= 0) continue;
+        const QByteArray name = param.left(eq).trimmed().toLower();
+        QByteArray value = param.mid(eq + 1).trimmed();
+        if (name == "filename*") {
+            // RFC 5987：charset'language'percent-encoded
+            const qsizetype q1 = value.indexOf('\'');
+            const qsizetype q2 = q1 < 0 ? -1 : value.indexOf('\'', q1 + 1);
+            if (q2 < 0) continue;
+            const QByteArray charset = value.left(q1).toLower();
+            const QByteArray decoded = QByteArray::fromPercentEncoding(value.mid(q2 + 1));
+            extended = charset == "utf-8" ? QString::fromUtf8(decoded) : QString::fromLatin1(decoded);
+        } else if (name == "filename") {
+            if (value.size() >= 2 && value.startsWith('"') && value.endsWith('"')) {
+                value = value.mid(1, value.size() - 2);
+            }
+            plain = QString::fromUtf8(value);
+        }
+    }
+
+    QString fileName = extended.isEmpty() ? plain : extended;
+    const qsizetype slash = qMax(fileName.lastIndexOf('/'), fileName.lastIndexOf('\\'));
+    if (slash >= 0) {
+        fileName = fileName.mid(slash + 1);
+    }
+    fileName = fileName.trimmed();
+    if (fileName == QLatin1String(".") || fileName == QLatin1String("..")) {
+        return QString();
+    }
+    for (QChar c : std::as_const(fileName)) {
+        if (c.unicode() < 0x20 || QStringLiteral("<>:\"|?*").contains(c)) {
+            return QString();
+        }
+    }
+    return fileName;
+}
@@ -0,0 +1,95 @@
+#ifndef URLMETADATACACHE_H
+#define URLMETADATACACHE_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QUrl>
+
+class QNetworkReply;
+
+/**
+ * @brief 一次 HEAD 探测得到的资源元数据。
+ */
+struct UrlMetadata {
+    QUrl finalUrl;              ///< 跟随重定向后的地址（钉住地址时主机仍写原主机名）。
+    qint64 totalSize = 0;       ///< Content-Length；未知时为 0。
+    QByteArray etag;            ///< ETag（无则为空）。
+    QByteArray lastModified;    ///< Last-Modified（无则为空）。
+    bool acceptRanges = false;  ///< 是否支持 Range 请求。
+    QString fileName;           ///< Content-Disposition 给出的文件名（无则为空）。
+};
+
+/**
+ * @brief URL 元数据与重定向终点缓存。
+ *
+ * 以源 URL（DownloadManager::taskKey 规范化后）为键，缓存探测结果 TTL_MS：
+ *  - 每个分片 worker 与重试直接请求重定向终点，短链 / 签名跳转的重定向往返只在探测时付一次，
+ *    而不是每个分片各走一遍；
+ *  - TTL 内重复下载同一 URL 不再发 HEAD，直接按缓存的大小与 Range 支持分片；
+ *  - 没有文件名的 URL 用 Content-Disposition 给出的名字落地。
+ *
+ * 缓存的终点可能过期（签名 URL 失效、文件被替换）：任务失败时 DownloadManager 会让对应条目失效，
+ * 重新开始时重新探测。线程安全。
+ */
+class UrlMetadataCache
+{
+public:
+    /**
+     * @brief 获取单例。
+     */
+    static UrlMetadataCache& instance();
+
+    UrlMetadataCache(const UrlMetadataCache&) = delete;
+    UrlMetadataCache& operator=(const UrlMetadataCache&) = delete;
+
+    /**
+     * @brief 查找未过期的元数据。
+     * @param url 源 URL。
+     * @param out 命中时写入。
+     * @return 是否命中。
+     */
+    bool lookup(const QUrl& url, UrlMetadata* out);
+
+    /**
+     * @brief 写入一次探测结果。
+     */
+    void store(const QUrl& url, const UrlMetadata& metadata);
+
+    /**
+     * @brief 让某个 URL 的条目失效（下载失败时调用）。
+     */
+    void invalidate(const QUrl& url);
+
+    /**
+     * @brief 从 Content-Disposition 头取文件名：优先 RFC 5987 的 filename*，其次 filename。
+     * 只保留最后一个路径分量。
+     * @return 没有文件名或不可用时返回空。
+     */
+    static QString fileNameFromContentDisposition(const QByteArray& header);
+
+    /**
+     * @brief 从一次成功的 HEAD 应答提取元数据。finalUrl 取应答的最终地址，
+     * 请求钉了地址时由调用方换回原主机名。
+     */
+    static UrlMetadata metadataFromReply(const QNetworkReply* reply);
+
+private:
+    UrlMetadataCache();
+
+    struct CacheEntry {
+        UrlMetadata metadata;       ///< 缓存的元数据。
+        qint64 expiresAtMs = 0;     ///< 过期时刻（m_clock 毫秒）。
+    };
+
+    QMutex m_mutex;                         ///< 保护 m_cache。
+    QElapsedTimer m_clock;                  ///< 过期时钟（单调）。
+    QHash<QString, CacheEntry> m_cache;     ///< 规范化 URL -> 元数据。
+
+    static constexpr qint64 TTL_MS          = 5 * 60 * 1000; ///< 条目有效期 5 分钟（签名 URL 通常更久才失效）
+    static constexpr int MAX_CACHE_ENTRIES  = 512;           ///< 条目上限
+};
+
+#endif // URLMETADATACACHE_H
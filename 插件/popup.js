@@ -1,15 +1,21 @@
 document.addEventListener('DOMContentLoaded', function() {
   const portInput = document.getElementById('port');
+  const tokenInput = document.getElementById('token');
   const saveButton = document.getElementById('save');
   const statusDiv = document.getElementById('status');
+  const linkFilterInput = document.getElementById('linkFilter');
+  const sendLinksButton = document.getElementById('sendLinks');
 
   // 加载保存的端口号
-  chrome.storage.local.get(['downloaderPort'], function(result) {
+  chrome.storage.local.get(['downloaderPort', 'downloaderToken'], function(result) {
     if (result.downloaderPort) {
       portInput.value = result.downloaderPort;
     } else {
       portInput.placeholder = '8080'; // 默认端口作为占位符
     }
+    if (result.downloaderToken) {
+      tokenInput.value = result.downloaderToken;
+    }
   });
 
   // 保存端口号
@@ -36,7 +42,8 @@ document.addEventListener('DOMContentLoaded', function() {
 
     // 先保存端口（不再强制要求测试成功才能保存），
     // 再异步测试连接并把结果以通知形式告知用户。
-    chrome.storage.local.set({downloaderPort: port}, function() {
+    const token = tokenInput.value.trim();
+    chrome.storage.local.set({downloaderPort: port, downloaderToken: token}, function() {
       if (chrome.runtime.lastError) {
         showStatus(`保存失败: ${chrome.runtime.lastError.message}`, 'error');
         return;
@@ -57,6 +64,29 @@ document.addEventListener('DOMContentLoaded', function() {
     });
   });
 
+  // 把当前页面的链接批量发给下载器（一次 /download/batch，而不是逐条 /download）
+  sendLinksButton.addEventListener('click', function() {
+    sendLinksButton.disabled = true;
+    showStatus('正在收集并发送链接...', 'info');
+    chrome.runtime.sendMessage({action: 'sendPageLinks', extensions: linkFilterInput.value}, function(response) {
+      sendLinksButton.disabled = false;
+      if (chrome.runtime.lastError) {
+        showStatus(`发送失败: ${chrome.runtime.lastError.message}`, 'error');
+        return;
+      }
+      if (!response || !response.success) {
+        showStatus(`发送失败: ${(response && response.error) || '未知错误'}`, 'error');
+        return;
+      }
+      if (response.total === 0) {
+        showStatus('本页没有符合条件的链接', 'error');
+        return;
+      }
+      showStatus(`已发送 ${response.total} 个链接：入队 ${response.accepted}，拒绝 ${response.rejected}`,
+                 response.accepted > 0 ? 'success' : 'error');
+    });
+  });
+
   // 测试与Downloader的连接
   function testConnection(port) {
     return new Promise((resolve, reject) => {